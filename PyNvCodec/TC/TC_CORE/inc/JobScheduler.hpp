@@ -0,0 +1,87 @@
+/*
+ * Copyright 2020 NVIDIA Corporation
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "Numa.hpp"
+#include "TC_CORE.hpp"
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace VPF {
+
+/* Resources job needs while it runs, or node has in total;
+ */
+struct DllExport JobResources {
+  uint32_t cpu_threads = 1U;
+  uint64_t memory_bytes = 0U;
+  uint32_t decoder_sessions = 0U;
+  uint32_t encoder_sessions = 0U;
+
+  bool Fits(const JobResources &available) const;
+  JobResources &operator+=(const JobResources &other);
+  JobResources &operator-=(const JobResources &other);
+};
+
+enum class JobState { JOB_QUEUED, JOB_RUNNING, JOB_DONE, JOB_FAILED };
+
+struct JobInfo {
+  std::string id;
+  int priority = 0;
+  JobResources cost;
+  JobState state = JobState::JOB_QUEUED;
+  std::string error;
+};
+
+/* Runs jobs on shared worker pool, admitting them by declared cost;
+ * Job starts when there's idle worker and enough free resources; Higher
+ * priority goes first, smaller jobs may overtake the blocked one a limited
+ * number of times, so big jobs don't starve;
+ * Job state is appended to journal file, so that after crash or restart
+ * jobs which are done already are skipped;
+ */
+class DllExport JobScheduler {
+public:
+  JobScheduler() = delete;
+  JobScheduler(const JobScheduler &other) = delete;
+  JobScheduler &operator=(const JobScheduler &other) = delete;
+
+  /* Empty journal path means no persistence; Workers are pinned according
+   * to placement;
+   */
+  JobScheduler(const JobResources &capacity, uint32_t num_workers,
+               const std::string &journal,
+               const ThreadPlacement &placement = ThreadPlacement());
+  ~JobScheduler();
+
+  /* Returns false if job is done according to journal and won't run;
+   * Throws std::invalid_argument if id is already submitted;
+   * Job which doesn't fit into node capacity fails immediately;
+   * Exception thrown by job marks it as failed;
+   */
+  bool Submit(const std::string &id, int priority, const JobResources &cost,
+              std::function<void()> job);
+
+  /* Blocks until all submitted jobs are done or failed;
+   */
+  void WaitAll();
+
+  std::vector<JobInfo> GetJobs() const;
+
+private:
+  struct JobScheduler_Impl *pImpl = nullptr;
+};
+
+DllExport const char *JobStateToString(JobState state);
+} // namespace VPF
@@ -0,0 +1,114 @@
+/*
+ * Copyright 2020 NVIDIA Corporation
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "TC_CORE.hpp"
+#include <functional>
+#include <sstream>
+#include <string>
+
+namespace VPF {
+
+enum class LogLevel {
+  LOG_LEVEL_TRACE = 0,
+  LOG_LEVEL_DEBUG = 1,
+  LOG_LEVEL_INFO = 2,
+  LOG_LEVEL_WARNING = 3,
+  LOG_LEVEL_ERROR = 4,
+  LOG_LEVEL_NONE = 5
+};
+
+/* Process-wide logger;
+ * Producers only format message and push it to lock-free bounded queue,
+ * sink is called from dedicated thread so hot paths never touch stdio lock;
+ * If queue is full message is dropped and counted;
+ */
+class DllExport Logger {
+public:
+  using LogSink = std::function<void(LogLevel level, const std::string &comp,
+                                     const std::string &message)>;
+
+  Logger(const Logger &other) = delete;
+  Logger &operator=(const Logger &other) = delete;
+
+  static Logger &Instance();
+
+  /* Sets global level; Messages below it are filtered at producer side;
+   */
+  void SetLevel(LogLevel level);
+
+  LogLevel GetLevel() const;
+
+  /* Overrides global level for given component;
+   */
+  void SetComponentLevel(const std::string &component, LogLevel level);
+
+  void ResetComponentLevels();
+
+  /* Max number of messages per second per component, 0 means no limit;
+   */
+  void SetRateLimit(uint32_t msgs_per_second);
+
+  /* Sets new sink, returns previous one; Empty sink means stderr;
+   * Sink is called from logger thread only, never concurrently;
+   */
+  LogSink SetSink(LogSink sink);
+
+  /* Returns true if message of given level from given component passes
+   * the filters; Cheap, call it before formatting message;
+   */
+  bool IsEnabled(LogLevel level, const char *component) const;
+
+  /* Pushes message to queue; Applies rate limit;
+   */
+  void Write(LogLevel level, const char *component, std::string &&message);
+
+  /* Blocks until all queued messages are passed to sink;
+   */
+  void Flush();
+
+  /* Returns number of messages dropped due to queue overflow or rate limit;
+   */
+  uint64_t GetNumDropped() const;
+
+  static const char *LevelToString(LogLevel level);
+
+private:
+  Logger();
+  ~Logger();
+
+  struct LoggerImpl *pImpl = nullptr;
+};
+
+/* Accumulates message in stream and writes it to logger upon destruction;
+ * Use it via VPF_LOG macro so formatting is skipped for filtered messages;
+ */
+class DllExport LogMessage {
+public:
+  LogMessage(LogLevel level, const char *component);
+  ~LogMessage();
+
+  std::ostream &Stream() { return ss; }
+
+private:
+  LogLevel level;
+  const char *component;
+  std::ostringstream ss;
+};
+} // namespace VPF
+
+#define VPF_LOG(level, component)                                              \
+  if (!VPF::Logger::Instance().IsEnabled(VPF::LogLevel::level, component)) {   \
+  } else                                                                       \
+    VPF::LogMessage(VPF::LogLevel::level, component).Stream()
@@ -0,0 +1,98 @@
+/*
+ * Copyright 2020 NVIDIA Corporation
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "TC_CORE.hpp"
+#include <map>
+#include <string>
+
+namespace VPF {
+
+/* What to do when reservation doesn't fit into budget;
+ * Block waits until other pipelines release memory, drop fails at once so
+ * that caller may skip the frame or shrink its queue;
+ */
+enum class BudgetPolicy { BUDGET_BLOCK, BUDGET_DROP };
+
+/* Memory accounted to single pipeline;
+ */
+struct DllExport MemoryUsage {
+  uint64_t current = 0U;
+  uint64_t peak = 0U;
+  // Reservations which had to wait for memory;
+  uint64_t num_waits = 0U;
+  // Reservations refused by drop policy or timeout;
+  uint64_t num_drops = 0U;
+};
+
+/* Process-wide budget of memory held by pools and inter-stage queues;
+ * They reserve bytes before allocating and release them after freeing, so
+ * total memory stays within the limit regardless of how many pipelines run
+ * and how deep their queues are; Every reservation is accounted to named
+ * pipeline, usage is reported per name;
+ * Waiting reservations are served in order, so large one doesn't starve;
+ * Budget is unlimited until SetLimit() is called;
+ */
+class DllExport MemoryBudget {
+public:
+  MemoryBudget(const MemoryBudget &other) = delete;
+  MemoryBudget &operator=(const MemoryBudget &other) = delete;
+
+  static MemoryBudget &Instance();
+
+  /* Zero means unlimited; Lowering limit doesn't take memory back, new
+   * reservations wait until usage goes below it;
+   */
+  void SetLimit(uint64_t bytes);
+
+  uint64_t GetLimit() const;
+
+  /* Reserves bytes for pipeline; Returns false if they were dropped by
+   * policy or didn't fit within timeout, zero timeout means no timeout;
+   * Reservation bigger than the whole limit is let through once nothing
+   * else is reserved, so it can't wait forever;
+   */
+  bool Reserve(const std::string &pipeline, uint64_t bytes,
+               BudgetPolicy policy = BudgetPolicy::BUDGET_BLOCK,
+               uint32_t timeout_ms = 0U);
+
+  /* Reserves bytes only if they fit right away; Refusal isn't counted as
+   * drop, it's for callers which can wait for memory they already hold;
+   */
+  bool TryReserve(const std::string &pipeline, uint64_t bytes);
+
+  /* Accounts bytes even if they don't fit; It's for memory which can be
+   * neither dropped nor waited for, e.g. when caller itself holds what it
+   * would wait for; Further reservations wait until usage is back within
+   * limit;
+   */
+  void Overcommit(const std::string &pipeline, uint64_t bytes);
+
+  void Release(const std::string &pipeline, uint64_t bytes);
+
+  // Total over all pipelines;
+  MemoryUsage GetTotalUsage() const;
+
+  std::map<std::string, MemoryUsage> GetUsage() const;
+
+  // Resets peaks to current usage and zeroes counters;
+  void ResetStats();
+
+private:
+  MemoryBudget();
+  ~MemoryBudget();
+
+  struct MemoryBudget_Impl *pImpl = nullptr;
+};
+} // namespace VPF
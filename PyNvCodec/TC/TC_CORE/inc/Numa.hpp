@@ -0,0 +1,96 @@
+/*
+ * Copyright 2020 NVIDIA Corporation
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "TC_CORE.hpp"
+#include <vector>
+
+namespace VPF {
+
+/* NUMA node with CPUs process may run on;
+ */
+struct DllExport NumaNode {
+  uint32_t id = 0U;
+  std::vector<uint32_t> cpus;
+  uint64_t memory_bytes = 0U;
+};
+
+/* Returns nodes read from sysfs once per process; Nodes without CPUs
+ * allowed to the process are left out; Where there's no sysfs it's single
+ * node with all CPUs;
+ */
+DllExport const std::vector<NumaNode> &GetNumaNodes();
+
+/* Node of CPU calling thread runs on, or the first node if it's unknown;
+ */
+DllExport uint32_t GetCurrentNumaNode();
+
+enum class PinPolicy {
+  // Threads run wherever scheduler puts them;
+  PIN_NONE,
+  // All threads run on CPUs of single node;
+  PIN_COMPACT,
+  // Threads are dealt to nodes round-robin;
+  PIN_SPREAD,
+  // All threads run on given CPUs;
+  PIN_EXPLICIT
+};
+
+/* Where pipeline threads run; Threads are pinned to node CPU set rather
+ * than single CPU, so pipelines which share node don't fight for the same
+ * cores;
+ */
+struct DllExport ThreadPlacement {
+  PinPolicy policy = PinPolicy::PIN_NONE;
+
+  // Node for compact policy; Negative means node of thread creating pool;
+  int node = -1;
+
+  // CPUs for explicit policy;
+  std::vector<uint32_t> cpus;
+
+  /* Returns CPUs for given thread of pool, empty if it isn't pinned;
+   * Compact node is resolved on calling thread;
+   */
+  std::vector<uint32_t> GetCpus(uint32_t thread_index) const;
+
+  /* Node memory of pipeline should come from, negative if policy doesn't
+   * keep threads on single node;
+   */
+  int GetNode() const;
+};
+
+/* Pins calling thread to given CPUs; Returns false if it's not supported
+ * or CPUs aren't allowed;
+ */
+DllExport bool PinCurrentThread(const std::vector<uint32_t> &cpus);
+
+/* Keeps calling thread on CPUs of given node until destroyed, then
+ * restores its affinity; Memory allocated and first touched meanwhile is
+ * placed on that node by default first-touch policy, pinned host memory
+ * as well; Negative node means no-op;
+ */
+class DllExport NumaNodeScope {
+public:
+  NumaNodeScope() = delete;
+  NumaNodeScope(const NumaNodeScope &other) = delete;
+  NumaNodeScope &operator=(const NumaNodeScope &other) = delete;
+
+  explicit NumaNodeScope(int node);
+  ~NumaNodeScope();
+
+private:
+  std::vector<uint32_t> saved_cpus;
+};
+} // namespace VPF
@@ -0,0 +1,45 @@
+/*
+ * Copyright 2020 NVIDIA Corporation
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "TC_CORE.hpp"
+
+namespace VPF {
+
+/* Snapshot of calling thread performance counters;
+ * HW counters are opened lazily per thread with perf_event_open;
+ */
+struct DllExport PerfSample {
+  uint64_t wall_time_ns = 0U;
+  uint64_t cycles = 0U;
+  uint64_t instructions = 0U;
+  uint64_t llc_misses = 0U;
+  uint64_t branch_misses = 0U;
+  bool hw_counters = false;
+
+  /* Takes snapshot of calling thread counters;
+   */
+  void Read();
+
+  /* Returns difference between this sample and earlier one;
+   */
+  TaskPerfStats operator-(const PerfSample &earlier) const;
+};
+
+/* Adds stats delta to process-wide per task name aggregate;
+ */
+void DllExport AccumulatePerfStats(const char *task_name,
+                                   const TaskPerfStats &delta);
+
+} // namespace VPF
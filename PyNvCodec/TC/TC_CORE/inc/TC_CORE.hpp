@@ -15,6 +15,8 @@
 
 #include "Version.hpp"
 #include <cstdint>
+#include <map>
+#include <string>
 #include <utility>
 
 #if defined(_WIN32)
@@ -41,6 +43,58 @@ protected:
 
 enum class TaskExecStatus { TASK_EXEC_SUCCESS, TASK_EXEC_FAIL };
 
+/* Performance statistics collected around Task::Execute calls;
+ * Wall time is always collected, HW counters are valid only if
+ * hw_counters is true (perf may be restricted or not supported);
+ */
+struct DllExport TaskPerfStats {
+  uint64_t num_calls = 0U;
+  uint64_t wall_time_ns = 0U;
+  uint64_t cycles = 0U;
+  uint64_t instructions = 0U;
+  uint64_t llc_misses = 0U;
+  uint64_t branch_misses = 0U;
+  bool hw_counters = false;
+
+  /* Instructions per cycle;
+   */
+  double IPC() const;
+
+  /* Average values per single Execute call (usually single frame);
+   */
+  double WallTimePerCall() const;
+  double LlcMissesPerCall() const;
+  double BranchMissesPerCall() const;
+
+  TaskPerfStats &operator+=(const TaskPerfStats &other);
+};
+
+/* Turns wall time collection on and off; It's off by default, cost is
+ * couple clock reads per Task::Run call;
+ */
+void DllExport EnableTaskTiming(bool enable);
+
+bool DllExport TaskTimingEnabled();
+
+/* Turns HW performance counters instrumentation on and off; Wall time is
+ * collected as well while it's on;
+ * It's off by default as it adds couple syscalls per Task::Run call;
+ */
+void DllExport EnablePerfCounters(bool enable);
+
+bool DllExport PerfCountersEnabled();
+
+/* Returns true if HW counters can be opened by calling thread,
+ * false otherwise (e. g. perf_event_paranoid is too strict);
+ */
+bool DllExport PerfCountersAvailable();
+
+/* Returns stats accumulated over all Task instances with given name;
+ */
+std::map<std::string, TaskPerfStats> DllExport GetPerfStatsByTaskName();
+
+void DllExport ResetPerfStatsByTaskName();
+
 /* Task is unit of processing; Inherit from this class to add user-defined
  * processing stage;
  */
@@ -56,6 +110,21 @@ public:
    */
   virtual TaskExecStatus Execute() = 0;
 
+  /* Calls Execute and attributes performance counters deltas to task
+   * if instrumentation is enabled; Use it instead of Execute in client code;
+   */
+  TaskExecStatus Run();
+
+  /* Returns performance stats collected by this task instance;
+   */
+  TaskPerfStats GetPerfStats() const;
+
+  void ResetPerfStats();
+
+  /* Returns task name;
+   */
+  const char *GetName() const;
+
   /* Sets given token as input;
    * Doesn't take ownership of object passed by pointer, only stores it
    * within inplementation;
@@ -0,0 +1,57 @@
+/*
+ * Copyright 2020 NVIDIA Corporation
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "Numa.hpp"
+#include "TC_CORE.hpp"
+#include <functional>
+#include <future>
+#include <memory>
+#include <type_traits>
+
+namespace VPF {
+
+/* Fixed size pool of worker threads;
+ * Jobs are executed in FIFO order, exceptions are passed to the future;
+ * Destructor waits for all submitted jobs to complete;
+ * Workers pin themselves according to placement before taking any job;
+ */
+class DllExport ThreadPool {
+public:
+  ThreadPool() = delete;
+  ThreadPool(const ThreadPool &other) = delete;
+  ThreadPool &operator=(const ThreadPool &other) = delete;
+
+  explicit ThreadPool(size_t num_threads,
+                      const ThreadPlacement &placement = ThreadPlacement());
+  ~ThreadPool();
+
+  size_t GetNumThreads() const;
+
+  template <class F>
+  std::future<typename std::result_of<F()>::type> Submit(F &&job) {
+    typedef typename std::result_of<F()>::type result_t;
+    auto task = std::make_shared<std::packaged_task<result_t()>>(
+        std::forward<F>(job));
+    auto result = task->get_future();
+    Enqueue([task]() { (*task)(); });
+    return result;
+  }
+
+private:
+  void Enqueue(std::function<void()> job);
+
+  struct ThreadPool_Impl *pImpl = nullptr;
+};
+} // namespace VPF
@@ -0,0 +1,327 @@
+/*
+ * Copyright 2020 NVIDIA Corporation
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "JobScheduler.hpp"
+#include "Logger.hpp"
+#include "ThreadPool.hpp"
+#include <condition_variable>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+
+using namespace VPF;
+using namespace std;
+
+bool JobResources::Fits(const JobResources &available) const {
+  return cpu_threads <= available.cpu_threads &&
+         memory_bytes <= available.memory_bytes &&
+         decoder_sessions <= available.decoder_sessions &&
+         encoder_sessions <= available.encoder_sessions;
+}
+
+JobResources &JobResources::operator+=(const JobResources &other) {
+  cpu_threads += other.cpu_threads;
+  memory_bytes += other.memory_bytes;
+  decoder_sessions += other.decoder_sessions;
+  encoder_sessions += other.encoder_sessions;
+  return *this;
+}
+
+JobResources &JobResources::operator-=(const JobResources &other) {
+  cpu_threads -= other.cpu_threads;
+  memory_bytes -= other.memory_bytes;
+  decoder_sessions -= other.decoder_sessions;
+  encoder_sessions -= other.encoder_sessions;
+  return *this;
+}
+
+const char *VPF::JobStateToString(JobState state) {
+  switch (state) {
+  case JobState::JOB_QUEUED:
+    return "queued";
+  case JobState::JOB_RUNNING:
+    return "running";
+  case JobState::JOB_DONE:
+    return "done";
+  case JobState::JOB_FAILED:
+    return "failed";
+  default:
+    return "unknown";
+  }
+}
+
+namespace VPF {
+struct JobScheduler_Impl {
+  struct JobRecord {
+    JobInfo info;
+    function<void()> job;
+    // How many times lower priority jobs have overtaken this one;
+    uint32_t bypassed = 0U;
+  };
+
+  JobResources capacity;
+  JobResources available;
+  uint32_t num_workers;
+  uint32_t num_running = 0U;
+
+  string journal_path;
+  unique_ptr<FILE, int (*)(FILE *)> journal;
+  set<string> done_before;
+
+  vector<unique_ptr<JobRecord>> jobs;
+  map<string, size_t> ids;
+  // Indices of queued jobs, by priority and then by submission order;
+  vector<size_t> queue;
+
+  mutable mutex lock;
+  condition_variable cv;
+
+  // Goes last, so that workers are joined before the rest is destroyed;
+  unique_ptr<ThreadPool> pool;
+
+  static const uint32_t maxBypass = 16U;
+
+  JobScheduler_Impl(const JobResources &new_capacity, uint32_t workers,
+                    const string &path, const ThreadPlacement &placement)
+      : capacity(new_capacity), available(new_capacity), num_workers(workers),
+        journal_path(path), journal(nullptr, fclose) {
+    if (!num_workers) {
+      throw invalid_argument("JobScheduler needs at least one worker");
+    }
+
+    if (!journal_path.empty()) {
+      LoadJournal();
+    }
+
+    pool.reset(new ThreadPool(num_workers, placement));
+  }
+
+  /* Journal is tab-separated "state id" lines, the last line of job wins;
+   * It's compacted upon load, only done jobs are kept;
+   */
+  void LoadJournal() {
+    map<string, string> states;
+    {
+      ifstream input(journal_path);
+      string line;
+      while (getline(input, line)) {
+        auto tab = line.find('\t');
+        if (string::npos != tab) {
+          states[line.substr(tab + 1)] = line.substr(0, tab);
+        }
+      }
+    }
+
+    auto const tmp_path = journal_path + ".tmp";
+    {
+      ofstream output(tmp_path, ios::trunc);
+      for (auto &state : states) {
+        if (JobStateToString(JobState::JOB_DONE) == state.second) {
+          output << state.second << "\t" << state.first << "\n";
+          done_before.insert(state.first);
+        }
+      }
+      if (!output) {
+        throw runtime_error("Can't write " + tmp_path);
+      }
+    }
+
+    if (0 != rename(tmp_path.c_str(), journal_path.c_str())) {
+      throw runtime_error("Can't replace " + journal_path);
+    }
+
+    journal.reset(fopen(journal_path.c_str(), "a"));
+    if (!journal) {
+      throw runtime_error("Can't open " + journal_path + " for writing");
+    }
+
+    VPF_LOG(LOG_LEVEL_INFO, "JobScheduler")
+        << done_before.size() << " jobs are done according to "
+        << journal_path;
+  }
+
+  void Journal(const JobInfo &info) {
+    if (journal) {
+      fprintf(journal.get(), "%s\t%s\n", JobStateToString(info.state),
+              info.id.c_str());
+      fflush(journal.get());
+    }
+  }
+
+  void Enqueue(size_t idx) {
+    auto &record = *jobs[idx];
+    auto pos = queue.begin();
+    while (pos != queue.end() &&
+           jobs[*pos]->info.priority >= record.info.priority) {
+      pos++;
+    }
+    queue.insert(pos, idx);
+  }
+
+  /* Called with lock held; Starts as many queued jobs as possible;
+   */
+  void Dispatch() {
+    size_t i = 0U;
+    while (num_running < num_workers && i < queue.size()) {
+      auto idx = queue[i];
+      auto &record = *jobs[idx];
+
+      if (!record.info.cost.Fits(available)) {
+        // Blocked job reserves resources once it's been overtaken enough;
+        if (record.bypassed >= maxBypass) {
+          break;
+        }
+        i++;
+        continue;
+      }
+
+      for (size_t j = 0U; j < i; j++) {
+        jobs[queue[j]]->bypassed++;
+      }
+      queue.erase(queue.begin() + i);
+      Start(idx);
+    }
+  }
+
+  void Start(size_t idx) {
+    auto &record = *jobs[idx];
+    available -= record.info.cost;
+    num_running++;
+    record.info.state = JobState::JOB_RUNNING;
+    Journal(record.info);
+
+    VPF_LOG(LOG_LEVEL_DEBUG, "JobScheduler") << "Starting " << record.info.id;
+    pool->Submit([this, idx]() { Execute(idx); });
+  }
+
+  void Execute(size_t idx) {
+    JobRecord *record = nullptr;
+    {
+      lock_guard<mutex> guard(lock);
+      record = jobs[idx].get();
+    }
+
+    string error;
+    try {
+      record->job();
+    } catch (exception &e) {
+      error = e.what();
+      if (error.empty()) {
+        error = "unknown error";
+      }
+    } catch (...) {
+      error = "unknown error";
+    }
+
+    lock_guard<mutex> guard(lock);
+    available += record->info.cost;
+    num_running--;
+    record->info.error = error;
+    record->info.state =
+        error.empty() ? JobState::JOB_DONE : JobState::JOB_FAILED;
+    record->job = nullptr;
+    Journal(record->info);
+
+    if (error.empty()) {
+      VPF_LOG(LOG_LEVEL_INFO, "JobScheduler") << record->info.id << " done";
+    } else {
+      VPF_LOG(LOG_LEVEL_ERROR, "JobScheduler")
+          << record->info.id << " failed: " << error;
+    }
+
+    Dispatch();
+    cv.notify_all();
+  }
+
+  bool Submit(const string &id, int priority, const JobResources &cost,
+              function<void()> job) {
+    if (id.empty() || string::npos != id.find_first_of("\t\n")) {
+      throw invalid_argument("Job id must be non-empty single line "
+                             "without tabs");
+    }
+
+    lock_guard<mutex> guard(lock);
+    if (ids.count(id)) {
+      throw invalid_argument("Job " + id + " is already submitted");
+    }
+
+    unique_ptr<JobRecord> record(new JobRecord());
+    record->info.id = id;
+    record->info.priority = priority;
+    record->info.cost = cost;
+    record->job = move(job);
+
+    auto const idx = jobs.size();
+    ids[id] = idx;
+    jobs.push_back(move(record));
+    auto &info = jobs[idx]->info;
+
+    if (done_before.count(id)) {
+      info.state = JobState::JOB_DONE;
+      jobs[idx]->job = nullptr;
+      return false;
+    }
+
+    if (!cost.Fits(capacity)) {
+      info.state = JobState::JOB_FAILED;
+      info.error = "job cost exceeds node capacity";
+      jobs[idx]->job = nullptr;
+      Journal(info);
+      VPF_LOG(LOG_LEVEL_ERROR, "JobScheduler")
+          << id << " failed: " << info.error;
+      return true;
+    }
+
+    Enqueue(idx);
+    Journal(info);
+    Dispatch();
+    return true;
+  }
+
+  void WaitAll() {
+    unique_lock<mutex> guard(lock);
+    cv.wait(guard, [this]() { return queue.empty() && !num_running; });
+  }
+};
+} // namespace VPF
+
+JobScheduler::JobScheduler(const JobResources &capacity, uint32_t num_workers,
+                           const string &journal,
+                           const ThreadPlacement &placement)
+    : pImpl(new JobScheduler_Impl(capacity, num_workers, journal,
+                                  placement)) {}
+
+JobScheduler::~JobScheduler() {
+  WaitAll();
+  delete pImpl;
+}
+
+bool JobScheduler::Submit(const string &id, int priority,
+                          const JobResources &cost, function<void()> job) {
+  return pImpl->Submit(id, priority, cost, move(job));
+}
+
+void JobScheduler::WaitAll() { pImpl->WaitAll(); }
+
+vector<JobInfo> JobScheduler::GetJobs() const {
+  lock_guard<mutex> guard(pImpl->lock);
+  vector<JobInfo> infos;
+  for (auto &record : pImpl->jobs) {
+    infos.push_back(record->info);
+  }
+  return infos;
+}
@@ -0,0 +1,348 @@
+/*
+ * Copyright 2020 NVIDIA Corporation
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "Logger.hpp"
+
+using namespace std;
+using namespace VPF;
+
+namespace VPF {
+
+struct LogRecord {
+  LogLevel level = LogLevel::LOG_LEVEL_NONE;
+  string component;
+  string message;
+};
+
+/* Bounded multi-producer queue;
+ * Every cell has sequence number which tells producers and consumer whether
+ * cell is free or occupied, so no locks are taken on either side;
+ */
+class LogQueue {
+public:
+  explicit LogQueue(size_t capacity_pow2)
+      : cells(new Cell[capacity_pow2]), mask(capacity_pow2 - 1U) {
+    for (size_t i = 0U; i < capacity_pow2; i++) {
+      cells[i].sequence.store(i, memory_order_relaxed);
+    }
+    enqueue_pos.store(0U, memory_order_relaxed);
+    dequeue_pos.store(0U, memory_order_relaxed);
+  }
+
+  bool Push(LogRecord &&record) {
+    Cell *cell = nullptr;
+    auto pos = enqueue_pos.load(memory_order_relaxed);
+    while (true) {
+      cell = &cells[pos & mask];
+      auto seq = cell->sequence.load(memory_order_acquire);
+      auto diff = (intptr_t)seq - (intptr_t)pos;
+      if (0 == diff) {
+        if (enqueue_pos.compare_exchange_weak(pos, pos + 1U,
+                                              memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        // Queue is full;
+        return false;
+      } else {
+        pos = enqueue_pos.load(memory_order_relaxed);
+      }
+    }
+
+    cell->record = move(record);
+    cell->sequence.store(pos + 1U, memory_order_release);
+    return true;
+  }
+
+  bool Pop(LogRecord &record) {
+    Cell *cell = nullptr;
+    auto pos = dequeue_pos.load(memory_order_relaxed);
+    while (true) {
+      cell = &cells[pos & mask];
+      auto seq = cell->sequence.load(memory_order_acquire);
+      auto diff = (intptr_t)seq - (intptr_t)(pos + 1U);
+      if (0 == diff) {
+        if (dequeue_pos.compare_exchange_weak(pos, pos + 1U,
+                                              memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        // Queue is empty;
+        return false;
+      } else {
+        pos = dequeue_pos.load(memory_order_relaxed);
+      }
+    }
+
+    record = move(cell->record);
+    cell->sequence.store(pos + mask + 1U, memory_order_release);
+    return true;
+  }
+
+private:
+  struct Cell {
+    atomic<size_t> sequence;
+    LogRecord record;
+  };
+
+  unique_ptr<Cell[]> cells;
+  size_t const mask;
+  atomic<size_t> enqueue_pos;
+  atomic<size_t> dequeue_pos;
+};
+
+/* Fixed amount of per-component message counters;
+ * Components are hashed into slots so there's no allocation or locking,
+ * collisions just make limit slightly stricter;
+ */
+struct RateLimiter {
+  static const size_t num_slots = 64U;
+
+  struct Slot {
+    atomic<int64_t> second;
+    atomic<uint32_t> count;
+  };
+
+  Slot slots[num_slots];
+  atomic<uint32_t> limit;
+
+  RateLimiter() {
+    for (auto &slot : slots) {
+      slot.second.store(-1);
+      slot.count.store(0U);
+    }
+    limit.store(0U);
+  }
+
+  bool Allow(const char *component) {
+    auto const max_msgs = limit.load(memory_order_relaxed);
+    if (!max_msgs) {
+      return true;
+    }
+
+    auto &slot = slots[hash<string>()(component) % num_slots];
+    auto const now = chrono::duration_cast<chrono::seconds>(
+                         chrono::steady_clock::now().time_since_epoch())
+                         .count();
+
+    auto second = slot.second.load(memory_order_relaxed);
+    if (second != now &&
+        slot.second.compare_exchange_strong(second, now)) {
+      slot.count.store(0U, memory_order_relaxed);
+    }
+
+    return slot.count.fetch_add(1U, memory_order_relaxed) < max_msgs;
+  }
+};
+
+struct LoggerImpl {
+  static const size_t queue_size = 4096U;
+
+  LogQueue queue;
+  RateLimiter rate_limiter;
+
+  atomic<int> level;
+  atomic<bool> has_component_levels;
+  mutable mutex component_levels_mutex;
+  map<string, LogLevel> component_levels;
+
+  mutex sink_mutex;
+  Logger::LogSink sink;
+
+  atomic<uint64_t> num_pushed;
+  atomic<uint64_t> num_processed;
+  atomic<uint64_t> num_dropped;
+
+  mutex wake_mutex;
+  condition_variable wake_cv;
+  atomic<bool> is_sleeping;
+  atomic<bool> stop;
+  thread worker;
+
+  LoggerImpl() : queue(queue_size) {
+    level.store((int)LogLevel::LOG_LEVEL_INFO);
+    has_component_levels.store(false);
+    num_pushed.store(0U);
+    num_processed.store(0U);
+    num_dropped.store(0U);
+    is_sleeping.store(false);
+    stop.store(false);
+    worker = thread(&LoggerImpl::Run, this);
+  }
+
+  ~LoggerImpl() {
+    stop.store(true);
+    wake_cv.notify_one();
+    if (worker.joinable()) {
+      worker.join();
+    }
+  }
+
+  static void WriteToStderr(LogLevel level, const string &component,
+                            const string &message) {
+    fprintf(stderr, "[VPF][%s][%s] %s\n", Logger::LevelToString(level),
+            component.c_str(), message.c_str());
+  }
+
+  void Consume(const LogRecord &record) {
+    lock_guard<mutex> lock(sink_mutex);
+    try {
+      if (sink) {
+        sink(record.level, record.component, record.message);
+      } else {
+        WriteToStderr(record.level, record.component, record.message);
+      }
+    } catch (...) {
+      // Sink must not kill logger thread;
+    }
+  }
+
+  void Run() {
+    LogRecord record;
+    while (true) {
+      if (queue.Pop(record)) {
+        Consume(record);
+        num_processed++;
+        continue;
+      }
+
+      if (stop.load()) {
+        break;
+      }
+
+      /* Producers don't take the lock, so wake up may be missed;
+       * Timeout bounds the latency in that case;
+       */
+      unique_lock<mutex> lock(wake_mutex);
+      is_sleeping.store(true);
+      wake_cv.wait_for(lock, chrono::milliseconds(5));
+      is_sleeping.store(false);
+    }
+  }
+};
+} // namespace VPF
+
+Logger::Logger() : pImpl(new LoggerImpl()) {}
+
+Logger::~Logger() { delete pImpl; }
+
+Logger &Logger::Instance() {
+  static Logger instance;
+  return instance;
+}
+
+void Logger::SetLevel(LogLevel level) { pImpl->level.store((int)level); }
+
+LogLevel Logger::GetLevel() const { return (LogLevel)pImpl->level.load(); }
+
+void Logger::SetComponentLevel(const string &component, LogLevel level) {
+  lock_guard<mutex> lock(pImpl->component_levels_mutex);
+  pImpl->component_levels[component] = level;
+  pImpl->has_component_levels.store(true);
+}
+
+void Logger::ResetComponentLevels() {
+  lock_guard<mutex> lock(pImpl->component_levels_mutex);
+  pImpl->component_levels.clear();
+  pImpl->has_component_levels.store(false);
+}
+
+void Logger::SetRateLimit(uint32_t msgs_per_second) {
+  pImpl->rate_limiter.limit.store(msgs_per_second);
+}
+
+Logger::LogSink Logger::SetSink(LogSink sink) {
+  lock_guard<mutex> lock(pImpl->sink_mutex);
+  swap(sink, pImpl->sink);
+  return sink;
+}
+
+bool Logger::IsEnabled(LogLevel level, const char *component) const {
+  if (pImpl->has_component_levels.load(memory_order_relaxed) && component) {
+    lock_guard<mutex> lock(pImpl->component_levels_mutex);
+    auto it = pImpl->component_levels.find(component);
+    if (it != pImpl->component_levels.end()) {
+      return LogLevel::LOG_LEVEL_NONE != level && level >= it->second;
+    }
+  }
+
+  return LogLevel::LOG_LEVEL_NONE != level &&
+         (int)level >= pImpl->level.load(memory_order_relaxed);
+}
+
+void Logger::Write(LogLevel level, const char *component, string &&message) {
+  component = component ? component : "";
+
+  if (!pImpl->rate_limiter.Allow(component)) {
+    pImpl->num_dropped++;
+    return;
+  }
+
+  LogRecord record;
+  record.level = level;
+  record.component = component;
+  record.message = move(message);
+
+  if (!pImpl->queue.Push(move(record))) {
+    pImpl->num_dropped++;
+    return;
+  }
+
+  pImpl->num_pushed++;
+  if (pImpl->is_sleeping.load(memory_order_relaxed)) {
+    pImpl->wake_cv.notify_one();
+  }
+}
+
+void Logger::Flush() {
+  auto const target = pImpl->num_pushed.load();
+  while (pImpl->num_processed.load() < target) {
+    pImpl->wake_cv.notify_one();
+    this_thread::sleep_for(chrono::microseconds(100));
+  }
+}
+
+uint64_t Logger::GetNumDropped() const { return pImpl->num_dropped.load(); }
+
+const char *Logger::LevelToString(LogLevel level) {
+  switch (level) {
+  case LogLevel::LOG_LEVEL_TRACE:
+    return "TRACE";
+  case LogLevel::LOG_LEVEL_DEBUG:
+    return "DEBUG";
+  case LogLevel::LOG_LEVEL_INFO:
+    return "INFO";
+  case LogLevel::LOG_LEVEL_WARNING:
+    return "WARNING";
+  case LogLevel::LOG_LEVEL_ERROR:
+    return "ERROR";
+  default:
+    return "NONE";
+  }
+}
+
+LogMessage::LogMessage(LogLevel log_level, const char *log_component)
+    : level(log_level), component(log_component) {}
+
+LogMessage::~LogMessage() {
+  Logger::Instance().Write(level, component, ss.str());
+}
@@ -0,0 +1,191 @@
+/*
+ * Copyright 2020 NVIDIA Corporation
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+#include "Logger.hpp"
+#include "MemoryBudget.hpp"
+
+using namespace std;
+using namespace VPF;
+
+namespace VPF {
+struct MemoryBudget_Impl {
+  mutable mutex mtx;
+  condition_variable cv;
+
+  uint64_t limit = 0U;
+  MemoryUsage total;
+  map<string, MemoryUsage> usage;
+
+  // Tickets of blocked reservations, the first one is served first;
+  deque<uint64_t> waiters;
+  uint64_t next_ticket = 0U;
+
+  bool Fits(uint64_t bytes) const {
+    return !limit || !total.current || total.current + bytes <= limit;
+  }
+
+  void Account(MemoryUsage &pipeline, uint64_t bytes) {
+    pipeline.current += bytes;
+    pipeline.peak = max(pipeline.peak, pipeline.current);
+    total.current += bytes;
+    total.peak = max(total.peak, total.current);
+  }
+
+  bool Reserve(const string &name, uint64_t bytes, BudgetPolicy policy,
+               uint32_t timeout_ms) {
+    unique_lock<mutex> lock(mtx);
+    auto &pipeline = usage[name];
+
+    if (waiters.empty() && Fits(bytes)) {
+      Account(pipeline, bytes);
+      return true;
+    }
+
+    if (BudgetPolicy::BUDGET_DROP == policy) {
+      pipeline.num_drops++;
+      total.num_drops++;
+      return false;
+    }
+
+    pipeline.num_waits++;
+    total.num_waits++;
+
+    auto const ticket = next_ticket++;
+    waiters.push_back(ticket);
+    auto ready = [&]() { return ticket == waiters.front() && Fits(bytes); };
+
+    auto success = true;
+    if (timeout_ms) {
+      success = cv.wait_for(lock, chrono::milliseconds(timeout_ms), ready);
+    } else {
+      cv.wait(lock, ready);
+    }
+
+    // Whoever is next may fit as well;
+    waiters.erase(find(waiters.begin(), waiters.end(), ticket));
+    cv.notify_all();
+
+    if (!success) {
+      pipeline.num_drops++;
+      total.num_drops++;
+      VPF_LOG(LOG_LEVEL_DEBUG, "MemoryBudget")
+          << name << ": " << bytes << " bytes didn't fit within "
+          << timeout_ms << " ms";
+      return false;
+    }
+
+    Account(pipeline, bytes);
+    return true;
+  }
+
+  bool TryReserve(const string &name, uint64_t bytes) {
+    lock_guard<mutex> lock(mtx);
+    if (!waiters.empty() || !Fits(bytes)) {
+      return false;
+    }
+    Account(usage[name], bytes);
+    return true;
+  }
+
+  void Overcommit(const string &name, uint64_t bytes) {
+    lock_guard<mutex> lock(mtx);
+    if (!Fits(bytes)) {
+      VPF_LOG(LOG_LEVEL_DEBUG, "MemoryBudget")
+          << name << ": " << bytes << " bytes overcommitted";
+    }
+    Account(usage[name], bytes);
+  }
+
+  void Release(const string &name, uint64_t bytes) {
+    lock_guard<mutex> lock(mtx);
+    auto &pipeline = usage[name];
+    if (bytes > pipeline.current) {
+      VPF_LOG(LOG_LEVEL_ERROR, "MemoryBudget")
+          << name << " releases " << bytes << " bytes but holds only "
+          << pipeline.current;
+      bytes = pipeline.current;
+    }
+
+    pipeline.current -= bytes;
+    total.current -= bytes;
+    if (!waiters.empty()) {
+      cv.notify_all();
+    }
+  }
+};
+} // namespace VPF
+
+MemoryBudget &MemoryBudget::Instance() {
+  static MemoryBudget budget;
+  return budget;
+}
+
+MemoryBudget::MemoryBudget() { pImpl = new MemoryBudget_Impl(); }
+
+MemoryBudget::~MemoryBudget() { delete pImpl; }
+
+void MemoryBudget::SetLimit(uint64_t bytes) {
+  lock_guard<mutex> lock(pImpl->mtx);
+  pImpl->limit = bytes;
+  pImpl->cv.notify_all();
+}
+
+uint64_t MemoryBudget::GetLimit() const {
+  lock_guard<mutex> lock(pImpl->mtx);
+  return pImpl->limit;
+}
+
+bool MemoryBudget::Reserve(const string &pipeline, uint64_t bytes,
+                           BudgetPolicy policy, uint32_t timeout_ms) {
+  return pImpl->Reserve(pipeline, bytes, policy, timeout_ms);
+}
+
+bool MemoryBudget::TryReserve(const string &pipeline, uint64_t bytes) {
+  return pImpl->TryReserve(pipeline, bytes);
+}
+
+void MemoryBudget::Overcommit(const string &pipeline, uint64_t bytes) {
+  pImpl->Overcommit(pipeline, bytes);
+}
+
+void MemoryBudget::Release(const string &pipeline, uint64_t bytes) {
+  pImpl->Release(pipeline, bytes);
+}
+
+MemoryUsage MemoryBudget::GetTotalUsage() const {
+  lock_guard<mutex> lock(pImpl->mtx);
+  return pImpl->total;
+}
+
+map<string, MemoryUsage> MemoryBudget::GetUsage() const {
+  lock_guard<mutex> lock(pImpl->mtx);
+  return pImpl->usage;
+}
+
+void MemoryBudget::ResetStats() {
+  lock_guard<mutex> lock(pImpl->mtx);
+  for (auto &it : pImpl->usage) {
+    it.second.peak = it.second.current;
+    it.second.num_waits = 0U;
+    it.second.num_drops = 0U;
+  }
+  pImpl->total.peak = pImpl->total.current;
+  pImpl->total.num_waits = 0U;
+  pImpl->total.num_drops = 0U;
+}
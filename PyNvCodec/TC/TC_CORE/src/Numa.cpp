@@ -0,0 +1,261 @@
+/*
+ * Copyright 2020 NVIDIA Corporation
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include "Logger.hpp"
+#include "Numa.hpp"
+
+#if defined(__linux__)
+#include <dirent.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+using namespace VPF;
+
+namespace {
+#if defined(__linux__)
+// Parses sysfs list like 0-63,128-191;
+vector<uint32_t> ParseCpuList(const string &list) {
+  vector<uint32_t> cpus;
+  stringstream ss(list);
+  string range;
+  while (getline(ss, range, ',')) {
+    if (range.empty() || !isdigit((unsigned char)range[0])) {
+      continue;
+    }
+    auto const dash = range.find('-');
+    auto const first = (uint32_t)strtoul(range.c_str(), nullptr, 10);
+    auto const last =
+        (string::npos == dash)
+            ? first
+            : (uint32_t)strtoul(range.c_str() + dash + 1U, nullptr, 10);
+    for (auto cpu = first; cpu <= last; cpu++) {
+      cpus.push_back(cpu);
+    }
+  }
+  return cpus;
+}
+
+uint64_t ReadNodeMemory(const string &node_dir) {
+  ifstream meminfo(node_dir + "/meminfo");
+  string line;
+  while (getline(meminfo, line)) {
+    // Node 0 MemTotal:       263842732 kB
+    auto const pos = line.find("MemTotal:");
+    if (string::npos != pos) {
+      return strtoull(line.c_str() + pos + 9U, nullptr, 10) * 1024U;
+    }
+  }
+  return 0U;
+}
+
+vector<NumaNode> ReadNodes() {
+  vector<NumaNode> nodes;
+
+  cpu_set_t allowed;
+  CPU_ZERO(&allowed);
+  auto const have_mask = !sched_getaffinity(0, sizeof(allowed), &allowed);
+
+  const string sysfs = "/sys/devices/system/node";
+  auto dir = opendir(sysfs.c_str());
+  if (!dir) {
+    return nodes;
+  }
+
+  while (auto entry = readdir(dir)) {
+    if (strncmp(entry->d_name, "node", 4U) ||
+        !isdigit((unsigned char)entry->d_name[4])) {
+      continue;
+    }
+
+    NumaNode node;
+    node.id = (uint32_t)strtoul(entry->d_name + 4U, nullptr, 10);
+    auto const node_dir = sysfs + "/" + entry->d_name;
+
+    ifstream cpulist(node_dir + "/cpulist");
+    string list;
+    getline(cpulist, list);
+    for (auto cpu : ParseCpuList(list)) {
+      if (!have_mask || (cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowed))) {
+        node.cpus.push_back(cpu);
+      }
+    }
+    if (node.cpus.empty()) {
+      continue;
+    }
+
+    node.memory_bytes = ReadNodeMemory(node_dir);
+    nodes.push_back(node);
+  }
+  closedir(dir);
+
+  sort(nodes.begin(), nodes.end(),
+       [](const NumaNode &a, const NumaNode &b) { return a.id < b.id; });
+  return nodes;
+}
+#else
+vector<NumaNode> ReadNodes() { return vector<NumaNode>(); }
+#endif
+
+vector<NumaNode> DiscoverNodes() {
+  auto nodes = ReadNodes();
+  if (nodes.empty()) {
+    NumaNode node;
+    auto const num_cpus = max(thread::hardware_concurrency(), 1U);
+    for (auto cpu = 0U; cpu < num_cpus; cpu++) {
+      node.cpus.push_back(cpu);
+    }
+    nodes.push_back(node);
+  }
+
+  for (auto &node : nodes) {
+    VPF_LOG(LOG_LEVEL_DEBUG, "Numa")
+        << "Node " << node.id << ": " << node.cpus.size() << " CPUs, "
+        << (node.memory_bytes >> 20U) << " MiB";
+  }
+  return nodes;
+}
+
+const NumaNode &FindNode(int id) {
+  auto &nodes = GetNumaNodes();
+  for (auto &node : nodes) {
+    if ((int)node.id == id) {
+      return node;
+    }
+  }
+
+  VPF_LOG(LOG_LEVEL_WARNING, "Numa")
+      << "No NUMA node " << id << ", using node " << nodes.front().id;
+  return nodes.front();
+}
+} // namespace
+
+namespace VPF {
+const vector<NumaNode> &GetNumaNodes() {
+  static const vector<NumaNode> nodes = DiscoverNodes();
+  return nodes;
+}
+
+uint32_t GetCurrentNumaNode() {
+  auto &nodes = GetNumaNodes();
+#if defined(__linux__)
+  auto const cpu = sched_getcpu();
+  for (auto &node : nodes) {
+    if (cpu >= 0 &&
+        find(node.cpus.begin(), node.cpus.end(), (uint32_t)cpu) !=
+            node.cpus.end()) {
+      return node.id;
+    }
+  }
+#endif
+  return nodes.front().id;
+}
+
+vector<uint32_t> ThreadPlacement::GetCpus(uint32_t thread_index) const {
+  switch (policy) {
+  case PinPolicy::PIN_COMPACT:
+    return FindNode(GetNode()).cpus;
+  case PinPolicy::PIN_SPREAD: {
+    auto &nodes = GetNumaNodes();
+    return nodes[thread_index % nodes.size()].cpus;
+  }
+  case PinPolicy::PIN_EXPLICIT:
+    return cpus;
+  default:
+    return vector<uint32_t>();
+  }
+}
+
+int ThreadPlacement::GetNode() const {
+  switch (policy) {
+  case PinPolicy::PIN_COMPACT:
+    return node < 0 ? (int)GetCurrentNumaNode() : node;
+  case PinPolicy::PIN_SPREAD:
+    return GetNumaNodes().size() > 1U ? -1 : (int)GetNumaNodes()[0].id;
+  case PinPolicy::PIN_EXPLICIT:
+    // Single node only if all CPUs belong to it;
+    for (auto &numa_node : GetNumaNodes()) {
+      auto const all = !cpus.empty() &&
+                       all_of(cpus.begin(), cpus.end(), [&](uint32_t cpu) {
+                         return find(numa_node.cpus.begin(),
+                                     numa_node.cpus.end(),
+                                     cpu) != numa_node.cpus.end();
+                       });
+      if (all) {
+        return (int)numa_node.id;
+      }
+    }
+    return -1;
+  default:
+    return -1;
+  }
+}
+
+bool PinCurrentThread(const vector<uint32_t> &cpus) {
+  if (cpus.empty()) {
+    return false;
+  }
+#if defined(__linux__)
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (auto cpu : cpus) {
+    if (cpu < CPU_SETSIZE) {
+      CPU_SET(cpu, &set);
+    }
+  }
+  return !pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+  return false;
+#endif
+}
+
+NumaNodeScope::NumaNodeScope(int node) {
+  if (node < 0 || GetNumaNodes().size() < 2U) {
+    return;
+  }
+#if defined(__linux__)
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  if (pthread_getaffinity_np(pthread_self(), sizeof(set), &set)) {
+    return;
+  }
+  vector<uint32_t> cpus;
+  for (uint32_t cpu = 0U; cpu < CPU_SETSIZE; cpu++) {
+    if (CPU_ISSET(cpu, &set)) {
+      cpus.push_back(cpu);
+    }
+  }
+
+  if (PinCurrentThread(FindNode(node).cpus)) {
+    saved_cpus.swap(cpus);
+  }
+#endif
+}
+
+NumaNodeScope::~NumaNodeScope() {
+  if (!saved_cpus.empty()) {
+    PinCurrentThread(saved_cpus);
+  }
+}
+} // namespace VPF
@@ -0,0 +1,211 @@
+/*
+ * Copyright 2020 NVIDIA Corporation
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+
+#include "PerfCounters.hpp"
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+using namespace VPF;
+
+namespace VPF {
+
+static atomic<bool> gTaskTimingEnabled(false);
+static atomic<bool> gPerfCountersEnabled(false);
+static mutex gPerfStatsMutex;
+static map<string, TaskPerfStats> gPerfStatsByName;
+
+#if defined(__linux__)
+/* Group of per-thread HW counters;
+ * Cycles counter is group leader so all counters are read with single
+ * read() syscall;
+ */
+class PerfEventGroup {
+public:
+  enum { CYCLES = 0, INSTRUCTIONS, LLC_MISSES, BRANCH_MISSES, NUM_EVENTS };
+
+  PerfEventGroup() {
+    const uint64_t configs[NUM_EVENTS] = {
+        PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+
+    for (auto i = 0; i < NUM_EVENTS; i++) {
+      perf_event_attr attr = {};
+      attr.type = PERF_TYPE_HARDWARE;
+      attr.size = sizeof(attr);
+      attr.config = configs[i];
+      attr.disabled = (0 == i) ? 1 : 0;
+      // User space only, so it works with perf_event_paranoid == 2;
+      attr.exclude_kernel = 1;
+      attr.exclude_hv = 1;
+      attr.read_format = PERF_FORMAT_GROUP;
+
+      // Count calling thread on any CPU;
+      auto fd = (int)syscall(__NR_perf_event_open, &attr, 0, -1,
+                             (0 == i) ? -1 : fds[CYCLES], 0);
+      if (fd < 0) {
+        Close();
+        return;
+      }
+      fds[i] = fd;
+    }
+
+    ioctl(fds[CYCLES], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(fds[CYCLES], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    is_open = true;
+  }
+
+  ~PerfEventGroup() { Close(); }
+
+  bool IsOpen() const { return is_open; }
+
+  bool Read(uint64_t (&values)[NUM_EVENTS]) {
+    if (!is_open) {
+      return false;
+    }
+
+    // Group read format: number of events followed by values;
+    uint64_t buf[NUM_EVENTS + 1] = {0};
+    auto ret = read(fds[CYCLES], buf, sizeof(buf));
+    if (ret != (ssize_t)sizeof(buf) || NUM_EVENTS != buf[0]) {
+      return false;
+    }
+
+    for (auto i = 0; i < NUM_EVENTS; i++) {
+      values[i] = buf[i + 1];
+    }
+    return true;
+  }
+
+private:
+  void Close() {
+    for (auto &fd : fds) {
+      if (fd >= 0) {
+        close(fd);
+        fd = -1;
+      }
+    }
+    is_open = false;
+  }
+
+  int fds[NUM_EVENTS] = {-1, -1, -1, -1};
+  bool is_open = false;
+};
+
+static PerfEventGroup &GetThreadPerfEventGroup() {
+  static thread_local PerfEventGroup group;
+  return group;
+}
+#endif
+} // namespace VPF
+
+double TaskPerfStats::IPC() const {
+  return cycles ? (double)instructions / (double)cycles : 0.0;
+}
+
+double TaskPerfStats::WallTimePerCall() const {
+  return num_calls ? (double)wall_time_ns / (double)num_calls : 0.0;
+}
+
+double TaskPerfStats::LlcMissesPerCall() const {
+  return num_calls ? (double)llc_misses / (double)num_calls : 0.0;
+}
+
+double TaskPerfStats::BranchMissesPerCall() const {
+  return num_calls ? (double)branch_misses / (double)num_calls : 0.0;
+}
+
+TaskPerfStats &TaskPerfStats::operator+=(const TaskPerfStats &other) {
+  // HW counters are valid only if every accumulated delta had them;
+  hw_counters = num_calls ? (hw_counters && other.hw_counters)
+                          : other.hw_counters;
+  num_calls += other.num_calls;
+  wall_time_ns += other.wall_time_ns;
+  cycles += other.cycles;
+  instructions += other.instructions;
+  llc_misses += other.llc_misses;
+  branch_misses += other.branch_misses;
+  return *this;
+}
+
+void PerfSample::Read() {
+  auto now = chrono::steady_clock::now().time_since_epoch();
+  wall_time_ns = chrono::duration_cast<chrono::nanoseconds>(now).count();
+  hw_counters = false;
+
+#if defined(__linux__)
+  uint64_t values[PerfEventGroup::NUM_EVENTS] = {0};
+  if (PerfCountersEnabled() && GetThreadPerfEventGroup().Read(values)) {
+    cycles = values[PerfEventGroup::CYCLES];
+    instructions = values[PerfEventGroup::INSTRUCTIONS];
+    llc_misses = values[PerfEventGroup::LLC_MISSES];
+    branch_misses = values[PerfEventGroup::BRANCH_MISSES];
+    hw_counters = true;
+  }
+#endif
+}
+
+TaskPerfStats PerfSample::operator-(const PerfSample &earlier) const {
+  TaskPerfStats delta;
+  delta.num_calls = 1U;
+  delta.wall_time_ns = wall_time_ns - earlier.wall_time_ns;
+  delta.hw_counters = hw_counters && earlier.hw_counters;
+  if (delta.hw_counters) {
+    delta.cycles = cycles - earlier.cycles;
+    delta.instructions = instructions - earlier.instructions;
+    delta.llc_misses = llc_misses - earlier.llc_misses;
+    delta.branch_misses = branch_misses - earlier.branch_misses;
+  }
+  return delta;
+}
+
+void VPF::AccumulatePerfStats(const char *task_name,
+                              const TaskPerfStats &delta) {
+  lock_guard<mutex> lock(gPerfStatsMutex);
+  gPerfStatsByName[task_name] += delta;
+}
+
+void VPF::EnableTaskTiming(bool enable) { gTaskTimingEnabled = enable; }
+
+bool VPF::TaskTimingEnabled() { return gTaskTimingEnabled; }
+
+void VPF::EnablePerfCounters(bool enable) { gPerfCountersEnabled = enable; }
+
+bool VPF::PerfCountersEnabled() { return gPerfCountersEnabled; }
+
+bool VPF::PerfCountersAvailable() {
+#if defined(__linux__)
+  return GetThreadPerfEventGroup().IsOpen();
+#else
+  return false;
+#endif
+}
+
+map<string, TaskPerfStats> VPF::GetPerfStatsByTaskName() {
+  lock_guard<mutex> lock(gPerfStatsMutex);
+  return gPerfStatsByName;
+}
+
+void VPF::ResetPerfStatsByTaskName() {
+  lock_guard<mutex> lock(gPerfStatsMutex);
+  gPerfStatsByName.clear();
+}
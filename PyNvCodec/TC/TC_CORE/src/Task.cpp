@@ -16,6 +16,7 @@
 #include <vector>
 #include <string>
 
+#include "PerfCounters.hpp"
 #include "TC_CORE.hpp"
 
 using namespace std;
@@ -26,6 +27,7 @@ struct TaskImpl {
   string name;
   vector<Token *> inputs;
   vector<Token *> outputs;
+  TaskPerfStats perf_stats;
 
   TaskImpl() = delete;
   TaskImpl(const TaskImpl &other) = delete;
@@ -86,6 +88,40 @@ Token *Task::GetOutput(uint32_t num_output) {
 
 Task::~Task() { delete p_impl; }
 
+TaskExecStatus Task::Run() {
+  if (!TaskTimingEnabled() && !PerfCountersEnabled()) {
+    return Execute();
+  }
+
+  /* Counters are read in destructor so deltas are attributed even if
+   * Execute throws;
+   */
+  struct PerfScope {
+    TaskImpl &impl;
+    PerfSample begin;
+
+    explicit PerfScope(TaskImpl &task_impl) : impl(task_impl) {
+      begin.Read();
+    }
+
+    ~PerfScope() {
+      PerfSample end;
+      end.Read();
+      auto delta = end - begin;
+      impl.perf_stats += delta;
+      AccumulatePerfStats(impl.name.c_str(), delta);
+    }
+  } scope(*p_impl);
+
+  return Execute();
+}
+
+TaskPerfStats Task::GetPerfStats() const { return p_impl->perf_stats; }
+
+void Task::ResetPerfStats() { p_impl->perf_stats = TaskPerfStats(); }
+
+const char *Task::GetName() const { return p_impl->name.c_str(); }
+
 size_t Task::GetNumOutputs() const { return p_impl->outputs.size(); }
 
 size_t Task::GetNumInputs() const { return p_impl->inputs.size(); }
\ No newline at end of file
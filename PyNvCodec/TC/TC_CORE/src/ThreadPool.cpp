@@ -0,0 +1,99 @@
+/*
+ * Copyright 2020 NVIDIA Corporation
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Logger.hpp"
+#include "ThreadPool.hpp"
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+using namespace VPF;
+using namespace std;
+
+namespace VPF {
+struct ThreadPool_Impl {
+  vector<thread> workers;
+  deque<function<void()>> jobs;
+  mutex lock;
+  condition_variable cv;
+  bool stop = false;
+
+  void Work(vector<uint32_t> cpus) {
+    if (!cpus.empty() && !PinCurrentThread(cpus)) {
+      VPF_LOG(LOG_LEVEL_WARNING, "ThreadPool")
+          << "Can't pin worker to " << cpus.size() << " CPUs starting at "
+          << cpus.front();
+    }
+
+    for (;;) {
+      function<void()> job;
+      {
+        unique_lock<mutex> guard(lock);
+        cv.wait(guard, [this]() { return stop || !jobs.empty(); });
+        if (jobs.empty()) {
+          return;
+        }
+        job = move(jobs.front());
+        jobs.pop_front();
+      }
+      job();
+    }
+  }
+};
+} // namespace VPF
+
+ThreadPool::ThreadPool(size_t num_threads,
+                       const ThreadPlacement &placement) {
+  if (!num_threads) {
+    throw invalid_argument("ThreadPool needs at least one thread");
+  }
+
+  // Resolved once, so compact pool goes to the node of its creator;
+  auto resolved = placement;
+  resolved.node = placement.GetNode();
+
+  pImpl = new ThreadPool_Impl();
+  for (size_t i = 0; i < num_threads; i++) {
+    pImpl->workers.emplace_back(&ThreadPool_Impl::Work, pImpl,
+                                resolved.GetCpus((uint32_t)i));
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    lock_guard<mutex> guard(pImpl->lock);
+    pImpl->stop = true;
+  }
+  pImpl->cv.notify_all();
+
+  for (auto &worker : pImpl->workers) {
+    worker.join();
+  }
+  delete pImpl;
+}
+
+size_t ThreadPool::GetNumThreads() const { return pImpl->workers.size(); }
+
+void ThreadPool::Enqueue(function<void()> job) {
+  {
+    lock_guard<mutex> guard(pImpl->lock);
+    if (pImpl->stop) {
+      throw runtime_error("ThreadPool is stopped");
+    }
+    pImpl->jobs.push_back(move(job));
+  }
+  pImpl->cv.notify_one();
+}
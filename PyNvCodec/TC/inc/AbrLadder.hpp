@@ -0,0 +1,101 @@
+/*
+ * Copyright 2020 NVIDIA Corporation
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "Tasks.hpp"
+#include <map>
+#include <string>
+#include <vector>
+
+namespace VPF {
+
+struct AbrRendition {
+  uint32_t width = 0U;
+  uint32_t height = 0U;
+
+  /* Elementary stream or container; Must have printf-style integer format
+   * (e. g. 720p_%05d.ts) if ladder is segmented;
+   */
+  std::string output;
+
+  // HLS media playlist, empty means no playlist;
+  std::string playlist;
+
+  // Nvenc options in PyNvEncoder format, override ladder-wide ones;
+  std::map<std::string, std::string> encoder_options;
+};
+
+struct AbrLadderParams {
+  std::string input;
+  std::map<std::string, std::string> demux_options;
+
+  // Nvenc options shared by all renditions (codec, preset, etc.);
+  std::map<std::string, std::string> encoder_options;
+  std::vector<AbrRendition> renditions;
+
+  CUcontext ctx = nullptr;
+  CUstream str = nullptr;
+
+  /* Keyframe interval of all renditions, every keyframe is IDR;
+   * Renditions get the same frames, so keyframes are aligned;
+   */
+  uint32_t gop = 60U;
+
+  // Segment length in frames, zero means single output per rendition;
+  uint32_t segment_frames = 0U;
+
+  /* Scale every rendition from the nearest larger one instead of source,
+   * so that most of scaling work is done on smaller frames;
+   */
+  bool cascade = true;
+};
+
+struct AbrLadderStats {
+  uint64_t num_frames = 0U;
+  double elapsed_sec = 0.0;
+  // In the same order as renditions in params;
+  std::vector<uint64_t> num_packets;
+  std::vector<uint32_t> num_segments;
+};
+
+/* Decodes input once and encodes it into several renditions;
+ * Pipeline is demux -> decode -> NV12 to YUV420 -> resize tree ->
+ * YUV420 to NV12 -> encode -> (segmented) output per rendition;
+ * Renditions of source size skip conversion and resize;
+ */
+class DllExport AbrLadder {
+public:
+  AbrLadder() = delete;
+  AbrLadder(const AbrLadder &other) = delete;
+  AbrLadder &operator=(const AbrLadder &other) = delete;
+
+  ~AbrLadder();
+  static AbrLadder *Make(const AbrLadderParams &params);
+
+  /* Returns number of decoded frames; Throws on error;
+   */
+  uint64_t Run();
+
+  void GetStats(AbrLadderStats &stats) const;
+
+  /* Returns (label, task) pairs in order of execution, so that caller may
+   * collect per-stage statistics;
+   */
+  std::vector<std::pair<std::string, Task *>> GetStages() const;
+
+private:
+  explicit AbrLadder(const AbrLadderParams &params);
+  struct AbrLadder_Impl *pImpl = nullptr;
+};
+} // namespace VPF
@@ -0,0 +1,151 @@
+/*
+ * Copyright 2020 NVIDIA Corporation
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "Tasks.hpp"
+#include <cmath>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace VPF {
+
+struct ActivityParams {
+  // Frame is active if its score is above threshold;
+  double threshold = 3.0;
+
+  // Frames of each type needed to establish baseline, none is active before;
+  uint32_t warmup_frames = 10U;
+
+  // Baseline follows stream over about that many frames of each type;
+  uint32_t window_frames = 250U;
+
+  // Active frames closer than merge gap end up in the same segment;
+  double merge_gap_sec = 2.0;
+  double pre_roll_sec = 1.0;
+  double post_roll_sec = 1.0;
+};
+
+/* Estimates activity of frames by compressed-domain signals: packet size
+ * compared to baseline of the same frame type and motion vectors energy if
+ * it's known; Baselines are exponential averages of size and its deviation,
+ * so threshold is in units of deviation and adapts to every stream;
+ * Active frames update baseline slower, so that long activity isn't
+ * absorbed at once;
+ */
+class DllExport ActivityEstimator {
+public:
+  ActivityEstimator(const ActivityEstimator &other) = delete;
+  ActivityEstimator &operator=(const ActivityEstimator &other) = delete;
+
+  explicit ActivityEstimator(const ActivityParams &params);
+  ~ActivityEstimator();
+
+  /* Returns activity score of frame; Negative mv_energy means it's unknown;
+   */
+  double Update(FrameType frame_type, uint64_t num_bytes,
+                double mv_energy = -1.0);
+
+  bool IsActive(double score) const;
+
+  void Reset();
+
+private:
+  struct ActivityEstimator_Impl *pImpl = nullptr;
+};
+
+/* Mean motion vector length in pixels, weighted by block area and
+ * normalized by frame area; Works for AVMotionVector and alike;
+ */
+template <typename T>
+double MotionVectorEnergy(const T *mvs, size_t num_mvs, uint32_t width,
+                          uint32_t height) {
+  if (!mvs || !num_mvs || !width || !height) {
+    return 0.0;
+  }
+
+  double energy = 0.0;
+  for (size_t i = 0U; i < num_mvs; i++) {
+    auto const &mv = mvs[i];
+    auto const scale = mv.motion_scale ? (double)mv.motion_scale : 1.0;
+    auto const length =
+        std::sqrt((double)mv.motion_x * mv.motion_x +
+                  (double)mv.motion_y * mv.motion_y) /
+        scale;
+    energy += length * mv.w * mv.h;
+  }
+  return energy / ((double)width * height);
+}
+
+struct FrameActivity {
+  // Presentation time since the first packet;
+  double time = 0.0;
+  uint64_t num_bytes = 0U;
+  FrameType frame_type = FRAME_TYPE_UNKNOWN;
+  bool is_keyframe = false;
+  double score = 0.0;
+  bool is_active = false;
+};
+
+/* Time range to be decoded; Decoding starts from keyframe packet, which
+ * precedes the range;
+ */
+struct ActivitySegment {
+  double start_time = 0.0;
+  double end_time = 0.0;
+  // Packet number in decode order and its pts;
+  uint64_t keyframe_packet = 0U;
+  int64_t keyframe_pts = 0;
+  uint32_t num_active = 0U;
+  double max_score = 0.0;
+};
+
+struct ActivityReport {
+  // All the frames in decode order;
+  std::vector<FrameActivity> frames;
+  std::vector<ActivitySegment> segments;
+  uint64_t num_active = 0U;
+  double duration_sec = 0.0;
+  // Share of input duration covered by segments;
+  double active_share = 0.0;
+};
+
+/* Reads input without decoding, scores every frame with ActivityEstimator
+ * and merges active frames into segments which are worth full decoding;
+ */
+class DllExport ActivitySampler {
+public:
+  ActivitySampler() = delete;
+  ActivitySampler(const ActivitySampler &other) = delete;
+  ActivitySampler &operator=(const ActivitySampler &other) = delete;
+
+  ~ActivitySampler();
+  static ActivitySampler *
+  Make(const std::string &input,
+       const std::map<std::string, std::string> &demux_options,
+       const ActivityParams &params);
+
+  /* Returns number of active frames; Throws on error;
+   */
+  uint64_t Run();
+
+  void GetReport(ActivityReport &report) const;
+
+private:
+  ActivitySampler(const std::string &input,
+                  const std::map<std::string, std::string> &demux_options,
+                  const ActivityParams &params);
+  struct ActivitySampler_Impl *pImpl = nullptr;
+};
+} // namespace VPF
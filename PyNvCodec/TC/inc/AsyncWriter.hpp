@@ -0,0 +1,171 @@
+/*
+ * Copyright 2020 NVIDIA Corporation
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "MemoryInterfaces.hpp"
+#include "TC_CORE.hpp"
+#include <functional>
+#include <memory>
+#include <string>
+
+namespace VPF {
+
+struct AsyncWriterParams {
+  // Size of pooled buffer, every full buffer is sent to disk by single write;
+  size_t buffer_size = 1U << 20U;
+  // Writer blocks when that many buffers are being written;
+  uint32_t max_in_flight = 64U;
+  // io_uring submission queue size;
+  uint32_t queue_depth = 128U;
+  // Threads which do pwrite when io_uring isn't available;
+  uint32_t num_threads = 4U;
+  bool use_io_uring = true;
+  // Buffers are accounted to that name in MemoryBudget;
+  std::string pipeline = "AsyncWriter";
+};
+
+struct AsyncWriterStats {
+  uint64_t num_writes = 0U;
+  uint64_t num_bytes = 0U;
+  uint64_t num_errors = 0U;
+  // Number of io_uring_enter calls, every one may carry many writes;
+  uint64_t num_submits = 0U;
+};
+
+/* Writes buffers to files asynchronously; One writer is meant to be shared
+ * by all outputs of the process, so writes to different files are batched
+ * together; On Linux it uses io_uring from single thread, elsewhere or if
+ * io_uring is unavailable it falls back to thread pool doing positional
+ * writes;
+ * Buffers come from the pool owned by writer, they are returned to it as
+ * soon as write completes; Buffers are aligned for direct I/O;
+ */
+class DllExport AsyncWriter {
+public:
+  AsyncWriter() = delete;
+  AsyncWriter(const AsyncWriter &other) = delete;
+  AsyncWriter &operator=(const AsyncWriter &other) = delete;
+
+  static std::shared_ptr<AsyncWriter>
+  Make(const AsyncWriterParams &params = AsyncWriterParams());
+
+  // Process-wide writer with default parameters;
+  static std::shared_ptr<AsyncWriter> GetDefault();
+
+  // Waits for all pending writes;
+  ~AsyncWriter();
+
+  bool IsIoUring() const;
+  size_t GetBufferSize() const;
+  AsyncWriterStats GetStats() const;
+
+  // Buffers, file offsets and sizes of direct writes are aligned to that;
+  static size_t GetAlignment();
+
+private:
+  friend class AsyncFile;
+  explicit AsyncWriter(const AsyncWriterParams &params);
+
+  struct AsyncWriter_Impl *pImpl = nullptr;
+};
+
+/* File written through AsyncWriter; Data is gathered into pooled buffers,
+ * every full buffer is submitted as single write, so Write() only copies
+ * memory unless all buffers are in flight;
+ * With direct flag file is opened with O_DIRECT, partial tail is padded and
+ * then truncated on Close(); If file system doesn't support direct I/O
+ * regular one is used;
+ * Not thread-safe, but different files may be written from different
+ * threads;
+ */
+class DllExport AsyncFile {
+public:
+  AsyncFile() = delete;
+  AsyncFile(const AsyncFile &other) = delete;
+  AsyncFile &operator=(const AsyncFile &other) = delete;
+
+  // Throws std::runtime_error if file can't be opened;
+  static AsyncFile *Make(std::shared_ptr<AsyncWriter> writer,
+                         const std::string &path, bool direct = false);
+
+  // Closes file;
+  ~AsyncFile();
+
+  // Returns false if any write of this file has failed;
+  bool Write(const void *data, size_t size);
+
+  /* Moves write position; Waits for pending writes when going back, so
+   * they don't overwrite new data; Not supported for direct files;
+   */
+  bool Seek(int64_t offset);
+
+  int64_t Tell() const;
+
+  // Largest offset written so far;
+  int64_t GetSize() const;
+
+  /* Submits buffered data and waits until all writes complete; Direct file
+   * keeps unaligned tail in memory until Close();
+   */
+  bool Flush();
+
+  bool Close();
+
+  /* Submits buffered data and returns at once; File is closed after its
+   * last write completes, then callback is called from writer thread with
+   * overall result, so it must be short; Direct file is closed as usual;
+   */
+  void CloseAsync(std::function<void(bool)> on_closed = nullptr);
+
+  bool IsDirect() const;
+
+private:
+  AsyncFile(std::shared_ptr<AsyncWriter> writer, const std::string &path,
+            bool direct);
+
+  struct AsyncFile_Impl *pImpl = nullptr;
+};
+
+/* Sink which appends input 0 Buffer to file through AsyncWriter;
+ * Suits elementary streams which come out of NvencEncodeFrame, raw frame
+ * dumps and any other data written sequentially;
+ */
+class DllExport AsyncFileSink final : public Task {
+public:
+  AsyncFileSink() = delete;
+  AsyncFileSink(const AsyncFileSink &other) = delete;
+  AsyncFileSink &operator=(const AsyncFileSink &other) = delete;
+
+  // Null writer means default one;
+  static AsyncFileSink *Make(const char *path,
+                             std::shared_ptr<AsyncWriter> writer = nullptr,
+                             bool direct = false);
+
+  ~AsyncFileSink() final;
+
+  TaskExecStatus Execute() final;
+
+  bool Flush();
+
+  uint64_t GetNumBytes() const;
+
+private:
+  static const uint32_t numInputs = 1U;
+  static const uint32_t numOutputs = 0U;
+
+  struct AsyncFileSink_Impl *pImpl = nullptr;
+  AsyncFileSink(const char *path, std::shared_ptr<AsyncWriter> writer,
+                bool direct);
+};
+} // namespace VPF
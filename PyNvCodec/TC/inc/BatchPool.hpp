@@ -0,0 +1,47 @@
+/*
+ * Copyright 2020 NVIDIA Corporation
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "MemoryBudget.hpp"
+#include "MemoryInterfaces.hpp"
+#include <string>
+
+namespace VPF {
+
+/* Pool of host batch buffers; Batches are reserved from MemoryBudget when
+ * allocated and released when freed, so pooled ones stay accounted; They
+ * are allocated on given NUMA node, if there's one;
+ */
+class DllExport BatchPool {
+public:
+  BatchPool() = delete;
+  BatchPool(const BatchPool &other) = delete;
+  BatchPool &operator=(const BatchPool &other) = delete;
+
+  BatchPool(const std::string &pipeline, int node);
+  ~BatchPool();
+
+  // Returns nullptr if batch is dropped by budget policy;
+  Buffer *Acquire(size_t size, BudgetPolicy policy);
+
+  // Takes ownership of buffer returned by Acquire;
+  void Release(Buffer *buffer);
+
+  // Frees idle buffers;
+  void Trim();
+
+private:
+  struct BatchPool_Impl *pImpl = nullptr;
+};
+} // namespace VPF
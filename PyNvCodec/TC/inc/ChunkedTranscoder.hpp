@@ -0,0 +1,91 @@
+/*
+ * Copyright 2020 NVIDIA Corporation
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "Tasks.hpp"
+#include <map>
+#include <string>
+#include <vector>
+
+namespace VPF {
+
+struct ChunkedTranscodeParams {
+  std::string input;
+  // Elementary stream or any container supported by FFmpeg;
+  std::string output;
+  std::map<std::string, std::string> demux_options;
+
+  /* Nvenc options in PyNvEncoder format; If "s" differs from input size,
+   * frames are resized; B frames are disabled and every keyframe is IDR,
+   * so each chunk is closed GOP sequence;
+   */
+  std::map<std::string, std::string> encoder_options;
+
+  // Chunks are assigned to contexts round robin, so several GPUs may be used;
+  std::vector<CUcontext> contexts;
+
+  // Number of concurrent Nvdec + Nvenc sessions;
+  uint32_t num_workers = 2U;
+
+  // Chunk is never shorter than that, unless it's the last one;
+  uint32_t min_chunk_frames = 250U;
+
+  /* Checkpoint file, empty means no checkpointing; If file exists,
+   * transcode is resumed from it, otherwise it's created;
+   * Transcoded chunks are kept next to output until it's complete, so at
+   * most one chunk per worker is lost when process is killed;
+   */
+  std::string checkpoint;
+
+  // With checkpoint on, chunk is never longer than that, if input allows;
+  uint32_t checkpoint_frames = 3000U;
+};
+
+struct ChunkedTranscodeStats {
+  uint32_t num_chunks = 0U;
+  // Chunks taken from checkpoint and not transcoded again;
+  uint32_t num_resumed_chunks = 0U;
+  uint64_t num_frames = 0U;
+  double index_sec = 0.0;
+  double transcode_sec = 0.0;
+};
+
+/* Splits input at keyframes into chunks of whole GOPs, transcodes chunks
+ * concurrently and concatenates them in order into single output;
+ * Frames which reference previous GOP (open GOP input) may be lost at chunk
+ * boundaries;
+ * Every chunk starts with IDR, so chunk boundaries are checkpoints: chunk
+ * plan, encoder settings and finished chunks are saved to checkpoint file,
+ * and interrupted transcode is resumed without indexing input again;
+ */
+class DllExport ChunkedTranscoder {
+public:
+  ChunkedTranscoder() = delete;
+  ChunkedTranscoder(const ChunkedTranscoder &other) = delete;
+  ChunkedTranscoder &operator=(const ChunkedTranscoder &other) = delete;
+
+  ~ChunkedTranscoder();
+  static ChunkedTranscoder *Make(const ChunkedTranscodeParams &params);
+
+  /* Returns number of frames written to output; Throws if any chunk fails;
+   */
+  uint64_t Run();
+
+  void GetStats(ChunkedTranscodeStats &stats) const;
+
+private:
+  explicit ChunkedTranscoder(const ChunkedTranscodeParams &params);
+  struct ChunkedTranscoder_Impl *pImpl = nullptr;
+};
+} // namespace VPF
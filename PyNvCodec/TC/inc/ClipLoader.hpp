@@ -0,0 +1,131 @@
+/*
+ * Copyright 2020 NVIDIA Corporation
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "MemoryInterfaces.hpp"
+#include "Numa.hpp"
+#include "TC_CORE.hpp"
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace VPF {
+
+struct ClipSpec {
+  // Frames per clip;
+  uint32_t length = 16U;
+
+  // Source frames between clip frames, used if fps is zero;
+  uint32_t stride = 1U;
+
+  /* Clip frame rate; Frames are taken at 1 / fps intervals, so source
+   * frames are skipped or repeated as needed;
+   */
+  double fps = 0.0;
+
+  // Distance between clip starts in seconds, zero means back to back clips;
+  double clip_step_sec = 0.0;
+
+  // Every frame is resized to that;
+  uint32_t width = 0U;
+  uint32_t height = 0U;
+
+  // RGB, BGR, Y or YUV420;
+  Pixel_Format format = RGB;
+};
+
+struct ClipLoaderParams {
+  uint32_t batch_size = 8U;
+  uint32_t num_threads = 4U;
+
+  /* Where threads run; If policy keeps them on single node, batches are
+   * allocated on it as well;
+   */
+  ThreadPlacement placement;
+
+  /* Number of batches decoded ahead of consumer; Batch is prefetched only
+   * if MemoryBudget allows right away;
+   */
+  uint32_t prefetch = 2U;
+
+  // Order of clips depends on seed and epoch only;
+  uint64_t seed = 0U;
+  bool shuffle = true;
+
+  // Otherwise the last batch of epoch may have fewer clips;
+  bool drop_last = false;
+
+  /* Batches are accounted to that name in MemoryBudget; Budget must fit
+   * the batch consumer holds plus the one being decoded;
+   */
+  std::string pipeline = "ClipLoader";
+};
+
+struct ClipInfo {
+  // Index in the list of files loader was given;
+  uint32_t file_index = 0U;
+  double start_time = 0.0;
+  // False if clip failed to decode, its frames are zeros then;
+  bool decoded = false;
+};
+
+/* Loads fixed-size video clips for training on CPU; Files are probed once,
+ * every one is split into clips which are visited in shuffled order each
+ * epoch; Clip is decoded by FfmpegDecodeFrame which seeks to the keyframe
+ * preceding clip start, frames are resized to clip size as they come out
+ * of decoder;
+ * Clips are decoded by thread pool; Every thread keeps its decoder open,
+ * so next clip of the same file doesn't reopen it; Consumer gets batches
+ * in order, a few of them are decoded ahead;
+ */
+class DllExport ClipLoader {
+public:
+  ClipLoader() = delete;
+  ClipLoader(const ClipLoader &other) = delete;
+  ClipLoader &operator=(const ClipLoader &other) = delete;
+
+  /* Throws std::invalid_argument if clip spec isn't supported; Files which
+   * can't be probed are skipped with warning;
+   */
+  static ClipLoader *Make(const std::vector<std::string> &files,
+                          const ClipSpec &spec,
+                          const ClipLoaderParams &params = ClipLoaderParams());
+
+  // Waits for clips being decoded;
+  ~ClipLoader();
+
+  /* Starts another pass over clips; Batches of previous epoch which are
+   * being decoded are waited for and dropped; Epoch 0 is started by Make();
+   */
+  void StartEpoch(uint32_t epoch);
+
+  /* Returns next batch of epoch or nullptr at its end; Blocks until batch
+   * is decoded; Clips are stacked one after another, every clip has
+   * spec.length frames;
+   */
+  std::shared_ptr<Buffer> Next(std::vector<ClipInfo> &clips);
+
+  uint32_t GetNumFiles() const;
+  uint64_t GetNumClips() const;
+  uint64_t GetNumBatches() const;
+  size_t GetFrameSize() const;
+  void GetSpec(ClipSpec &spec) const;
+
+private:
+  ClipLoader(const std::vector<std::string> &files, const ClipSpec &spec,
+             const ClipLoaderParams &params);
+
+  struct ClipLoader_Impl *pImpl = nullptr;
+};
+} // namespace VPF
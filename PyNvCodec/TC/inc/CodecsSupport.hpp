@@ -16,11 +16,37 @@
 #include "cuviddec.h"
 #include <stdint.h>
 
+enum FrameType {
+  FRAME_TYPE_UNKNOWN = 0,
+  FRAME_TYPE_I = 1,
+  FRAME_TYPE_P = 2,
+  FRAME_TYPE_B = 3,
+};
+
 struct PacketData {
   int64_t pts;
   int64_t dts;
   uint64_t pos;
   uint64_t duration;
+
+  /* Taken from slice headers of H.264 / HEVC access unit, unknown for other
+   * codecs; Keyframe flag comes from container;
+   */
+  FrameType frame_type;
+  bool is_keyframe;
+  bool is_idr;
+  bool is_reference;
+};
+
+/* Keyframe position within video stream;
+ * Timestamps are given in video stream time base;
+ */
+struct KeyframeIndexEntry {
+  int64_t pts;
+  int64_t dts;
+  int64_t pos;
+  // Number of video packets preceding keyframe in decode order;
+  uint64_t packet_number;
 };
 
 struct VideoContext {
@@ -32,6 +58,8 @@ struct VideoContext {
   cudaVideoCodec codec;
   PacketData packetData;
   Pixel_Format format;
+  // Clockwise rotation in degrees display matrix asks for;
+  int rotation;
 };
 
 struct AudioContext {
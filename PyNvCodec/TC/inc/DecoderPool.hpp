@@ -0,0 +1,108 @@
+/*
+ * Copyright 2020 NVIDIA Corporation
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "Tasks.hpp"
+#include <map>
+#include <string>
+
+namespace VPF {
+
+/* Session is warm if its decoder is taken from pool and cold otherwise;
+ * Setup time is counted from Acquire() to the first decoded frame, so it
+ * includes input probing and HW decoder creation;
+ */
+struct DecoderPoolStats {
+  uint64_t num_demuxers_created = 0U;
+  uint64_t num_demuxers_reused = 0U;
+  uint64_t num_decoders_created = 0U;
+  uint64_t num_decoders_reused = 0U;
+  // Reused decoders which were reconfigured for other resolution;
+  uint64_t num_decoders_reconfigured = 0U;
+  uint64_t num_cold_sessions = 0U;
+  uint64_t num_warm_sessions = 0U;
+  double cold_setup_sec = 0.0;
+  double warm_setup_sec = 0.0;
+};
+
+/* Demuxer and Nvdec decoder bound to single input;
+ */
+class DllExport DecodeSession {
+public:
+  DecodeSession(const DecodeSession &other) = delete;
+  DecodeSession &operator=(const DecodeSession &other) = delete;
+
+  /* Returns nullptr when input is over and decoder is flushed;
+   * Surface is valid until next call; Packet data of returned surface is
+   * written to pPktData if it's given;
+   */
+  Surface *DecodeSingleSurface(PacketData *pPktData = nullptr);
+
+  void GetParams(MuxingParams &params) const;
+
+  DemuxFrame *GetDemuxer();
+
+  NvdecDecodeFrame *GetDecoder();
+
+  /* Accounts setup time on first call; Only needed when caller runs
+   * demuxer and decoder on its own rather than with DecodeSingleSurface;
+   */
+  void OnSurfaceDecoded();
+
+  /* Replaces decoder which faced HW error with new one; Returns new decoder,
+   * previous one is destroyed;
+   */
+  NvdecDecodeFrame *RecreateDecoder();
+
+private:
+  friend class DecoderPool;
+  DecodeSession();
+  ~DecodeSession();
+  struct DecodeSession_Impl *pImpl = nullptr;
+};
+
+/* Keeps demuxers and decoders of finished sessions to open next inputs with
+ * them; Demuxer is rebound to new input keeping its bitstream filters when
+ * possible, decoder is reused for input of the same codec and pixel format
+ * without HW decoder re-creation; Input of other resolution is handled by
+ * decoder reconfiguration if it isn't bigger than input decoder was created
+ * for;
+ * Idle decoders keep their Nvdec sessions and video memory, so pool size is
+ * limited; Pool may be shared by several threads;
+ */
+class DllExport DecoderPool {
+public:
+  DecoderPool() = delete;
+  DecoderPool(const DecoderPool &other) = delete;
+  DecoderPool &operator=(const DecoderPool &other) = delete;
+
+  ~DecoderPool();
+  static DecoderPool *Make(CUcontext ctx, CUstream str,
+                           uint32_t max_idle_decoders = 4U);
+
+  /* Opens input, throws if it can't be opened or decoded by Nvdec;
+   * Session must be given back with Release() before pool is destroyed;
+   */
+  DecodeSession *Acquire(const std::string &url,
+                         const std::map<std::string, std::string> &options);
+
+  void Release(DecodeSession *session);
+
+  void GetStats(DecoderPoolStats &stats) const;
+
+private:
+  DecoderPool(CUcontext ctx, CUstream str, uint32_t max_idle_decoders);
+  struct DecoderPool_Impl *pImpl = nullptr;
+};
+} // namespace VPF
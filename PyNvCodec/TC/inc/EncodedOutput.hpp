@@ -0,0 +1,71 @@
+/*
+ * Copyright 2020 NVIDIA Corporation
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "Tasks.hpp"
+#include <string>
+
+namespace VPF {
+
+/* Tells if encoded video should be written to file as is (.h264, .hevc,
+ * etc.) instead of being muxed by FFmpeg;
+ */
+bool DllExport IsElementaryStreamUrl(const std::string &url);
+
+/* Tells if URL is local file to be written with AsyncWriter; Network and
+ * file: URLs are left to avio;
+ */
+bool DllExport IsLocalPath(const std::string &url);
+
+/* URL is used as format string, so make sure it has single integer
+ * conversion (e. g. %05d) and nothing else;
+ */
+bool DllExport IsNumberPattern(const std::string &url);
+
+/* Writes encoded packets to elementary stream or container;
+ * Packets must come in display order (no B frames), timestamps are counted
+ * from zero;
+ * If segment length is given, output is split into segments of that many
+ * frames; URL must have printf-style integer format then (e. g.
+ * out_%05d.ts) which is substituted by segment number;
+ */
+class DllExport EncodedOutput {
+public:
+  EncodedOutput() = delete;
+  EncodedOutput(const EncodedOutput &other) = delete;
+  EncodedOutput &operator=(const EncodedOutput &other) = delete;
+
+  ~EncodedOutput();
+  static EncodedOutput *Make(const std::string &url,
+                             const MuxingParams &params,
+                             uint32_t segment_frames = 0U);
+
+  void Write(const uint8_t *data, size_t size);
+
+  void Write(Buffer *packet);
+
+  /* Writes HLS VOD media playlist with all segments written so far;
+   */
+  void WritePlaylist(const std::string &path) const;
+
+  uint64_t GetNumPackets() const;
+
+  uint32_t GetNumSegments() const;
+
+private:
+  EncodedOutput(const std::string &url, const MuxingParams &params,
+                uint32_t segment_frames);
+  struct EncodedOutput_Impl *pImpl = nullptr;
+};
+} // namespace VPF
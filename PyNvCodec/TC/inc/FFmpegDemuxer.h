@@ -27,6 +27,7 @@ extern "C" {
 
 #include "CodecsSupport.hpp"
 #include "NvCodecUtils.h"
+#include "ParameterSets.hpp"
 #include "cuviddec.h"
 #include <map>
 #include <string>
@@ -40,6 +41,8 @@ class DllExport FFmpegDemuxer {
   AVFormatContext *fmtc = nullptr;
 
   AVPacket pkt, pktAnnexB, pktSei;
+  // Packet read while probing parameter sets, it's demuxed first;
+  AVPacket pendingPkt;
   PacketData lastPacketData;
   AVCodecID eVideoCodec = AV_CODEC_ID_NONE;
   AVPixelFormat eChromaFormat;
@@ -48,6 +51,7 @@ class DllExport FFmpegDemuxer {
   uint32_t height;
   double framerate;
   double timebase;
+  int rotation = 0;
 
   int videoStream = -1;
 
@@ -55,11 +59,34 @@ class DllExport FFmpegDemuxer {
   bool is_mp4HEVC;
   bool is_EOF = false;
 
+  VPF::VideoStreamInfo streamInfo;
+  bool hasStreamInfo = false;
+
+  // Frame type of demuxed packets, off unless asked for;
+  bool isSliceParsing = false;
+  VPF::SliceHeaderParser sliceParser =
+      VPF::SliceHeaderParser(cudaVideoCodec_NumCodecs);
+
   std::vector<uint8_t> annexbBytes;
   std::vector<uint8_t> seiBytes;
 
   explicit FFmpegDemuxer(AVFormatContext *fmtcx);
 
+  // Sets demuxer up for videoStream of fmtc;
+  void OpenVideoStream();
+
+  /* Finds video stream of input and its properties; Doesn't touch demuxer
+   * state, so input may be probed while previous one is still open;
+   * Throws std::runtime_error if there's no video stream;
+   */
+  static int ProbeVideoStream(AVFormatContext *ctx, AVPacket &pending,
+                              VPF::VideoStreamInfo &info, bool &hasInfo);
+
+  static bool ProbeParameterSets(AVFormatContext *ctx, AVPacket &pending,
+                                 VPF::VideoStreamInfo &info, bool &hasInfo);
+
+  int ReadFrame(AVPacket *pPkt);
+
   AVFormatContext *
   CreateFormatContext(DataProvider *pDataProvider,
                       const std::map<std::string, std::string> &ffmpeg_options);
@@ -91,14 +118,61 @@ public:
 
   AVPixelFormat GetPixelFormat() const;
 
+  // Clockwise rotation in degrees display matrix asks for, 0 if there's none;
+  int GetRotation() const;
+
+  // Duration in seconds, zero if unknown;
+  double GetDuration() const;
+
+  // Overall bitrate in bits per second, zero if unknown;
+  int64_t GetBitrate() const;
+
+  // Number of video frames according to container, zero if unknown;
+  int64_t GetNumFrames() const;
+
   bool Demux(uint8_t *&pVideo, size_t &rVideoBytes, uint8_t **ppSEI = nullptr,
              size_t *pSEIBytes = nullptr);
 
   void GetLastPacketData(PacketData &pktData);
 
+  /* Fills frame type, IDR and reference flags of H.264 / HEVC packet data
+   * from slice headers; Off by default as it's extra pass over packet;
+   */
+  void EnableSliceParsing(bool enable);
+
+  /* Returns false if video stream isn't H.264 / HEVC or its parameter sets
+   * can't be parsed;
+   */
+  bool GetStreamInfo(VPF::VideoStreamInfo &info) const;
+
+  /* Builds video stream keyframes index;
+   * Uses container index if it has entry for every packet, otherwise reads
+   * through whole input unless allow_scan is false; Demuxer is rewound to
+   * the beginning afterwards;
+   */
+  bool GetKeyframeIndex(std::vector<KeyframeIndexEntry> &index,
+                        uint64_t &num_packets, bool allow_scan = true);
+
+  /* Seeks to keyframe from index; Next demuxed packet is keyframe itself
+   * or one of packets preceding it;
+   */
+  bool Seek(const KeyframeIndexEntry &keyframe);
+
+  /* Rebinds demuxer to another input; Bitstream filters are kept if codec
+   * parameters are the same; Returns false if input can't be opened,
+   * demuxer stays bound to previous input then;
+   */
+  bool Reopen(const char *szFilePath,
+              const std::map<std::string, std::string> &ffmpeg_options);
+
   static int ReadPacket(void *opaque, uint8_t *pBuf, int nBuf);
 };
 
+/* Clockwise rotation in degrees, multiple of 90, which makes frames of the
+ * stream upright according to its display matrix side data;
+ */
+DllExport int GetDisplayRotation(const AVStream *stream);
+
 inline cudaVideoCodec FFmpeg2NvCodecId(AVCodecID id) {
   switch (id) {
   case AV_CODEC_ID_MPEG1VIDEO:
@@ -0,0 +1,153 @@
+/*
+ * Copyright 2020 NVIDIA Corporation
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "MemoryInterfaces.hpp"
+#include "TC_CORE.hpp"
+#include <string>
+
+namespace VPF {
+
+/* Layout of cached frames; Planes of every frame are packed one after
+ * another, the same way GetHostFrameSize counts them;
+ */
+struct FrameCacheParams {
+  uint32_t width = 0U;
+  uint32_t height = 0U;
+  Pixel_Format format = UNDEFINED;
+
+  // Frames are LZ compressed when it pays off, see max_compressed_ratio;
+  bool compress = false;
+
+  /* Compressed frame is kept only if it's at most that share of raw one;
+   * Otherwise decompression costs more CPU than reading raw frame saves;
+   */
+  double max_compressed_ratio = 0.75;
+};
+
+/* Directory of cache entries, one file per source video and frame layout;
+ * Entry is the same for all epochs, so video is decoded once;
+ * Entries are evicted least recently used first to fit disk budget, Lookup()
+ * marks entry as used;
+ */
+class DllExport FrameCache {
+public:
+  FrameCache() = delete;
+  FrameCache(const FrameCache &other) = delete;
+  FrameCache &operator=(const FrameCache &other) = delete;
+
+  // Creates directory if there's none; Zero budget means unlimited;
+  static FrameCache *Make(const char *dir, uint64_t budget);
+
+  ~FrameCache();
+
+  // Path of entry for given source; Compress flag doesn't affect it;
+  std::string GetEntryPath(const std::string &source,
+                           const FrameCacheParams &params) const;
+
+  // True if complete entry exists;
+  bool Lookup(const std::string &source, const FrameCacheParams &params);
+
+  /* Removes least recently used entries until their total size plus reserve
+   * fits the budget; Returns number of bytes removed;
+   */
+  uint64_t Evict(uint64_t reserve = 0U);
+
+  // Total size of complete entries;
+  uint64_t GetSize() const;
+  uint64_t GetBudget() const;
+
+private:
+  FrameCache(const char *dir, uint64_t budget);
+
+  struct FrameCache_Impl *pImpl = nullptr;
+};
+
+/* Writes frames to cache entry; Data goes to temporary file which replaces
+ * entry on Close(), so readers never see incomplete one;
+ * Input 0 is Buffer with host frame, input 1 is optional Buffer with
+ * PacketData, e. g. output 2 of FfmpegDecodeFrame; Without it frame index is
+ * used as pts;
+ */
+class DllExport FrameCacheWriter final : public Task {
+public:
+  FrameCacheWriter() = delete;
+  FrameCacheWriter(const FrameCacheWriter &other) = delete;
+  FrameCacheWriter &operator=(const FrameCacheWriter &other) = delete;
+
+  // Throws std::invalid_argument if frame layout isn't given;
+  static FrameCacheWriter *Make(const char *path,
+                                const FrameCacheParams &params);
+
+  // Closes entry if it wasn't closed;
+  ~FrameCacheWriter() final;
+
+  TaskExecStatus Execute() final;
+
+  // Writes index and publishes entry; Returns false if any write failed;
+  bool Close();
+
+  uint64_t GetNumFrames() const;
+  uint64_t GetNumCompressed() const;
+
+private:
+  static const uint32_t numInputs = 2U;
+  static const uint32_t numOutputs = 0U;
+
+  struct FrameCacheWriter_Impl *pImpl = nullptr;
+  FrameCacheWriter(const char *path, const FrameCacheParams &params);
+};
+
+/* Reads cache entry; File is memory-mapped, raw frames are output without
+ * copy, compressed ones are unpacked into internal buffer;
+ * Output 0 is Buffer with frame, output 1 is Buffer with PacketData; Both
+ * stay valid until the next Execute() call;
+ */
+class DllExport FrameCacheReader final : public Task {
+public:
+  FrameCacheReader() = delete;
+  FrameCacheReader(const FrameCacheReader &other) = delete;
+  FrameCacheReader &operator=(const FrameCacheReader &other) = delete;
+
+  // Throws std::runtime_error if file isn't complete cache entry;
+  static FrameCacheReader *Make(const char *path);
+
+  ~FrameCacheReader() final;
+
+  // Outputs next frame, fails at the end of entry;
+  TaskExecStatus Execute() final;
+
+  void GetParams(FrameCacheParams &params) const;
+
+  uint64_t GetNumFrames() const;
+  uint64_t GetFrameIndex() const;
+  size_t GetFrameSize() const;
+
+  // Returns false if there's no such frame;
+  bool Seek(uint64_t frame_index);
+
+  // Seeks to frame with given pts or the first one after it;
+  bool SeekToPts(int64_t pts);
+
+  // Mapped frame if it's stored raw, nullptr otherwise;
+  const uint8_t *GetRawFrame(uint64_t frame_index) const;
+
+private:
+  static const uint32_t numInputs = 0U;
+  static const uint32_t numOutputs = 2U;
+
+  struct FrameCacheReader_Impl *pImpl = nullptr;
+  explicit FrameCacheReader(const char *path);
+};
+} // namespace VPF
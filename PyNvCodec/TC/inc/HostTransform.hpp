@@ -0,0 +1,143 @@
+/*
+ * Copyright 2020 NVIDIA Corporation
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "MemoryInterfaces.hpp"
+#include "ThreadPool.hpp"
+#include <cstddef>
+#include <cstdint>
+
+namespace VPF {
+
+enum DownscaleFilter {
+  // Average of all pixels of block;
+  DOWNSCALE_BOX = 0,
+  // Average of 2x2 pixels at block center, cheaper for 4x;
+  DOWNSCALE_BILINEAR = 1
+};
+
+// Clockwise rotation, in degrees;
+enum FrameRotation {
+  ROTATE_0 = 0,
+  ROTATE_90 = 90,
+  ROTATE_180 = 180,
+  ROTATE_270 = 270
+};
+
+/* Converts angle in degrees to the nearest multiple of 90;
+ */
+DllExport FrameRotation RotationFromDegrees(int degrees);
+
+/* Transform applied while decoded frame is copied out of decoder;
+ * Crop is done first, then downscale, rotation and color conversion;
+ */
+struct FrameCopyParams {
+  // YUV420, Y (luma only), RGB or BGR;
+  Pixel_Format format = YUV420;
+
+  // Crop rectangle, zero size means whole frame; Origin must be even;
+  uint32_t crop_x = 0U;
+  uint32_t crop_y = 0U;
+  uint32_t crop_width = 0U;
+  uint32_t crop_height = 0U;
+
+  // 1, 2 or 4;
+  uint32_t downscale = 1U;
+  DownscaleFilter filter = DOWNSCALE_BOX;
+
+  // Mirroring is done after rotation;
+  FrameRotation rotation = ROTATE_0;
+  bool hflip = false;
+
+  // Decoder adds rotation of stream display matrix to the one above;
+  bool auto_rotate = false;
+};
+
+struct RotateParams {
+  FrameRotation rotation = ROTATE_0;
+
+  /* Mirror horizontally after rotation; Transpose is ROTATE_90 with hflip,
+   * vertical flip is ROTATE_180 with hflip;
+   */
+  bool hflip = false;
+
+  // 1, 2 or 4;
+  uint32_t downscale = 1U;
+  DownscaleFilter filter = DOWNSCALE_BOX;
+};
+
+/* Host-side planar YUV420 frame;
+ */
+struct HostPlanes {
+  const uint8_t *data[3];
+  int pitch[3];
+  uint32_t width;
+  uint32_t height;
+};
+
+/* Computes size of transformed frame, width and height are given after
+ * rotation; Throws std::invalid_argument if parameters don't fit the frame;
+ */
+DllExport void GetFrameCopySize(const FrameCopyParams &params,
+                                uint32_t src_width, uint32_t src_height,
+                                uint32_t &dst_width, uint32_t &dst_height,
+                                size_t &dst_size);
+
+/* Crops, downscales and converts YUV420 frame in single pass over source;
+ * Rows are processed one by one through small scratch buffers, so source
+ * is read once and destination is written once; Destination is packed:
+ * planar for YUV420 and Y, interleaved for RGB and BGR;
+ * RGB conversion uses the same coefficients as ConvertSurface
+ * YUV420 -> RGB does on GPU;
+ */
+DllExport void CopyFrameYUV420(const HostPlanes &src,
+                               const FrameCopyParams &params, uint8_t *dst);
+
+/* Size of host frame with planes packed one after another, as
+ * CudaDownloadSurface gives them; Throws std::invalid_argument for
+ * UNDEFINED format;
+ */
+DllExport size_t GetHostFrameSize(Pixel_Format format, uint32_t width,
+                                  uint32_t height);
+
+/* Computes size of rotated and downscaled host frame; Throws
+ * std::invalid_argument if format isn't supported or frame is too small;
+ */
+DllExport void GetRotatedFrameSize(Pixel_Format format, uint32_t src_width,
+                                   uint32_t src_height,
+                                   const RotateParams &params,
+                                   uint32_t &dst_width, uint32_t &dst_height,
+                                   size_t &dst_size);
+
+/* Rotates, flips and downscales host frame in single pass;
+ * Frame planes are packed one after another, as CudaDownloadSurface gives
+ * them; Works with Y, NV12, YUV420, YCBCR, YUV444, RGB, BGR and RGB_PLANAR;
+ * Destination is walked by 16x16 tiles, so both source and destination
+ * rows of the tile stay in cache; Tile rows are split between pool
+ * threads if pool is given;
+ */
+DllExport void RotateHostFrame(const uint8_t *src, uint32_t src_width,
+                               uint32_t src_height, Pixel_Format format,
+                               const RotateParams &params, uint8_t *dst,
+                               ThreadPool *pool = nullptr);
+
+/* Resizes host frame to arbitrary size plane by plane; Area average is used
+ * when frame shrinks, bilinear interpolation otherwise; Frame planes are
+ * packed the same way RotateHostFrame takes them;
+ */
+DllExport void ResizeHostFrame(const uint8_t *src, uint32_t src_width,
+                               uint32_t src_height, Pixel_Format format,
+                               uint8_t *dst, uint32_t dst_width,
+                               uint32_t dst_height);
+} // namespace VPF
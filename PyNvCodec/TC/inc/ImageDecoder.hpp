@@ -0,0 +1,94 @@
+/*
+ * Copyright 2020 NVIDIA Corporation
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "MemoryInterfaces.hpp"
+#include "Numa.hpp"
+#include "TC_CORE.hpp"
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace VPF {
+
+struct ImageDecoderParams {
+  // RGB, BGR, RGB_PLANAR or Y;
+  Pixel_Format format = RGB;
+
+  // Every image is resized to that; Area filter downscales, bilinear upscales;
+  uint32_t width = 0U;
+  uint32_t height = 0U;
+
+  uint32_t num_threads = 4U;
+
+  /* Where threads run; If policy keeps them on single node, batches are
+   * allocated on it as well;
+   */
+  ThreadPlacement placement;
+
+  // Batches are accounted to that name in MemoryBudget;
+  std::string pipeline = "ImageDecoder";
+};
+
+/* Encoded image, either file path or memory blob; Blob memory must stay
+ * valid until decoding is done;
+ */
+struct ImageSource {
+  std::string path;
+  const uint8_t *data = nullptr;
+  size_t size = 0U;
+};
+
+struct ImageInfo {
+  bool decoded = false;
+  // Size of encoded image;
+  uint32_t width = 0U;
+  uint32_t height = 0U;
+  std::string error;
+};
+
+/* Decodes batches of JPEG, PNG and WebP images with libavcodec on thread
+ * pool; Every thread keeps its own decoder contexts, so they are opened
+ * once; Color conversion and resize are done in the same pass which
+ * writes output frame;
+ * Frames of a batch are stacked one after another in single Buffer; Those
+ * come from the pool of decoder and go back to it once released;
+ */
+class DllExport ImageDecoder {
+public:
+  ImageDecoder() = delete;
+  ImageDecoder(const ImageDecoder &other) = delete;
+  ImageDecoder &operator=(const ImageDecoder &other) = delete;
+
+  // Throws std::invalid_argument if format or size isn't supported;
+  static ImageDecoder *Make(const ImageDecoderParams &params);
+
+  ~ImageDecoder();
+
+  /* Decodes all images; Image which can't be decoded has its frame filled
+   * with zeros and error in info; Returned buffer is GetFrameSize() times
+   * number of sources; Waits for MemoryBudget if it's exhausted;
+   */
+  std::shared_ptr<Buffer> DecodeBatch(const std::vector<ImageSource> &sources,
+                                      std::vector<ImageInfo> &info);
+
+  size_t GetFrameSize() const;
+  void GetParams(ImageDecoderParams &params) const;
+
+private:
+  explicit ImageDecoder(const ImageDecoderParams &params);
+
+  struct ImageDecoder_Impl *pImpl = nullptr;
+};
+} // namespace VPF
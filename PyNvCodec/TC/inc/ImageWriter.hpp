@@ -0,0 +1,109 @@
+/*
+ * Copyright 2020 NVIDIA Corporation
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "AsyncWriter.hpp"
+#include "MemoryBudget.hpp"
+#include "MemoryInterfaces.hpp"
+#include "Numa.hpp"
+#include "TC_CORE.hpp"
+#include <memory>
+
+namespace VPF {
+
+enum ImageCodec { IMAGE_JPEG, IMAGE_PNG, IMAGE_WEBP };
+
+struct ImageWriterParams {
+  ImageCodec codec = IMAGE_JPEG;
+
+  // JPEG and WebP quality, 1 to 100;
+  uint32_t quality = 90U;
+
+  // PNG zlib compression level, 0 to 9;
+  uint32_t compression_level = 3U;
+
+  // Number substituted into path template for the first image;
+  uint32_t start_number = 0U;
+
+  uint32_t num_threads = 4U;
+
+  /* Where threads run; If policy keeps them on single node, frame copies are
+   * allocated on it as well;
+   */
+  ThreadPlacement placement;
+
+  /* YUV frames come from decoder in limited (TV) range, JPEG and PNG want
+   * full range, so samples are expanded unless this is set;
+   */
+  bool full_range = false;
+
+  /* Frame copies are accounted to that name in MemoryBudget; With drop
+   * policy frame is skipped if there's no free copy and budget doesn't
+   * allow another one;
+   */
+  std::string pipeline = "ImageWriter";
+  BudgetPolicy budget_policy = BudgetPolicy::BUDGET_BLOCK;
+};
+
+/* Encodes host frames to image files by libavcodec on thread pool; Every
+ * thread has its own encoder context, files go through AsyncWriter;
+ * JPEG and WebP take YUV frames as is, no RGB conversion is done;
+ * PNG takes RGB, YUV420 and NV12 are converted the same way ConvertSurface
+ * does on GPU; YUV444 can't be written as PNG;
+ * Path template has single integer conversion, e. g. frame_%06d.jpg;
+ * Input 0 is Buffer with frame, it's copied and Execute() returns before
+ * image is encoded;
+ */
+class DllExport ImageWriter final : public Task {
+public:
+  ImageWriter() = delete;
+  ImageWriter(const ImageWriter &other) = delete;
+  ImageWriter &operator=(const ImageWriter &other) = delete;
+
+  /* Throws std::invalid_argument if format or template isn't supported and
+   * std::runtime_error if FFmpeg has no such encoder; Null writer means
+   * default one;
+   */
+  static ImageWriter *Make(const char *path_template, uint32_t width,
+                           uint32_t height, Pixel_Format format,
+                           const ImageWriterParams &params = ImageWriterParams(),
+                           std::shared_ptr<AsyncWriter> writer = nullptr);
+
+  // Waits for pending images;
+  ~ImageWriter() final;
+
+  /* Blocks if all threads are busy and their queue is full; Frame dropped
+   * by budget policy isn't a failure, its number is skipped;
+   */
+  TaskExecStatus Execute() final;
+
+  /* Waits until all images are encoded and written; Returns false if any of
+   * them has failed;
+   */
+  bool Flush();
+
+  uint64_t GetNumImages() const;
+  uint64_t GetNumFailed() const;
+  uint64_t GetNumDropped() const;
+
+private:
+  static const uint32_t numInputs = 1U;
+  static const uint32_t numOutputs = 0U;
+
+  struct ImageWriter_Impl *pImpl = nullptr;
+  ImageWriter(const char *path_template, uint32_t width, uint32_t height,
+              Pixel_Format format, const ImageWriterParams &params,
+              std::shared_ptr<AsyncWriter> writer);
+};
+} // namespace VPF
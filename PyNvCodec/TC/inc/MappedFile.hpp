@@ -0,0 +1,43 @@
+/*
+ * Copyright 2020 NVIDIA Corporation
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "TC_CORE.hpp"
+#include <cstddef>
+#include <cstdint>
+
+namespace VPF {
+
+/* Memory mapped file; Mapping is private, so writes to it go to process
+ * copy of the page rather than file;
+ */
+class DllExport MappedFile {
+public:
+  MappedFile() = delete;
+  MappedFile(const MappedFile &other) = delete;
+  MappedFile &operator=(const MappedFile &other) = delete;
+
+  /* Throws std::runtime_error if file can't be mapped; Sequential flag
+   * tells OS to read ahead aggressively;
+   */
+  explicit MappedFile(const char *path, bool sequential = true);
+  ~MappedFile();
+
+  uint8_t *Data() const;
+  size_t Size() const;
+
+private:
+  struct MappedFile_Impl *pImpl = nullptr;
+};
+} // namespace VPF
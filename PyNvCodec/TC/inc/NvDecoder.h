@@ -48,15 +48,31 @@ public:
 
   int GetBitDepth();
 
+  /* Timestamp is attached to packet and goes through parser reordering;
+   * If surface is returned, timestamp of packet it was decoded from is
+   * written to pSurfaceTimestamp;
+   */
   bool DecodeLockSurface(const uint8_t *pData, size_t nSize,
                          CUdeviceptr &decSurface, bool &isFrameReturned,
-                         uint32_t flags = 0U);
+                         uint32_t flags = 0U, int64_t timestamp = 0,
+                         int64_t *pSurfaceTimestamp = nullptr);
 
   void UnlockSurface(CUdeviceptr &lockedSurface);
 
   cudaVideoCodec GetCodec() const;
 
+  /* Prepares decoder for new input of the same codec and format; Parser is
+   * re-created while HW decoder is kept, so that new input doesn't pay for
+   * cuvidCreateDecoder; Input of other resolution is handled by decoder
+   * reconfiguration as long as it isn't bigger than the first one;
+   * Locked surfaces must be unlocked before; Returns false if decoder
+   * faced error and can't be reused;
+   */
+  bool Reset();
+
 private:
+  void CreateParser();
+
   /* All the functions with Handle* prefix doesn't
    * throw as they are called from different thread;
    */
@@ -83,5 +99,7 @@ private:
 
   int ReconfigureDecoder(CUVIDEOFORMAT *pVideoFormat);
 
+  int ReconfigureForNewInput(CUVIDEOFORMAT *pVideoFormat, int nDecodeSurface);
+
   struct NvDecoderImpl *p_impl;
 };
@@ -0,0 +1,111 @@
+/*
+ * Copyright 2020 NVIDIA Corporation
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#if defined(_WIN32)
+#define DllExport __declspec(dllexport)
+#else
+#define DllExport
+#endif
+
+#include "CodecsSupport.hpp"
+#include "cuviddec.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace VPF {
+
+/* Video stream properties taken from H.264 / HEVC parameter sets;
+ * Colour description values are ISO/IEC 23091-2 codes, 2 is unspecified;
+ */
+struct VideoStreamInfo {
+  cudaVideoCodec codec = cudaVideoCodec_NumCodecs;
+  uint32_t profile = 0U;
+  uint32_t level = 0U;
+  // HEVC only, 0 is main tier;
+  uint32_t tier = 0U;
+
+  // Decoded picture size, multiple of MB / CTB;
+  uint32_t coded_width = 0U;
+  uint32_t coded_height = 0U;
+
+  // Picture size after conformance cropping;
+  uint32_t width = 0U;
+  uint32_t height = 0U;
+  uint32_t crop_left = 0U;
+  uint32_t crop_right = 0U;
+  uint32_t crop_top = 0U;
+  uint32_t crop_bottom = 0U;
+
+  // 0 is monochrome, 1 is 4:2:0, 2 is 4:2:2, 3 is 4:4:4;
+  uint32_t chroma_format_idc = 1U;
+  uint32_t bit_depth_luma = 8U;
+  uint32_t bit_depth_chroma = 8U;
+  bool progressive = true;
+
+  uint32_t sar_width = 0U;
+  uint32_t sar_height = 0U;
+  bool video_full_range = false;
+  uint32_t colour_primaries = 2U;
+  uint32_t transfer_characteristics = 2U;
+  uint32_t matrix_coefficients = 2U;
+
+  // Timing info, frame rate is zero if stream has none;
+  uint32_t num_units_in_tick = 0U;
+  uint32_t time_scale = 0U;
+  double frame_rate = 0.0;
+
+  // PPS flags, valid if has_pps is set;
+  bool has_pps = false;
+  bool cabac = false;
+  bool tiles = false;
+  bool wavefront = false;
+};
+
+/* Parses SPS (and PPS / VPS if there are any) from avcC / hvcC extradata
+ * or Annex B byte stream, e. g. extradata of MPEG-TS stream or first
+ * keyframe; Emulation prevention bytes are handled;
+ * Returns true if SPS is found and parsed;
+ */
+DllExport bool ParseParameterSets(cudaVideoCodec codec, const uint8_t *data,
+                                  size_t size, VideoStreamInfo &info);
+
+struct AccessUnitInfo {
+  FrameType frame_type = FRAME_TYPE_UNKNOWN;
+  bool is_idr = false;
+  // False for H.264 pictures with zero nal_ref_idc and HEVC sub-layer
+  // non-reference pictures;
+  bool is_reference = false;
+};
+
+/* Classifies Annex B access units by their slice headers, no decoding is
+ * done; Picture type is taken from the first slice (segment), access unit
+ * isn't scanned any further;
+ * HEVC slice header layout depends on PPS, so access units are to be
+ * given in decode order with parameter sets in-band;
+ */
+class DllExport SliceHeaderParser {
+public:
+  explicit SliceHeaderParser(cudaVideoCodec codec);
+
+  // Returns false if access unit has no slices;
+  bool Parse(const uint8_t *data, size_t size, AccessUnitInfo &info);
+
+private:
+  cudaVideoCodec codec;
+  // HEVC num_extra_slice_header_bits indexed by PPS id;
+  std::vector<uint8_t> extraSliceHeaderBits;
+};
+} // namespace VPF
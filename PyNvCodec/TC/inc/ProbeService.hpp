@@ -0,0 +1,109 @@
+/*
+ * Copyright 2020 NVIDIA Corporation
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#if defined(_WIN32)
+#define DllExport __declspec(dllexport)
+#else
+#define DllExport
+#endif
+
+#include "cuviddec.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace VPF {
+
+/* Video file properties; File is identified by path, size and modification
+ * time, so record is stale once file is changed;
+ */
+struct MediaInfo {
+  std::string path;
+  uint64_t file_size = 0U;
+  int64_t mtime = 0;
+
+  // Empty if file was probed successfully;
+  std::string error;
+
+  cudaVideoCodec codec = cudaVideoCodec_NumCodecs;
+  uint32_t profile = 0U;
+  uint32_t level = 0U;
+  uint32_t width = 0U;
+  uint32_t height = 0U;
+  uint32_t chroma_format_idc = 1U;
+  uint32_t bit_depth = 8U;
+
+  double frame_rate = 0.0;
+  double duration = 0.0;
+  int64_t bit_rate = 0;
+  int64_t num_frames = 0;
+
+  // GOP structure, zeros if input has no index and scan is disabled;
+  uint64_t num_keyframes = 0U;
+  uint32_t max_gop_size = 0U;
+  double avg_gop_size = 0.0;
+};
+
+struct ProbeStats {
+  uint64_t num_probed = 0U;
+  // Files skipped because database record is up to date;
+  uint64_t num_cached = 0U;
+  uint64_t num_failed = 0U;
+  double probe_sec = 0.0;
+};
+
+/* Probes video files concurrently and keeps results in on-disk database;
+ * Files are probed again only if their size or modification time has
+ * changed, so repeated scans of large catalogs are incremental;
+ *
+ * Database is append-only binary log, the last record of path wins; It's
+ * compacted upon load and flushed every few hundred records, so crashed
+ * scan loses only the last ones;
+ */
+class DllExport ProbeService {
+public:
+  ProbeService() = delete;
+  ProbeService(const ProbeService &other) = delete;
+  ProbeService &operator=(const ProbeService &other) = delete;
+
+  ~ProbeService();
+
+  /* Zero num_threads means number of CPU cores; If scan_gop is true, inputs
+   * without complete container index (MPEG-TS, raw streams) are read
+   * through to get frame count and GOP structure;
+   */
+  static ProbeService *Make(const std::string &db_path,
+                            uint32_t num_threads = 0U, bool scan_gop = false);
+
+  /* Probes files which aren't in database or have changed since;
+   * Failed probes are stored too, with error message;
+   */
+  ProbeStats Probe(const std::vector<std::string> &paths);
+
+  /* Returns database records for given paths, record of path which isn't in
+   * database has error set; Files aren't checked for changes;
+   */
+  std::vector<MediaInfo> Query(const std::vector<std::string> &paths) const;
+
+  std::vector<MediaInfo> QueryAll() const;
+
+  size_t Size() const;
+
+private:
+  ProbeService(const std::string &db_path, uint32_t num_threads,
+               bool scan_gop);
+  struct ProbeService_Impl *pImpl = nullptr;
+};
+} // namespace VPF
@@ -0,0 +1,111 @@
+/*
+ * Copyright 2020 NVIDIA Corporation
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "HostTransform.hpp"
+#include "MemoryInterfaces.hpp"
+#include "TC_CORE.hpp"
+
+namespace VPF {
+
+/* Raw video frames layout; Planes of every frame are packed one after
+ * another, the same way CudaDownloadSurface gives them;
+ */
+struct RawVideoParams {
+  uint32_t width = 0U;
+  uint32_t height = 0U;
+  Pixel_Format format = UNDEFINED;
+  // Zero if unknown;
+  double frame_rate = 0.0;
+};
+
+/* Reads .yuv or .y4m file; Y4M is detected by file signature, its header
+ * overrides given parameters; Y4M 420, 444 and mono streams are supported,
+ * as well as any format written by RawVideoWriter;
+ * File is memory-mapped, output 0 is Buffer which points to mapped frame,
+ * so no pixels are copied; It stays valid until the next Execute() call;
+ */
+class DllExport RawVideoReader final : public Task {
+public:
+  RawVideoReader() = delete;
+  RawVideoReader(const RawVideoReader &other) = delete;
+  RawVideoReader &operator=(const RawVideoReader &other) = delete;
+
+  static RawVideoReader *Make(const char *path,
+                              const RawVideoParams &params = RawVideoParams());
+
+  ~RawVideoReader() final;
+
+  // Outputs next frame, fails at the end of file;
+  TaskExecStatus Execute() final;
+
+  void GetParams(RawVideoParams &params) const;
+
+  uint64_t GetNumFrames() const;
+
+  // Index of frame next Execute() call outputs;
+  uint64_t GetFrameIndex() const;
+
+  // Returns false if there's no such frame;
+  bool Seek(uint64_t frame_index);
+
+  // Random access without moving read position; nullptr if there's no frame;
+  const uint8_t *GetFrame(uint64_t frame_index) const;
+
+  size_t GetFrameSize() const;
+
+private:
+  static const uint32_t numInputs = 0U;
+  static const uint32_t numOutputs = 1U;
+
+  struct RawVideoReader_Impl *pImpl = nullptr;
+  RawVideoReader(const char *path, const RawVideoParams &params);
+};
+
+/* Writes raw frames to .yuv file, or .y4m if y4m flag is set; Formats Y4M
+ * has no colorspace for are tagged with XVPF_FORMAT, so RawVideoReader
+ * reads them back;
+ * File is written through default AsyncWriter, so Execute() only copies
+ * frame to memory;
+ * Input 0 is Buffer with frame;
+ */
+class DllExport RawVideoWriter final : public Task {
+public:
+  RawVideoWriter() = delete;
+  RawVideoWriter(const RawVideoWriter &other) = delete;
+  RawVideoWriter &operator=(const RawVideoWriter &other) = delete;
+
+  static RawVideoWriter *Make(const char *path, const RawVideoParams &params,
+                              bool y4m);
+
+  // Flushes pending data;
+  ~RawVideoWriter() final;
+
+  TaskExecStatus Execute() final;
+
+  /* Waits until everything is on disk; Returns false if any write has
+   * failed;
+   */
+  bool Flush();
+
+  uint64_t GetNumFrames() const;
+
+private:
+  static const uint32_t numInputs = 1U;
+  static const uint32_t numOutputs = 0U;
+
+  struct RawVideoWriter_Impl *pImpl = nullptr;
+  RawVideoWriter(const char *path, const RawVideoParams &params, bool y4m);
+};
+} // namespace VPF
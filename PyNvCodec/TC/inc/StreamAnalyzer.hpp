@@ -0,0 +1,94 @@
+/*
+ * Copyright 2020 NVIDIA Corporation
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "Tasks.hpp"
+#include <map>
+#include <string>
+#include <vector>
+
+namespace VPF {
+
+struct StreamAnalyzerParams {
+  std::string input;
+  std::map<std::string, std::string> demux_options;
+
+  // Bitrate is measured over windows of that length, starting every step;
+  double window_sec = 1.0;
+  double step_sec = 1.0;
+};
+
+/* Frames from keyframe up to the next one, in decode order;
+ */
+struct GopInfo {
+  uint64_t first_packet = 0U;
+  uint32_t num_frames = 0U;
+  uint32_t num_i = 0U;
+  uint32_t num_p = 0U;
+  uint32_t num_b = 0U;
+  uint64_t num_bytes = 0U;
+  // Distance to the next keyframe;
+  double duration_sec = 0.0;
+  bool is_idr = false;
+};
+
+struct StreamAnalysis {
+  uint64_t num_frames = 0U;
+  uint64_t num_i = 0U;
+  uint64_t num_p = 0U;
+  uint64_t num_b = 0U;
+  // Frames slice headers couldn't be parsed for;
+  uint64_t num_unknown = 0U;
+  uint64_t num_idr = 0U;
+  uint64_t num_reference = 0U;
+  // Longest run of consecutive B frames in decode order;
+  uint32_t max_consecutive_b = 0U;
+
+  uint64_t num_bytes = 0U;
+  double duration_sec = 0.0;
+  double avg_bitrate = 0.0;
+  double max_bitrate = 0.0;
+
+  std::vector<GopInfo> gops;
+
+  // Bits per second of every window;
+  std::vector<double> bitrate;
+};
+
+/* Reads through input without decoding and classifies every access unit
+ * by its slice headers; Gives GOP structure, frame type statistics and
+ * bitrate curve at demuxing speed;
+ * GOP starts at packet which container marks as keyframe, or at IDR if
+ * container has no keyframe flags;
+ */
+class DllExport StreamAnalyzer {
+public:
+  StreamAnalyzer() = delete;
+  StreamAnalyzer(const StreamAnalyzer &other) = delete;
+  StreamAnalyzer &operator=(const StreamAnalyzer &other) = delete;
+
+  ~StreamAnalyzer();
+  static StreamAnalyzer *Make(const StreamAnalyzerParams &params);
+
+  /* Returns number of analyzed packets; Throws on error;
+   */
+  uint64_t Run();
+
+  void GetAnalysis(StreamAnalysis &analysis) const;
+
+private:
+  explicit StreamAnalyzer(const StreamAnalyzerParams &params);
+  struct StreamAnalyzer_Impl *pImpl = nullptr;
+};
+} // namespace VPF
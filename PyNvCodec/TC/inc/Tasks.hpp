@@ -12,11 +12,15 @@
  */
 
 #pragma once
+#include "AsyncWriter.hpp"
 #include "CodecsSupport.hpp"
+#include "HostTransform.hpp"
 #include "MemoryInterfaces.hpp"
 #include "NvCodecCLIOptions.h"
+#include "ParameterSets.hpp"
 #include "TC_CORE.hpp"
 #include "cuviddec.h"
+#include <vector>
 
 extern "C" {
   #include <libavutil/frame.h>
@@ -51,6 +55,11 @@ private:
   struct NvencEncodeFrame_Impl *pImpl = nullptr;
 };
 
+/* Input 1 is optional Buffer with PacketData of given packet; It's given
+ * back at output 1 along with surface decoded from that packet, after
+ * reordering; Without input packet data, output timestamps are
+ * AV_NOPTS_VALUE;
+ */
 class DllExport NvdecDecodeFrame final : public Task {
 public:
   NvdecDecodeFrame() = delete;
@@ -61,6 +70,13 @@ public:
                              uint32_t &elemSize);
   TaskExecStatus Execute() final;
   uint32_t GetDeviceFramePitch();
+
+  /* Makes decoder ready for new input of the same codec, format and size;
+   * HW decoder is kept, see NvDecoder::Reset; Returns false if decoder
+   * can't be reused;
+   */
+  bool Reset();
+
   ~NvdecDecodeFrame() final;
   static NvdecDecodeFrame *Make(CUstream cuStream, CUcontext cuContext,
                                 cudaVideoCodec videoCodec,
@@ -69,8 +85,10 @@ public:
                                 Pixel_Format format);
 
 private:
-  static const uint32_t numInputs = 1U;
-  static const uint32_t numOutputs = 1U;
+  // Elementary video + optional packet data;
+  static const uint32_t numInputs = 2U;
+  // Decoded surface + packet data of the surface;
+  static const uint32_t numOutputs = 2U;
   struct NvdecDecodeFrame_Impl *pImpl = nullptr;
 
   NvdecDecodeFrame(CUstream cuStream, CUcontext cuContext,
@@ -79,6 +97,21 @@ private:
                    Pixel_Format format);
 };
 
+/* Errors met by FfmpegDecodeFrame since it was made;
+ */
+struct DllExport DecodeErrorStats {
+  // Errors reported by decoder, mostly corrupt bitstream;
+  uint64_t num_decode_errors = 0U;
+  // Read errors other than end of input;
+  uint64_t num_demux_errors = 0U;
+  // Video packets dropped while waiting for keyframe, a frame each;
+  uint64_t num_skipped_frames = 0U;
+  // Frames output with errors concealed by decoder;
+  uint64_t num_corrupt_frames = 0U;
+  // Times decoding went on from keyframe after error;
+  uint64_t num_recoveries = 0U;
+};
+
 class DllExport FfmpegDecodeFrame final : public Task {
 public:
   FfmpegDecodeFrame() = delete;
@@ -88,17 +121,46 @@ public:
   TaskExecStatus Execute() final;
   TaskExecStatus GetSideData(AVFrameSideDataType);
 
+  /* Size of the last decoded frame after crop and downscale;
+   */
+  void GetFrameParams(uint32_t &width, uint32_t &height) const;
+
+  /* Next Execute() outputs frame with given pts or the first one after it;
+   * Frames before it are decoded but not copied out; Decoder seeks to the
+   * keyframe which precedes pts, unless pts is ahead within GOP being
+   * decoded, then it just decodes forward; Pts is in stream time base;
+   */
+  bool Seek(int64_t pts);
+
+  // Stream time base in seconds and pts of its first frame;
+  double GetTimebase() const;
+  int64_t GetStartPts() const;
+
+  /* In resilient mode corrupt data and read errors don't fail Execute();
+   * Decoder is flushed, video packets are dropped until the next keyframe
+   * and decoding goes on with the same demuxer and decoder; Execute() still
+   * fails at the end of input, on errors which won't go away (e. g. out of
+   * memory) and after max_errors errors in a row without decoded frame;
+   */
+  void SetErrorResilience(bool enable, uint32_t max_errors = 16U);
+  void GetErrorStats(DecodeErrorStats &stats) const;
+
   ~FfmpegDecodeFrame() final;
-  static FfmpegDecodeFrame *Make(const char *URL,
-                                 NvDecoderClInterface &cli_iface);
+  /* Decoded frame is transformed as described by copy_params while it's
+   * copied to output, default is plain YUV420 copy;
+   */
+  static FfmpegDecodeFrame *
+  Make(const char *URL, NvDecoderClInterface &cli_iface,
+       const FrameCopyParams &copy_params = FrameCopyParams());
 
 private:
   static const uint32_t num_inputs = 0U;
-  // Reconstructed pixels + side data;
-  static const uint32_t num_outputs = 2U;
+  // Reconstructed pixels + side data + packet data of the frame;
+  static const uint32_t num_outputs = 3U;
   struct FfmpegDecodeFrame_Impl *pImpl = nullptr;
 
-  FfmpegDecodeFrame(const char *URL, NvDecoderClInterface &cli_iface);
+  FfmpegDecodeFrame(const char *URL, NvDecoderClInterface &cli_iface,
+                    const FrameCopyParams &copy_params);
 };
 
 class DllExport CudaUploadFrame final : public Task {
@@ -149,6 +211,33 @@ public:
   DemuxFrame &operator=(const DemuxFrame &other) = delete;
 
   void GetParams(struct MuxingParams &params) const;
+
+  /* Builds keyframes index and rewinds to the beginning;
+   * See FFmpegDemuxer::GetKeyframeIndex for details;
+   */
+  bool GetKeyframeIndex(std::vector<KeyframeIndexEntry> &index,
+                        uint64_t &num_packets);
+
+  /* Seeks to keyframe, next Execute() call returns keyframe or one of
+   * packets preceding it;
+   */
+  bool Seek(const KeyframeIndexEntry &keyframe);
+
+  /* Rebinds demuxer to another input, see FFmpegDemuxer::Reopen;
+   */
+  bool Reopen(const char *url, const char **ffmpeg_options,
+              uint32_t opts_size);
+
+  /* Video stream info parsed from H.264 / HEVC parameter sets;
+   * Returns false if there's none;
+   */
+  bool GetStreamInfo(VideoStreamInfo &info) const;
+
+  /* Fills frame type of output packet data, see
+   * FFmpegDemuxer::EnableSliceParsing;
+   */
+  void EnableSliceParsing(bool enable);
+
   TaskExecStatus Execute() final;
   ~DemuxFrame() final;
   static DemuxFrame *Make(const char *url, const char **ffmpeg_options,
@@ -161,6 +250,10 @@ private:
   struct DemuxFrame_Impl *pImpl = nullptr;
 };
 
+/* Writes elementary video packets to container;
+ * Packet pts and dts are taken from muxing params packet data and are given
+ * in 1 / frameRate units;
+ */
 class DllExport MuxFrame final : public Task {
 public:
   MuxFrame() = delete;
@@ -169,14 +262,20 @@ public:
 
   TaskExecStatus Execute() final;
   ~MuxFrame() final;
-  static MuxFrame *Make(const char *url);
+
+  /* If writer is given, url is treated as local file path and muxer output
+   * goes through it instead of blocking avio writes;
+   */
+  static MuxFrame *Make(const char *url,
+                        std::shared_ptr<AsyncWriter> writer = nullptr);
 
 private:
-  MuxFrame(const char *url);
+  MuxFrame(const char *url, std::shared_ptr<AsyncWriter> writer);
   static const uint32_t numInputs = 2U;
   static const uint32_t numOutputs = 0U;
   struct MuxFrame_Impl *pImpl = nullptr;
   char *output = nullptr;
+  std::shared_ptr<AsyncWriter> writer;
 };
 
 class DllExport ConvertSurface final : public Task {
@@ -224,4 +323,100 @@ private:
   ResizeSurface(uint32_t width, uint32_t height, Pixel_Format format,
                 CUcontext ctx, CUstream str);
 };
+
+enum FrameRateMode {
+  // Frame is passed at most once, gaps in input stay gaps in output;
+  FRC_DROP = 0,
+  /* Output slot is taken by frame closest to it rather than the next one;
+   * Next frame time is predicted from the last frame interval, so frames
+   * aren't delayed;
+   */
+  FRC_NEAREST = 1,
+  // Constant rate output, frame is repeated to fill gaps;
+  FRC_DUPLICATE = 2
+};
+
+struct FrameRateParams {
+  double target_fps = 0.0;
+  // Input timestamps time base in seconds;
+  double time_base = 0.0;
+  // Used to count time if input has no timestamps;
+  double src_fps = 0.0;
+  FrameRateMode mode = FRC_NEAREST;
+
+  /* Input is packets in decode order; Non-reference packets whose output
+   * slot is already taken by another packet are dropped before decoding,
+   * exact selection is done by frame level converter after decoder;
+   * Packet data has to come from demuxer with slice parsing enabled, no
+   * packet is dropped otherwise;
+   */
+  bool packet_level = false;
+};
+
+/* Chooses frames for target frame rate by their timestamps, no pixels are
+ * touched; Output slots are multiples of 1 / target_fps, so converters
+ * placed before and after decoder agree on them;
+ * Input 0 is any token (surface, frame or packet), input 1 is optional
+ * Buffer with PacketData; Output 0 is the same token or nullptr if it's
+ * dropped, output 1 is PacketData with duration of output slots it takes;
+ */
+class DllExport FrameRateConverter final : public Task {
+public:
+  FrameRateConverter() = delete;
+  FrameRateConverter(const FrameRateConverter &other) = delete;
+  FrameRateConverter &operator=(const FrameRateConverter &other) = delete;
+
+  static FrameRateConverter *Make(const FrameRateParams &params);
+
+  ~FrameRateConverter() final;
+
+  TaskExecStatus Execute() final;
+
+  /* Same decision as Execute makes, without tokens; Returns number of
+   * output slots given frame takes, 0 means it's dropped;
+   */
+  uint32_t Select(const PacketData *pPktData);
+
+  // Number of output slots taken by the last input;
+  uint32_t GetNumRepeats() const;
+
+  void Reset();
+
+private:
+  static const uint32_t numInputs = 2U;
+  static const uint32_t numOutputs = 2U;
+
+  struct FrameRateConverter_Impl *pImpl = nullptr;
+  explicit FrameRateConverter(const FrameRateParams &params);
+};
+
+/* Rotates, flips and optionally downscales host frames; Input 0 and
+ * output 0 are Buffers with frame planes packed one after another;
+ * Rotation and downscale are done in single pass, see RotateHostFrame;
+ */
+class DllExport RotateFrame final : public Task {
+public:
+  RotateFrame() = delete;
+  RotateFrame(const RotateFrame &other) = delete;
+  RotateFrame &operator=(const RotateFrame &other) = delete;
+
+  static RotateFrame *Make(uint32_t width, uint32_t height,
+                           Pixel_Format format, const RotateParams &params,
+                           uint32_t num_threads = 1U);
+
+  ~RotateFrame() final;
+
+  TaskExecStatus Execute() final;
+
+  // Output frame size;
+  void GetFrameParams(uint32_t &width, uint32_t &height) const;
+
+private:
+  static const uint32_t numInputs = 1U;
+  static const uint32_t numOutputs = 1U;
+
+  struct RotateFrame_Impl *pImpl = nullptr;
+  RotateFrame(uint32_t width, uint32_t height, Pixel_Format format,
+              const RotateParams &params, uint32_t num_threads);
+};
 } // namespace VPF
\ No newline at end of file
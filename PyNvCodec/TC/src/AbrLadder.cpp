@@ -0,0 +1,377 @@
+/*
+ * Copyright 2020 NVIDIA Corporation
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "AbrLadder.hpp"
+#include "EncodedOutput.hpp"
+#include "Logger.hpp"
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+
+using namespace VPF;
+using namespace std;
+using namespace std::chrono;
+
+constexpr auto TASK_EXEC_SUCCESS = TaskExecStatus::TASK_EXEC_SUCCESS;
+
+namespace {
+Token *RunTask(Task *task, Token *input) {
+  task->SetInput(input, 0U);
+  if (TASK_EXEC_SUCCESS != task->Run()) {
+    throw runtime_error(string(task->GetName()) + " failed");
+  }
+  return task->GetOutput(0U);
+}
+} // namespace
+
+namespace VPF {
+struct AbrLadder_Impl {
+  struct Rung {
+    // Index in params.renditions;
+    size_t idx = 0U;
+    // Rung to scale from, negative means source;
+    int parent = -1;
+    Task *resizer = nullptr;
+    Task *to_nv12 = nullptr;
+    NvencEncodeFrame *encoder = nullptr;
+    unique_ptr<EncodedOutput> output;
+    // Resized YUV420 frame, may be used by smaller rungs;
+    Surface *scaled = nullptr;
+  };
+
+  AbrLadderParams params;
+  AbrLadderStats stats;
+  MuxingParams in_params = {};
+
+  vector<pair<string, unique_ptr<Task>>> stages;
+  DemuxFrame *demuxer = nullptr;
+  NvdecDecodeFrame *decoder = nullptr;
+  Task *to_yuv420 = nullptr;
+  bool demuxer_eof = false;
+
+  // Sorted by frame area, largest first;
+  vector<Rung> rungs;
+
+  static const uint32_t poolFrameSize = 4U;
+
+  template <typename T> T *AddStage(const string &label, T *task) {
+    stages.emplace_back(label, unique_ptr<Task>(task));
+    return task;
+  }
+
+  explicit AbrLadder_Impl(const AbrLadderParams &new_params)
+      : params(new_params) {
+    if (params.renditions.empty()) {
+      throw invalid_argument("ABR ladder has no renditions");
+    }
+
+    if (!params.gop) {
+      throw invalid_argument("ABR ladder GOP must be positive");
+    }
+
+    if (params.segment_frames % params.gop) {
+      stringstream ss;
+      ss << "Segment length " << params.segment_frames
+         << " isn't multiple of GOP " << params.gop
+         << ", segments wouldn't start with IDR";
+      throw invalid_argument(ss.str());
+    }
+
+    SetupSource();
+    SetupRungs();
+  }
+
+  void SetupSource() {
+    vector<const char *> options;
+    for (auto &pair : params.demux_options) {
+      options.push_back(pair.first.c_str());
+      options.push_back(pair.second.c_str());
+    }
+
+    demuxer = AddStage("DemuxFrame",
+                       DemuxFrame::Make(params.input.c_str(), options.data(),
+                                        options.size()));
+    demuxer->GetParams(in_params);
+
+    auto &video = in_params.videoContext;
+    decoder = AddStage("NvdecDecodeFrame",
+                       NvdecDecodeFrame::Make(params.str, params.ctx,
+                                              video.codec, poolFrameSize,
+                                              video.width, video.height,
+                                              video.format));
+  }
+
+  bool IsSourceSize(const AbrRendition &rendition) const {
+    return rendition.width == in_params.videoContext.width &&
+           rendition.height == in_params.videoContext.height;
+  }
+
+  void SetupRungs() {
+    auto &video = in_params.videoContext;
+
+    for (size_t i = 0U; i < params.renditions.size(); i++) {
+      Rung rung;
+      rung.idx = i;
+      rungs.push_back(move(rung));
+    }
+
+    auto Area = [&](const Rung &rung) {
+      auto &rendition = params.renditions[rung.idx];
+      return (uint64_t)rendition.width * rendition.height;
+    };
+    stable_sort(rungs.begin(), rungs.end(),
+                [&](const Rung &a, const Rung &b) {
+                  return Area(a) > Area(b);
+                });
+
+    for (size_t i = 0U; i < rungs.size(); i++) {
+      auto &rung = rungs[i];
+      auto &rendition = params.renditions[rung.idx];
+
+      if (!rendition.width || !rendition.height) {
+        throw invalid_argument("Rendition " + rendition.output +
+                               " has zero size");
+      }
+
+      if (!IsSourceSize(rendition)) {
+        if (NV12 != video.format) {
+          throw invalid_argument("Only NV12 input may be scaled");
+        }
+
+        // There's no NV12 resizer, so whole tree works with YUV420;
+        if (!to_yuv420) {
+          to_yuv420 = AddStage(
+              "ConvertSurface nv12->yuv420",
+              ConvertSurface::Make(video.width, video.height, NV12, YUV420,
+                                   params.ctx, params.str));
+        }
+
+        // Nearest larger rung which contains this one;
+        for (int j = (int)i - 1; params.cascade && j >= 0; j--) {
+          auto &larger = params.renditions[rungs[j].idx];
+          if (rungs[j].resizer && larger.width >= rendition.width &&
+              larger.height >= rendition.height) {
+            rung.parent = j;
+            break;
+          }
+        }
+
+        stringstream label;
+        label << "ResizeSurface " << rendition.width << "x"
+              << rendition.height;
+        if (rung.parent >= 0) {
+          auto &parent = params.renditions[rungs[rung.parent].idx];
+          label << " from " << parent.width << "x" << parent.height;
+        }
+        rung.resizer = AddStage(
+            label.str(), ResizeSurface::Make(rendition.width, rendition.height,
+                                             YUV420, params.ctx, params.str));
+
+        label.str("");
+        label << "ConvertSurface yuv420->nv12 " << rendition.width << "x"
+              << rendition.height;
+        rung.to_nv12 = AddStage(
+            label.str(),
+            ConvertSurface::Make(rendition.width, rendition.height, YUV420,
+                                 NV12, params.ctx, params.str));
+      }
+
+      SetupEncoder(rung);
+    }
+  }
+
+  void SetupEncoder(Rung &rung) {
+    auto &rendition = params.renditions[rung.idx];
+    auto &video = in_params.videoContext;
+
+    auto options = params.encoder_options;
+    for (auto &pair : rendition.encoder_options) {
+      options[pair.first] = pair.second;
+    }
+
+    if (options.end() == options.find("codec")) {
+      options["codec"] = "h264";
+    }
+
+    if (options.end() == options.find("fps")) {
+      stringstream ss;
+      ss << video.frameRate;
+      options["fps"] = ss.str();
+    }
+
+    stringstream size;
+    size << rendition.width << "x" << rendition.height;
+    options["s"] = size.str();
+
+    auto enc_format = NV_ENC_BUFFER_FORMAT_NV12;
+    options["fmt"] = "NV12";
+    if (YUV444 == video.format) {
+      enc_format = NV_ENC_BUFFER_FORMAT_YUV444;
+      options["fmt"] = "YUV444";
+    }
+
+    /* Same GOP without B frames in every rendition, so keyframes are
+     * aligned and packets come in display order;
+     */
+    stringstream gop;
+    gop << params.gop;
+    options["gop"] = gop.str();
+    options["bf"] = "1";
+    options.erase("idrperiod");
+
+    NvEncoderClInterface cli_iface(options);
+    rung.encoder = AddStage(
+        "NvencEncodeFrame " + size.str(),
+        NvencEncodeFrame::Make(params.str, params.ctx, cli_iface, enc_format,
+                               rendition.width, rendition.height, false));
+
+    MuxingParams out_params = {};
+    auto &out_video = out_params.videoContext;
+    out_video.width = rendition.width;
+    out_video.height = rendition.height;
+    out_video.frameRate = video.frameRate;
+    out_video.timeBase = 1.0 / video.frameRate;
+    out_video.streamIndex = 0U;
+    out_video.codec = ("hevc" == options["codec"]) ? cudaVideoCodec_HEVC
+                                                   : cudaVideoCodec_H264;
+    out_video.format = NV12;
+    rung.output.reset(EncodedOutput::Make(rendition.output, out_params,
+                                          params.segment_frames));
+  }
+
+  Surface *NextSurface() {
+    while (true) {
+      Buffer *elementaryVideo = nullptr;
+      if (!demuxer_eof) {
+        if (TASK_EXEC_SUCCESS != demuxer->Run()) {
+          demuxer_eof = true;
+        } else {
+          elementaryVideo = (Buffer *)demuxer->GetOutput(0U);
+          if (!elementaryVideo) {
+            continue;
+          }
+        }
+      }
+
+      // Empty input after end of stream flushes the decoder;
+      decoder->SetInput(elementaryVideo, 0U);
+      auto res = decoder->Run();
+      auto surface = (Surface *)decoder->GetOutput(0U);
+      if (surface) {
+        return surface;
+      }
+
+      if (demuxer_eof) {
+        return nullptr;
+      }
+
+      if (TASK_EXEC_SUCCESS != res) {
+        throw runtime_error("NvdecDecodeFrame failed");
+      }
+    }
+  }
+
+  void ProcessFrame(Surface *surface) {
+    auto source = to_yuv420 ? RunTask(to_yuv420, surface) : nullptr;
+
+    for (auto &rung : rungs) {
+      Token *frame = surface;
+      if (rung.resizer) {
+        auto from = rung.parent < 0 ? source : rungs[rung.parent].scaled;
+        rung.scaled = (Surface *)RunTask(rung.resizer, from);
+        frame = RunTask(rung.to_nv12, rung.scaled);
+      }
+
+      rung.encoder->ClearInputs();
+      rung.output->Write((Buffer *)RunTask(rung.encoder, frame));
+    }
+  }
+
+  void FlushEncoders() {
+    for (auto &rung : rungs) {
+      while (true) {
+        // Non-zero 2nd input signals sync encode;
+        rung.encoder->ClearInputs();
+        rung.encoder->SetInput((Token *)0xdeadbeef, 1U);
+        auto packet = (Buffer *)RunTask(rung.encoder, nullptr);
+        if (!packet) {
+          break;
+        }
+        rung.output->Write(packet);
+      }
+    }
+  }
+
+  uint64_t Run() {
+    auto then = steady_clock::now();
+
+    while (auto surface = NextSurface()) {
+      ProcessFrame(surface);
+      stats.num_frames++;
+    }
+    FlushEncoders();
+
+    stats.num_packets.assign(rungs.size(), 0U);
+    stats.num_segments.assign(rungs.size(), 0U);
+    for (auto &rung : rungs) {
+      auto &rendition = params.renditions[rung.idx];
+      if (!rendition.playlist.empty()) {
+        rung.output->WritePlaylist(rendition.playlist);
+      }
+
+      stats.num_packets[rung.idx] = rung.output->GetNumPackets();
+      stats.num_segments[rung.idx] = rung.output->GetNumSegments();
+    }
+
+    stats.elapsed_sec = duration<double>(steady_clock::now() - then).count();
+    VPF_LOG(LOG_LEVEL_INFO, "AbrLadder")
+        << stats.num_frames << " frames, " << rungs.size()
+        << " renditions in " << stats.elapsed_sec << " s";
+    return stats.num_frames;
+  }
+
+  ~AbrLadder_Impl() {
+    // Outputs finalize containers, do that before tasks are gone;
+    for (auto &rung : rungs) {
+      rung.output.reset();
+    }
+
+    while (!stages.empty()) {
+      stages.pop_back();
+    }
+  }
+};
+} // namespace VPF
+
+AbrLadder *AbrLadder::Make(const AbrLadderParams &params) {
+  return new AbrLadder(params);
+}
+
+AbrLadder::AbrLadder(const AbrLadderParams &params)
+    : pImpl(new AbrLadder_Impl(params)) {}
+
+AbrLadder::~AbrLadder() { delete pImpl; }
+
+uint64_t AbrLadder::Run() { return pImpl->Run(); }
+
+void AbrLadder::GetStats(AbrLadderStats &stats) const { stats = pImpl->stats; }
+
+vector<pair<string, Task *>> AbrLadder::GetStages() const {
+  vector<pair<string, Task *>> stages;
+  for (auto &stage : pImpl->stages) {
+    stages.emplace_back(stage.first, stage.second.get());
+  }
+  return stages;
+}
@@ -0,0 +1,276 @@
+/*
+ * Copyright 2020 NVIDIA Corporation
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ActivitySampler.hpp"
+#include "FFmpegDemuxer.h"
+#include "Logger.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+using namespace VPF;
+using namespace std;
+
+namespace {
+struct Baseline {
+  double mean = 0.0;
+  double dev = 0.0;
+  uint32_t count = 0U;
+};
+
+struct KeyframeTime {
+  double time;
+  uint64_t packet;
+  int64_t pts;
+};
+
+struct ActiveFrame {
+  double time;
+  double score;
+};
+} // namespace
+
+namespace VPF {
+struct ActivityEstimator_Impl {
+  ActivityParams params;
+
+  // Packet size baselines are kept per frame type;
+  Baseline sizes[FRAME_TYPE_B + 1];
+  Baseline motion;
+
+  explicit ActivityEstimator_Impl(const ActivityParams &new_params)
+      : params(new_params) {
+    if (!params.window_frames) {
+      throw invalid_argument("Activity window must be positive");
+    }
+  }
+
+  // Deviation is floored, so that tiny noise of still stream isn't activity;
+  double Score(const Baseline &baseline, double value) const {
+    if (baseline.count < params.warmup_frames) {
+      return 0.0;
+    }
+
+    auto const dev = max(baseline.dev, max(0.05 * baseline.mean, 1e-6));
+    return (value - baseline.mean) / dev;
+  }
+
+  void Learn(Baseline &baseline, double value, bool is_active) {
+    // Plain average during warmup, exponential one afterwards;
+    auto alpha = (baseline.count < params.warmup_frames)
+                     ? 1.0 / (baseline.count + 1U)
+                     : 1.0 / params.window_frames;
+    if (is_active) {
+      alpha *= 0.1;
+    }
+
+    auto const deviation = fabs(value - baseline.mean);
+    baseline.mean += alpha * (value - baseline.mean);
+    baseline.dev += alpha * (deviation - baseline.dev);
+    baseline.count++;
+  }
+
+  double Update(FrameType frame_type, uint64_t num_bytes, double mv_energy) {
+    auto &size = sizes[frame_type];
+    auto score = Score(size, (double)num_bytes);
+    if (mv_energy >= 0.0) {
+      score = max(score, Score(motion, mv_energy));
+    }
+
+    auto const is_active = IsActive(score);
+    Learn(size, (double)num_bytes, is_active);
+    if (mv_energy >= 0.0) {
+      Learn(motion, mv_energy, is_active);
+    }
+    return score;
+  }
+
+  bool IsActive(double score) const { return score > params.threshold; }
+
+  void Reset() {
+    for (auto &size : sizes) {
+      size = Baseline();
+    }
+    motion = Baseline();
+  }
+};
+
+struct ActivitySampler_Impl {
+  string input;
+  map<string, string> demux_options;
+  ActivityParams params;
+  ActivityReport report;
+
+  ActivitySampler_Impl(const string &new_input,
+                       const map<string, string> &new_demux_options,
+                       const ActivityParams &new_params)
+      : input(new_input), demux_options(new_demux_options),
+        params(new_params) {}
+
+  void MakeSegments(vector<ActiveFrame> &active,
+                    vector<KeyframeTime> &keyframes) {
+    sort(active.begin(), active.end(),
+         [](const ActiveFrame &a, const ActiveFrame &b) {
+           return a.time < b.time;
+         });
+    sort(keyframes.begin(), keyframes.end(),
+         [](const KeyframeTime &a, const KeyframeTime &b) {
+           return a.time < b.time;
+         });
+
+    auto &segments = report.segments;
+    for (auto &frame : active) {
+      auto const start = max(0.0, frame.time - params.pre_roll_sec);
+      auto const end =
+          min(report.duration_sec, frame.time + params.post_roll_sec);
+
+      if (segments.empty() ||
+          start - segments.back().end_time > params.merge_gap_sec) {
+        ActivitySegment segment;
+        segment.start_time = start;
+        segment.end_time = end;
+        segments.push_back(segment);
+      }
+
+      auto &segment = segments.back();
+      segment.end_time = max(segment.end_time, end);
+      segment.num_active++;
+      segment.max_score = max(segment.max_score, frame.score);
+    }
+
+    double active_sec = 0.0;
+    for (auto &segment : segments) {
+      active_sec += segment.end_time - segment.start_time;
+
+      // The last keyframe at or before segment start, or the first one;
+      auto it = upper_bound(keyframes.begin(), keyframes.end(),
+                            segment.start_time,
+                            [](double time, const KeyframeTime &keyframe) {
+                              return time < keyframe.time;
+                            });
+      if (it != keyframes.begin()) {
+        --it;
+      }
+      if (it != keyframes.end()) {
+        segment.keyframe_packet = it->packet;
+        segment.keyframe_pts = it->pts;
+      }
+    }
+
+    if (report.duration_sec > 0.0) {
+      report.active_share = min(1.0, active_sec / report.duration_sec);
+    }
+  }
+
+  uint64_t Run() {
+    report = ActivityReport();
+    ActivityEstimator estimator(params);
+    FFmpegDemuxer demuxer(input.c_str(), demux_options);
+    demuxer.EnableSliceParsing(true);
+
+    auto const frame_rate = demuxer.GetFramerate();
+    auto const frame_sec = (frame_rate > 0.0) ? 1.0 / frame_rate : 0.0;
+    auto const time_base = demuxer.GetTimebase();
+
+    uint8_t *data = nullptr;
+    size_t size = 0U;
+    PacketData pkt_data = {};
+
+    bool use_timestamps = false;
+    double start_time = 0.0, end_time = 0.0;
+    vector<ActiveFrame> active;
+    vector<KeyframeTime> keyframes;
+
+    while (demuxer.Demux(data, size)) {
+      if (!size) {
+        continue;
+      }
+      demuxer.GetLastPacketData(pkt_data);
+
+      auto const num_packets = report.frames.size();
+      if (!num_packets) {
+        use_timestamps = (AV_NOPTS_VALUE != pkt_data.pts);
+        start_time = use_timestamps ? pkt_data.pts * time_base : 0.0;
+      }
+
+      FrameActivity frame;
+      frame.time = (use_timestamps && AV_NOPTS_VALUE != pkt_data.pts)
+                       ? pkt_data.pts * time_base - start_time
+                       : num_packets * frame_sec;
+      frame.num_bytes = size;
+      frame.frame_type = pkt_data.frame_type;
+      frame.is_keyframe = pkt_data.is_keyframe;
+      frame.score = estimator.Update(frame.frame_type, size);
+      frame.is_active = estimator.IsActive(frame.score);
+
+      auto const duration =
+          pkt_data.duration ? pkt_data.duration * time_base : frame_sec;
+      end_time = max(end_time, frame.time + duration);
+
+      if (frame.is_keyframe) {
+        keyframes.push_back({frame.time, num_packets, pkt_data.pts});
+      }
+      if (frame.is_active) {
+        active.push_back({frame.time, frame.score});
+        report.num_active++;
+      }
+      report.frames.push_back(frame);
+    }
+
+    report.duration_sec = end_time;
+    MakeSegments(active, keyframes);
+
+    VPF_LOG(LOG_LEVEL_INFO, "ActivitySampler")
+        << input << ": " << report.num_active << " of "
+        << report.frames.size() << " frames active, "
+        << report.segments.size() << " segments cover "
+        << report.active_share * 100.0 << "% of input";
+    return report.num_active;
+  }
+};
+} // namespace VPF
+
+ActivityEstimator::ActivityEstimator(const ActivityParams &params)
+    : pImpl(new ActivityEstimator_Impl(params)) {}
+
+ActivityEstimator::~ActivityEstimator() { delete pImpl; }
+
+double ActivityEstimator::Update(FrameType frame_type, uint64_t num_bytes,
+                                 double mv_energy) {
+  return pImpl->Update(frame_type, num_bytes, mv_energy);
+}
+
+bool ActivityEstimator::IsActive(double score) const {
+  return pImpl->IsActive(score);
+}
+
+void ActivityEstimator::Reset() { pImpl->Reset(); }
+
+ActivitySampler *
+ActivitySampler::Make(const string &input,
+                      const map<string, string> &demux_options,
+                      const ActivityParams &params) {
+  return new ActivitySampler(input, demux_options, params);
+}
+
+ActivitySampler::ActivitySampler(const string &input,
+                                 const map<string, string> &demux_options,
+                                 const ActivityParams &params)
+    : pImpl(new ActivitySampler_Impl(input, demux_options, params)) {}
+
+ActivitySampler::~ActivitySampler() { delete pImpl; }
+
+uint64_t ActivitySampler::Run() { return pImpl->Run(); }
+
+void ActivitySampler::GetReport(ActivityReport &report) const {
+  report = pImpl->report;
+}
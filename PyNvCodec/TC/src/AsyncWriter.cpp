@@ -0,0 +1,896 @@
+/*
+ * Copyright 2020 NVIDIA Corporation
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "AsyncWriter.hpp"
+#include "Logger.hpp"
+#include "MemoryBudget.hpp"
+#include "ThreadPool.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#if defined(_WIN32)
+#define NOMINMAX
+#include <malloc.h>
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#define VPF_IO_URING 1
+#ifndef __NR_io_uring_setup
+#define __NR_io_uring_setup 425
+#endif
+#ifndef __NR_io_uring_enter
+#define __NR_io_uring_enter 426
+#endif
+#endif
+#endif
+
+using namespace VPF;
+using namespace std;
+
+namespace {
+const size_t alignment = 4096U;
+
+size_t AlignUp(size_t size) {
+  return (size + alignment - 1U) & ~(alignment - 1U);
+}
+
+#if defined(_WIN32)
+typedef HANDLE native_file_t;
+const native_file_t invalid_file = INVALID_HANDLE_VALUE;
+
+bool OpenFile(const string &path, bool direct, native_file_t &file) {
+  DWORD flags = FILE_ATTRIBUTE_NORMAL;
+  if (direct) {
+    flags |= FILE_FLAG_NO_BUFFERING | FILE_FLAG_WRITE_THROUGH;
+  }
+  file = CreateFileA(path.c_str(), GENERIC_WRITE, FILE_SHARE_READ, nullptr,
+                     CREATE_ALWAYS, flags, nullptr);
+  return invalid_file != file;
+}
+
+int64_t WriteAt(native_file_t file, const uint8_t *data, size_t size,
+                int64_t offset) {
+  // File isn't opened for overlapped I/O, so this is synchronous pwrite;
+  OVERLAPPED ov = {};
+  ov.Offset = (DWORD)(offset & 0xFFFFFFFF);
+  ov.OffsetHigh = (DWORD)(offset >> 32);
+  DWORD written = 0U;
+  if (!WriteFile(file, data, (DWORD)min(size, (size_t)1U << 30U), &written,
+                 &ov)) {
+    return -1;
+  }
+  return written;
+}
+
+bool TruncateFile(native_file_t file, int64_t size) {
+  LARGE_INTEGER pos;
+  pos.QuadPart = size;
+  return SetFilePointerEx(file, pos, nullptr, FILE_BEGIN) &&
+         SetEndOfFile(file);
+}
+
+void CloseFile(native_file_t file) { CloseHandle(file); }
+
+uint8_t *AllocAligned(size_t size) {
+  return (uint8_t *)_aligned_malloc(size, alignment);
+}
+
+void FreeAligned(uint8_t *ptr) { _aligned_free(ptr); }
+#else
+typedef int native_file_t;
+const native_file_t invalid_file = -1;
+
+bool OpenFile(const string &path, bool direct, native_file_t &file) {
+  auto flags = O_WRONLY | O_CREAT | O_TRUNC;
+#ifdef O_DIRECT
+  if (direct) {
+    flags |= O_DIRECT;
+  }
+#else
+  if (direct) {
+    return false;
+  }
+#endif
+  file = open(path.c_str(), flags, 0644);
+  return invalid_file != file;
+}
+
+int64_t WriteAt(native_file_t file, const uint8_t *data, size_t size,
+                int64_t offset) {
+  return pwrite(file, data, size, offset);
+}
+
+bool TruncateFile(native_file_t file, int64_t size) {
+  return 0 == ftruncate(file, size);
+}
+
+void CloseFile(native_file_t file) { close(file); }
+
+uint8_t *AllocAligned(size_t size) {
+  void *ptr = nullptr;
+  return posix_memalign(&ptr, alignment, size) ? nullptr : (uint8_t *)ptr;
+}
+
+void FreeAligned(uint8_t *ptr) { free(ptr); }
+#endif
+
+/* Pending writes bookkeeping of single file; It's shared by file and its
+ * requests, so writes may complete after file object is gone;
+ */
+struct FileState {
+  native_file_t file = invalid_file;
+  mutex mtx;
+  condition_variable cv;
+  uint32_t pending = 0U;
+  bool failed = false;
+
+  // Set by CloseAsync(), file is closed when the last write is done;
+  function<void(bool)> on_closed;
+
+  ~FileState() {
+    if (invalid_file != file) {
+      CloseFile(file);
+    }
+    if (on_closed) {
+      on_closed(!failed);
+    }
+  }
+
+  void Begin() {
+    lock_guard<mutex> lock(mtx);
+    pending++;
+  }
+
+  void Complete(bool success) {
+    {
+      lock_guard<mutex> lock(mtx);
+      pending--;
+      failed = failed || !success;
+    }
+    cv.notify_all();
+  }
+
+  bool Wait() {
+    unique_lock<mutex> lock(mtx);
+    cv.wait(lock, [this]() { return !pending; });
+    return !failed;
+  }
+
+  bool Failed() {
+    lock_guard<mutex> lock(mtx);
+    return failed;
+  }
+};
+
+struct WriteRequest {
+  shared_ptr<FileState> state;
+  uint8_t *buffer = nullptr;
+  size_t size = 0U;
+  size_t done = 0U;
+  int64_t offset = 0;
+#ifndef _WIN32
+  struct iovec iov;
+#endif
+};
+
+typedef function<void(WriteRequest *, bool)> completion_t;
+
+/* Buffers are allocated on demand and never freed until the pool is gone;
+ * Their number is bounded by number of open files plus writes in flight;
+ * Every buffer is reserved from MemoryBudget; While writes are in flight,
+ * buffer is allocated only if budget allows right away, otherwise writer
+ * waits for one to come back from disk; With no write in flight nothing
+ * comes back, so writer waits for budget instead, or overcommits it if
+ * buffers held by open files alone leave no room for another one;
+ */
+class BufferPool {
+public:
+  BufferPool(size_t new_buffer_size, const string &new_pipeline)
+      : buffer_size(new_buffer_size), pipeline(new_pipeline),
+        budget(MemoryBudget::Instance()) {}
+
+  ~BufferPool() {
+    for (auto buffer : all_buffers) {
+      FreeAligned(buffer);
+    }
+    budget.Release(pipeline, buffer_size * all_buffers.size());
+  }
+
+  uint8_t *Acquire() {
+    unique_lock<mutex> lock(mtx);
+    while (free_buffers.empty()) {
+      auto reserved = budget.TryReserve(pipeline, buffer_size);
+      if (!reserved && !num_writing) {
+        // No buffer comes back from disk, so it's budget to wait for;
+        if (IsStarved()) {
+          VPF_LOG(LOG_LEVEL_WARNING, "AsyncWriter")
+              << "No room in memory budget for " << all_buffers.size() + 1U
+              << " write buffers, overcommitting";
+          budget.Overcommit(pipeline, buffer_size);
+        } else {
+          lock.unlock();
+          budget.Reserve(pipeline, buffer_size);
+          lock.lock();
+        }
+        reserved = true;
+      }
+
+      if (reserved) {
+        auto buffer = AllocAligned(buffer_size);
+        if (!buffer) {
+          budget.Release(pipeline, buffer_size);
+          throw bad_alloc();
+        }
+        all_buffers.push_back(buffer);
+        return buffer;
+      }
+
+      /* Buffers held by open files don't come back until they are filled,
+       * so budget is polled as well;
+       */
+      cv.wait_for(lock, chrono::milliseconds(10));
+    }
+
+    auto buffer = free_buffers.back();
+    free_buffers.pop_back();
+    return buffer;
+  }
+
+  void Release(uint8_t *buffer) {
+    lock_guard<mutex> lock(mtx);
+    free_buffers.push_back(buffer);
+    cv.notify_one();
+  }
+
+  // Buffer goes to disk, it comes back with EndWrite();
+  void BeginWrite() {
+    lock_guard<mutex> lock(mtx);
+    num_writing++;
+  }
+
+  void EndWrite(uint8_t *buffer) {
+    lock_guard<mutex> lock(mtx);
+    num_writing--;
+    free_buffers.push_back(buffer);
+    cv.notify_one();
+  }
+
+  size_t GetBufferSize() const { return buffer_size; }
+
+private:
+  size_t buffer_size;
+  string pipeline;
+  MemoryBudget &budget;
+  mutex mtx;
+  condition_variable cv;
+  vector<uint8_t *> free_buffers;
+  vector<uint8_t *> all_buffers;
+  uint32_t num_writing = 0U;
+
+  // True if buffer won't fit even after other pipelines release memory;
+  bool IsStarved() const {
+    auto const limit = budget.GetLimit();
+    return limit && buffer_size * (all_buffers.size() + 1U) > limit;
+  }
+};
+
+class WriterBackend {
+public:
+  virtual ~WriterBackend() = default;
+  virtual void Submit(WriteRequest *request) = 0;
+  virtual bool IsIoUring() const = 0;
+};
+
+class ThreadBackend final : public WriterBackend {
+public:
+  ThreadBackend(uint32_t num_threads, completion_t new_on_complete)
+      : on_complete(new_on_complete), pool(max(num_threads, 1U)) {}
+
+  void Submit(WriteRequest *request) final {
+    auto &callback = on_complete;
+    pool.Submit([request, &callback]() {
+      while (request->done < request->size) {
+        auto const res = WriteAt(
+            request->state->file, request->buffer + request->done,
+            request->size - request->done, request->offset + request->done);
+        if (res < 0 && EINTR == errno) {
+          continue;
+        }
+        if (res <= 0) {
+          break;
+        }
+        request->done += res;
+      }
+      callback(request, request->done == request->size);
+    });
+  }
+
+  bool IsIoUring() const final { return false; }
+
+private:
+  completion_t on_complete;
+  ThreadPool pool;
+};
+
+#ifdef VPF_IO_URING
+/* Single thread moves queued requests to submission ring and reaps
+ * completions; Requests of all files go through the same ring, so one
+ * io_uring_enter call submits many writes;
+ */
+class IoUringBackend final : public WriterBackend {
+public:
+  IoUringBackend(uint32_t queue_depth, atomic<uint64_t> &new_num_submits,
+                 completion_t new_on_complete)
+      : on_complete(new_on_complete), num_submits(new_num_submits) {
+    io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    ring_fd = (int)syscall(__NR_io_uring_setup, queue_depth, &params);
+    if (ring_fd < 0) {
+      stringstream ss;
+      ss << "io_uring_setup failed: " << strerror(errno);
+      throw runtime_error(ss.str());
+    }
+
+    sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_ring_size =
+        params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    auto const single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (single_mmap) {
+      sq_ring_size = cq_ring_size = max(sq_ring_size, cq_ring_size);
+    }
+
+    sq_ring = Map(sq_ring_size, IORING_OFF_SQ_RING);
+    cq_ring = single_mmap ? sq_ring : Map(cq_ring_size, IORING_OFF_CQ_RING);
+    sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+    sqes = (io_uring_sqe *)Map(sqes_size, IORING_OFF_SQES);
+    if (!sq_ring || !cq_ring || !sqes) {
+      Unmap();
+      throw runtime_error("Can't map io_uring rings");
+    }
+
+    sq_entries = params.sq_entries;
+    sq_head = (unsigned *)(sq_ring + params.sq_off.head);
+    sq_tail = (unsigned *)(sq_ring + params.sq_off.tail);
+    sq_mask = *(unsigned *)(sq_ring + params.sq_off.ring_mask);
+    sq_array = (unsigned *)(sq_ring + params.sq_off.array);
+    cq_head = (unsigned *)(cq_ring + params.cq_off.head);
+    cq_tail = (unsigned *)(cq_ring + params.cq_off.tail);
+    cq_mask = *(unsigned *)(cq_ring + params.cq_off.ring_mask);
+    cqes = (io_uring_cqe *)(cq_ring + params.cq_off.cqes);
+
+    worker = thread(&IoUringBackend::Run, this);
+  }
+
+  ~IoUringBackend() final {
+    {
+      lock_guard<mutex> lock(mtx);
+      stop = true;
+    }
+    cv.notify_all();
+    worker.join();
+    Unmap();
+  }
+
+  void Submit(WriteRequest *request) final {
+    request->iov.iov_base = request->buffer;
+    request->iov.iov_len = request->size;
+    {
+      lock_guard<mutex> lock(mtx);
+      queue.push_back(request);
+    }
+    cv.notify_one();
+  }
+
+  bool IsIoUring() const final { return true; }
+
+private:
+  uint8_t *Map(size_t size, off_t offset) {
+    auto ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, ring_fd, offset);
+    return MAP_FAILED == ptr ? nullptr : (uint8_t *)ptr;
+  }
+
+  void Unmap() {
+    if (sqes) {
+      munmap(sqes, sqes_size);
+    }
+    if (cq_ring && cq_ring != sq_ring) {
+      munmap(cq_ring, cq_ring_size);
+    }
+    if (sq_ring) {
+      munmap(sq_ring, sq_ring_size);
+    }
+    close(ring_fd);
+  }
+
+  void Run() {
+    // Submitted, but not yet completed; Only this thread touches it;
+    uint32_t in_flight = 0U;
+
+    unique_lock<mutex> lock(mtx);
+    while (true) {
+      cv.wait(lock, [&]() { return stop || !queue.empty() || in_flight; });
+      if (stop && queue.empty() && !in_flight) {
+        return;
+      }
+
+      // Completion queue is twice as big, so it never overflows;
+      auto tail = *sq_tail;
+      while (!queue.empty() && in_flight < sq_entries) {
+        auto request = queue.front();
+        queue.pop_front();
+
+        auto const index = tail & sq_mask;
+        auto sqe = &sqes[index];
+        memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode = IORING_OP_WRITEV;
+        sqe->fd = request->state->file;
+        sqe->addr = (uint64_t)(uintptr_t)&request->iov;
+        sqe->len = 1U;
+        sqe->off = request->offset + request->done;
+        sqe->user_data = (uint64_t)(uintptr_t)request;
+        sq_array[index] = index;
+
+        tail++;
+        in_flight++;
+      }
+      __atomic_store_n(sq_tail, tail, __ATOMIC_RELEASE);
+      lock.unlock();
+
+      // Entries kernel hasn't consumed yet are submitted again;
+      auto const to_submit = tail - __atomic_load_n(sq_head, __ATOMIC_ACQUIRE);
+      auto const res = syscall(__NR_io_uring_enter, ring_fd, to_submit, 1U,
+                               IORING_ENTER_GETEVENTS, nullptr, 0);
+      num_submits++;
+      if (res < 0 && EINTR != errno && EAGAIN != errno && EBUSY != errno) {
+        VPF_LOG(LOG_LEVEL_ERROR, "AsyncWriter")
+            << "io_uring_enter failed: " << strerror(errno);
+      }
+
+      Reap(in_flight);
+      lock.lock();
+    }
+  }
+
+  void Reap(uint32_t &in_flight) {
+    auto head = *cq_head;
+    auto const tail = __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE);
+    vector<WriteRequest *> retry;
+
+    for (; head != tail; head++) {
+      auto const &cqe = cqes[head & cq_mask];
+      auto request = (WriteRequest *)(uintptr_t)cqe.user_data;
+      in_flight--;
+
+      if (cqe.res > 0) {
+        request->done += cqe.res;
+        if (request->done == request->size) {
+          on_complete(request, true);
+        } else {
+          // Short write, the rest goes again;
+          request->iov.iov_base = request->buffer + request->done;
+          request->iov.iov_len = request->size - request->done;
+          retry.push_back(request);
+        }
+      } else if (-EINTR == cqe.res || -EAGAIN == cqe.res) {
+        retry.push_back(request);
+      } else {
+        on_complete(request, false);
+      }
+    }
+    __atomic_store_n(cq_head, head, __ATOMIC_RELEASE);
+
+    if (!retry.empty()) {
+      lock_guard<mutex> lock(mtx);
+      queue.insert(queue.begin(), retry.begin(), retry.end());
+    }
+  }
+
+  completion_t on_complete;
+  atomic<uint64_t> &num_submits;
+
+  int ring_fd = -1;
+  uint8_t *sq_ring = nullptr;
+  uint8_t *cq_ring = nullptr;
+  size_t sq_ring_size = 0U;
+  size_t cq_ring_size = 0U;
+  io_uring_sqe *sqes = nullptr;
+  size_t sqes_size = 0U;
+
+  uint32_t sq_entries = 0U;
+  unsigned *sq_head = nullptr;
+  unsigned *sq_tail = nullptr;
+  unsigned sq_mask = 0U;
+  unsigned *sq_array = nullptr;
+  unsigned *cq_head = nullptr;
+  unsigned *cq_tail = nullptr;
+  unsigned cq_mask = 0U;
+  io_uring_cqe *cqes = nullptr;
+
+  mutex mtx;
+  condition_variable cv;
+  deque<WriteRequest *> queue;
+  bool stop = false;
+  thread worker;
+};
+#endif
+} // namespace
+
+namespace VPF {
+struct AsyncWriter_Impl {
+  AsyncWriterParams params;
+  BufferPool pool;
+  unique_ptr<WriterBackend> backend;
+
+  mutex mtx;
+  condition_variable cv;
+  uint32_t in_flight = 0U;
+
+  atomic<uint64_t> num_writes;
+  atomic<uint64_t> num_bytes;
+  atomic<uint64_t> num_errors;
+  atomic<uint64_t> num_submits;
+
+  explicit AsyncWriter_Impl(const AsyncWriterParams &new_params)
+      : params(new_params),
+        pool(AlignUp(max(new_params.buffer_size, (size_t)1U)),
+             new_params.pipeline),
+        num_writes(0U), num_bytes(0U), num_errors(0U), num_submits(0U) {
+    params.buffer_size = pool.GetBufferSize();
+    params.max_in_flight = max(params.max_in_flight, 1U);
+
+    auto on_complete = [this](WriteRequest *request, bool success) {
+      Complete(request, success);
+    };
+
+#ifdef VPF_IO_URING
+    if (params.use_io_uring) {
+      try {
+        backend.reset(new IoUringBackend(max(params.queue_depth, 1U),
+                                         num_submits, on_complete));
+      } catch (exception &e) {
+        VPF_LOG(LOG_LEVEL_WARNING, "AsyncWriter")
+            << e.what() << ", falling back to thread pool";
+      }
+    }
+#endif
+    if (!backend) {
+      backend.reset(new ThreadBackend(params.num_threads, on_complete));
+    }
+  }
+
+  ~AsyncWriter_Impl() {
+    unique_lock<mutex> lock(mtx);
+    cv.wait(lock, [this]() { return !in_flight; });
+    lock.unlock();
+    backend.reset();
+  }
+
+  void Submit(const shared_ptr<FileState> &state, uint8_t *buffer,
+              size_t size, int64_t offset) {
+    {
+      unique_lock<mutex> lock(mtx);
+      cv.wait(lock, [this]() { return in_flight < params.max_in_flight; });
+      in_flight++;
+    }
+
+    auto request = new WriteRequest;
+    request->state = state;
+    request->buffer = buffer;
+    request->size = size;
+    request->offset = offset;
+
+    state->Begin();
+    pool.BeginWrite();
+    backend->Submit(request);
+  }
+
+  void Complete(WriteRequest *request, bool success) {
+    if (success) {
+      num_writes++;
+      num_bytes += request->size;
+    } else {
+      num_errors++;
+      VPF_LOG(LOG_LEVEL_ERROR, "AsyncWriter")
+          << "Failed to write " << request->size << " bytes at offset "
+          << request->offset;
+    }
+
+    pool.EndWrite(request->buffer);
+    request->state->Complete(success);
+    delete request;
+
+    // Notified under lock, since destructor may be waiting for the last one;
+    lock_guard<mutex> lock(mtx);
+    in_flight--;
+    cv.notify_all();
+  }
+};
+
+struct AsyncFile_Impl {
+  shared_ptr<AsyncWriter> writer;
+  AsyncWriter_Impl &impl;
+  shared_ptr<FileState> state;
+  bool direct;
+
+  // Buffer being filled and its offset in file;
+  uint8_t *buffer = nullptr;
+  size_t fill = 0U;
+  int64_t offset = 0;
+
+  int64_t size = 0;
+  int64_t submitted_end = 0;
+  bool closed = false;
+
+  AsyncFile_Impl(shared_ptr<AsyncWriter> new_writer, AsyncWriter_Impl &new_impl,
+                 const string &path, bool new_direct)
+      : writer(new_writer), impl(new_impl), state(make_shared<FileState>()),
+        direct(new_direct) {
+    if (direct && !OpenFile(path, true, state->file)) {
+      VPF_LOG(LOG_LEVEL_INFO, "AsyncWriter")
+          << "No direct I/O for " << path << ", using buffered one";
+      direct = false;
+    }
+
+    if (!direct && !OpenFile(path, false, state->file)) {
+      stringstream ss;
+      ss << "Can't open file " << path << " for writing";
+      throw runtime_error(ss.str());
+    }
+  }
+
+  ~AsyncFile_Impl() { Close(); }
+
+  bool Write(const uint8_t *data, size_t num_bytes) {
+    auto const buffer_size = impl.pool.GetBufferSize();
+    while (num_bytes) {
+      if (!buffer) {
+        buffer = impl.pool.Acquire();
+        fill = 0U;
+      }
+
+      auto const chunk = min(num_bytes, buffer_size - fill);
+      memcpy(buffer + fill, data, chunk);
+      fill += chunk;
+      data += chunk;
+      num_bytes -= chunk;
+      size = max(size, offset + (int64_t)fill);
+
+      if (buffer_size == fill) {
+        SubmitBuffer(fill);
+      }
+    }
+    return !state->Failed();
+  }
+
+  void SubmitBuffer(size_t write_size) {
+    if (!buffer) {
+      return;
+    }
+    if (!fill) {
+      impl.pool.Release(buffer);
+      buffer = nullptr;
+      return;
+    }
+
+    impl.Submit(state, buffer, write_size, offset);
+    submitted_end = max(submitted_end, offset + (int64_t)fill);
+    offset += fill;
+    buffer = nullptr;
+    fill = 0U;
+  }
+
+  bool Seek(int64_t new_offset) {
+    if (new_offset == offset + (int64_t)fill) {
+      return true;
+    }
+    if (direct || new_offset < 0) {
+      return false;
+    }
+
+    SubmitBuffer(fill);
+    if (new_offset < submitted_end) {
+      state->Wait();
+    }
+    offset = new_offset;
+    return !state->Failed();
+  }
+
+  bool Flush() {
+    if (!direct) {
+      SubmitBuffer(fill);
+    }
+    return state->Wait();
+  }
+
+  void CloseAsync(function<void(bool)> on_closed) {
+    if (direct) {
+      // Tail can only be truncated after it's written;
+      auto const success = Close();
+      if (on_closed) {
+        on_closed(success);
+      }
+      return;
+    }
+
+    if (closed) {
+      return;
+    }
+    closed = true;
+
+    SubmitBuffer(fill);
+    state->on_closed = on_closed;
+  }
+
+  bool Close() {
+    if (closed) {
+      return !state->Failed();
+    }
+    closed = true;
+
+    auto const tail = fill;
+    if (direct && tail) {
+      // Direct write has to be aligned, padding is cut away afterwards;
+      auto const padded = AlignUp(tail);
+      memset(buffer + tail, 0, padded - tail);
+      SubmitBuffer(padded);
+    } else {
+      SubmitBuffer(fill);
+    }
+
+    auto success = state->Wait();
+    if (direct && tail) {
+      success = TruncateFile(state->file, size) && success;
+    }
+    CloseFile(state->file);
+    state->file = invalid_file;
+    return success;
+  }
+};
+
+struct AsyncFileSink_Impl {
+  unique_ptr<AsyncFile> file;
+  uint64_t num_bytes = 0U;
+
+  AsyncFileSink_Impl(const char *path, shared_ptr<AsyncWriter> writer,
+                     bool direct) {
+    if (!writer) {
+      writer = AsyncWriter::GetDefault();
+    }
+    file.reset(AsyncFile::Make(writer, path, direct));
+  }
+};
+} // namespace VPF
+
+shared_ptr<AsyncWriter> AsyncWriter::Make(const AsyncWriterParams &params) {
+  return shared_ptr<AsyncWriter>(new AsyncWriter(params));
+}
+
+shared_ptr<AsyncWriter> AsyncWriter::GetDefault() {
+  static shared_ptr<AsyncWriter> writer = AsyncWriter::Make();
+  return writer;
+}
+
+AsyncWriter::AsyncWriter(const AsyncWriterParams &params) {
+  pImpl = new AsyncWriter_Impl(params);
+}
+
+AsyncWriter::~AsyncWriter() { delete pImpl; }
+
+bool AsyncWriter::IsIoUring() const { return pImpl->backend->IsIoUring(); }
+
+size_t AsyncWriter::GetBufferSize() const {
+  return pImpl->pool.GetBufferSize();
+}
+
+AsyncWriterStats AsyncWriter::GetStats() const {
+  AsyncWriterStats stats;
+  stats.num_writes = pImpl->num_writes;
+  stats.num_bytes = pImpl->num_bytes;
+  stats.num_errors = pImpl->num_errors;
+  stats.num_submits = pImpl->num_submits;
+  return stats;
+}
+
+size_t AsyncWriter::GetAlignment() { return alignment; }
+
+AsyncFile *AsyncFile::Make(shared_ptr<AsyncWriter> writer, const string &path,
+                           bool direct) {
+  return new AsyncFile(writer, path, direct);
+}
+
+AsyncFile::AsyncFile(shared_ptr<AsyncWriter> writer, const string &path,
+                     bool direct) {
+  if (!writer) {
+    throw invalid_argument("AsyncFile needs writer");
+  }
+  pImpl = new AsyncFile_Impl(writer, *writer->pImpl, path, direct);
+}
+
+AsyncFile::~AsyncFile() { delete pImpl; }
+
+bool AsyncFile::Write(const void *data, size_t size) {
+  return pImpl->Write((const uint8_t *)data, size);
+}
+
+bool AsyncFile::Seek(int64_t offset) { return pImpl->Seek(offset); }
+
+int64_t AsyncFile::Tell() const { return pImpl->offset + pImpl->fill; }
+
+int64_t AsyncFile::GetSize() const { return pImpl->size; }
+
+bool AsyncFile::Flush() { return pImpl->Flush(); }
+
+bool AsyncFile::Close() { return pImpl->Close(); }
+
+void AsyncFile::CloseAsync(function<void(bool)> on_closed) {
+  pImpl->CloseAsync(on_closed);
+}
+
+bool AsyncFile::IsDirect() const { return pImpl->direct; }
+
+AsyncFileSink *AsyncFileSink::Make(const char *path,
+                                   shared_ptr<AsyncWriter> writer,
+                                   bool direct) {
+  return new AsyncFileSink(path, writer, direct);
+}
+
+AsyncFileSink::AsyncFileSink(const char *path, shared_ptr<AsyncWriter> writer,
+                             bool direct)
+    : Task("AsyncFileSink", AsyncFileSink::numInputs,
+           AsyncFileSink::numOutputs) {
+  pImpl = new AsyncFileSink_Impl(path, writer, direct);
+}
+
+AsyncFileSink::~AsyncFileSink() { delete pImpl; }
+
+TaskExecStatus AsyncFileSink::Execute() {
+  auto pInput = (Buffer *)GetInput(0U);
+  if (!pInput) {
+    return TaskExecStatus::TASK_EXEC_FAIL;
+  }
+
+  if (!pImpl->file->Write(pInput->GetRawMemPtr(), pInput->GetRawMemSize())) {
+    VPF_LOG(LOG_LEVEL_ERROR, "AsyncFileSink") << "Failed to write data";
+    return TaskExecStatus::TASK_EXEC_FAIL;
+  }
+
+  pImpl->num_bytes += pInput->GetRawMemSize();
+  return TaskExecStatus::TASK_EXEC_SUCCESS;
+}
+
+bool AsyncFileSink::Flush() { return pImpl->file->Flush(); }
+
+uint64_t AsyncFileSink::GetNumBytes() const { return pImpl->num_bytes; }
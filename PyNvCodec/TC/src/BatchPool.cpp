@@ -0,0 +1,101 @@
+/*
+ * Copyright 2020 NVIDIA Corporation
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "BatchPool.hpp"
+#include "Numa.hpp"
+#include <memory>
+#include <mutex>
+#include <vector>
+
+using namespace VPF;
+using namespace std;
+
+namespace {
+// Batch buffers kept for reuse;
+const size_t max_pooled_batches = 4U;
+} // namespace
+
+namespace VPF {
+struct BatchPool_Impl {
+  string pipeline;
+  int node;
+  MemoryBudget &budget;
+
+  mutex mtx;
+  vector<unique_ptr<Buffer>> buffers;
+
+  BatchPool_Impl(const string &new_pipeline, int new_node)
+      : pipeline(new_pipeline), node(new_node),
+        budget(MemoryBudget::Instance()) {}
+};
+} // namespace VPF
+
+BatchPool::BatchPool(const string &pipeline, int node) {
+  pImpl = new BatchPool_Impl(pipeline, node);
+}
+
+BatchPool::~BatchPool() {
+  Trim();
+  delete pImpl;
+}
+
+Buffer *BatchPool::Acquire(size_t size, BudgetPolicy policy) {
+  {
+    lock_guard<mutex> lock(pImpl->mtx);
+    auto &buffers = pImpl->buffers;
+    for (auto it = buffers.begin(); it != buffers.end(); it++) {
+      if ((*it)->GetRawMemSize() == size) {
+        auto buffer = it->release();
+        buffers.erase(it);
+        return buffer;
+      }
+    }
+  }
+
+  // Pooled batches of other size are of no use if memory is short;
+  if (!pImpl->budget.TryReserve(pImpl->pipeline, size)) {
+    Trim();
+    if (!pImpl->budget.Reserve(pImpl->pipeline, size, policy)) {
+      return nullptr;
+    }
+  }
+  NumaNodeScope scope(pImpl->node);
+  return Buffer::MakeOwnMem(size);
+}
+
+void BatchPool::Release(Buffer *buffer) {
+  unique_ptr<Buffer> evicted;
+  {
+    lock_guard<mutex> lock(pImpl->mtx);
+    auto &buffers = pImpl->buffers;
+    if (buffers.size() == max_pooled_batches) {
+      evicted = move(buffers.front());
+      buffers.erase(buffers.begin());
+    }
+    buffers.emplace_back(buffer);
+  }
+  if (evicted) {
+    pImpl->budget.Release(pImpl->pipeline, evicted->GetRawMemSize());
+  }
+}
+
+void BatchPool::Trim() {
+  vector<unique_ptr<Buffer>> idle;
+  {
+    lock_guard<mutex> lock(pImpl->mtx);
+    idle.swap(pImpl->buffers);
+  }
+  for (auto &buffer : idle) {
+    pImpl->budget.Release(pImpl->pipeline, buffer->GetRawMemSize());
+  }
+}
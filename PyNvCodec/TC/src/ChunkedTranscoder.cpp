@@ -0,0 +1,653 @@
+/*
+ * Copyright 2020 NVIDIA Corporation
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ChunkedTranscoder.hpp"
+#include "EncodedOutput.hpp"
+#include "Logger.hpp"
+#include "ThreadPool.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+
+extern "C" {
+#include "libavutil/avutil.h"
+}
+
+using namespace VPF;
+using namespace std;
+using namespace std::chrono;
+
+constexpr auto TASK_EXEC_SUCCESS = TaskExecStatus::TASK_EXEC_SUCCESS;
+
+namespace {
+
+void ThrowOnCudaError(CUresult res, int lineNum) {
+  if (CUDA_SUCCESS != res) {
+    stringstream ss;
+    ss << __FILE__ << ":" << lineNum << ": CUDA error with code " << res;
+    throw runtime_error(ss.str());
+  }
+}
+
+struct CudaStream {
+  CUcontext ctx = nullptr;
+  CUstream str = nullptr;
+
+  explicit CudaStream(CUcontext context) : ctx(context) {
+    CudaCtxPush push(ctx);
+    ThrowOnCudaError(cuStreamCreate(&str, 0), __LINE__);
+  }
+
+  ~CudaStream() {
+    CudaCtxPush push(ctx);
+    cuStreamDestroy(str);
+  }
+};
+
+struct Chunk {
+  KeyframeIndexEntry start;
+  // Zero means until the end of input;
+  uint64_t num_packets = 0U;
+};
+
+struct ChunkResult {
+  string path;
+  uint64_t num_packets = 0U;
+  uint64_t num_bytes = 0U;
+};
+
+vector<string> SplitLine(const string &line) {
+  vector<string> fields;
+  stringstream ss(line);
+  string field;
+  while (getline(ss, field, '\t')) {
+    fields.push_back(field);
+  }
+  return fields;
+}
+
+uint64_t FileSize(const string &path) {
+  ifstream file(path, ios::binary | ios::ate);
+  return file ? (uint64_t)file.tellg() : 0U;
+}
+
+/* Seek lands at or before keyframe, so packets preceding it are skipped;
+ */
+bool ReachedKeyframe(const PacketData &pkt, const KeyframeIndexEntry &key) {
+  return (AV_NOPTS_VALUE != key.dts) ? pkt.dts >= key.dts
+                                     : (int64_t)pkt.pos >= key.pos;
+}
+
+Token *RunTask(Task *task, Token *input) {
+  task->SetInput(input, 0U);
+  if (TASK_EXEC_SUCCESS != task->Run()) {
+    throw runtime_error(string(task->GetName()) + " failed");
+  }
+  return task->GetOutput(0U);
+}
+} // namespace
+
+namespace VPF {
+struct ChunkedTranscoder_Impl {
+  ChunkedTranscodeParams params;
+  ChunkedTranscodeStats stats;
+
+  MuxingParams in_params = {};
+  vector<Chunk> chunks;
+
+  // Chunks which are transcoded already, saved to checkpoint;
+  vector<ChunkResult> done_chunks;
+  vector<bool> is_done;
+  mutex checkpoint_lock;
+
+  map<string, string> enc_options;
+  NV_ENC_BUFFER_FORMAT enc_format = NV_ENC_BUFFER_FORMAT_NV12;
+  uint32_t out_width = 0U;
+  uint32_t out_height = 0U;
+  bool resize = false;
+
+  static const uint32_t poolFrameSize = 4U;
+  static const uint32_t chunksPerWorker = 4U;
+
+  explicit ChunkedTranscoder_Impl(const ChunkedTranscodeParams &new_params)
+      : params(new_params) {
+    if (params.contexts.empty()) {
+      throw invalid_argument("ChunkedTranscoder needs at least one context");
+    }
+
+    if (!params.num_workers) {
+      throw invalid_argument("ChunkedTranscoder needs at least one worker");
+    }
+
+    auto then = steady_clock::now();
+    {
+      auto options = DemuxOptions();
+      unique_ptr<DemuxFrame> probe(DemuxFrame::Make(
+          params.input.c_str(), options.data(), options.size()));
+      probe->GetParams(in_params);
+      SetupEncoderOptions();
+
+      if (!LoadCheckpoint()) {
+        vector<KeyframeIndexEntry> index;
+        uint64_t num_packets = 0U;
+        if (!probe->GetKeyframeIndex(index, num_packets)) {
+          throw runtime_error("Can't build keyframe index of " +
+                              params.input);
+        }
+        PlanChunks(index, num_packets);
+
+        VPF_LOG(LOG_LEVEL_INFO, "ChunkedTranscoder")
+            << index.size() << " keyframes, " << num_packets << " packets, "
+            << chunks.size() << " chunks";
+      }
+    }
+    stats.index_sec = duration<double>(steady_clock::now() - then).count();
+
+    done_chunks.resize(chunks.size());
+    is_done.resize(chunks.size(), false);
+    ReadDoneChunks();
+    SaveCheckpoint();
+  }
+
+  vector<const char *> DemuxOptions() const {
+    vector<const char *> options;
+    for (auto &pair : params.demux_options) {
+      options.push_back(pair.first.c_str());
+      options.push_back(pair.second.c_str());
+    }
+    return options;
+  }
+
+  /* Chunks are made of whole GOPs; There are several chunks per worker,
+   * so that single slow chunk doesn't stall the whole pool;
+   */
+  void PlanChunks(const vector<KeyframeIndexEntry> &index,
+                  uint64_t num_packets) {
+    auto target = max<uint64_t>(
+        params.min_chunk_frames,
+        num_packets / (params.num_workers * chunksPerWorker));
+    if (!params.checkpoint.empty()) {
+      target = min<uint64_t>(
+          target, max(params.min_chunk_frames, params.checkpoint_frames));
+    }
+
+    for (auto &keyframe : index) {
+      if (chunks.empty() || keyframe.packet_number -
+                                    chunks.back().start.packet_number >=
+                                target) {
+        if (!chunks.empty()) {
+          chunks.back().num_packets =
+              keyframe.packet_number - chunks.back().start.packet_number;
+        }
+
+        Chunk chunk;
+        chunk.start = keyframe;
+        chunks.push_back(chunk);
+      }
+    }
+  }
+
+  void SetupEncoderOptions() {
+    enc_options = params.encoder_options;
+    auto &video = in_params.videoContext;
+
+    if (enc_options.end() == enc_options.find("codec")) {
+      enc_options["codec"] = "h264";
+    }
+
+    if (enc_options.end() == enc_options.find("fps")) {
+      stringstream ss;
+      ss << video.frameRate;
+      enc_options["fps"] = ss.str();
+    }
+
+    out_width = video.width;
+    out_height = video.height;
+    auto size = enc_options.find("s");
+    if (enc_options.end() != size) {
+      if (2 != sscanf(size->second.c_str(), "%ux%u", &out_width,
+                      &out_height)) {
+        throw invalid_argument("Invalid frame size " + size->second);
+      }
+    } else {
+      stringstream ss;
+      ss << out_width << "x" << out_height;
+      enc_options["s"] = ss.str();
+    }
+    resize = (out_width != video.width) || (out_height != video.height);
+
+    if (YUV444 == video.format) {
+      if (resize) {
+        throw invalid_argument("YUV444 input can't be resized");
+      }
+      enc_format = NV_ENC_BUFFER_FORMAT_YUV444;
+      enc_options["fmt"] = "YUV444";
+    } else {
+      enc_format = NV_ENC_BUFFER_FORMAT_NV12;
+      enc_options["fmt"] = "NV12";
+    }
+
+    /* No B frames, so pts equals dts and chunks may be concatenated by
+     * counting packets; Every keyframe is IDR, so every GOP is closed;
+     */
+    enc_options["bf"] = "1";
+    enc_options.erase("idrperiod");
+  }
+
+  /* Checkpoint is made of tab-separated lines:
+   * input / output URLs, encoder options, chunk plan (start keyframe and
+   * length of every chunk) and finished chunks with their size;
+   * Returns false if there's no checkpoint to resume from;
+   */
+  bool LoadCheckpoint() {
+    if (params.checkpoint.empty()) {
+      return false;
+    }
+
+    ifstream file(params.checkpoint);
+    if (!file) {
+      return false;
+    }
+
+    map<string, string> options;
+    string line;
+    while (getline(file, line)) {
+      auto fields = SplitLine(line);
+      if (fields.empty()) {
+        continue;
+      }
+
+      auto const &key = fields[0];
+      if (("input" == key || "output" == key) && 2U == fields.size()) {
+        auto const &url = ("input" == key) ? params.input : params.output;
+        if (fields[1] != url) {
+          throw invalid_argument("Checkpoint " + params.checkpoint +
+                                 " is made for " + key + " " + fields[1]);
+        }
+      } else if ("option" == key && 3U == fields.size()) {
+        options[fields[1]] = fields[2];
+      } else if ("chunk" == key && 6U == fields.size()) {
+        Chunk chunk;
+        chunk.start.pts = stoll(fields[1]);
+        chunk.start.dts = stoll(fields[2]);
+        chunk.start.pos = stoll(fields[3]);
+        chunk.start.packet_number = stoull(fields[4]);
+        chunk.num_packets = stoull(fields[5]);
+        chunks.push_back(chunk);
+      } else if ("done" != key) {
+        throw runtime_error("Invalid line in checkpoint " +
+                            params.checkpoint + ": " + line);
+      }
+    }
+
+    if (options != enc_options) {
+      throw invalid_argument("Checkpoint " + params.checkpoint +
+                             " is made with other encoder settings");
+    }
+
+    if (chunks.empty()) {
+      throw runtime_error("Checkpoint " + params.checkpoint +
+                          " has no chunk plan");
+    }
+
+    VPF_LOG(LOG_LEVEL_INFO, "ChunkedTranscoder")
+        << "Resuming from " << params.checkpoint << ", " << chunks.size()
+        << " chunks";
+    return true;
+  }
+
+  /* Chunk is taken from checkpoint only if its file is intact;
+   */
+  void ReadDoneChunks() {
+    if (params.checkpoint.empty()) {
+      return;
+    }
+
+    ifstream file(params.checkpoint);
+    string line;
+    while (getline(file, line)) {
+      auto fields = SplitLine(line);
+      if (4U != fields.size() || "done" != fields[0]) {
+        continue;
+      }
+
+      auto const chunk_idx = stoull(fields[1]);
+      if (chunk_idx >= chunks.size()) {
+        continue;
+      }
+
+      ChunkResult result;
+      result.path = ChunkPath(chunk_idx);
+      result.num_packets = stoull(fields[2]);
+      result.num_bytes = stoull(fields[3]);
+      if (FileSize(result.path) != result.num_bytes) {
+        VPF_LOG(LOG_LEVEL_WARNING, "ChunkedTranscoder")
+            << result.path << " is damaged, chunk will be transcoded again";
+        continue;
+      }
+
+      done_chunks[chunk_idx] = result;
+      is_done[chunk_idx] = true;
+      stats.num_resumed_chunks++;
+    }
+  }
+
+  /* Checkpoint is written to temporary file and renamed, so it's either
+   * old or new one after crash;
+   */
+  void SaveCheckpoint() {
+    if (params.checkpoint.empty()) {
+      return;
+    }
+
+    lock_guard<mutex> guard(checkpoint_lock);
+    auto const tmp_path = params.checkpoint + ".tmp";
+    {
+      ofstream file(tmp_path, ios::trunc);
+      file << "input\t" << params.input << "\n";
+      file << "output\t" << params.output << "\n";
+      for (auto &option : enc_options) {
+        file << "option\t" << option.first << "\t" << option.second << "\n";
+      }
+      for (auto &chunk : chunks) {
+        file << "chunk\t" << chunk.start.pts << "\t" << chunk.start.dts
+             << "\t" << chunk.start.pos << "\t" << chunk.start.packet_number
+             << "\t" << chunk.num_packets << "\n";
+      }
+      for (size_t i = 0U; i < chunks.size(); i++) {
+        if (is_done[i]) {
+          file << "done\t" << i << "\t" << done_chunks[i].num_packets << "\t"
+               << done_chunks[i].num_bytes << "\n";
+        }
+      }
+      if (!file) {
+        throw runtime_error("Can't write " + tmp_path);
+      }
+    }
+
+    if (0 != rename(tmp_path.c_str(), params.checkpoint.c_str())) {
+      throw runtime_error("Can't replace " + params.checkpoint);
+    }
+  }
+
+  void MarkDone(size_t chunk_idx, const ChunkResult &result) {
+    {
+      lock_guard<mutex> guard(checkpoint_lock);
+      done_chunks[chunk_idx] = result;
+      is_done[chunk_idx] = true;
+    }
+    SaveCheckpoint();
+  }
+
+  string ChunkPath(size_t chunk_idx) const {
+    stringstream ss;
+    ss << params.output << ".chunk" << chunk_idx;
+    return ss.str();
+  }
+
+  /* Runs on pool thread; Every chunk has its own demuxer, decoder and
+   * encoder, so chunks don't share any state;
+   */
+  ChunkResult TranscodeChunk(size_t chunk_idx) {
+    auto const &chunk = chunks[chunk_idx];
+    auto ctx = params.contexts[chunk_idx % params.contexts.size()];
+    auto &video = in_params.videoContext;
+
+    ChunkResult result;
+    result.path = ChunkPath(chunk_idx);
+
+    CudaStream cuda(ctx);
+
+    auto options = DemuxOptions();
+    unique_ptr<DemuxFrame> demuxer(DemuxFrame::Make(
+        params.input.c_str(), options.data(), options.size()));
+    if (!demuxer->Seek(chunk.start)) {
+      stringstream ss;
+      ss << "Can't seek to chunk " << chunk_idx;
+      throw runtime_error(ss.str());
+    }
+
+    unique_ptr<NvdecDecodeFrame> decoder(NvdecDecodeFrame::Make(
+        cuda.str, ctx, video.codec, poolFrameSize, video.width, video.height,
+        video.format));
+
+    // There's no NV12 resizer, so go through YUV420;
+    vector<unique_ptr<Task>> processing;
+    if (resize) {
+      processing.emplace_back(ConvertSurface::Make(
+          video.width, video.height, NV12, YUV420, ctx, cuda.str));
+      processing.emplace_back(
+          ResizeSurface::Make(out_width, out_height, YUV420, ctx, cuda.str));
+      processing.emplace_back(ConvertSurface::Make(
+          out_width, out_height, YUV420, NV12, ctx, cuda.str));
+    }
+
+    NvEncoderClInterface cli_iface(enc_options);
+    unique_ptr<NvencEncodeFrame> encoder(NvencEncodeFrame::Make(
+        cuda.str, ctx, cli_iface, enc_format, out_width, out_height, false));
+
+    unique_ptr<FILE, int (*)(FILE *)> file(fopen(result.path.c_str(), "wb"),
+                                           fclose);
+    if (!file) {
+      throw runtime_error("Can't open " + result.path + " for writing");
+    }
+
+    // Packets are stored length-prefixed;
+    auto write = [&](Token *packet) {
+      auto buffer = (Buffer *)packet;
+      if (!buffer) {
+        return;
+      }
+
+      uint32_t size = buffer->GetRawMemSize();
+      if (1U != fwrite(&size, sizeof(size), 1U, file.get()) ||
+          size != fwrite(buffer->GetRawMemPtr(), 1U, size, file.get())) {
+        throw runtime_error("Can't write to " + result.path);
+      }
+      result.num_packets++;
+      result.num_bytes += sizeof(size) + size;
+    };
+
+    auto encode = [&](Token *frame) {
+      for (auto &task : processing) {
+        frame = RunTask(task.get(), frame);
+      }
+      encoder->ClearInputs();
+      write(RunTask(encoder.get(), frame));
+    };
+
+    uint64_t num_fed = 0U;
+    bool started = false;
+    while (!chunk.num_packets || num_fed < chunk.num_packets) {
+      if (TASK_EXEC_SUCCESS != demuxer->Run()) {
+        break;
+      }
+
+      auto elementaryVideo = demuxer->GetOutput(0U);
+      if (!elementaryVideo) {
+        continue;
+      }
+
+      if (!started) {
+        auto muxParams = ((Buffer *)demuxer->GetOutput(1U))
+                             ->GetDataAs<MuxingParams>();
+        started = ReachedKeyframe(muxParams->videoContext.packetData,
+                                  chunk.start);
+        if (!started) {
+          continue;
+        }
+      }
+
+      decoder->SetInput(elementaryVideo, 0U);
+      decoder->Run();
+      num_fed++;
+
+      auto surface = decoder->GetOutput(0U);
+      if (surface) {
+        encode(surface);
+      }
+    }
+
+    // Empty input flushes the decoder;
+    while (true) {
+      decoder->SetInput(nullptr, 0U);
+      decoder->Run();
+      auto surface = decoder->GetOutput(0U);
+      if (!surface) {
+        break;
+      }
+      encode(surface);
+    }
+
+    // Non-zero 2nd input signals sync encode;
+    while (true) {
+      encoder->ClearInputs();
+      encoder->SetInput((Token *)0xdeadbeef, 1U);
+      auto packet = RunTask(encoder.get(), nullptr);
+      if (!packet) {
+        break;
+      }
+      write(packet);
+    }
+
+    // Chunk must be on disk before checkpoint says it's done;
+    if (0 != fclose(file.release())) {
+      throw runtime_error("Can't write to " + result.path);
+    }
+
+    VPF_LOG(LOG_LEVEL_DEBUG, "ChunkedTranscoder")
+        << "Chunk " << chunk_idx << ": " << num_fed << " packets in, "
+        << result.num_packets << " packets out";
+    return result;
+  }
+
+  uint64_t Run() {
+    auto then = steady_clock::now();
+
+    vector<future<ChunkResult>> results;
+    try {
+      auto const num_left =
+          chunks.size() - count(is_done.begin(), is_done.end(), true);
+      ThreadPool pool(
+          max<size_t>(1U, min<size_t>(params.num_workers, num_left)));
+      for (size_t i = 0U; i < chunks.size(); i++) {
+        if (is_done[i]) {
+          promise<ChunkResult> done;
+          done.set_value(done_chunks[i]);
+          results.push_back(done.get_future());
+          continue;
+        }
+
+        results.push_back(pool.Submit([this, i]() {
+          auto result = TranscodeChunk(i);
+          MarkDone(i, result);
+          return result;
+        }));
+      }
+
+      Concatenate(results);
+    } catch (...) {
+      /* Pool is gone by now, so all chunks are either done or failed;
+       * Finished chunks are kept for resume if there's checkpoint;
+       */
+      if (params.checkpoint.empty()) {
+        RemoveChunks();
+      }
+      throw;
+    }
+
+    // Output is complete, nothing to resume;
+    if (!params.checkpoint.empty()) {
+      remove(params.checkpoint.c_str());
+      RemoveChunks();
+    }
+
+    stats.num_chunks = chunks.size();
+    stats.transcode_sec = duration<double>(steady_clock::now() - then).count();
+    return stats.num_frames;
+  }
+
+  void RemoveChunks() {
+    for (size_t i = 0U; i < chunks.size(); i++) {
+      remove(ChunkPath(i).c_str());
+    }
+  }
+
+  /* Chunks are appended as soon as they're ready, in order;
+   * Timestamps are counted from the beginning of output;
+   */
+  void Concatenate(vector<future<ChunkResult>> &results) {
+    MuxingParams out_params = {};
+    auto &video = out_params.videoContext;
+    video.width = out_width;
+    video.height = out_height;
+    video.frameRate = in_params.videoContext.frameRate;
+    video.timeBase = 1.0 / video.frameRate;
+    video.streamIndex = 0U;
+    video.codec = ("hevc" == enc_options["codec"]) ? cudaVideoCodec_HEVC
+                                                   : cudaVideoCodec_H264;
+    video.format = NV12;
+    unique_ptr<EncodedOutput> output(
+        EncodedOutput::Make(params.output, out_params));
+
+    vector<uint8_t> bytes;
+    for (auto &future : results) {
+      auto result = future.get();
+
+      unique_ptr<FILE, int (*)(FILE *)> file(
+          fopen(result.path.c_str(), "rb"), fclose);
+      if (!file) {
+        throw runtime_error("Can't open " + result.path + " for reading");
+      }
+
+      uint32_t size = 0U;
+      while (1U == fread(&size, sizeof(size), 1U, file.get())) {
+        bytes.resize(size);
+        if (size != fread(bytes.data(), 1U, size, file.get())) {
+          throw runtime_error("Truncated chunk " + result.path);
+        }
+        output->Write(bytes.data(), size);
+      }
+
+      file.reset();
+      // With checkpoint chunks are kept until output is complete;
+      if (params.checkpoint.empty()) {
+        remove(result.path.c_str());
+      }
+    }
+
+    stats.num_frames = output->GetNumPackets();
+  }
+};
+} // namespace VPF
+
+ChunkedTranscoder *ChunkedTranscoder::Make(const ChunkedTranscodeParams &params) {
+  return new ChunkedTranscoder(params);
+}
+
+ChunkedTranscoder::ChunkedTranscoder(const ChunkedTranscodeParams &params)
+    : pImpl(new ChunkedTranscoder_Impl(params)) {}
+
+ChunkedTranscoder::~ChunkedTranscoder() { delete pImpl; }
+
+uint64_t ChunkedTranscoder::Run() { return pImpl->Run(); }
+
+void ChunkedTranscoder::GetStats(ChunkedTranscodeStats &stats) const {
+  stats = pImpl->stats;
+}
@@ -0,0 +1,463 @@
+/*
+ * Copyright 2020 NVIDIA Corporation
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ClipLoader.hpp"
+#include "BatchPool.hpp"
+#include "CodecsSupport.hpp"
+#include "FFmpegDemuxer.h"
+#include "HostTransform.hpp"
+#include "Logger.hpp"
+#include "MemoryBudget.hpp"
+#include "NvCodecCLIOptions.h"
+#include "Tasks.hpp"
+#include "ThreadPool.hpp"
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <future>
+#include <map>
+#include <mutex>
+#include <random>
+#include <stdexcept>
+
+using namespace VPF;
+using namespace std;
+
+namespace {
+struct FileInfo {
+  string path;
+  uint32_t index = 0U;
+  uint32_t width = 0U;
+  uint32_t height = 0U;
+  double frame_rate = 0.0;
+  double duration = 0.0;
+  // Decoder downscale, so that resize has less to do;
+  uint32_t downscale = 1U;
+};
+
+struct Clip {
+  uint32_t file;
+  double start_time;
+};
+
+/* Decoder of single thread; It stays open between clips, so clips of the
+ * same file only seek;
+ */
+struct DecoderSlot {
+  string path;
+  unique_ptr<FfmpegDecodeFrame> decoder;
+};
+
+
+struct BatchJob {
+  shared_ptr<Buffer> buffer;
+  vector<ClipInfo> clips;
+  uint32_t num_pending = 0U;
+};
+
+// Largest decoder downscale which keeps frame at least as big as output;
+uint32_t ChooseDownscale(const FileInfo &file, const ClipSpec &spec) {
+  for (uint32_t factor = 4U; factor > 1U; factor /= 2U) {
+    if (file.width / factor < spec.width ||
+        file.height / factor < spec.height) {
+      continue;
+    }
+
+    FrameCopyParams params;
+    params.format = spec.format;
+    params.downscale = factor;
+    uint32_t width = 0U, height = 0U;
+    size_t size = 0U;
+    try {
+      GetFrameCopySize(params, file.width, file.height, width, height, size);
+      return factor;
+    } catch (exception &) {
+      continue;
+    }
+  }
+  return 1U;
+}
+
+/* Fisher-Yates shuffle on top of mt19937_64, unlike std::shuffle it gives
+ * the same order with every standard library;
+ */
+void Shuffle(vector<uint64_t> &order, uint64_t seed) {
+  mt19937_64 rng(seed);
+  for (auto i = order.size(); i > 1U; i--) {
+    swap(order[i - 1U], order[rng() % i]);
+  }
+}
+} // namespace
+
+namespace VPF {
+struct ClipLoader_Impl {
+  ClipSpec spec;
+  ClipLoaderParams params;
+  size_t frame_size = 0U;
+  size_t clip_size = 0U;
+
+  vector<FileInfo> files;
+  vector<Clip> clips;
+  vector<uint64_t> order;
+  uint64_t num_batches = 0U;
+
+  mutex mtx;
+  condition_variable cv;
+  map<uint64_t, unique_ptr<BatchJob>> batches;
+  uint64_t next_batch = 0U;
+  uint64_t next_submit = 0U;
+
+  vector<unique_ptr<DecoderSlot>> slots;
+  vector<DecoderSlot *> free_slots;
+
+  shared_ptr<BatchPool> pool_buffers;
+  unique_ptr<ThreadPool> pool;
+
+  ClipLoader_Impl(const vector<string> &paths, const ClipSpec &new_spec,
+                  const ClipLoaderParams &new_params)
+      : spec(new_spec), params(new_params) {
+    if (RGB != spec.format && BGR != spec.format && Y != spec.format &&
+        YUV420 != spec.format) {
+      throw invalid_argument("Clip format must be RGB, BGR, Y or YUV420");
+    }
+    if (!spec.width || !spec.height || !spec.length) {
+      throw invalid_argument("Clip length and frame size must be given");
+    }
+    if (YUV420 == spec.format && (spec.width % 2U || spec.height % 2U)) {
+      throw invalid_argument("YUV420 clip frame size must be even");
+    }
+
+    frame_size = GetHostFrameSize(spec.format, spec.width, spec.height);
+    clip_size = frame_size * spec.length;
+
+    params.batch_size = max(params.batch_size, 1U);
+    params.num_threads = max(params.num_threads, 1U);
+    params.prefetch = max(params.prefetch, 1U);
+    spec.stride = max(spec.stride, 1U);
+
+    // Compact node is resolved once, so batches and workers share it;
+    params.placement.node = params.placement.GetNode();
+    pool_buffers = make_shared<BatchPool>(params.pipeline,
+                                          params.placement.node);
+    pool.reset(new ThreadPool(params.num_threads, params.placement));
+    for (auto i = 0U; i < params.num_threads; i++) {
+      slots.emplace_back(new DecoderSlot());
+      free_slots.push_back(slots.back().get());
+    }
+
+    ProbeFiles(paths);
+    for (auto &file : files) {
+      AddClips(file);
+    }
+
+    num_batches = params.drop_last
+                      ? clips.size() / params.batch_size
+                      : (clips.size() + params.batch_size - 1U) /
+                            params.batch_size;
+
+    VPF_LOG(LOG_LEVEL_INFO, "ClipLoader")
+        << clips.size() << " clips in " << files.size() << " files";
+  }
+
+  ~ClipLoader_Impl() {
+    Drain();
+    pool.reset();
+  }
+
+  void ProbeFiles(const vector<string> &paths) {
+    vector<FileInfo> probed(paths.size());
+    vector<future<void>> jobs;
+    for (size_t i = 0U; i < paths.size(); i++) {
+      auto *info = &probed[i];
+      info->path = paths[i];
+      info->index = (uint32_t)i;
+      jobs.push_back(pool->Submit([info]() {
+        try {
+          FFmpegDemuxer demuxer(info->path.c_str(), map<string, string>());
+          info->width = demuxer.GetWidth();
+          info->height = demuxer.GetHeight();
+          info->frame_rate = demuxer.GetFramerate();
+          info->duration = demuxer.GetDuration();
+          if (0.0 == info->duration && info->frame_rate > 0.0) {
+            info->duration = demuxer.GetNumFrames() / info->frame_rate;
+          }
+        } catch (exception &e) {
+          VPF_LOG(LOG_LEVEL_WARNING, "ClipLoader")
+              << "Can't probe " << info->path << ": " << e.what();
+        }
+      }));
+    }
+
+    for (auto &job : jobs) {
+      job.get();
+    }
+
+    for (auto &info : probed) {
+      if (info.frame_rate <= 0.0 || info.duration <= 0.0 || !info.width ||
+          !info.height) {
+        VPF_LOG(LOG_LEVEL_WARNING, "ClipLoader")
+            << "Skipping " << info.path << ", its duration is unknown";
+        continue;
+      }
+      info.downscale = ChooseDownscale(info, spec);
+      files.push_back(info);
+    }
+  }
+
+  // Interval between clip frames in seconds;
+  double GetFrameStep(const FileInfo &file) const {
+    return spec.fps > 0.0 ? 1.0 / spec.fps : spec.stride / file.frame_rate;
+  }
+
+  void AddClips(const FileInfo &file) {
+    auto const frame_step = GetFrameStep(file);
+    auto const span = (spec.length - 1U) * frame_step + 1.0 / file.frame_rate;
+    auto const clip_step = spec.clip_step_sec > 0.0
+                               ? spec.clip_step_sec
+                               : spec.length * frame_step;
+
+    // Video shorter than clip still gives one, its last frame is repeated;
+    auto const file_index = (uint32_t)(&file - files.data());
+    clips.push_back({file_index, 0.0});
+    for (auto start = clip_step; start + span <= file.duration + 1e-6;
+         start += clip_step) {
+      clips.push_back({file_index, start});
+    }
+  }
+
+  void StartEpoch(uint32_t epoch) {
+    Drain();
+
+    order.resize(clips.size());
+    for (uint64_t i = 0U; i < order.size(); i++) {
+      order[i] = i;
+    }
+    if (params.shuffle) {
+      Shuffle(order, params.seed ^ (0x9E3779B97F4A7C15ULL * (epoch + 1U)));
+    }
+
+    unique_lock<mutex> lock(mtx);
+    next_batch = 0U;
+    next_submit = 0U;
+    lock.unlock();
+    SubmitAhead();
+  }
+
+  // Waits until no batch is being decoded and drops them all;
+  void Drain() {
+    unique_lock<mutex> lock(mtx);
+    cv.wait(lock, [this]() {
+      for (auto &it : batches) {
+        if (it.second->num_pending) {
+          return false;
+        }
+      }
+      return true;
+    });
+    batches.clear();
+  }
+
+  void SubmitAhead() {
+    unique_lock<mutex> lock(mtx);
+    while (next_submit < num_batches &&
+           next_submit < next_batch + params.prefetch) {
+      auto const batch_index = next_submit;
+      auto const first = batch_index * params.batch_size;
+      auto const num_clips =
+          (uint32_t)min<uint64_t>(params.batch_size, order.size() - first);
+
+      /* Only batch consumer needs now waits for memory, others are left for
+       * later if budget is exhausted; Workers take the lock, so it's not
+       * held while waiting;
+       */
+      auto const policy = (batch_index == next_batch)
+                              ? BudgetPolicy::BUDGET_BLOCK
+                              : BudgetPolicy::BUDGET_DROP;
+      lock.unlock();
+      auto buffer = pool_buffers->Acquire(clip_size * num_clips, policy);
+      lock.lock();
+      if (!buffer) {
+        return;
+      }
+      next_submit++;
+
+      auto pool_buffers_ref = pool_buffers;
+      unique_ptr<BatchJob> job(new BatchJob());
+      job->buffer.reset(buffer, [pool_buffers_ref](Buffer *buffer) {
+        pool_buffers_ref->Release(buffer);
+      });
+      job->clips.resize(num_clips);
+      job->num_pending = num_clips;
+
+      auto const *p_job = job.get();
+      batches[batch_index] = move(job);
+
+      for (auto i = 0U; i < num_clips; i++) {
+        auto const clip_index = order[first + i];
+        auto *dst = p_job->buffer->GetDataAs<uint8_t>() + i * clip_size;
+        pool->Submit([this, batch_index, i, clip_index, dst]() {
+          RunClip(batch_index, i, clip_index, dst);
+        });
+      }
+    }
+  }
+
+  void RunClip(uint64_t batch_index, uint32_t slot_index, uint64_t clip_index,
+               uint8_t *dst) {
+    DecoderSlot *slot = nullptr;
+    {
+      // As many slots as threads, so one is always free;
+      lock_guard<mutex> lock(mtx);
+      slot = free_slots.back();
+      free_slots.pop_back();
+    }
+
+    auto const &clip = clips[clip_index];
+    ClipInfo info;
+    info.file_index = files[clip.file].index;
+    info.start_time = clip.start_time;
+
+    try {
+      DecodeClip(*slot, clip, dst);
+      info.decoded = true;
+    } catch (exception &e) {
+      VPF_LOG(LOG_LEVEL_ERROR, "ClipLoader")
+          << "Clip at " << clip.start_time << " s of "
+          << files[clip.file].path << " failed: " << e.what();
+      memset(dst, 0, clip_size);
+      slot->decoder.reset();
+      slot->path.clear();
+    }
+
+    lock_guard<mutex> lock(mtx);
+    free_slots.push_back(slot);
+    auto &job = batches[batch_index];
+    job->clips[slot_index] = info;
+    if (!--job->num_pending) {
+      cv.notify_all();
+    }
+  }
+
+  void DecodeClip(DecoderSlot &slot, const Clip &clip, uint8_t *dst) {
+    auto const &file = files[clip.file];
+    if (!slot.decoder || slot.path != file.path) {
+      FrameCopyParams copy_params;
+      copy_params.format = spec.format;
+      copy_params.downscale = file.downscale;
+
+      NvDecoderClInterface cli_iface(map<string, string>{});
+      slot.decoder.reset(
+          FfmpegDecodeFrame::Make(file.path.c_str(), cli_iface, copy_params));
+      slot.path = file.path;
+    }
+
+    auto decoder = slot.decoder.get();
+    auto const time_base = decoder->GetTimebase();
+    auto const start_pts = decoder->GetStartPts();
+    if (!decoder->Seek(start_pts +
+                       (int64_t)(clip.start_time / time_base + 0.5))) {
+      throw runtime_error("Can't seek to clip start");
+    }
+
+    /* Every clip frame takes decoded frame nearest to its time, so frame
+     * may be used few times or not at all;
+     */
+    auto const frame_step = GetFrameStep(file);
+    auto const half_frame = 0.5 / file.frame_rate;
+    const uint8_t *frame = nullptr;
+    uint32_t width = 0U, height = 0U;
+    double frame_time = 0.0;
+    bool eos = false;
+
+    for (auto i = 0U; i < spec.length; i++) {
+      auto const time = clip.start_time + i * frame_step;
+      while (!eos && (!frame || frame_time < time - half_frame)) {
+        if (TaskExecStatus::TASK_EXEC_SUCCESS != decoder->Run()) {
+          // Clip at the end of video is padded with its last frame;
+          eos = true;
+          break;
+        }
+
+        frame = ((Buffer *)decoder->GetOutput(0U))->GetDataAs<uint8_t>();
+        decoder->GetFrameParams(width, height);
+
+        auto pkt_data =
+            ((Buffer *)decoder->GetOutput(2U))->GetDataAs<PacketData>();
+        frame_time = (AV_NOPTS_VALUE != pkt_data->pts)
+                         ? (pkt_data->pts - start_pts) * time_base
+                         : frame_time + 1.0 / file.frame_rate;
+      }
+
+      if (!frame) {
+        throw runtime_error("No frames decoded");
+      }
+      ResizeHostFrame(frame, width, height, spec.format, dst + i * frame_size,
+                      spec.width, spec.height);
+    }
+  }
+
+  shared_ptr<Buffer> Next(vector<ClipInfo> &clip_infos) {
+    clip_infos.clear();
+    SubmitAhead();
+
+    unique_lock<mutex> lock(mtx);
+    if (next_batch >= num_batches) {
+      return nullptr;
+    }
+
+    auto const batch_index = next_batch;
+    cv.wait(lock, [&]() { return !batches[batch_index]->num_pending; });
+
+    auto job = move(batches[batch_index]);
+    batches.erase(batch_index);
+    next_batch++;
+    lock.unlock();
+
+    SubmitAhead();
+    clip_infos = job->clips;
+    return job->buffer;
+  }
+};
+} // namespace VPF
+
+ClipLoader *ClipLoader::Make(const vector<string> &files,
+                             const ClipSpec &spec,
+                             const ClipLoaderParams &params) {
+  return new ClipLoader(files, spec, params);
+}
+
+ClipLoader::ClipLoader(const vector<string> &files, const ClipSpec &spec,
+                       const ClipLoaderParams &params) {
+  pImpl = new ClipLoader_Impl(files, spec, params);
+  pImpl->StartEpoch(0U);
+}
+
+ClipLoader::~ClipLoader() { delete pImpl; }
+
+void ClipLoader::StartEpoch(uint32_t epoch) { pImpl->StartEpoch(epoch); }
+
+shared_ptr<Buffer> ClipLoader::Next(vector<ClipInfo> &clips) {
+  return pImpl->Next(clips);
+}
+
+uint32_t ClipLoader::GetNumFiles() const {
+  return (uint32_t)pImpl->files.size();
+}
+
+uint64_t ClipLoader::GetNumClips() const { return pImpl->clips.size(); }
+
+uint64_t ClipLoader::GetNumBatches() const { return pImpl->num_batches; }
+
+size_t ClipLoader::GetFrameSize() const { return pImpl->frame_size; }
+
+void ClipLoader::GetSpec(ClipSpec &spec) const { spec = pImpl->spec; }
@@ -0,0 +1,379 @@
+/*
+ * Copyright 2020 NVIDIA Corporation
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "DecoderPool.hpp"
+#include "Logger.hpp"
+#include <chrono>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <tuple>
+#include <vector>
+
+using namespace VPF;
+using namespace std;
+using namespace std::chrono;
+
+constexpr auto TASK_EXEC_SUCCESS = TaskExecStatus::TASK_EXEC_SUCCESS;
+
+namespace {
+vector<const char *> OptionsToList(const map<string, string> &options) {
+  vector<const char *> list;
+  for (auto &pair : options) {
+    list.push_back(pair.first.c_str());
+    list.push_back(pair.second.c_str());
+  }
+  return list;
+}
+
+/* Decoder may only be reused for input it was created for, parser can't
+ * reconfigure it for other codec, bit depth or chroma format; Resolution
+ * may change, see NvDecoder::Reset;
+ */
+struct DecoderKey {
+  cudaVideoCodec codec;
+  Pixel_Format format;
+
+  explicit DecoderKey(const MuxingParams &params)
+      : codec(params.videoContext.codec), format(params.videoContext.format) {}
+
+  bool operator==(const DecoderKey &other) const {
+    return tie(codec, format) == tie(other.codec, other.format);
+  }
+};
+
+struct IdleDecoder {
+  DecoderKey key;
+  // Resolution of input decoder was created for is its max resolution;
+  uint32_t max_width;
+  uint32_t max_height;
+  uint32_t width;
+  uint32_t height;
+  unique_ptr<NvdecDecodeFrame> decoder;
+
+  bool Fits(const MuxingParams &params) const {
+    return key == DecoderKey(params) &&
+           params.videoContext.width <= max_width &&
+           params.videoContext.height <= max_height;
+  }
+};
+} // namespace
+
+namespace VPF {
+struct DecoderPool_Impl {
+  CUcontext ctx;
+  CUstream str;
+  uint32_t max_idle_decoders;
+
+  mutex lock;
+  DecoderPoolStats stats;
+  vector<unique_ptr<DemuxFrame>> idle_demuxers;
+  // Least recently used go first;
+  list<IdleDecoder> idle_decoders;
+
+  static const uint32_t poolFrameSize = 4U;
+
+  DecoderPool_Impl(CUcontext new_ctx, CUstream new_str, uint32_t max_idle)
+      : ctx(new_ctx), str(new_str), max_idle_decoders(max_idle) {}
+
+  ~DecoderPool_Impl() {
+    auto const num_cold = stats.num_cold_sessions;
+    auto const num_warm = stats.num_warm_sessions;
+    if (num_cold && num_warm) {
+      auto const cold = stats.cold_setup_sec / num_cold;
+      auto const warm = stats.warm_setup_sec / num_warm;
+      VPF_LOG(LOG_LEVEL_INFO, "DecoderPool")
+          << num_warm << " of " << num_cold + num_warm
+          << " sessions reused decoder, setup " << cold * 1000.0
+          << " ms cold vs " << warm * 1000.0 << " ms warm";
+    }
+  }
+
+  unique_ptr<DemuxFrame> OpenDemuxer(const string &url,
+                                     const map<string, string> &options) {
+    auto list = OptionsToList(options);
+
+    unique_ptr<DemuxFrame> demuxer;
+    {
+      lock_guard<mutex> guard(lock);
+      if (!idle_demuxers.empty()) {
+        demuxer = move(idle_demuxers.back());
+        idle_demuxers.pop_back();
+      }
+    }
+
+    if (demuxer) {
+      if (demuxer->Reopen(url.c_str(), list.data(), list.size())) {
+        lock_guard<mutex> guard(lock);
+        stats.num_demuxers_reused++;
+        return demuxer;
+      }
+
+      // Demuxer stays bound to previous input, so it's still usable;
+      lock_guard<mutex> guard(lock);
+      idle_demuxers.push_back(move(demuxer));
+      throw runtime_error("Can't open " + url);
+    }
+
+    demuxer.reset(DemuxFrame::Make(url.c_str(), list.data(), list.size()));
+    lock_guard<mutex> guard(lock);
+    stats.num_demuxers_created++;
+    return demuxer;
+  }
+
+  unique_ptr<NvdecDecodeFrame> TakeDecoder(const MuxingParams &params,
+                                           uint32_t &max_width,
+                                           uint32_t &max_height,
+                                           bool &is_reused) {
+    auto &video = params.videoContext;
+    {
+      lock_guard<mutex> guard(lock);
+      for (auto it = idle_decoders.begin(); it != idle_decoders.end(); it++) {
+        if (it->Fits(params)) {
+          if (it->width != video.width || it->height != video.height) {
+            stats.num_decoders_reconfigured++;
+          }
+          auto decoder = move(it->decoder);
+          max_width = it->max_width;
+          max_height = it->max_height;
+          idle_decoders.erase(it);
+          stats.num_decoders_reused++;
+          is_reused = true;
+          return decoder;
+        }
+      }
+    }
+
+    auto decoder = MakeDecoder(params);
+    max_width = video.width;
+    max_height = video.height;
+    is_reused = false;
+    return decoder;
+  }
+
+  unique_ptr<NvdecDecodeFrame> MakeDecoder(const MuxingParams &params) {
+    auto &video = params.videoContext;
+    unique_ptr<NvdecDecodeFrame> decoder(
+        NvdecDecodeFrame::Make(str, ctx, video.codec, poolFrameSize,
+                               video.width, video.height, video.format));
+
+    lock_guard<mutex> guard(lock);
+    stats.num_decoders_created++;
+    return decoder;
+  }
+
+  void PutDemuxer(unique_ptr<DemuxFrame> demuxer) {
+    lock_guard<mutex> guard(lock);
+    // Idle demuxer is cheap, keep as many as there are idle decoders;
+    if (idle_demuxers.size() < max_idle_decoders) {
+      idle_demuxers.push_back(move(demuxer));
+    }
+  }
+
+  void PutDecoder(const MuxingParams &params, uint32_t max_width,
+                  uint32_t max_height, unique_ptr<NvdecDecodeFrame> decoder) {
+    if (!decoder->Reset()) {
+      VPF_LOG(LOG_LEVEL_WARNING, "DecoderPool")
+          << "Decoder faced error, it won't be reused";
+      return;
+    }
+
+    IdleDecoder idle = {DecoderKey(params),
+                        max_width,
+                        max_height,
+                        params.videoContext.width,
+                        params.videoContext.height,
+                        move(decoder)};
+    // Evicted decoder is destroyed after lock is released;
+    unique_ptr<NvdecDecodeFrame> evicted;
+    {
+      lock_guard<mutex> guard(lock);
+      idle_decoders.push_back(move(idle));
+      if (idle_decoders.size() > max_idle_decoders) {
+        evicted = move(idle_decoders.front().decoder);
+        idle_decoders.pop_front();
+      }
+    }
+  }
+
+  void AddSetupTime(bool is_warm, double setup_sec) {
+    lock_guard<mutex> guard(lock);
+    if (is_warm) {
+      stats.num_warm_sessions++;
+      stats.warm_setup_sec += setup_sec;
+    } else {
+      stats.num_cold_sessions++;
+      stats.cold_setup_sec += setup_sec;
+    }
+  }
+};
+
+struct DecodeSession_Impl {
+  DecoderPool_Impl *pool = nullptr;
+  unique_ptr<DemuxFrame> demuxer;
+  unique_ptr<NvdecDecodeFrame> decoder;
+  MuxingParams params = {};
+  uint32_t max_width = 0U;
+  uint32_t max_height = 0U;
+  // Demuxed packet data given to decoder along with packet;
+  unique_ptr<Buffer> packet_data{Buffer::MakeOwnMem(sizeof(PacketData))};
+
+  steady_clock::time_point acquired;
+  bool is_warm = false;
+  bool got_frame = false;
+  bool is_flushing = false;
+
+  void OnSurfaceDecoded() {
+    if (!got_frame) {
+      got_frame = true;
+      pool->AddSetupTime(
+          is_warm, duration<double>(steady_clock::now() - acquired).count());
+    }
+  }
+
+  Surface *OnSurface(Token *surface, PacketData *pPktData) {
+    if (surface) {
+      OnSurfaceDecoded();
+    }
+
+    auto pOutPktData = (Buffer *)decoder->GetOutput(1U);
+    if (surface && pPktData && pOutPktData) {
+      *pPktData = *pOutPktData->GetDataAs<PacketData>();
+    }
+    return (Surface *)surface;
+  }
+
+  Surface *DecodeSingleSurface(PacketData *pPktData) {
+    while (!is_flushing) {
+      if (TASK_EXEC_SUCCESS != demuxer->Run()) {
+        is_flushing = true;
+        break;
+      }
+
+      auto elementaryVideo = demuxer->GetOutput(0U);
+      if (!elementaryVideo) {
+        continue;
+      }
+
+      auto muxParams = (Buffer *)demuxer->GetOutput(1U);
+      if (muxParams) {
+        *packet_data->GetDataAs<PacketData>() =
+            muxParams->GetDataAs<MuxingParams>()->videoContext.packetData;
+      }
+
+      decoder->SetInput(elementaryVideo, 0U);
+      decoder->SetInput(muxParams ? packet_data.get() : nullptr, 1U);
+      decoder->Run();
+      auto surface = decoder->GetOutput(0U);
+      if (surface) {
+        return OnSurface(surface, pPktData);
+      }
+    }
+
+    // Empty input flushes the decoder;
+    decoder->SetInput(nullptr, 0U);
+    decoder->SetInput(nullptr, 1U);
+    decoder->Run();
+    return OnSurface(decoder->GetOutput(0U), pPktData);
+  }
+};
+} // namespace VPF
+
+DecodeSession::DecodeSession() : pImpl(new DecodeSession_Impl()) {}
+
+DecodeSession::~DecodeSession() { delete pImpl; }
+
+Surface *DecodeSession::DecodeSingleSurface(PacketData *pPktData) {
+  return pImpl->DecodeSingleSurface(pPktData);
+}
+
+void DecodeSession::GetParams(MuxingParams &params) const {
+  params = pImpl->params;
+}
+
+DemuxFrame *DecodeSession::GetDemuxer() { return pImpl->demuxer.get(); }
+
+NvdecDecodeFrame *DecodeSession::GetDecoder() { return pImpl->decoder.get(); }
+
+void DecodeSession::OnSurfaceDecoded() { pImpl->OnSurfaceDecoded(); }
+
+NvdecDecodeFrame *DecodeSession::RecreateDecoder() {
+  auto &impl = *pImpl;
+  // Old decoder is gone before new one takes its video memory;
+  impl.decoder.reset();
+  impl.decoder = impl.pool->MakeDecoder(impl.params);
+  impl.max_width = impl.params.videoContext.width;
+  impl.max_height = impl.params.videoContext.height;
+  return impl.decoder.get();
+}
+
+DecoderPool *DecoderPool::Make(CUcontext ctx, CUstream str,
+                               uint32_t max_idle_decoders) {
+  return new DecoderPool(ctx, str, max_idle_decoders);
+}
+
+DecoderPool::DecoderPool(CUcontext ctx, CUstream str,
+                         uint32_t max_idle_decoders)
+    : pImpl(new DecoderPool_Impl(ctx, str, max_idle_decoders)) {}
+
+DecoderPool::~DecoderPool() { delete pImpl; }
+
+DecodeSession *DecoderPool::Acquire(const string &url,
+                                    const map<string, string> &options) {
+  auto session = new DecodeSession();
+  auto &impl = *session->pImpl;
+  impl.pool = pImpl;
+  impl.acquired = steady_clock::now();
+
+  try {
+    impl.demuxer = pImpl->OpenDemuxer(url, options);
+    impl.demuxer->GetParams(impl.params);
+    if (cudaVideoCodec_NumCodecs == impl.params.videoContext.codec) {
+      pImpl->PutDemuxer(move(impl.demuxer));
+      throw invalid_argument(url + " can't be decoded by Nvdec");
+    }
+
+    impl.decoder = pImpl->TakeDecoder(impl.params, impl.max_width,
+                                      impl.max_height, impl.is_warm);
+  } catch (...) {
+    delete session;
+    throw;
+  }
+
+  return session;
+}
+
+void DecoderPool::Release(DecodeSession *session) {
+  if (!session) {
+    return;
+  }
+
+  auto &impl = *session->pImpl;
+  pImpl->PutDemuxer(move(impl.demuxer));
+  try {
+    if (impl.decoder) {
+      pImpl->PutDecoder(impl.params, impl.max_width, impl.max_height,
+                        move(impl.decoder));
+    }
+  } catch (exception &e) {
+    VPF_LOG(LOG_LEVEL_WARNING, "DecoderPool")
+        << "Can't reset decoder: " << e.what();
+  }
+  delete session;
+}
+
+void DecoderPool::GetStats(DecoderPoolStats &stats) const {
+  lock_guard<mutex> guard(pImpl->lock);
+  stats = pImpl->stats;
+}
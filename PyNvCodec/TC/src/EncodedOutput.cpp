@@ -0,0 +1,226 @@
+/*
+ * Copyright 2020 NVIDIA Corporation
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "EncodedOutput.hpp"
+#include "Logger.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+using namespace VPF;
+using namespace std;
+
+constexpr auto TASK_EXEC_SUCCESS = TaskExecStatus::TASK_EXEC_SUCCESS;
+
+bool VPF::IsElementaryStreamUrl(const string &url) {
+  static const char *extensions[] = {".h264", ".264", ".h265",
+                                     ".265",  ".hevc", ".bin"};
+  for (auto ext : extensions) {
+    auto const len = strlen(ext);
+    if (url.size() > len && 0 == url.compare(url.size() - len, len, ext)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool VPF::IsLocalPath(const string &url) {
+  return string::npos == url.find("://") && 0 != url.compare(0, 5, "file:");
+}
+
+bool VPF::IsNumberPattern(const string &url) {
+  auto num_conversions = 0U;
+  for (size_t i = 0U; i < url.size(); i++) {
+    if ('%' != url[i]) {
+      continue;
+    }
+
+    if (i + 1 < url.size() && '%' == url[i + 1]) {
+      i++;
+      continue;
+    }
+
+    auto j = i + 1;
+    while (j < url.size() && isdigit(url[j])) {
+      j++;
+    }
+    if (j == url.size() || 'd' != url[j]) {
+      return false;
+    }
+    num_conversions++;
+    i = j;
+  }
+  return 1U == num_conversions;
+}
+
+namespace {
+string BaseName(const string &path) {
+  auto pos = path.find_last_of("/\\");
+  return string::npos == pos ? path : path.substr(pos + 1);
+}
+} // namespace
+
+namespace VPF {
+struct EncodedOutput_Impl {
+  struct Segment {
+    string url;
+    uint64_t num_frames = 0U;
+  };
+
+  string url;
+  uint32_t segment_frames;
+  MuxingParams params;
+  vector<Segment> segments;
+  uint64_t num_packets = 0U;
+
+  unique_ptr<AsyncFile> es_file;
+  unique_ptr<MuxFrame> muxer;
+  unique_ptr<Buffer> mux_params;
+  unique_ptr<Buffer> packet;
+
+  EncodedOutput_Impl(const string &new_url, const MuxingParams &new_params,
+                     uint32_t new_segment_frames)
+      : url(new_url), segment_frames(new_segment_frames), params(new_params) {
+    if (segment_frames && !IsNumberPattern(url)) {
+      throw invalid_argument("Segment URL " + url +
+                             " must have single integer format, e. g. %05d");
+    }
+
+    mux_params.reset(Buffer::MakeOwnMem(sizeof(params), &params));
+    packet.reset(Buffer::MakeOwnMem(0U));
+  }
+
+  void OpenSegment() {
+    // Muxer writes trailer upon destruction;
+    muxer.reset();
+    es_file.reset();
+
+    Segment segment;
+    if (segment_frames) {
+      vector<char> name(url.size() + 32U);
+      snprintf(name.data(), name.size(), url.c_str(),
+               (int)segments.size());
+      segment.url = name.data();
+    } else {
+      segment.url = url;
+    }
+
+    if (IsElementaryStreamUrl(segment.url)) {
+      es_file.reset(AsyncFile::Make(AsyncWriter::GetDefault(), segment.url));
+    } else if (IsLocalPath(segment.url)) {
+      muxer.reset(
+          MuxFrame::Make(segment.url.c_str(), AsyncWriter::GetDefault()));
+    } else {
+      muxer.reset(MuxFrame::Make(segment.url.c_str()));
+    }
+
+    VPF_LOG(LOG_LEVEL_DEBUG, "EncodedOutput") << "Opened " << segment.url;
+    segments.push_back(segment);
+  }
+
+  void Write(const uint8_t *data, size_t size) {
+    if (segments.empty() ||
+        (segment_frames && 0U == num_packets % segment_frames)) {
+      OpenSegment();
+    }
+
+    if (es_file) {
+      if (!es_file->Write(data, size)) {
+        throw runtime_error("Can't write to " + segments.back().url);
+      }
+    } else {
+      auto &packetData = params.videoContext.packetData;
+      packetData.pts = num_packets;
+      packetData.dts = num_packets;
+      packetData.duration = 1U;
+      mux_params->Update(sizeof(params), &params);
+      packet->Update(size, (void *)data);
+
+      muxer->SetInput(packet.get(), 0U);
+      muxer->SetInput(mux_params.get(), 1U);
+      if (TASK_EXEC_SUCCESS != muxer->Run()) {
+        throw runtime_error("Can't mux packet to " + segments.back().url);
+      }
+    }
+
+    segments.back().num_frames++;
+    num_packets++;
+  }
+};
+} // namespace VPF
+
+EncodedOutput *EncodedOutput::Make(const string &url,
+                                   const MuxingParams &params,
+                                   uint32_t segment_frames) {
+  return new EncodedOutput(url, params, segment_frames);
+}
+
+EncodedOutput::EncodedOutput(const string &url, const MuxingParams &params,
+                             uint32_t segment_frames)
+    : pImpl(new EncodedOutput_Impl(url, params, segment_frames)) {}
+
+EncodedOutput::~EncodedOutput() { delete pImpl; }
+
+void EncodedOutput::Write(const uint8_t *data, size_t size) {
+  pImpl->Write(data, size);
+}
+
+void EncodedOutput::Write(Buffer *packet) {
+  if (packet) {
+    pImpl->Write((const uint8_t *)packet->GetRawMemPtr(),
+                 packet->GetRawMemSize());
+  }
+}
+
+void EncodedOutput::WritePlaylist(const string &path) const {
+  auto const fps = pImpl->params.videoContext.frameRate;
+  if (fps <= 0.0) {
+    throw runtime_error("Can't write playlist without frame rate");
+  }
+
+  double target_duration = 0.0;
+  for (auto &segment : pImpl->segments) {
+    target_duration = max(target_duration, segment.num_frames / fps);
+  }
+
+  ofstream playlist(path);
+  if (!playlist) {
+    throw runtime_error("Can't open " + path + " for writing");
+  }
+
+  playlist << "#EXTM3U\n"
+           << "#EXT-X-VERSION:3\n"
+           << "#EXT-X-PLAYLIST-TYPE:VOD\n"
+           << "#EXT-X-TARGETDURATION:" << (int)ceil(target_duration) << "\n"
+           << "#EXT-X-MEDIA-SEQUENCE:0\n";
+  for (auto &segment : pImpl->segments) {
+    playlist << "#EXTINF:" << fixed << setprecision(3)
+             << segment.num_frames / fps << ",\n"
+             << BaseName(segment.url) << "\n";
+  }
+  playlist << "#EXT-X-ENDLIST\n";
+}
+
+uint64_t EncodedOutput::GetNumPackets() const { return pImpl->num_packets; }
+
+uint32_t EncodedOutput::GetNumSegments() const {
+  return pImpl->segments.size();
+}
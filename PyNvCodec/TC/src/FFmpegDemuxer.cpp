@@ -12,9 +12,13 @@
  */
 
 #include "FFmpegDemuxer.h"
+#include "Logger.hpp"
 #include "NvCodecUtils.h"
 #include "libavutil/avstring.h"
 #include "libavutil/avutil.h"
+#include "libavutil/display.h"
+#include <cmath>
+#include <cstring>
 #include <iostream>
 #include <limits>
 #include <sstream>
@@ -68,6 +72,57 @@ uint32_t FFmpegDemuxer::GetVideoStreamIndex() const { return videoStream; }
 
 AVPixelFormat FFmpegDemuxer::GetPixelFormat() const { return eChromaFormat; }
 
+int FFmpegDemuxer::GetRotation() const { return rotation; }
+
+int GetDisplayRotation(const AVStream *stream) {
+  auto const *matrix = (const int32_t *)av_stream_get_side_data(
+      stream, AV_PKT_DATA_DISPLAYMATRIX, nullptr);
+  if (!matrix) {
+    return 0;
+  }
+
+  // Matrix angle is counterclockwise;
+  auto const angle = -av_display_rotation_get(matrix);
+  if (std::isnan(angle)) {
+    return 0;
+  }
+
+  auto const quarters = ((int)lround(angle / 90.0) % 4 + 4) % 4;
+  return quarters * 90;
+}
+
+double FFmpegDemuxer::GetDuration() const {
+  if (AV_NOPTS_VALUE != fmtc->duration && fmtc->duration > 0) {
+    return (double)fmtc->duration / AV_TIME_BASE;
+  }
+
+  // Container duration is estimated upon stream info probing only;
+  auto stream = fmtc->streams[videoStream];
+  if (AV_NOPTS_VALUE != stream->duration && stream->duration > 0) {
+    return stream->duration * timebase;
+  }
+
+  return 0.0;
+}
+
+int64_t FFmpegDemuxer::GetBitrate() const {
+  if (fmtc->bit_rate > 0) {
+    return fmtc->bit_rate;
+  }
+
+  auto const duration = GetDuration();
+  auto const size = fmtc->pb ? avio_size(fmtc->pb) : -1;
+  if (duration > 0.0 && size > 0) {
+    return (int64_t)(size * 8 / duration);
+  }
+
+  return 0;
+}
+
+int64_t FFmpegDemuxer::GetNumFrames() const {
+  return fmtc->streams[videoStream]->nb_frames;
+}
+
 bool FFmpegDemuxer::Demux(uint8_t *&pVideo, size_t &rVideoBytes,
                           uint8_t **ppSEI, size_t *pSEIBytes) {
   if (!fmtc) {
@@ -115,7 +170,7 @@ bool FFmpegDemuxer::Demux(uint8_t *&pVideo, size_t &rVideoBytes,
   bool isDone = false, gotVideo = false;
 
   while (!isDone) {
-    ret = av_read_frame(fmtc, &pkt);
+    ret = ReadFrame(&pkt);
     gotVideo = (pkt.stream_index == videoStream);
     isDone = (ret < 0) || gotVideo;
 
@@ -124,7 +179,7 @@ bool FFmpegDemuxer::Demux(uint8_t *&pVideo, size_t &rVideoBytes,
       // We don't do this in constructor as user may not be needing SEI
       // extraction at all;
       if (!bsfc_sei) {
-        cout << "Initializing SEI filter;" << endl;
+        VPF_LOG(LOG_LEVEL_DEBUG, "FFmpegDemuxer") << "Initializing SEI filter";
 
         // SEI has NAL type 6 for H.264 and NAL type 39 & 40 for H.265;
         const string sei_filter =
@@ -166,21 +221,41 @@ bool FFmpegDemuxer::Demux(uint8_t *&pVideo, size_t &rVideoBytes,
   }
 
   if (ret < 0) {
-    cerr << "Failed to read frame: " << AvErrorToString(ret) << endl;
+    VPF_LOG(LOG_LEVEL_INFO, "FFmpegDemuxer")
+        << "Failed to read frame: " << AvErrorToString(ret);
     return false;
   }
 
+  /* Packet is given away to bitstream filter, so its data is taken first;
+   * Filtered packet carries timestamps of its own then;
+   */
+  auto const isFilteringNeeded = is_mp4H264 || is_mp4HEVC;
+  lastPacketData.dts = pkt.dts;
+  lastPacketData.duration = pkt.duration;
+  lastPacketData.pos = pkt.pos;
+  lastPacketData.pts = pkt.pts;
+  lastPacketData.is_keyframe = (0 != (pkt.flags & AV_PKT_FLAG_KEY));
+
   appendBytes(annexbBytes, pkt, pktAnnexB, bsfc_annexb, videoStream,
-              is_mp4H264 || is_mp4HEVC);
+              isFilteringNeeded);
 
   pVideo = annexbBytes.data();
   rVideoBytes = annexbBytes.size();
 
-  // Update last packet data;
-  lastPacketData.dts = pktAnnexB.dts;
-  lastPacketData.duration = pktAnnexB.duration;
-  lastPacketData.pos = pktAnnexB.pos;
-  lastPacketData.pts = pktAnnexB.pts;
+  if (isFilteringNeeded) {
+    lastPacketData.dts = pktAnnexB.dts;
+    lastPacketData.duration = pktAnnexB.duration;
+    lastPacketData.pos = pktAnnexB.pos;
+    lastPacketData.pts = pktAnnexB.pts;
+  }
+
+  VPF::AccessUnitInfo auInfo;
+  if (isSliceParsing) {
+    sliceParser.Parse(annexbBytes.data(), annexbBytes.size(), auInfo);
+  }
+  lastPacketData.frame_type = auInfo.frame_type;
+  lastPacketData.is_idr = auInfo.is_idr;
+  lastPacketData.is_reference = auInfo.is_reference;
 
   if (pSEIBytes && ppSEI && !seiBytes.empty()) {
     *ppSEI = seiBytes.data();
@@ -194,6 +269,129 @@ void FFmpegDemuxer::GetLastPacketData(PacketData &pktData) {
   pktData = lastPacketData;
 }
 
+void FFmpegDemuxer::EnableSliceParsing(bool enable) {
+  isSliceParsing = enable;
+}
+
+bool FFmpegDemuxer::GetStreamInfo(VPF::VideoStreamInfo &info) const {
+  if (hasStreamInfo) {
+    info = streamInfo;
+  }
+  return hasStreamInfo;
+}
+
+int FFmpegDemuxer::ReadFrame(AVPacket *pPkt) {
+  if (pendingPkt.data) {
+    av_packet_move_ref(pPkt, &pendingPkt);
+    return 0;
+  }
+  return av_read_frame(fmtc, pPkt);
+}
+
+bool FFmpegDemuxer::GetKeyframeIndex(vector<KeyframeIndexEntry> &index,
+                                     uint64_t &num_packets, bool allow_scan) {
+  index.clear();
+  num_packets = 0U;
+
+  if (!fmtc) {
+    return false;
+  }
+
+  auto stream = fmtc->streams[videoStream];
+
+  // Fast path, container has entry for every packet (mp4, mov);
+  if (stream->nb_frames > 0 && stream->nb_index_entries == stream->nb_frames) {
+    for (int i = 0; i < stream->nb_index_entries; i++) {
+      auto &entry = stream->index_entries[i];
+      if (entry.flags & AVINDEX_KEYFRAME) {
+        KeyframeIndexEntry keyframe;
+        keyframe.pts = AV_NOPTS_VALUE;
+        keyframe.dts = entry.timestamp;
+        keyframe.pos = entry.pos;
+        keyframe.packet_number = i;
+        index.push_back(keyframe);
+      }
+    }
+    num_packets = stream->nb_index_entries;
+    return !index.empty();
+  }
+
+  if (!allow_scan) {
+    return false;
+  }
+
+  // Slow path, read through whole input;
+  VPF_LOG(LOG_LEVEL_DEBUG, "FFmpegDemuxer")
+      << "No complete container index, scanning input";
+
+  AVPacket scanPkt;
+  av_init_packet(&scanPkt);
+  scanPkt.data = nullptr;
+  scanPkt.size = 0;
+
+  while (ReadFrame(&scanPkt) >= 0) {
+    if (scanPkt.stream_index == videoStream) {
+      if (scanPkt.flags & AV_PKT_FLAG_KEY) {
+        KeyframeIndexEntry keyframe;
+        keyframe.pts = scanPkt.pts;
+        keyframe.dts = scanPkt.dts;
+        keyframe.pos = scanPkt.pos;
+        keyframe.packet_number = num_packets;
+        index.push_back(keyframe);
+      }
+      num_packets++;
+    }
+    av_packet_unref(&scanPkt);
+  }
+
+  if (index.empty()) {
+    return false;
+  }
+
+  return Seek(index.front());
+}
+
+bool FFmpegDemuxer::Seek(const KeyframeIndexEntry &keyframe) {
+  if (!fmtc) {
+    return false;
+  }
+
+  /* Elementary streams have no timestamps, seek by byte offset then;
+   */
+  auto ret = (AV_NOPTS_VALUE != keyframe.dts)
+                 ? av_seek_frame(fmtc, videoStream, keyframe.dts,
+                                 AVSEEK_FLAG_BACKWARD)
+                 : av_seek_frame(fmtc, videoStream, keyframe.pos,
+                                 AVSEEK_FLAG_BYTE);
+  if (ret < 0) {
+    VPF_LOG(LOG_LEVEL_ERROR, "FFmpegDemuxer")
+        << "Failed to seek: " << AvErrorToString(ret);
+    return false;
+  }
+
+  if (pkt.data) {
+    av_packet_unref(&pkt);
+  }
+  if (pktAnnexB.data) {
+    av_packet_unref(&pktAnnexB);
+  }
+  if (pendingPkt.data) {
+    av_packet_unref(&pendingPkt);
+  }
+
+  // Drop packets buffered before seek;
+  if (bsfc_annexb) {
+    av_bsf_flush(bsfc_annexb);
+  }
+  if (bsfc_sei) {
+    av_bsf_flush(bsfc_sei);
+  }
+
+  lastPacketData = {};
+  is_EOF = false;
+  return true;
+}
+
 int FFmpegDemuxer::ReadPacket(void *opaque, uint8_t *pBuf, int nBuf) {
   return ((DataProvider *)opaque)->GetData(pBuf, nBuf);
 }
@@ -207,6 +405,9 @@ FFmpegDemuxer::~FFmpegDemuxer() {
   if (pktAnnexB.data) {
     av_packet_unref(&pktAnnexB);
   }
+  if (pendingPkt.data) {
+    av_packet_unref(&pendingPkt);
+  }
 
   if (bsfc_annexb) {
     av_bsf_free(&bsfc_annexb);
@@ -229,7 +430,8 @@ FFmpegDemuxer::CreateFormatContext(DataProvider *pDataProvider,
                                    const map<string, string> &ffmpeg_options) {
   AVFormatContext *ctx = avformat_alloc_context();
   if (!ctx) {
-    cerr << "Can't allocate AVFormatContext at " << __FILE__ << " " << __LINE__;
+    VPF_LOG(LOG_LEVEL_ERROR, "FFmpegDemuxer")
+        << "Can't allocate AVFormatContext at " << __FILE__ << " " << __LINE__;
     return nullptr;
   }
 
@@ -237,14 +439,16 @@ FFmpegDemuxer::CreateFormatContext(DataProvider *pDataProvider,
   int avioc_buffer_size = 8 * 1024 * 1024;
   avioc_buffer = (uint8_t *)av_malloc(avioc_buffer_size);
   if (!avioc_buffer) {
-    cerr << "Can't allocate avioc_buffer at " << __FILE__ << " " << __LINE__;
+    VPF_LOG(LOG_LEVEL_ERROR, "FFmpegDemuxer")
+        << "Can't allocate avioc_buffer at " << __FILE__ << " " << __LINE__;
     return nullptr;
   }
   avioc = avio_alloc_context(avioc_buffer, avioc_buffer_size, 0, pDataProvider,
                              &ReadPacket, nullptr, nullptr);
 
   if (!avioc) {
-    cerr << "Can't allocate AVIOContext at " << __FILE__ << " " << __LINE__;
+    VPF_LOG(LOG_LEVEL_ERROR, "FFmpegDemuxer")
+        << "Can't allocate AVIOContext at " << __FILE__ << " " << __LINE__;
     return nullptr;
   }
   ctx->pb = avioc;
@@ -255,15 +459,17 @@ FFmpegDemuxer::CreateFormatContext(DataProvider *pDataProvider,
     auto err =
         av_dict_set(&options, pair.first.c_str(), pair.second.c_str(), 0);
     if (err < 0) {
-      cerr << "Can't set up dictionary option: " << pair.first << " "
-           << pair.second << ": " << AvErrorToString(err) << "\n";
+      VPF_LOG(LOG_LEVEL_ERROR, "FFmpegDemuxer")
+          << "Can't set up dictionary option: " << pair.first << " "
+          << pair.second << ": " << AvErrorToString(err);
       return nullptr;
     }
   }
 
   auto err = avformat_open_input(&ctx, nullptr, nullptr, &options);
   if (0 != err) {
-    cerr << "Can't open input. Error message: " << AvErrorToString(err);
+    VPF_LOG(LOG_LEVEL_ERROR, "FFmpegDemuxer")
+        << "Can't open input. Error message: " << AvErrorToString(err);
     return nullptr;
   }
 
@@ -278,12 +484,14 @@ FFmpegDemuxer::CreateFormatContext(const char *szFilePath,
   // Set up format context options;
   AVDictionary *options = NULL;
   for (auto &pair : ffmpeg_options) {
-    cout << pair.first << ": " << pair.second << endl;
+    VPF_LOG(LOG_LEVEL_DEBUG, "FFmpegDemuxer")
+        << "Option " << pair.first << ": " << pair.second;
     auto err =
         av_dict_set(&options, pair.first.c_str(), pair.second.c_str(), 0);
     if (err < 0) {
-      cerr << "Can't set up dictionary option: " << pair.first << " "
-           << pair.second << ": " << AvErrorToString(err) << "\n";
+      VPF_LOG(LOG_LEVEL_ERROR, "FFmpegDemuxer")
+          << "Can't set up dictionary option: " << pair.first << " "
+          << pair.second << ": " << AvErrorToString(err);
       return nullptr;
     }
   }
@@ -292,7 +500,8 @@ FFmpegDemuxer::CreateFormatContext(const char *szFilePath,
   av_register_all();
   auto err = avformat_open_input(&ctx, szFilePath, nullptr, &options);
   if (err < 0) {
-    cerr << "Can't open " << szFilePath << ": " << AvErrorToString(err) << "\n";
+    VPF_LOG(LOG_LEVEL_ERROR, "FFmpegDemuxer")
+        << "Can't open " << szFilePath << ": " << AvErrorToString(err);
     return nullptr;
   }
 
@@ -302,6 +511,7 @@ FFmpegDemuxer::CreateFormatContext(const char *szFilePath,
 FFmpegDemuxer::FFmpegDemuxer(AVFormatContext *fmtcx) : fmtc(fmtcx) {
   pkt = {};
   pktAnnexB = {};
+  pendingPkt = {};
 
   if (!fmtc) {
     stringstream ss;
@@ -309,22 +519,230 @@ FFmpegDemuxer::FFmpegDemuxer(AVFormatContext *fmtcx) : fmtc(fmtcx) {
     throw invalid_argument(ss.str());
   }
 
-  auto ret = avformat_find_stream_info(fmtc, nullptr);
-  if (0 != ret) {
-    stringstream ss;
-    ss << __FUNCTION__ << ": can't find stream info;" << AvErrorToString(ret)
-       << endl;
-    throw runtime_error(ss.str());
+  videoStream = ProbeVideoStream(fmtc, pendingPkt, streamInfo, hasStreamInfo);
+  OpenVideoStream();
+}
+
+/* Bitstream filter state depends on codec parameters only (extradata
+ * included), so filter is kept if new input has the same ones;
+ */
+static bool CanReuseBsf(const AVBSFContext *bsfc,
+                        const AVCodecParameters *par) {
+  if (!bsfc || !bsfc->par_in) {
+    return false;
+  }
+
+  auto const *old_par = bsfc->par_in;
+  return old_par->codec_id == par->codec_id &&
+         old_par->extradata_size == par->extradata_size &&
+         (!par->extradata_size || 0 == memcmp(old_par->extradata,
+                                              par->extradata,
+                                              par->extradata_size));
+}
+
+bool FFmpegDemuxer::Reopen(const char *szFilePath,
+                           const map<string, string> &ffmpeg_options) {
+  auto new_fmtc = CreateFormatContext(szFilePath, ffmpeg_options);
+  if (!new_fmtc) {
+    return false;
+  }
+
+  // New input is probed first, so that demuxer is intact if it fails;
+  AVPacket newPendingPkt = {};
+  VPF::VideoStreamInfo newStreamInfo;
+  bool newHasStreamInfo = false;
+  int newVideoStream = -1;
+  try {
+    newVideoStream = ProbeVideoStream(new_fmtc, newPendingPkt, newStreamInfo,
+                                      newHasStreamInfo);
+  } catch (exception &e) {
+    VPF_LOG(LOG_LEVEL_ERROR, "FFmpegDemuxer")
+        << "Can't reopen with " << szFilePath << ": " << e.what();
+    if (newPendingPkt.data) {
+      av_packet_unref(&newPendingPkt);
+    }
+    avformat_close_input(&new_fmtc);
+    return false;
+  }
+
+  if (pkt.data) {
+    av_packet_unref(&pkt);
+  }
+  if (pktAnnexB.data) {
+    av_packet_unref(&pktAnnexB);
+  }
+  if (pendingPkt.data) {
+    av_packet_unref(&pendingPkt);
+  }
+  avformat_close_input(&fmtc);
+  if (avioc) {
+    av_freep(&avioc->buffer);
+    av_freep(&avioc);
+  }
+
+  fmtc = new_fmtc;
+  if (newPendingPkt.data) {
+    av_packet_move_ref(&pendingPkt, &newPendingPkt);
+  }
+  streamInfo = newStreamInfo;
+  hasStreamInfo = newHasStreamInfo;
+  videoStream = newVideoStream;
+  lastPacketData = {};
+  is_EOF = false;
+  OpenVideoStream();
+  return true;
+}
+
+static AVPixelFormat StreamInfoToPixelFormat(const VPF::VideoStreamInfo &info) {
+  auto const is_8bit = (8U == info.bit_depth_luma);
+  auto const is_10bit = (10U == info.bit_depth_luma);
+  auto const is_12bit = (12U == info.bit_depth_luma);
+
+  switch (info.chroma_format_idc) {
+  case 0:
+    return is_8bit ? AV_PIX_FMT_GRAY8 : AV_PIX_FMT_NONE;
+  case 1:
+    return is_8bit    ? AV_PIX_FMT_YUV420P
+           : is_10bit ? AV_PIX_FMT_YUV420P10
+           : is_12bit ? AV_PIX_FMT_YUV420P12
+                      : AV_PIX_FMT_NONE;
+  case 2:
+    return is_8bit    ? AV_PIX_FMT_YUV422P
+           : is_10bit ? AV_PIX_FMT_YUV422P10
+           : is_12bit ? AV_PIX_FMT_YUV422P12
+                      : AV_PIX_FMT_NONE;
+  case 3:
+    return is_8bit    ? AV_PIX_FMT_YUV444P
+           : is_10bit ? AV_PIX_FMT_YUV444P10
+           : is_12bit ? AV_PIX_FMT_YUV444P12
+                      : AV_PIX_FMT_NONE;
+  default:
+    return AV_PIX_FMT_NONE;
+  }
+}
+
+/* Takes video stream properties from SPS instead of decoding frames with
+ * avformat_find_stream_info(); Parameter sets are taken from extradata or,
+ * for Annex B inputs like live MPEG-TS, from the first video packet which
+ * is kept to be demuxed first; Returns false if probing is still needed;
+ */
+bool FFmpegDemuxer::ProbeParameterSets(AVFormatContext *ctx, AVPacket &pending,
+                                       VPF::VideoStreamInfo &info,
+                                       bool &hasInfo) {
+  auto const streamIdx =
+      av_find_best_stream(ctx, AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0);
+  if (streamIdx < 0) {
+    return false;
+  }
+
+  auto stream = ctx->streams[streamIdx];
+  auto par = stream->codecpar;
+  auto const codec = FFmpeg2NvCodecId(par->codec_id);
+  if (cudaVideoCodec_H264 != codec && cudaVideoCodec_HEVC != codec) {
+    return false;
+  }
+
+  auto found = par->extradata_size > 0 &&
+               VPF::ParseParameterSets(codec, par->extradata,
+                                       par->extradata_size, info);
+
+  if (!found) {
+    while (!pending.data) {
+      if (av_read_frame(ctx, &pending) < 0) {
+        return false;
+      }
+      if (pending.stream_index != streamIdx) {
+        av_packet_unref(&pending);
+      }
+    }
+    found = VPF::ParseParameterSets(codec, pending.data, pending.size, info);
+  }
+
+  if (!found) {
+    return false;
+  }
+  hasInfo = true;
+
+  // Container frame rate is preferred as SPS timing is optional;
+  if (!stream->r_frame_rate.num || !stream->r_frame_rate.den) {
+    if (stream->avg_frame_rate.num && stream->avg_frame_rate.den) {
+      stream->r_frame_rate = stream->avg_frame_rate;
+    } else if (info.frame_rate > 0.0) {
+      stream->r_frame_rate = av_d2q(info.frame_rate, 1 << 16);
+    } else {
+      return false;
+    }
+  }
+
+  auto const format = StreamInfoToPixelFormat(info);
+  if (AV_PIX_FMT_NONE == format) {
+    return false;
+  }
+
+  if (AV_PIX_FMT_NONE == par->format) {
+    par->format = format;
+  }
+  if (!par->width || !par->height) {
+    par->width = info.width;
+    par->height = info.height;
+  }
+  if (FF_PROFILE_UNKNOWN == par->profile) {
+    par->profile = info.profile;
+  }
+  if (FF_LEVEL_UNKNOWN == par->level) {
+    par->level = info.level;
   }
+  if (AVCOL_RANGE_UNSPECIFIED == par->color_range) {
+    par->color_range =
+        info.video_full_range ? AVCOL_RANGE_JPEG : AVCOL_RANGE_MPEG;
+  }
+  if (AVCOL_SPC_UNSPECIFIED == par->color_space) {
+    par->color_space = (AVColorSpace)info.matrix_coefficients;
+    par->color_primaries = (AVColorPrimaries)info.colour_primaries;
+    par->color_trc =
+        (AVColorTransferCharacteristic)info.transfer_characteristics;
+  }
+
+  VPF_LOG(LOG_LEVEL_DEBUG, "FFmpegDemuxer")
+      << "Stream info probing skipped, " << info.width << "x" << info.height
+      << " " << av_get_pix_fmt_name(format);
+  return true;
+}
 
-  videoStream =
-      av_find_best_stream(fmtc, AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0);
-  if (videoStream < 0) {
+int FFmpegDemuxer::ProbeVideoStream(AVFormatContext *ctx, AVPacket &pending,
+                                    VPF::VideoStreamInfo &info, bool &hasInfo) {
+  info = VPF::VideoStreamInfo();
+  hasInfo = false;
+
+  if (!ProbeParameterSets(ctx, pending, info, hasInfo)) {
+    auto ret = avformat_find_stream_info(ctx, nullptr);
+    if (0 != ret) {
+      stringstream ss;
+      ss << __FUNCTION__ << ": can't find stream info;"
+         << AvErrorToString(ret) << endl;
+      throw runtime_error(ss.str());
+    }
+  }
+
+  auto const streamIdx =
+      av_find_best_stream(ctx, AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0);
+  if (streamIdx < 0) {
     stringstream ss;
     ss << __FUNCTION__ << ": can't find video stream in input file." << endl;
     throw runtime_error(ss.str());
   }
 
+  if (!hasInfo) {
+    auto const *par = ctx->streams[streamIdx]->codecpar;
+    hasInfo = par->extradata_size > 0 &&
+              VPF::ParseParameterSets(FFmpeg2NvCodecId(par->codec_id),
+                                      par->extradata, par->extradata_size,
+                                      info);
+  }
+  return streamIdx;
+}
+
+void FFmpegDemuxer::OpenVideoStream() {
   eVideoCodec = fmtc->streams[videoStream]->codecpar->codec_id;
   width = fmtc->streams[videoStream]->codecpar->width;
   height = fmtc->streams[videoStream]->codecpar->height;
@@ -333,7 +751,9 @@ FFmpegDemuxer::FFmpegDemuxer(AVFormatContext *fmtcx) : fmtc(fmtcx) {
   timebase = (double)fmtc->streams[videoStream]->time_base.num /
              (double)fmtc->streams[videoStream]->time_base.den;
   eChromaFormat = (AVPixelFormat)fmtc->streams[videoStream]->codecpar->format;
+  rotation = GetDisplayRotation(fmtc->streams[videoStream]);
 
+  sliceParser = VPF::SliceHeaderParser(FFmpeg2NvCodecId(eVideoCodec));
   is_mp4H264 = (eVideoCodec == AV_CODEC_ID_H264);
   is_mp4HEVC = (eVideoCodec == AV_CODEC_ID_HEVC);
   av_init_packet(&pkt);
@@ -346,6 +766,23 @@ FFmpegDemuxer::FFmpegDemuxer(AVFormatContext *fmtcx) : fmtc(fmtcx) {
   pktSei.data = nullptr;
   pktSei.size = 0;
 
+  auto const *codecpar = fmtc->streams[videoStream]->codecpar;
+  if (CanReuseBsf(bsfc_annexb, codecpar)) {
+    av_bsf_flush(bsfc_annexb);
+    if (bsfc_sei) {
+      av_bsf_flush(bsfc_sei);
+    }
+    VPF_LOG(LOG_LEVEL_DEBUG, "FFmpegDemuxer") << "Reusing bitstream filters";
+    return;
+  }
+
+  if (bsfc_annexb) {
+    av_bsf_free(&bsfc_annexb);
+  }
+  if (bsfc_sei) {
+    av_bsf_free(&bsfc_sei);
+  }
+
   // Initialize Annex.B BSF;
   const string bfs_name = is_mp4H264
                               ? "h264_mp4toannexb"
@@ -354,14 +791,13 @@ FFmpegDemuxer::FFmpegDemuxer(AVFormatContext *fmtcx) : fmtc(fmtcx) {
   if (!toAnnexB) {
     throw runtime_error("can't get " + bfs_name + " filter by name");
   }
-  ret = av_bsf_alloc(toAnnexB, &bsfc_annexb);
+  auto ret = av_bsf_alloc(toAnnexB, &bsfc_annexb);
   if (0 != ret) {
     throw runtime_error("Error allocating " + bfs_name +
                         " filter: " + AvErrorToString(ret));
   }
 
-  ret = avcodec_parameters_copy(bsfc_annexb->par_in,
-                                fmtc->streams[videoStream]->codecpar);
+  ret = avcodec_parameters_copy(bsfc_annexb->par_in, codecpar);
   if (0 != ret) {
     throw runtime_error("Error copying codec parameters: " +
                         AvErrorToString(ret));
@@ -11,6 +11,9 @@
  * limitations under the License.
  */
 
+#include "FFmpegDemuxer.h"
+#include "HostTransform.hpp"
+#include "Logger.hpp"
 #include "Tasks.hpp"
 #include <iostream>
 #include <sstream>
@@ -59,12 +62,36 @@ struct FfmpegDecodeFrame_Impl {
   AVPacket pkt = {0};
 
   Buffer *dec_frame = nullptr;
+  Buffer *pkt_data = nullptr;
   map<AVFrameSideDataType, Buffer *> side_data;
 
+  FrameCopyParams copy_params;
+  uint32_t out_width = 0U;
+  uint32_t out_height = 0U;
+
   int video_stream_idx = -1;
   bool end_encode = false;
 
-  FfmpegDecodeFrame_Impl(const char *URL, AVDictionary *pOptions) {
+  // Frames before seek target are dropped, last_pts tracks decoder position;
+  int64_t seek_pts = AV_NOPTS_VALUE;
+  int64_t last_pts = AV_NOPTS_VALUE;
+
+  // Input is over, decoder is drained of buffered frames;
+  bool flushing = false;
+
+  /* In resilient mode decoder is flushed upon error and video packets are
+   * dropped until the next keyframe;
+   */
+  bool resilient = false;
+  bool wait_keyframe = false;
+  uint32_t max_errors = 16U;
+  uint32_t num_errors_in_row = 0U;
+  DecodeErrorStats error_stats;
+  int last_error = 0;
+
+  FfmpegDecodeFrame_Impl(const char *URL, AVDictionary *pOptions,
+                         const FrameCopyParams &new_copy_params)
+      : copy_params(new_copy_params) {
 
     av_register_all();
 
@@ -97,7 +124,13 @@ struct FfmpegDecodeFrame_Impl {
     video_stream = fmt_ctx->streams[video_stream_idx];
 
     if (!video_stream) {
-      cerr << "Could not find video stream in the input, aborting" << endl;
+      VPF_LOG(LOG_LEVEL_ERROR, "FfmpegDecodeFrame")
+          << "Could not find video stream in the input, aborting";
+    }
+
+    if (copy_params.auto_rotate) {
+      copy_params.rotation = RotationFromDegrees(
+          copy_params.rotation + GetDisplayRotation(video_stream));
     }
 
     avctx = fmt_ctx->streams[video_stream_idx]->codec;
@@ -127,13 +160,47 @@ struct FfmpegDecodeFrame_Impl {
 
     frame = av_frame_alloc();
     if (!frame) {
-      cerr << "Could not allocate frame" << endl;
+      VPF_LOG(LOG_LEVEL_ERROR, "FfmpegDecodeFrame")
+          << "Could not allocate frame";
+    }
+  }
+
+  void SavePacketData(AVFrame *frame) {
+    if (!pkt_data) {
+      pkt_data = Buffer::MakeOwnMem(sizeof(PacketData));
+    }
+
+    // Decoder reorders frames, so timestamps are taken from frame itself;
+    auto *p_data = pkt_data->GetDataAs<PacketData>();
+    *p_data = PacketData();
+    p_data->pts = frame->best_effort_timestamp;
+    last_pts = p_data->pts;
+    p_data->dts = frame->pkt_dts;
+    p_data->pos = frame->pkt_pos;
+    p_data->duration = frame->pkt_duration > 0 ? frame->pkt_duration : 0;
+    p_data->is_keyframe = (0 != frame->key_frame);
+
+    switch (frame->pict_type) {
+    case AV_PICTURE_TYPE_I:
+      p_data->frame_type = FRAME_TYPE_I;
+      break;
+    case AV_PICTURE_TYPE_P:
+      p_data->frame_type = FRAME_TYPE_P;
+      break;
+    case AV_PICTURE_TYPE_B:
+      p_data->frame_type = FRAME_TYPE_B;
+      break;
+    default:
+      p_data->frame_type = FRAME_TYPE_UNKNOWN;
+      break;
     }
   }
 
   bool SaveYUV420(AVFrame *pframe) {
-    // Detect frame size & allocate memory if necessary;
-    size_t size = frame->width * frame->height * 3 / 2;
+    // Detect output frame size & allocate memory if necessary;
+    size_t size = 0U;
+    GetFrameCopySize(copy_params, pframe->width, pframe->height, out_width,
+                     out_height, size);
 
     if (!dec_frame) {
       dec_frame = Buffer::MakeOwnMem(size);
@@ -142,59 +209,148 @@ struct FfmpegDecodeFrame_Impl {
       dec_frame = Buffer::MakeOwnMem(size);
     }
 
-    // Copy pixels;
-    auto plane = 0U;
-    auto *dst = dec_frame->GetDataAs<uint8_t>();
-
-    for (plane = 0; plane < 3; plane++) {
-      auto *src = frame->data[plane];
-      auto width = (0 == plane) ? frame->width : frame->width / 2;
-      auto height = (0 == plane) ? frame->height : frame->height / 2;
-
-      for (int i = 0; i < height; i++) {
-        memcpy(dst, src, width);
-        dst += width;
-        src += frame->linesize[plane];
-      }
+    /* Crop, downscale and color conversion are done while pixels are
+     * copied, so decoded frame is read only once;
+     */
+    HostPlanes src;
+    for (auto plane = 0; plane < 3; plane++) {
+      src.data[plane] = pframe->data[plane];
+      src.pitch[plane] = pframe->linesize[plane];
     }
+    src.width = pframe->width;
+    src.height = pframe->height;
 
+    CopyFrameYUV420(src, copy_params, dec_frame->GetDataAs<uint8_t>());
     return true;
   }
 
   bool DecodeSingleFrame() {
-    if (end_encode) {
-      return false;
-    }
-
-    // Send packets to decoder until it outputs frame;
-    do {
-      // Read packets from stream until we find a video packet;
-      do {
-        auto ret = av_read_frame(fmt_ctx, &pkt);
-        if (ret < 0) {
-          // Flush decoder;
-          end_encode = true;
-          return DecodeSinglePacket(nullptr);
+    while (!end_encode) {
+      // Decoder may hold more than one frame, so it's drained first;
+      auto status = ReceiveFrame();
+      if (DEC_SUCCESS == status) {
+        num_errors_in_row = 0U;
+        return true;
+      }
+      if (DEC_EOS == status) {
+        end_encode = true;
+        return false;
+      }
+      if (DEC_ERROR == status) {
+        if (!Recover()) {
+          return false;
         }
-      } while (pkt.stream_index != video_stream_idx);
-
-      auto status = DecodeSinglePacket(&pkt);
+        continue;
+      }
 
-      switch (status) {
-      case DEC_SUCCESS:
-        return true;
-      case DEC_ERROR:
+      // Decoder needs more input;
+      if (flushing) {
+        end_encode = true;
         return false;
-      case DEC_EOS:
+      }
+
+      status = ReadPacket();
+      if (DEC_EOS == status) {
+        flushing = true;
+        avcodec_send_packet(avctx, nullptr);
+        continue;
+      }
+      if (DEC_ERROR == status) {
+        if (!Recover()) {
+          return false;
+        }
+        continue;
+      }
+
+      status = SendPacket(&pkt);
+      av_packet_unref(&pkt);
+      if (DEC_ERROR == status && !Recover()) {
         return false;
-      case DEC_MORE:
+      }
+    }
+
+    return false;
+  }
+
+  /* Reads next video packet into pkt; While waiting for keyframe other
+   * video packets are dropped;
+   */
+  DECODE_STATUS ReadPacket() {
+    while (true) {
+      auto res = av_read_frame(fmt_ctx, &pkt);
+      if (AVERROR_EOF == res) {
+        return DEC_EOS;
+      }
+      if (res < 0) {
+        error_stats.num_demux_errors++;
+        last_error = res;
+        if (!resilient) {
+          // Treated as end of input, so buffered frames aren't lost;
+          VPF_LOG(LOG_LEVEL_ERROR, "FfmpegDecodeFrame")
+              << "Error while reading a packet: " << AvErrorToString(res);
+          return DEC_EOS;
+        }
+        return DEC_ERROR;
+      }
+
+      if (pkt.stream_index != video_stream_idx) {
+        av_packet_unref(&pkt);
         continue;
       }
-    } while (true);
 
+      if (wait_keyframe) {
+        if (!(pkt.flags & AV_PKT_FLAG_KEY)) {
+          error_stats.num_skipped_frames++;
+          av_packet_unref(&pkt);
+          continue;
+        }
+        wait_keyframe = false;
+        error_stats.num_recoveries++;
+      }
+      return DEC_SUCCESS;
+    }
+  }
+
+  /* Flushes decoder and makes it wait for keyframe if error can be
+   * recovered from; Returns false if decoding should stop;
+   */
+  bool Recover() {
+    auto const recoverable = resilient && IsRecoverable(last_error);
+    if (!recoverable) {
+      VPF_LOG(LOG_LEVEL_ERROR, "FfmpegDecodeFrame")
+          << "Decoding error: " << AvErrorToString(last_error);
+      return false;
+    }
+
+    if (++num_errors_in_row > max_errors) {
+      VPF_LOG(LOG_LEVEL_ERROR, "FfmpegDecodeFrame")
+          << num_errors_in_row << " errors without decoded frame, last one: "
+          << AvErrorToString(last_error);
+      return false;
+    }
+
+    VPF_LOG(LOG_LEVEL_WARNING, "FfmpegDecodeFrame")
+        << AvErrorToString(last_error) << ", skipping to next keyframe";
+    avcodec_flush_buffers(avctx);
+    wait_keyframe = true;
     return true;
   }
 
+  /* Corrupt or truncated data may be followed by good one; Out of memory,
+   * API misuse and unsupported features won't go away;
+   */
+  static bool IsRecoverable(int av_error) {
+    switch (av_error) {
+    case AVERROR(ENOMEM):
+    case AVERROR(EINVAL):
+    case AVERROR_PATCHWELCOME:
+    case AVERROR_EOF:
+      return false;
+    default:
+      return true;
+    }
+  }
+
   bool SaveVideoFrame(AVFrame *frame) {
     // Only YUV420P is supported so far;
     if (AV_PIX_FMT_YUV420P != frame->format) {
@@ -227,33 +383,91 @@ struct FfmpegDecodeFrame_Impl {
     return true;
   }
 
-  DECODE_STATUS DecodeSinglePacket(const AVPacket *pkt) {
+  DECODE_STATUS SendPacket(const AVPacket *pkt) {
     auto res = avcodec_send_packet(avctx, pkt);
     if (res < 0) {
-      cerr << "Error while sending a packet to the decoder" << endl;
-      cerr << "Error description: " << AvErrorToString(res) << endl;
+      error_stats.num_decode_errors++;
+      last_error = res;
+      VPF_LOG(LOG_LEVEL_DEBUG, "FfmpegDecodeFrame")
+          << "Error while sending a packet to the decoder: "
+          << AvErrorToString(res);
       return DEC_ERROR;
     }
+    return DEC_SUCCESS;
+  }
 
-    while (res >= 0) {
-      res = avcodec_receive_frame(avctx, frame);
+  DECODE_STATUS ReceiveFrame() {
+    while (true) {
+      auto res = avcodec_receive_frame(avctx, frame);
       if (res == AVERROR_EOF) {
-        cerr << "Input file is over" << endl;
+        VPF_LOG(LOG_LEVEL_DEBUG, "FfmpegDecodeFrame") << "Input file is over";
         return DEC_EOS;
       } else if (res == AVERROR(EAGAIN)) {
         return DEC_MORE;
       } else if (res < 0) {
-        cerr << "Error while receiving a frame from the decoder" << endl;
-        cerr << "Error description: " << AvErrorToString(res) << endl;
+        error_stats.num_decode_errors++;
+        last_error = res;
+        VPF_LOG(LOG_LEVEL_DEBUG, "FfmpegDecodeFrame")
+            << "Error while receiving a frame from the decoder: "
+            << AvErrorToString(res);
         return DEC_ERROR;
       }
 
+      // Decoder has concealed errors in this one;
+      if (frame->decode_error_flags ||
+          (frame->flags & AV_FRAME_FLAG_CORRUPT)) {
+        error_stats.num_corrupt_frames++;
+      }
+
+      if (AV_NOPTS_VALUE != seek_pts) {
+        auto const pts = frame->best_effort_timestamp;
+        if (AV_NOPTS_VALUE != pts && pts < seek_pts) {
+          last_pts = pts;
+          av_frame_unref(frame);
+          continue;
+        }
+        seek_pts = AV_NOPTS_VALUE;
+      }
+
       SaveVideoFrame(frame);
       SaveSideData(frame);
+      SavePacketData(frame);
       return DEC_SUCCESS;
     }
+  }
 
-    return DEC_SUCCESS;
+  bool Seek(int64_t pts) {
+    /* Decoding forward is cheaper than seeking if there's no keyframe
+     * between current position and target;
+     */
+    auto same_gop = false;
+    if (!end_encode && !flushing && !wait_keyframe &&
+        AV_NOPTS_VALUE != last_pts && pts > last_pts) {
+      auto const idx = av_index_search_timestamp(video_stream, pts,
+                                                 AVSEEK_FLAG_BACKWARD);
+      same_gop =
+          (idx >= 0 && video_stream->index_entries[idx].timestamp <= last_pts);
+    }
+
+    if (!same_gop) {
+      auto res = av_seek_frame(fmt_ctx, video_stream_idx, pts,
+                               AVSEEK_FLAG_BACKWARD);
+      if (res < 0) {
+        VPF_LOG(LOG_LEVEL_ERROR, "FfmpegDecodeFrame")
+            << "Can't seek to pts " << pts << ": " << AvErrorToString(res);
+        return false;
+      }
+
+      avcodec_flush_buffers(avctx);
+      end_encode = false;
+      flushing = false;
+      wait_keyframe = false;
+      num_errors_in_row = 0U;
+      last_pts = AV_NOPTS_VALUE;
+    }
+
+    seek_pts = pts;
+    return true;
   }
 
   ~FfmpegDecodeFrame_Impl() {
@@ -270,6 +484,10 @@ struct FfmpegDecodeFrame_Impl {
     if (dec_frame) {
       delete dec_frame;
     }
+
+    if (pkt_data) {
+      delete pkt_data;
+    }
   }
 };
 } // namespace VPF
@@ -279,6 +497,7 @@ TaskExecStatus FfmpegDecodeFrame::Execute() {
 
   if (pImpl->DecodeSingleFrame()) {
     SetOutput((Token *)pImpl->dec_frame, 0U);
+    SetOutput((Token *)pImpl->pkt_data, 2U);
     return TaskExecStatus::TASK_EXEC_SUCCESS;
   }
 
@@ -296,16 +515,44 @@ TaskExecStatus FfmpegDecodeFrame::GetSideData(AVFrameSideDataType data_type) {
   return TaskExecStatus::TASK_EXEC_FAIL;
 }
 
+void FfmpegDecodeFrame::GetFrameParams(uint32_t &width,
+                                       uint32_t &height) const {
+  width = pImpl->out_width;
+  height = pImpl->out_height;
+}
+
+bool FfmpegDecodeFrame::Seek(int64_t pts) { return pImpl->Seek(pts); }
+
+void FfmpegDecodeFrame::SetErrorResilience(bool enable, uint32_t max_errors) {
+  pImpl->resilient = enable;
+  pImpl->max_errors = max_errors;
+}
+
+void FfmpegDecodeFrame::GetErrorStats(DecodeErrorStats &stats) const {
+  stats = pImpl->error_stats;
+}
+
+double FfmpegDecodeFrame::GetTimebase() const {
+  return av_q2d(pImpl->video_stream->time_base);
+}
+
+int64_t FfmpegDecodeFrame::GetStartPts() const {
+  auto const start_time = pImpl->video_stream->start_time;
+  return (AV_NOPTS_VALUE == start_time) ? 0 : start_time;
+}
+
 FfmpegDecodeFrame *FfmpegDecodeFrame::Make(const char *URL,
-                                           NvDecoderClInterface &cli_iface) {
-  return new FfmpegDecodeFrame(URL, cli_iface);
+                                           NvDecoderClInterface &cli_iface,
+                                           const FrameCopyParams &copy_params) {
+  return new FfmpegDecodeFrame(URL, cli_iface, copy_params);
 }
 
 FfmpegDecodeFrame::FfmpegDecodeFrame(const char *URL,
-                                     NvDecoderClInterface &cli_iface)
+                                     NvDecoderClInterface &cli_iface,
+                                     const FrameCopyParams &copy_params)
     : Task("FfmpegDecodeFrame", FfmpegDecodeFrame::num_inputs,
            FfmpegDecodeFrame::num_outputs) {
-  pImpl = new FfmpegDecodeFrame_Impl(URL, cli_iface.GetOptions());
+  pImpl = new FfmpegDecodeFrame_Impl(URL, cli_iface.GetOptions(), copy_params);
 }
 
 FfmpegDecodeFrame::~FfmpegDecodeFrame() { delete pImpl; }
\ No newline at end of file
@@ -0,0 +1,749 @@
+/*
+ * Copyright 2020 NVIDIA Corporation
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "FrameCache.hpp"
+#include "AsyncWriter.hpp"
+#include "CodecsSupport.hpp"
+#include "HostTransform.hpp"
+#include "Logger.hpp"
+#include "MappedFile.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+#if defined(_WIN32)
+#define NOMINMAX
+#include <direct.h>
+#include <sys/utime.h>
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <sys/stat.h>
+#include <utime.h>
+#endif
+
+using namespace VPF;
+using namespace std;
+
+namespace {
+const char entry_magic[8] = {'V', 'P', 'F', 'C', 'A', 'C', 'H', 'E'};
+const uint32_t entry_version = 1U;
+const char entry_suffix[] = ".vfc";
+const char part_suffix[] = ".part";
+
+// Frame records start at page boundary, after the header;
+const uint64_t header_block_size = 4096U;
+
+struct EntryHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t width;
+  uint32_t height;
+  int32_t format;
+  uint64_t frame_size;
+  uint64_t num_frames;
+  // Index is written after the last frame;
+  uint64_t index_offset;
+};
+
+struct IndexEntry {
+  int64_t pts;
+  int64_t duration;
+  uint64_t offset;
+  uint32_t size;
+  uint32_t compressed;
+};
+
+/* When that many frames in a row don't compress well, compression is
+ * skipped for a while, e. g. on noisy content;
+ */
+const uint32_t max_compress_misses = 8U;
+const uint32_t compress_skip_frames = 64U;
+
+/* LZ77 codec with LZ4-like block layout; Sequence is token byte with
+ * literal and match length nibbles, optional length extension bytes,
+ * literals, 16 bit match offset and match length extension; The last
+ * sequence has literals only;
+ */
+const uint32_t lz_min_match = 4U;
+const uint32_t lz_hash_bits = 14U;
+const uint32_t lz_max_offset = 65535U;
+
+uint32_t Read32(const uint8_t *ptr) {
+  uint32_t value;
+  memcpy(&value, ptr, sizeof(value));
+  return value;
+}
+
+bool LzPutLength(size_t length, uint8_t *&op, const uint8_t *end) {
+  while (length >= 255U) {
+    if (op == end) {
+      return false;
+    }
+    *op++ = 255U;
+    length -= 255U;
+  }
+  if (op == end) {
+    return false;
+  }
+  *op++ = (uint8_t)length;
+  return true;
+}
+
+bool LzPutSequence(const uint8_t *literals, size_t num_literals,
+                   size_t offset, size_t match, uint8_t *&op,
+                   const uint8_t *end) {
+  if (op == end) {
+    return false;
+  }
+
+  auto const match_code = match ? match - lz_min_match : 0U;
+  auto *token = op++;
+  *token = (uint8_t)((min(num_literals, (size_t)15U) << 4U) |
+                     min(match_code, (size_t)15U));
+
+  if (num_literals >= 15U && !LzPutLength(num_literals - 15U, op, end)) {
+    return false;
+  }
+  if ((size_t)(end - op) < num_literals) {
+    return false;
+  }
+  memcpy(op, literals, num_literals);
+  op += num_literals;
+
+  if (!match) {
+    return true;
+  }
+
+  if (end - op < 2) {
+    return false;
+  }
+  *op++ = (uint8_t)offset;
+  *op++ = (uint8_t)(offset >> 8U);
+
+  return match_code < 15U || LzPutLength(match_code - 15U, op, end);
+}
+
+// Returns compressed size or zero if it doesn't fit into capacity;
+size_t LzCompress(const uint8_t *src, size_t size, uint8_t *dst,
+                  size_t capacity) {
+  vector<uint32_t> table(1U << lz_hash_bits, 0U);
+  auto *op = dst;
+  auto const *end = dst + capacity;
+
+  size_t pos = 0U, anchor = 0U;
+  while (pos + lz_min_match <= size) {
+    auto const seq = Read32(src + pos);
+    auto const hash = (seq * 2654435761U) >> (32U - lz_hash_bits);
+    size_t const candidate = table[hash];
+    table[hash] = (uint32_t)pos;
+
+    if (candidate >= pos || pos - candidate > lz_max_offset ||
+        Read32(src + candidate) != seq) {
+      // Step grows on incompressible data;
+      pos += 1U + ((pos - anchor) >> 6U);
+      continue;
+    }
+
+    auto match = lz_min_match;
+    while (pos + match < size && src[candidate + match] == src[pos + match]) {
+      match++;
+    }
+
+    if (!LzPutSequence(src + anchor, pos - anchor, pos - candidate, match, op,
+                       end)) {
+      return 0U;
+    }
+    pos += match;
+    anchor = pos;
+  }
+
+  if (!LzPutSequence(src + anchor, size - anchor, 0U, 0U, op, end)) {
+    return 0U;
+  }
+  return op - dst;
+}
+
+bool LzGetLength(const uint8_t *&ip, const uint8_t *end, size_t &length) {
+  uint8_t byte;
+  do {
+    if (ip == end) {
+      return false;
+    }
+    byte = *ip++;
+    length += byte;
+  } while (255U == byte);
+  return true;
+}
+
+// Returns false if data is corrupted or doesn't unpack to exactly size bytes;
+bool LzDecompress(const uint8_t *src, size_t src_size, uint8_t *dst,
+                  size_t size) {
+  auto const *ip = src;
+  auto const *src_end = src + src_size;
+  size_t pos = 0U;
+
+  while (ip < src_end) {
+    auto const token = *ip++;
+
+    size_t num_literals = token >> 4U;
+    if (15U == num_literals && !LzGetLength(ip, src_end, num_literals)) {
+      return false;
+    }
+    if ((size_t)(src_end - ip) < num_literals ||
+        size - pos < num_literals) {
+      return false;
+    }
+    memcpy(dst + pos, ip, num_literals);
+    ip += num_literals;
+    pos += num_literals;
+
+    if (ip == src_end) {
+      break;
+    }
+
+    if (src_end - ip < 2) {
+      return false;
+    }
+    size_t const offset = ip[0] | (ip[1] << 8U);
+    ip += 2;
+
+    size_t match = token & 15U;
+    if (15U == match && !LzGetLength(ip, src_end, match)) {
+      return false;
+    }
+    match += lz_min_match;
+
+    if (!offset || offset > pos || size - pos < match) {
+      return false;
+    }
+    // Match may overlap output it's copied to;
+    for (size_t i = 0U; i < match; i++, pos++) {
+      dst[pos] = dst[pos - offset];
+    }
+  }
+
+  return pos == size;
+}
+
+// FNV-1a;
+uint64_t HashString(const string &value) {
+  uint64_t hash = 14695981039346656037ULL;
+  for (auto c : value) {
+    hash = (hash ^ (uint8_t)c) * 1099511628211ULL;
+  }
+  return hash;
+}
+
+bool EndsWith(const string &value, const string &suffix) {
+  return value.size() >= suffix.size() &&
+         0 == value.compare(value.size() - suffix.size(), suffix.size(),
+                            suffix);
+}
+
+struct DirEntry {
+  string path;
+  uint64_t size;
+  int64_t mtime;
+};
+
+// Complete cache entries of directory;
+vector<DirEntry> ListEntries(const string &dir) {
+  vector<DirEntry> entries;
+#if defined(_WIN32)
+  WIN32_FIND_DATAA find_data;
+  auto handle = FindFirstFileA((dir + "\\*" + entry_suffix).c_str(),
+                               &find_data);
+  if (INVALID_HANDLE_VALUE == handle) {
+    return entries;
+  }
+  do {
+    ULARGE_INTEGER size, mtime;
+    size.LowPart = find_data.nFileSizeLow;
+    size.HighPart = find_data.nFileSizeHigh;
+    mtime.LowPart = find_data.ftLastWriteTime.dwLowDateTime;
+    mtime.HighPart = find_data.ftLastWriteTime.dwHighDateTime;
+    entries.push_back({dir + "\\" + find_data.cFileName, size.QuadPart,
+                       (int64_t)mtime.QuadPart});
+  } while (FindNextFileA(handle, &find_data));
+  FindClose(handle);
+#else
+  auto handle = opendir(dir.c_str());
+  if (!handle) {
+    return entries;
+  }
+  while (auto item = readdir(handle)) {
+    string name(item->d_name);
+    if (!EndsWith(name, entry_suffix)) {
+      continue;
+    }
+
+    auto const path = dir + "/" + name;
+    struct stat st;
+    if (0 == stat(path.c_str(), &st) && S_ISREG(st.st_mode)) {
+      entries.push_back({path, (uint64_t)st.st_size, (int64_t)st.st_mtime});
+    }
+  }
+  closedir(handle);
+#endif
+  return entries;
+}
+
+// Modification time is used as last access time, atime is often disabled;
+void TouchFile(const string &path) {
+#if defined(_WIN32)
+  _utime(path.c_str(), nullptr);
+#else
+  utime(path.c_str(), nullptr);
+#endif
+}
+
+bool FileExists(const string &path) {
+  auto file = fopen(path.c_str(), "rb");
+  if (file) {
+    fclose(file);
+  }
+  return nullptr != file;
+}
+
+void MakeDir(const string &path) {
+#if defined(_WIN32)
+  _mkdir(path.c_str());
+#else
+  mkdir(path.c_str(), 0755);
+#endif
+}
+
+size_t GetFrameSize(const FrameCacheParams &params) {
+  if (!params.width || !params.height || UNDEFINED == params.format) {
+    throw invalid_argument("Frame cache frame size and format must be given");
+  }
+  return GetHostFrameSize(params.format, params.width, params.height);
+}
+} // namespace
+
+namespace VPF {
+struct FrameCache_Impl {
+  string dir;
+  uint64_t budget;
+  mutable mutex mtx;
+
+  FrameCache_Impl(const char *new_dir, uint64_t new_budget)
+      : dir(new_dir), budget(new_budget) {
+    MakeDir(dir);
+  }
+};
+
+struct FrameCacheWriter_Impl {
+  FrameCacheParams params;
+  size_t frame_size = 0U;
+  string path;
+  string part_path;
+  unique_ptr<AsyncFile> file;
+
+  vector<IndexEntry> index;
+  vector<uint8_t> packed;
+  uint64_t num_compressed = 0U;
+  uint32_t compress_misses = 0U;
+  uint32_t compress_skip = 0U;
+  bool failed = false;
+
+  FrameCacheWriter_Impl(const char *new_path,
+                        const FrameCacheParams &new_params)
+      : params(new_params), path(new_path) {
+    frame_size = GetFrameSize(params);
+    part_path = path + part_suffix;
+    file.reset(AsyncFile::Make(AsyncWriter::GetDefault(), part_path));
+
+    // Header is written once index offset is known;
+    vector<uint8_t> header_block(header_block_size, 0U);
+    failed |= !file->Write(header_block.data(), header_block.size());
+  }
+
+  ~FrameCacheWriter_Impl() { Close(); }
+
+  void Write(const uint8_t *data, int64_t pts, int64_t duration) {
+    IndexEntry entry = {};
+    entry.pts = pts;
+    entry.duration = duration;
+    entry.offset = (uint64_t)file->Tell();
+    entry.size = (uint32_t)frame_size;
+
+    size_t packed_size = 0U;
+    if (params.compress && !compress_skip) {
+      auto const capacity = (size_t)(frame_size * params.max_compressed_ratio);
+      packed.resize(max(capacity, (size_t)1U));
+      packed_size = LzCompress(data, frame_size, packed.data(), capacity);
+
+      if (packed_size) {
+        compress_misses = 0U;
+      } else if (++compress_misses == max_compress_misses) {
+        compress_misses = 0U;
+        compress_skip = compress_skip_frames;
+      }
+    } else if (compress_skip) {
+      compress_skip--;
+    }
+
+    if (packed_size) {
+      entry.size = (uint32_t)packed_size;
+      entry.compressed = 1U;
+      num_compressed++;
+      failed |= !file->Write(packed.data(), packed_size);
+    } else {
+      failed |= !file->Write(data, frame_size);
+    }
+    index.push_back(entry);
+  }
+
+  bool Close() {
+    if (!file) {
+      return !failed;
+    }
+
+    EntryHeader header = {};
+    memcpy(header.magic, entry_magic, sizeof(entry_magic));
+    header.version = entry_version;
+    header.width = params.width;
+    header.height = params.height;
+    header.format = params.format;
+    header.frame_size = frame_size;
+    header.num_frames = index.size();
+    header.index_offset = (uint64_t)file->Tell();
+
+    failed |= !file->Write(index.data(), index.size() * sizeof(IndexEntry));
+    failed |= !file->Seek(0);
+    failed |= !file->Write(&header, sizeof(header));
+    failed |= !file->Close();
+    file.reset();
+
+    if (failed) {
+      VPF_LOG(LOG_LEVEL_ERROR, "FrameCacheWriter")
+          << "Failed to write " << part_path;
+      remove(part_path.c_str());
+      return false;
+    }
+
+#if defined(_WIN32)
+    remove(path.c_str());
+#endif
+    if (0 != rename(part_path.c_str(), path.c_str())) {
+      VPF_LOG(LOG_LEVEL_ERROR, "FrameCacheWriter")
+          << "Can't rename " << part_path << " to " << path;
+      remove(part_path.c_str());
+      failed = true;
+    }
+    return !failed;
+  }
+};
+
+struct FrameCacheReader_Impl {
+  MappedFile file;
+  FrameCacheParams params;
+  size_t frame_size = 0U;
+  vector<IndexEntry> index;
+
+  // Pts and frame index, sorted by pts;
+  vector<pair<int64_t, uint64_t>> pts_order;
+  uint64_t next_frame = 0U;
+
+  vector<uint8_t> unpacked;
+  Buffer *frame = nullptr;
+  Buffer *pkt_data = nullptr;
+
+  explicit FrameCacheReader_Impl(const char *path) : file(path) {
+    auto const *data = file.Data();
+    auto const size = file.Size();
+
+    EntryHeader header;
+    if (size < header_block_size) {
+      ThrowError(path);
+    }
+    memcpy(&header, data, sizeof(header));
+    if (0 != memcmp(header.magic, entry_magic, sizeof(entry_magic)) ||
+        entry_version != header.version) {
+      ThrowError(path);
+    }
+
+    params.width = header.width;
+    params.height = header.height;
+    params.format = (Pixel_Format)header.format;
+    frame_size = GetFrameSize(params);
+    if (frame_size != header.frame_size ||
+        header.index_offset < header_block_size ||
+        header.index_offset > size ||
+        (size - header.index_offset) / sizeof(IndexEntry) <
+            header.num_frames) {
+      ThrowError(path);
+    }
+
+    // Index may be unaligned;
+    index.resize(header.num_frames);
+    memcpy(index.data(), data + header.index_offset,
+           index.size() * sizeof(IndexEntry));
+
+    for (auto &entry : index) {
+      if (entry.offset < header_block_size ||
+          entry.offset + entry.size > header.index_offset ||
+          (!entry.compressed && entry.size != frame_size)) {
+        ThrowError(path);
+      }
+      params.compress |= (0U != entry.compressed);
+    }
+
+    for (uint64_t i = 0U; i < index.size(); i++) {
+      pts_order.emplace_back(index[i].pts, i);
+    }
+    sort(pts_order.begin(), pts_order.end());
+
+    frame = Buffer::Make(frame_size, nullptr);
+    pkt_data = Buffer::MakeOwnMem(sizeof(PacketData));
+  }
+
+  ~FrameCacheReader_Impl() {
+    delete frame;
+    delete pkt_data;
+  }
+
+  void ThrowError(const char *path) {
+    stringstream ss;
+    ss << path << " isn't complete frame cache entry";
+    throw runtime_error(ss.str());
+  }
+
+  const uint8_t *GetFrame(uint64_t frame_index) {
+    auto const &entry = index[frame_index];
+    auto const *data = file.Data() + entry.offset;
+    if (!entry.compressed) {
+      return data;
+    }
+
+    unpacked.resize(frame_size);
+    if (!LzDecompress(data, entry.size, unpacked.data(), frame_size)) {
+      VPF_LOG(LOG_LEVEL_ERROR, "FrameCacheReader")
+          << "Frame " << frame_index << " is corrupted";
+      return nullptr;
+    }
+    return unpacked.data();
+  }
+};
+} // namespace VPF
+
+FrameCache *FrameCache::Make(const char *dir, uint64_t budget) {
+  return new FrameCache(dir, budget);
+}
+
+FrameCache::FrameCache(const char *dir, uint64_t budget) {
+  pImpl = new FrameCache_Impl(dir, budget);
+}
+
+FrameCache::~FrameCache() { delete pImpl; }
+
+string FrameCache::GetEntryPath(const string &source,
+                                const FrameCacheParams &params) const {
+  stringstream key;
+  key << source << "|" << params.width << "x" << params.height << "|"
+      << params.format;
+
+  stringstream ss;
+  ss << pImpl->dir << "/" << hex << HashString(key.str()) << entry_suffix;
+  return ss.str();
+}
+
+bool FrameCache::Lookup(const string &source, const FrameCacheParams &params) {
+  auto const path = GetEntryPath(source, params);
+  if (!FileExists(path)) {
+    return false;
+  }
+
+  TouchFile(path);
+  return true;
+}
+
+uint64_t FrameCache::Evict(uint64_t reserve) {
+  if (!pImpl->budget) {
+    return 0U;
+  }
+
+  lock_guard<mutex> lock(pImpl->mtx);
+  auto entries = ListEntries(pImpl->dir);
+  sort(entries.begin(), entries.end(),
+       [](const DirEntry &a, const DirEntry &b) { return a.mtime < b.mtime; });
+
+  uint64_t total = 0U;
+  for (auto &entry : entries) {
+    total += entry.size;
+  }
+
+  uint64_t removed = 0U;
+  for (auto &entry : entries) {
+    if (total + reserve <= pImpl->budget) {
+      break;
+    }
+
+    // Entry mapped by reader can't be removed on Windows, it's kept then;
+    if (0 == remove(entry.path.c_str())) {
+      total -= entry.size;
+      removed += entry.size;
+      VPF_LOG(LOG_LEVEL_DEBUG, "FrameCache") << "Evicted " << entry.path;
+    }
+  }
+  return removed;
+}
+
+uint64_t FrameCache::GetSize() const {
+  lock_guard<mutex> lock(pImpl->mtx);
+  uint64_t total = 0U;
+  for (auto &entry : ListEntries(pImpl->dir)) {
+    total += entry.size;
+  }
+  return total;
+}
+
+uint64_t FrameCache::GetBudget() const { return pImpl->budget; }
+
+FrameCacheWriter *FrameCacheWriter::Make(const char *path,
+                                         const FrameCacheParams &params) {
+  return new FrameCacheWriter(path, params);
+}
+
+FrameCacheWriter::FrameCacheWriter(const char *path,
+                                   const FrameCacheParams &params)
+    : Task("FrameCacheWriter", FrameCacheWriter::numInputs,
+           FrameCacheWriter::numOutputs) {
+  pImpl = new FrameCacheWriter_Impl(path, params);
+}
+
+FrameCacheWriter::~FrameCacheWriter() { delete pImpl; }
+
+TaskExecStatus FrameCacheWriter::Execute() {
+  auto input = (Buffer *)GetInput(0U);
+  if (!input || !pImpl->file) {
+    return TaskExecStatus::TASK_EXEC_FAIL;
+  }
+
+  if (input->GetRawMemSize() != pImpl->frame_size) {
+    VPF_LOG(LOG_LEVEL_ERROR, "FrameCacheWriter")
+        << "Frame is " << input->GetRawMemSize() << " bytes, expected "
+        << pImpl->frame_size;
+    return TaskExecStatus::TASK_EXEC_FAIL;
+  }
+
+  int64_t pts = pImpl->index.size();
+  int64_t duration = 0;
+  auto pPktData = (Buffer *)GetInput(1U);
+  if (pPktData) {
+    auto pkt_data = pPktData->GetDataAs<PacketData>();
+    pts = pkt_data->pts;
+    duration = pkt_data->duration;
+  }
+
+  pImpl->Write(input->GetDataAs<uint8_t>(), pts, duration);
+  return pImpl->failed ? TaskExecStatus::TASK_EXEC_FAIL
+                       : TaskExecStatus::TASK_EXEC_SUCCESS;
+}
+
+bool FrameCacheWriter::Close() { return pImpl->Close(); }
+
+uint64_t FrameCacheWriter::GetNumFrames() const {
+  return pImpl->index.size();
+}
+
+uint64_t FrameCacheWriter::GetNumCompressed() const {
+  return pImpl->num_compressed;
+}
+
+FrameCacheReader *FrameCacheReader::Make(const char *path) {
+  return new FrameCacheReader(path);
+}
+
+FrameCacheReader::FrameCacheReader(const char *path)
+    : Task("FrameCacheReader", FrameCacheReader::numInputs,
+           FrameCacheReader::numOutputs) {
+  pImpl = new FrameCacheReader_Impl(path);
+}
+
+FrameCacheReader::~FrameCacheReader() { delete pImpl; }
+
+TaskExecStatus FrameCacheReader::Execute() {
+  ClearOutputs();
+
+  auto const frame_index = pImpl->next_frame;
+  if (frame_index >= pImpl->index.size()) {
+    return TaskExecStatus::TASK_EXEC_FAIL;
+  }
+  pImpl->next_frame++;
+
+  auto const *data = pImpl->GetFrame(frame_index);
+  if (!data) {
+    return TaskExecStatus::TASK_EXEC_FAIL;
+  }
+  pImpl->frame->Update(pImpl->frame_size, (void *)data);
+
+  auto const &entry = pImpl->index[frame_index];
+  auto pkt_data = pImpl->pkt_data->GetDataAs<PacketData>();
+  memset(pkt_data, 0, sizeof(*pkt_data));
+  pkt_data->pts = entry.pts;
+  pkt_data->dts = entry.pts;
+  pkt_data->pos = frame_index;
+  pkt_data->duration = entry.duration;
+  pkt_data->is_keyframe = true;
+
+  SetOutput(pImpl->frame, 0U);
+  SetOutput(pImpl->pkt_data, 1U);
+  return TaskExecStatus::TASK_EXEC_SUCCESS;
+}
+
+void FrameCacheReader::GetParams(FrameCacheParams &params) const {
+  params = pImpl->params;
+}
+
+uint64_t FrameCacheReader::GetNumFrames() const { return pImpl->index.size(); }
+
+uint64_t FrameCacheReader::GetFrameIndex() const { return pImpl->next_frame; }
+
+size_t FrameCacheReader::GetFrameSize() const { return pImpl->frame_size; }
+
+bool FrameCacheReader::Seek(uint64_t frame_index) {
+  if (frame_index >= pImpl->index.size()) {
+    return false;
+  }
+
+  pImpl->next_frame = frame_index;
+  return true;
+}
+
+bool FrameCacheReader::SeekToPts(int64_t pts) {
+  auto const &order = pImpl->pts_order;
+  auto it =
+      lower_bound(order.begin(), order.end(), make_pair(pts, (uint64_t)0U));
+  if (order.end() == it) {
+    return false;
+  }
+
+  pImpl->next_frame = it->second;
+  return true;
+}
+
+const uint8_t *FrameCacheReader::GetRawFrame(uint64_t frame_index) const {
+  if (frame_index >= pImpl->index.size() ||
+      pImpl->index[frame_index].compressed) {
+    return nullptr;
+  }
+  return pImpl->file.Data() + pImpl->index[frame_index].offset;
+}
@@ -0,0 +1,265 @@
+/*
+ * Copyright 2020 NVIDIA Corporation
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "MemoryInterfaces.hpp"
+#include "Tasks.hpp"
+#include <cmath>
+#include <map>
+#include <stdexcept>
+
+extern "C" {
+#include <libavutil/avutil.h>
+}
+
+using namespace VPF;
+using namespace std;
+
+namespace VPF {
+struct FrameRateConverter_Impl {
+  FrameRateParams params;
+  double period = 0.0;
+
+  int64_t last_slot = 0;
+  bool has_last_slot = false;
+  uint64_t num_inputs = 0U;
+  uint32_t num_repeats = 0U;
+
+  // Time of previous input and interval between inputs, frame level only;
+  double last_time = 0.0;
+  bool has_last_time = false;
+  double interval = 0.0;
+
+  /* Distance of closest passed packet to its slot, packet level only;
+   * Non-reference packet farther from its slot than that can't be chosen
+   * by frame level converter;
+   */
+  map<int64_t, double> taken_slots;
+  static const size_t max_taken_slots = 256U;
+
+  // Timestamp jump longer than that is discontinuity, not a gap to fill;
+  static constexpr double max_gap_sec = 10.0;
+
+  Buffer *pkt_data = nullptr;
+
+  explicit FrameRateConverter_Impl(const FrameRateParams &new_params)
+      : params(new_params) {
+    if (params.target_fps <= 0.0) {
+      throw invalid_argument("Target frame rate must be positive");
+    }
+    period = 1.0 / params.target_fps;
+    if (params.src_fps > 0.0) {
+      interval = 1.0 / params.src_fps;
+    }
+    pkt_data = Buffer::MakeOwnMem(sizeof(PacketData));
+  }
+
+  ~FrameRateConverter_Impl() { delete pkt_data; }
+
+  bool FrameTime(const PacketData *pPktData, double &time) const {
+    if (pPktData && params.time_base > 0.0) {
+      auto ts = pPktData->pts;
+      // Packets without pts are placed by dts, frames can't be;
+      if (AV_NOPTS_VALUE == ts && params.packet_level) {
+        ts = pPktData->dts;
+      }
+      if (AV_NOPTS_VALUE != ts) {
+        time = ts * params.time_base;
+        return true;
+      }
+    }
+
+    if (params.src_fps > 0.0) {
+      time = num_inputs / params.src_fps;
+      return true;
+    }
+
+    return false;
+  }
+
+  int64_t Slot(double time) const {
+    auto const slot = time / period;
+    // Small epsilon keeps frames which are exactly at slot boundary in it;
+    return (int64_t)floor(FRC_NEAREST == params.mode ? slot + 0.5
+                                                     : slot + 1e-6);
+  }
+
+  /* Frame level converter takes the earliest frame of slot, or the closest
+   * one in nearest mode;
+   */
+  double Distance(double time, int64_t slot) const {
+    auto const distance = time - slot * period;
+    return FRC_NEAREST == params.mode ? fabs(distance) : distance;
+  }
+
+  uint32_t SelectPacket(const PacketData *pPktData, double time,
+                        int64_t slot) {
+    /* Reference flag is only known when slice header was parsed, other
+     * packets are always decoded;
+     */
+    auto const can_skip = pPktData && !pPktData->is_reference &&
+                          FRAME_TYPE_UNKNOWN != pPktData->frame_type;
+
+    auto const distance = Distance(time, slot);
+    auto it = taken_slots.find(slot);
+    if (taken_slots.end() != it) {
+      if (can_skip && it->second < distance) {
+        return 0U;
+      }
+      it->second = min(it->second, distance);
+      return 1U;
+    }
+
+    taken_slots[slot] = distance;
+    while (taken_slots.size() > max_taken_slots) {
+      taken_slots.erase(taken_slots.begin());
+    }
+    return 1U;
+  }
+
+  /* Frames can't be held until the next one shows which is closer to slot,
+   * as output is input token itself; Next frame time is predicted from the
+   * last interval instead; If predicted frame doesn't come, slot stays
+   * empty as in case of gap;
+   */
+  bool IsNextFrameCloser(double time, int64_t slot) const {
+    if (FRC_NEAREST != params.mode || interval <= 0.0) {
+      return false;
+    }
+
+    auto const next_time = time + interval;
+    return Slot(next_time) == slot &&
+           Distance(next_time, slot) < Distance(time, slot);
+  }
+
+  uint32_t SelectFrame(double time, int64_t slot) {
+    if (has_last_time && time > last_time) {
+      interval = time - last_time;
+    }
+    last_time = time;
+    has_last_time = true;
+
+    auto const max_gap = (int64_t)ceil(max_gap_sec / period);
+    if (has_last_slot && llabs(slot - last_slot) > max_gap) {
+      // Start over after discontinuity;
+      has_last_slot = false;
+    }
+
+    if (IsNextFrameCloser(time, slot)) {
+      return 0U;
+    }
+
+    uint32_t repeats = 1U;
+    if (has_last_slot) {
+      if (slot <= last_slot) {
+        return 0U;
+      }
+      repeats = (FRC_DUPLICATE == params.mode) ? slot - last_slot : 1U;
+    }
+
+    last_slot = slot;
+    has_last_slot = true;
+    return repeats;
+  }
+
+  uint32_t Select(const PacketData *pPktData) {
+    double time = 0.0;
+    auto const has_time = FrameTime(pPktData, time);
+    num_inputs++;
+
+    // Nothing to choose by, pass everything;
+    if (!has_time) {
+      num_repeats = 1U;
+      return num_repeats;
+    }
+
+    auto const slot = Slot(time);
+    num_repeats = params.packet_level ? SelectPacket(pPktData, time, slot)
+                                      : SelectFrame(time, slot);
+    return num_repeats;
+  }
+
+  void UpdatePacketData(const PacketData *pPktData) {
+    auto *pOut = pkt_data->GetDataAs<PacketData>();
+    if (pPktData) {
+      *pOut = *pPktData;
+    } else {
+      *pOut = PacketData();
+      pOut->pts = AV_NOPTS_VALUE;
+      pOut->dts = AV_NOPTS_VALUE;
+    }
+
+    if (!params.packet_level && params.time_base > 0.0) {
+      pOut->duration =
+          (uint64_t)llround(num_repeats * period / params.time_base);
+    }
+  }
+
+  void Reset() {
+    has_last_slot = false;
+    has_last_time = false;
+    interval = params.src_fps > 0.0 ? 1.0 / params.src_fps : 0.0;
+    num_inputs = 0U;
+    num_repeats = 0U;
+    taken_slots.clear();
+  }
+};
+} // namespace VPF
+
+FrameRateConverter *FrameRateConverter::Make(const FrameRateParams &params) {
+  return new FrameRateConverter(params);
+}
+
+FrameRateConverter::FrameRateConverter(const FrameRateParams &params)
+    : Task("FrameRateConverter", FrameRateConverter::numInputs,
+           FrameRateConverter::numOutputs) {
+  pImpl = new FrameRateConverter_Impl(params);
+}
+
+FrameRateConverter::~FrameRateConverter() { delete pImpl; }
+
+TaskExecStatus FrameRateConverter::Execute() {
+  ClearOutputs();
+
+  auto pInput = GetInput(0U);
+  if (!pInput) {
+    return TaskExecStatus::TASK_EXEC_FAIL;
+  }
+
+  auto pInPktData = (Buffer *)GetInput(1U);
+  const PacketData *pPktData = nullptr;
+  if (pInPktData && pInPktData->GetRawMemSize() >= sizeof(PacketData)) {
+    pPktData = pInPktData->GetDataAs<PacketData>();
+  }
+
+  if (pImpl->Select(pPktData)) {
+    pImpl->UpdatePacketData(pPktData);
+    SetOutput(pInput, 0U);
+    SetOutput(pImpl->pkt_data, 1U);
+  }
+
+  return TaskExecStatus::TASK_EXEC_SUCCESS;
+}
+
+uint32_t FrameRateConverter::Select(const PacketData *pPktData) {
+  return pImpl->Select(pPktData);
+}
+
+uint32_t FrameRateConverter::GetNumRepeats() const {
+  return pImpl->num_repeats;
+}
+
+void FrameRateConverter::Reset() {
+  ClearInputs();
+  ClearOutputs();
+  pImpl->Reset();
+}
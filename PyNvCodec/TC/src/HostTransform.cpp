@@ -0,0 +1,706 @@
+/*
+ * Copyright 2020 NVIDIA Corporation
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "HostTransform.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <future>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+using namespace VPF;
+using namespace std;
+
+namespace {
+/* Inner loops are kept branchless and free of aliasing, so that compiler
+ * vectorizes them;
+ */
+void DownscaleRow2x(const uint8_t *__restrict src, int pitch, uint32_t width,
+                    uint8_t *__restrict dst) {
+  auto const *s0 = src;
+  auto const *s1 = src + pitch;
+  for (uint32_t x = 0U; x < width; x++) {
+    dst[x] = (uint8_t)((s0[2 * x] + s0[2 * x + 1] + s1[2 * x] +
+                        s1[2 * x + 1] + 2) >>
+                       2);
+  }
+}
+
+void DownscaleRow4xBox(const uint8_t *__restrict src, int pitch,
+                       uint32_t width, uint8_t *__restrict dst) {
+  auto const *s0 = src;
+  auto const *s1 = src + pitch;
+  auto const *s2 = src + pitch * 2;
+  auto const *s3 = src + pitch * 3;
+  for (uint32_t x = 0U; x < width; x++) {
+    auto const i = 4 * x;
+    uint32_t sum = 8U;
+    sum += s0[i] + s0[i + 1] + s0[i + 2] + s0[i + 3];
+    sum += s1[i] + s1[i + 1] + s1[i + 2] + s1[i + 3];
+    sum += s2[i] + s2[i + 1] + s2[i + 2] + s2[i + 3];
+    sum += s3[i] + s3[i + 1] + s3[i + 2] + s3[i + 3];
+    dst[x] = (uint8_t)(sum >> 4);
+  }
+}
+
+void DownscaleRow4xBilinear(const uint8_t *__restrict src, int pitch,
+                            uint32_t width, uint8_t *__restrict dst) {
+  // Block center is between 2nd and 3rd pixels;
+  auto const *s1 = src + pitch + 1;
+  auto const *s2 = src + pitch * 2 + 1;
+  for (uint32_t x = 0U; x < width; x++) {
+    auto const i = 4 * x;
+    dst[x] = (uint8_t)((s1[i] + s1[i + 1] + s2[i] + s2[i + 1] + 2) >> 2);
+  }
+}
+
+// Produces single row of downscaled plane from factor rows of source;
+void DownscaleRow(const uint8_t *src, int pitch, uint32_t width,
+                  uint32_t factor, DownscaleFilter filter, uint8_t *dst) {
+  switch (factor) {
+  case 1U:
+    memcpy(dst, src, width);
+    break;
+  case 2U:
+    // Both filters are the same for 2x;
+    DownscaleRow2x(src, pitch, width, dst);
+    break;
+  case 4U:
+    if (DOWNSCALE_BILINEAR == filter) {
+      DownscaleRow4xBilinear(src, pitch, width, dst);
+    } else {
+      DownscaleRow4xBox(src, pitch, width, dst);
+    }
+    break;
+  default:
+    throw invalid_argument("Unsupported downscale factor");
+  }
+}
+
+inline uint8_t Clamp(int value) {
+  return (uint8_t)(value < 0 ? 0 : (value > 255 ? 255 : value));
+}
+
+/* Same coefficients as nppiYUV420ToRGB, scaled by 256:
+ * R = Y + 1.140V, G = Y - 0.394U - 0.581V, B = Y + 2.032U;
+ */
+void YuvToRgbRow(const uint8_t *__restrict y_row,
+                 const uint8_t *__restrict u_row,
+                 const uint8_t *__restrict v_row, uint32_t width,
+                 uint32_t chroma_width, bool bgr, uint8_t *__restrict dst) {
+  auto const r_idx = bgr ? 2 : 0;
+  auto const b_idx = bgr ? 0 : 2;
+
+  for (uint32_t x = 0U; x < width; x++) {
+    // Odd width has no chroma sample for the last pixel, reuse previous;
+    auto const cx = min(x / 2U, chroma_width - 1U);
+    auto const u = (int)u_row[cx] - 128;
+    auto const v = (int)v_row[cx] - 128;
+    auto const y = (int)y_row[x] * 256 + 128;
+
+    auto *pixel = dst + 3 * x;
+    pixel[r_idx] = Clamp((y + 292 * v) >> 8);
+    pixel[1] = Clamp((y - 101 * u - 149 * v) >> 8);
+    pixel[b_idx] = Clamp((y + 520 * u) >> 8);
+  }
+}
+
+/* Downscaled source grid walked in destination order; Element is a pixel
+ * of the plane: 1 byte for planar formats, 2 for NV12 chroma, 3 for RGB;
+ */
+struct RotatedPlane {
+  const uint8_t *src;
+  int pitch;
+  uint32_t elem;
+  // Downscaled source size;
+  uint32_t width;
+  uint32_t height;
+
+  uint8_t *dst;
+  uint32_t dst_width;
+  uint32_t dst_height;
+  size_t dst_pitch;
+
+  // Source address of destination pixel is origin + x * step_x + y * step_y;
+  const uint8_t *origin;
+  ptrdiff_t step_x;
+  ptrdiff_t step_y;
+};
+
+RotatedPlane MakeRotatedPlane(const uint8_t *src, int pitch, uint32_t elem,
+                              uint32_t width, uint32_t height, uint8_t *dst,
+                              const RotateParams &params) {
+  RotatedPlane plane;
+  plane.src = src;
+  plane.pitch = pitch;
+  plane.elem = elem;
+  plane.width = width;
+  plane.height = height;
+  plane.dst = dst;
+
+  auto const transpose =
+      (ROTATE_90 == params.rotation || ROTATE_270 == params.rotation);
+  plane.dst_width = transpose ? height : width;
+  plane.dst_height = transpose ? width : height;
+  plane.dst_pitch = (size_t)plane.dst_width * elem;
+
+  // Source grid position (u, v) = (u0 + ux * x + uy * y, v0 + vx * x + vy * y);
+  ptrdiff_t u0 = 0, ux = 1, uy = 0, v0 = 0, vx = 0, vy = 1;
+  switch (params.rotation) {
+  case ROTATE_90:
+    ux = 0, uy = 1, v0 = height - 1, vx = -1, vy = 0;
+    break;
+  case ROTATE_180:
+    u0 = width - 1, ux = -1, v0 = height - 1, vy = -1;
+    break;
+  case ROTATE_270:
+    u0 = width - 1, ux = 0, uy = -1, vx = 1, vy = 0;
+    break;
+  default:
+    break;
+  }
+
+  if (params.hflip) {
+    u0 += ux * (plane.dst_width - 1);
+    v0 += vx * (plane.dst_width - 1);
+    ux = -ux;
+    vx = -vx;
+  }
+
+  ptrdiff_t const f = params.downscale;
+  plane.origin = src + (u0 * elem + v0 * pitch) * f;
+  plane.step_x = (ux * elem + vx * pitch) * f;
+  plane.step_y = (uy * elem + vy * pitch) * f;
+  return plane;
+}
+
+/* Element is averaged over F x F block, bilinear 4x takes central 2x2 of
+ * the block; Template parameters let compiler unroll channel and block
+ * loops completely;
+ */
+template <uint32_t E, uint32_t F, bool BILINEAR>
+inline void SampleBlock(const uint8_t *src, ptrdiff_t pitch, uint8_t *dst) {
+  for (uint32_t c = 0U; c < E; c++) {
+    if (1U == F) {
+      dst[c] = src[c];
+    } else if (BILINEAR && 4U == F) {
+      auto const *s = src + pitch + E + c;
+      dst[c] = (uint8_t)((s[0] + s[E] + s[pitch] + s[pitch + E] + 2) >> 2);
+    } else {
+      uint32_t sum = F * F / 2U;
+      for (uint32_t i = 0U; i < F; i++) {
+        for (uint32_t j = 0U; j < F; j++) {
+          sum += src[i * pitch + j * E + c];
+        }
+      }
+      dst[c] = (uint8_t)(sum / (F * F));
+    }
+  }
+}
+
+const uint32_t tile_size = 16U;
+
+template <uint32_t E, uint32_t F, bool BILINEAR>
+void RotateRows(const RotatedPlane &plane, uint32_t row_begin,
+                uint32_t row_end) {
+  auto const pitch = (ptrdiff_t)plane.pitch;
+  for (auto ty = row_begin; ty < row_end; ty += tile_size) {
+    auto const y_end = min(ty + tile_size, row_end);
+    for (auto tx = 0U; tx < plane.dst_width; tx += tile_size) {
+      auto const x_end = min(tx + tile_size, plane.dst_width);
+      for (auto y = ty; y < y_end; y++) {
+        auto const *src = plane.origin + y * plane.step_y;
+        auto *dst = plane.dst + y * plane.dst_pitch;
+        for (auto x = tx; x < x_end; x++) {
+          SampleBlock<E, F, BILINEAR>(src + x * plane.step_x, pitch,
+                                      dst + x * E);
+        }
+      }
+    }
+  }
+}
+
+template <uint32_t E>
+void RotateRows(const RotatedPlane &plane, uint32_t factor,
+                DownscaleFilter filter, uint32_t row_begin,
+                uint32_t row_end) {
+  auto const bilinear = (DOWNSCALE_BILINEAR == filter);
+  switch (factor) {
+  case 1U:
+    // Plain copy when nothing is rotated;
+    if ((ptrdiff_t)E == plane.step_x) {
+      for (auto y = row_begin; y < row_end; y++) {
+        memcpy(plane.dst + y * plane.dst_pitch, plane.origin + y * plane.step_y,
+               plane.dst_pitch);
+      }
+    } else {
+      RotateRows<E, 1U, false>(plane, row_begin, row_end);
+    }
+    break;
+  case 2U:
+    RotateRows<E, 2U, false>(plane, row_begin, row_end);
+    break;
+  case 4U:
+    if (bilinear) {
+      RotateRows<E, 4U, true>(plane, row_begin, row_end);
+    } else {
+      RotateRows<E, 4U, false>(plane, row_begin, row_end);
+    }
+    break;
+  default:
+    throw invalid_argument("Unsupported downscale factor");
+  }
+}
+
+void RotatePlaneRows(const RotatedPlane &plane, const RotateParams &params,
+                     uint32_t row_begin, uint32_t row_end) {
+  auto const f = params.downscale;
+  auto const filter = params.filter;
+  switch (plane.elem) {
+  case 1U:
+    RotateRows<1U>(plane, f, filter, row_begin, row_end);
+    break;
+  case 2U:
+    RotateRows<2U>(plane, f, filter, row_begin, row_end);
+    break;
+  case 3U:
+    RotateRows<3U>(plane, f, filter, row_begin, row_end);
+    break;
+  default:
+    throw invalid_argument("Unsupported pixel size");
+  }
+}
+
+void RotatePlanes(const vector<RotatedPlane> &planes,
+                  const RotateParams &params, ThreadPool *pool) {
+  auto const num_threads = pool ? pool->GetNumThreads() : 0U;
+  if (num_threads < 2U) {
+    for (auto &plane : planes) {
+      RotatePlaneRows(plane, params, 0U, plane.dst_height);
+    }
+    return;
+  }
+
+  // Every thread gets whole tile rows of each plane;
+  vector<future<void>> jobs;
+  for (auto &plane : planes) {
+    auto const num_tiles = (plane.dst_height + tile_size - 1U) / tile_size;
+    auto const tiles_per_job =
+        max<size_t>(1U, (num_tiles + num_threads - 1U) / num_threads);
+    for (size_t tile = 0U; tile < num_tiles; tile += tiles_per_job) {
+      auto const row_begin = (uint32_t)(tile * tile_size);
+      auto const row_end = (uint32_t)min<size_t>(
+          (tile + tiles_per_job) * tile_size, plane.dst_height);
+      auto const *p_plane = &plane;
+      jobs.push_back(pool->Submit([p_plane, &params, row_begin, row_end]() {
+        RotatePlaneRows(*p_plane, params, row_begin, row_end);
+      }));
+    }
+  }
+
+  for (auto &job : jobs) {
+    job.get();
+  }
+}
+
+struct PlaneLayout {
+  // Element size in bytes;
+  uint32_t elem;
+  // Chroma subsampling;
+  uint32_t div;
+};
+
+// Layout of host frame planes, as they are packed after download;
+vector<PlaneLayout> GetPlaneLayout(Pixel_Format format) {
+  switch (format) {
+  case Y:
+    return {{1U, 1U}};
+  case NV12:
+    return {{1U, 1U}, {2U, 2U}};
+  case YUV420:
+  case YCBCR:
+    return {{1U, 1U}, {1U, 2U}, {1U, 2U}};
+  case YUV444:
+  case RGB_PLANAR:
+    return {{1U, 1U}, {1U, 1U}, {1U, 1U}};
+  case RGB:
+  case BGR:
+    return {{3U, 1U}};
+  default:
+    throw invalid_argument("Pixel format has no host frame layout");
+  }
+}
+
+/* Resizes plane of interleaved channels; Area average when both sides
+ * shrink, bilinear otherwise; Weights are scaled by 2^8;
+ */
+void ResizePlane(const uint8_t *src, uint32_t src_width, uint32_t src_height,
+                 uint32_t channels, uint8_t *dst, uint32_t dst_width,
+                 uint32_t dst_height) {
+  auto const src_pitch = (size_t)src_width * channels;
+  auto const dst_pitch = (size_t)dst_width * channels;
+
+  if (src_width == dst_width && src_height == dst_height) {
+    memcpy(dst, src, src_pitch * src_height);
+    return;
+  }
+
+  if (dst_width <= src_width && dst_height <= src_height) {
+    vector<uint32_t> x_begin(dst_width), x_end(dst_width);
+    for (uint32_t x = 0U; x < dst_width; x++) {
+      x_begin[x] = (uint32_t)((uint64_t)x * src_width / dst_width);
+      x_end[x] = max(x_begin[x] + 1U,
+                     (uint32_t)((uint64_t)(x + 1U) * src_width / dst_width));
+    }
+
+    vector<uint32_t> sums(channels);
+    for (uint32_t y = 0U; y < dst_height; y++) {
+      auto const y0 = (uint32_t)((uint64_t)y * src_height / dst_height);
+      auto const y1 = max(
+          y0 + 1U, (uint32_t)((uint64_t)(y + 1U) * src_height / dst_height));
+      auto *out = dst + y * dst_pitch;
+
+      for (uint32_t x = 0U; x < dst_width; x++) {
+        fill(sums.begin(), sums.end(), 0U);
+        for (auto sy = y0; sy < y1; sy++) {
+          auto const *p = src + sy * src_pitch + x_begin[x] * channels;
+          for (auto sx = x_begin[x]; sx < x_end[x]; sx++) {
+            for (uint32_t c = 0U; c < channels; c++) {
+              sums[c] += *p++;
+            }
+          }
+        }
+
+        auto const area = (y1 - y0) * (x_end[x] - x_begin[x]);
+        for (uint32_t c = 0U; c < channels; c++) {
+          *out++ = (uint8_t)((sums[c] + area / 2U) / area);
+        }
+      }
+    }
+    return;
+  }
+
+  // Pixel centers are aligned;
+  auto Map = [](uint32_t dst_pos, uint32_t src_size, uint32_t dst_size,
+                uint32_t &pos0, uint32_t &pos1, uint32_t &weight) {
+    auto const pos =
+        max(((double)dst_pos + 0.5) * src_size / dst_size - 0.5, 0.0);
+    pos0 = min((uint32_t)pos, src_size - 1U);
+    pos1 = min(pos0 + 1U, src_size - 1U);
+    weight = (uint32_t)((pos - pos0) * 256.0 + 0.5);
+  };
+
+  vector<uint32_t> x0(dst_width), x1(dst_width), wx(dst_width);
+  for (uint32_t x = 0U; x < dst_width; x++) {
+    Map(x, src_width, dst_width, x0[x], x1[x], wx[x]);
+    x0[x] *= channels;
+    x1[x] *= channels;
+  }
+
+  for (uint32_t y = 0U; y < dst_height; y++) {
+    uint32_t y0, y1, wy;
+    Map(y, src_height, dst_height, y0, y1, wy);
+    auto const *r0 = src + y0 * src_pitch;
+    auto const *r1 = src + y1 * src_pitch;
+    auto *out = dst + y * dst_pitch;
+
+    for (uint32_t x = 0U; x < dst_width; x++) {
+      for (uint32_t c = 0U; c < channels; c++) {
+        auto const top = r0[x0[x] + c] * (256U - wx[x]) + r0[x1[x] + c] * wx[x];
+        auto const bottom =
+            r1[x0[x] + c] * (256U - wx[x]) + r1[x1[x] + c] * wx[x];
+        *out++ = (uint8_t)((top * (256U - wy) + bottom * wy + 32768U) >> 16U);
+      }
+    }
+  }
+}
+} // namespace
+
+FrameRotation VPF::RotationFromDegrees(int degrees) {
+  auto const quarters = ((int)lround(degrees / 90.0) % 4 + 4) % 4;
+  return (FrameRotation)(quarters * 90);
+}
+
+void VPF::GetFrameCopySize(const FrameCopyParams &params, uint32_t src_width,
+                           uint32_t src_height, uint32_t &dst_width,
+                           uint32_t &dst_height, size_t &dst_size) {
+  auto const factor = params.downscale;
+  if (1U != factor && 2U != factor && 4U != factor) {
+    throw invalid_argument("Downscale factor must be 1, 2 or 4");
+  }
+
+  auto const crop_width =
+      params.crop_width ? params.crop_width : src_width - params.crop_x;
+  auto const crop_height =
+      params.crop_height ? params.crop_height : src_height - params.crop_y;
+
+  if ((params.crop_x % 2U) || (params.crop_y % 2U) ||
+      params.crop_x >= src_width || params.crop_y >= src_height ||
+      crop_width > src_width - params.crop_x ||
+      crop_height > src_height - params.crop_y) {
+    stringstream ss;
+    ss << "Crop " << crop_width << "x" << crop_height << "+" << params.crop_x
+       << "+" << params.crop_y << " doesn't fit " << src_width << "x"
+       << src_height << " frame or has odd origin";
+    throw invalid_argument(ss.str());
+  }
+
+  dst_width = crop_width / factor;
+  dst_height = crop_height / factor;
+
+  auto const num_pixels = (size_t)dst_width * dst_height;
+  switch (params.format) {
+  case YUV420:
+    dst_size = num_pixels + 2U * (dst_width / 2U) * (dst_height / 2U);
+    break;
+  case Y:
+    dst_size = num_pixels;
+    break;
+  case RGB:
+  case BGR:
+    dst_size = num_pixels * 3U;
+    break;
+  default:
+    throw invalid_argument("Frame may only be copied out as YUV420, Y, RGB "
+                           "or BGR");
+  }
+
+  // Chroma needs at least one sample;
+  auto const min_size = (Y == params.format) ? 1U : 2U;
+  if (dst_width < min_size || dst_height < min_size) {
+    throw invalid_argument("Frame is too small after crop and downscale");
+  }
+
+  if (ROTATE_90 == params.rotation || ROTATE_270 == params.rotation) {
+    swap(dst_width, dst_height);
+  }
+}
+
+namespace {
+/* Downscale and rotation are fused into one pass; RGB is converted from
+ * rotated YUV420 afterwards, which is smaller than decoded frame if it's
+ * downscaled;
+ */
+void CopyFrameRotated(const uint8_t *const planes[3], const int pitch[3],
+                      const FrameCopyParams &params, uint32_t width,
+                      uint32_t height, uint8_t *dst) {
+  RotateParams rotate;
+  rotate.rotation = params.rotation;
+  rotate.hflip = params.hflip;
+  rotate.downscale = params.downscale;
+  rotate.filter = params.filter;
+
+  // Output size is rotated, grid size isn't;
+  auto const transpose =
+      (ROTATE_90 == params.rotation || ROTATE_270 == params.rotation);
+  auto const grid_width = transpose ? height : width;
+  auto const grid_height = transpose ? width : height;
+
+  auto const is_rgb = (RGB == params.format || BGR == params.format);
+  vector<uint8_t> yuv;
+  if (is_rgb) {
+    yuv.resize((size_t)width * height +
+               2U * (width / 2U) * (height / 2U));
+  }
+  auto *out = is_rgb ? yuv.data() : dst;
+
+  vector<RotatedPlane> rotated;
+  rotated.push_back(MakeRotatedPlane(planes[0], pitch[0], 1U, grid_width,
+                                     grid_height, out, rotate));
+  if (Y != params.format) {
+    out += (size_t)width * height;
+    for (int i = 1; i < 3; i++) {
+      rotated.push_back(MakeRotatedPlane(planes[i], pitch[i], 1U,
+                                         grid_width / 2U, grid_height / 2U,
+                                         out, rotate));
+      out += (size_t)(width / 2U) * (height / 2U);
+    }
+  }
+  RotatePlanes(rotated, rotate, nullptr);
+
+  if (is_rgb) {
+    HostPlanes src;
+    src.data[0] = yuv.data();
+    src.data[1] = src.data[0] + (size_t)width * height;
+    src.data[2] = src.data[1] + (size_t)(width / 2U) * (height / 2U);
+    src.pitch[0] = width;
+    src.pitch[1] = src.pitch[2] = width / 2U;
+    src.width = width;
+    src.height = height;
+
+    FrameCopyParams convert;
+    convert.format = params.format;
+    CopyFrameYUV420(src, convert, dst);
+  }
+}
+} // namespace
+
+void VPF::CopyFrameYUV420(const HostPlanes &src, const FrameCopyParams &params,
+                          uint8_t *dst) {
+  uint32_t width = 0U, height = 0U;
+  size_t size = 0U;
+  GetFrameCopySize(params, src.width, src.height, width, height, size);
+
+  auto const factor = params.downscale;
+  auto const filter = params.filter;
+  auto const chroma_width = width / 2U;
+  auto const chroma_height = height / 2U;
+
+  const uint8_t *planes[3];
+  planes[0] = src.data[0] + params.crop_y * src.pitch[0] + params.crop_x;
+  for (int i = 1; i < 3; i++) {
+    planes[i] = src.data[i] + (params.crop_y / 2U) * src.pitch[i] +
+                params.crop_x / 2U;
+  }
+
+  if (ROTATE_0 != params.rotation || params.hflip) {
+    CopyFrameRotated(planes, src.pitch, params, width, height, dst);
+    return;
+  }
+
+  auto const SrcRow = [&](int plane, uint32_t row) {
+    return planes[plane] + (size_t)row * factor * src.pitch[plane];
+  };
+
+  if (YUV420 == params.format || Y == params.format) {
+    auto *dst_plane = dst;
+    for (uint32_t y = 0U; y < height; y++, dst_plane += width) {
+      DownscaleRow(SrcRow(0, y), src.pitch[0], width, factor, filter,
+                   dst_plane);
+    }
+
+    if (Y == params.format) {
+      return;
+    }
+
+    for (int i = 1; i < 3; i++) {
+      for (uint32_t y = 0U; y < chroma_height; y++) {
+        DownscaleRow(SrcRow(i, y), src.pitch[i], chroma_width, factor,
+                     filter, dst_plane);
+        dst_plane += chroma_width;
+      }
+    }
+    return;
+  }
+
+  // RGB and BGR go through scratch rows;
+  vector<uint8_t> y_row(width), u_row(chroma_width), v_row(chroma_width);
+  auto const bgr = (BGR == params.format);
+  uint32_t last_chroma_row = chroma_height;
+
+  for (uint32_t y = 0U; y < height; y++) {
+    DownscaleRow(SrcRow(0, y), src.pitch[0], width, factor, filter,
+                 y_row.data());
+
+    auto const chroma_row = min(y / 2U, chroma_height - 1U);
+    if (chroma_row != last_chroma_row) {
+      DownscaleRow(SrcRow(1, chroma_row), src.pitch[1], chroma_width, factor,
+                   filter, u_row.data());
+      DownscaleRow(SrcRow(2, chroma_row), src.pitch[2], chroma_width, factor,
+                   filter, v_row.data());
+      last_chroma_row = chroma_row;
+    }
+
+    YuvToRgbRow(y_row.data(), u_row.data(), v_row.data(), width,
+                chroma_width, bgr, dst + (size_t)y * width * 3U);
+  }
+}
+
+size_t VPF::GetHostFrameSize(Pixel_Format format, uint32_t width,
+                             uint32_t height) {
+  size_t size = 0U;
+  for (auto &plane : GetPlaneLayout(format)) {
+    size += (size_t)(width / plane.div) * (height / plane.div) * plane.elem;
+  }
+  return size;
+}
+
+void VPF::GetRotatedFrameSize(Pixel_Format format, uint32_t src_width,
+                              uint32_t src_height, const RotateParams &params,
+                              uint32_t &dst_width, uint32_t &dst_height,
+                              size_t &dst_size) {
+  auto const factor = params.downscale;
+  if (1U != factor && 2U != factor && 4U != factor) {
+    throw invalid_argument("Downscale factor must be 1, 2 or 4");
+  }
+
+  auto const layout = GetPlaneLayout(format);
+  auto const width = src_width / factor;
+  auto const height = src_height / factor;
+
+  dst_size = 0U;
+  for (auto &plane : layout) {
+    auto const plane_size =
+        (size_t)(width / plane.div) * (height / plane.div) * plane.elem;
+    if (!plane_size) {
+      throw invalid_argument("Frame is too small after downscale");
+    }
+    dst_size += plane_size;
+  }
+
+  auto const transpose =
+      (ROTATE_90 == params.rotation || ROTATE_270 == params.rotation);
+  dst_width = transpose ? height : width;
+  dst_height = transpose ? width : height;
+}
+
+void VPF::RotateHostFrame(const uint8_t *src, uint32_t src_width,
+                          uint32_t src_height, Pixel_Format format,
+                          const RotateParams &params, uint8_t *dst,
+                          ThreadPool *pool) {
+  uint32_t width = 0U, height = 0U;
+  size_t size = 0U;
+  GetRotatedFrameSize(format, src_width, src_height, params, width, height,
+                      size);
+
+  auto const grid_width = src_width / params.downscale;
+  auto const grid_height = src_height / params.downscale;
+
+  vector<RotatedPlane> planes;
+  for (auto &layout : GetPlaneLayout(format)) {
+    auto const pitch = (src_width / layout.div) * layout.elem;
+    auto const plane = MakeRotatedPlane(
+        src, pitch, layout.elem, grid_width / layout.div,
+        grid_height / layout.div, dst, params);
+    planes.push_back(plane);
+
+    src += (size_t)pitch * (src_height / layout.div);
+    dst += plane.dst_pitch * plane.dst_height;
+  }
+
+  RotatePlanes(planes, params, pool);
+}
+
+void VPF::ResizeHostFrame(const uint8_t *src, uint32_t src_width,
+                          uint32_t src_height, Pixel_Format format,
+                          uint8_t *dst, uint32_t dst_width,
+                          uint32_t dst_height) {
+  for (auto &layout : GetPlaneLayout(format)) {
+    auto const src_plane_width = src_width / layout.div;
+    auto const src_plane_height = src_height / layout.div;
+    auto const dst_plane_width = dst_width / layout.div;
+    auto const dst_plane_height = dst_height / layout.div;
+    if (!src_plane_width || !src_plane_height || !dst_plane_width ||
+        !dst_plane_height) {
+      throw invalid_argument("Frame is too small to be resized");
+    }
+
+    ResizePlane(src, src_plane_width, src_plane_height, layout.elem, dst,
+                dst_plane_width, dst_plane_height);
+
+    src += (size_t)src_plane_width * src_plane_height * layout.elem;
+    dst += (size_t)dst_plane_width * dst_plane_height * layout.elem;
+  }
+}
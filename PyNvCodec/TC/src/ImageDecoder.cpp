@@ -0,0 +1,596 @@
+/*
+ * Copyright 2020 NVIDIA Corporation
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ImageDecoder.hpp"
+#include "BatchPool.hpp"
+#include "HostTransform.hpp"
+#include "Logger.hpp"
+#include "MemoryBudget.hpp"
+#include "ThreadPool.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <future>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavutil/error.h>
+#include <libavutil/frame.h>
+}
+
+using namespace VPF;
+using namespace std;
+
+namespace {
+string AvErrorToString(int av_error_code) {
+  char err_string[AV_ERROR_MAX_STRING_SIZE] = {0};
+  if (0 != av_strerror(av_error_code, err_string, sizeof(err_string))) {
+    stringstream ss;
+    ss << "Unknown error with code " << av_error_code;
+    return ss.str();
+  }
+  return string(err_string);
+}
+
+AVCodecID DetectCodec(const uint8_t *data, size_t size) {
+  static const uint8_t jpeg[] = {0xFF, 0xD8, 0xFF};
+  static const uint8_t png[] = {0x89, 'P', 'N', 'G', 0x0D, 0x0A, 0x1A, 0x0A};
+
+  if (size >= sizeof(jpeg) && !memcmp(data, jpeg, sizeof(jpeg))) {
+    return AV_CODEC_ID_MJPEG;
+  }
+  if (size >= sizeof(png) && !memcmp(data, png, sizeof(png))) {
+    return AV_CODEC_ID_PNG;
+  }
+  if (size >= 12U && !memcmp(data, "RIFF", 4U) &&
+      !memcmp(data + 8U, "WEBP", 4U)) {
+    return AV_CODEC_ID_WEBP;
+  }
+  return AV_CODEC_ID_NONE;
+}
+
+// Decoders read a bit past the end, so data is followed by zero padding;
+void ReadFile(const string &path, vector<uint8_t> &data) {
+  unique_ptr<FILE, int (*)(FILE *)> file(fopen(path.c_str(), "rb"), fclose);
+  if (!file) {
+    throw runtime_error("Can't open " + path);
+  }
+
+  fseek(file.get(), 0, SEEK_END);
+  auto const size = ftell(file.get());
+  fseek(file.get(), 0, SEEK_SET);
+  if (size <= 0) {
+    throw runtime_error("Can't read " + path);
+  }
+
+  data.resize(size + AV_INPUT_BUFFER_PADDING_SIZE);
+  if ((size_t)size != fread(data.data(), 1U, size, file.get())) {
+    throw runtime_error("Can't read " + path);
+  }
+  memset(data.data() + size, 0, AV_INPUT_BUFFER_PADDING_SIZE);
+  data.resize(size);
+}
+
+/* Where every channel of output pixel goes; Covers packed and planar
+ * layouts the same way;
+ */
+struct OutputLayout {
+  uint8_t *data[3];
+  uint32_t channels;
+  uint32_t step;
+  size_t pitch;
+
+  OutputLayout(uint8_t *dst, Pixel_Format format, uint32_t width,
+               uint32_t height) {
+    pitch = width;
+    step = 1U;
+    channels = 3U;
+    switch (format) {
+    case Y:
+      data[0] = data[1] = data[2] = dst;
+      channels = 1U;
+      break;
+    case RGB_PLANAR:
+      data[0] = dst;
+      data[1] = dst + (size_t)width * height;
+      data[2] = dst + (size_t)width * height * 2U;
+      break;
+    default:
+      auto const bgr = (BGR == format);
+      data[0] = dst + (bgr ? 2U : 0U);
+      data[1] = dst + 1U;
+      data[2] = dst + (bgr ? 0U : 2U);
+      pitch = width * 3U;
+      step = 3U;
+      break;
+    }
+  }
+};
+
+struct ChromaShift {
+  uint32_t x;
+  uint32_t y;
+};
+
+bool GetChromaShift(int format, ChromaShift &shift) {
+  switch (format) {
+  case AV_PIX_FMT_YUV420P:
+  case AV_PIX_FMT_YUVJ420P:
+  case AV_PIX_FMT_YUVA420P:
+    shift = {1U, 1U};
+    return true;
+  case AV_PIX_FMT_YUV422P:
+  case AV_PIX_FMT_YUVJ422P:
+    shift = {1U, 0U};
+    return true;
+  case AV_PIX_FMT_YUV444P:
+  case AV_PIX_FMT_YUVJ444P:
+    shift = {0U, 0U};
+    return true;
+  case AV_PIX_FMT_YUV440P:
+  case AV_PIX_FMT_YUVJ440P:
+    shift = {0U, 1U};
+    return true;
+  case AV_PIX_FMT_YUV411P:
+  case AV_PIX_FMT_YUVJ411P:
+    shift = {2U, 0U};
+    return true;
+  default:
+    return false;
+  }
+}
+
+bool IsFullRange(const AVFrame *frame) {
+  switch (frame->format) {
+  case AV_PIX_FMT_YUVJ420P:
+  case AV_PIX_FMT_YUVJ422P:
+  case AV_PIX_FMT_YUVJ444P:
+  case AV_PIX_FMT_YUVJ440P:
+  case AV_PIX_FMT_YUVJ411P:
+    return true;
+  default:
+    return AVCOL_RANGE_JPEG == frame->color_range;
+  }
+}
+
+uint8_t Clamp(int value) { return (uint8_t)min(max(value, 0), 255); }
+
+// BT.601, coefficients are scaled by 2^8;
+void YuvToRgb(int y, int u, int v, bool full_range, uint8_t *rgb) {
+  auto const d = u - 128;
+  auto const e = v - 128;
+  if (full_range) {
+    auto const c = y << 8;
+    rgb[0] = Clamp((c + 359 * e + 128) >> 8);
+    rgb[1] = Clamp((c - 88 * d - 183 * e + 128) >> 8);
+    rgb[2] = Clamp((c + 454 * d + 128) >> 8);
+  } else {
+    auto const c = 298 * (y - 16);
+    rgb[0] = Clamp((c + 409 * e + 128) >> 8);
+    rgb[1] = Clamp((c - 100 * d - 208 * e + 128) >> 8);
+    rgb[2] = Clamp((c + 516 * d + 128) >> 8);
+  }
+}
+
+uint8_t RgbToLuma(const uint8_t *rgb) {
+  return (uint8_t)((77 * rgb[0] + 150 * rgb[1] + 29 * rgb[2] + 128) >> 8);
+}
+
+/* Brings decoded frame to packed 8 bit gray or RGB; Gray is produced when
+ * output is Y, luma of YUV source is taken as is;
+ */
+void UnpackFrame(const AVFrame *frame, bool gray_out, vector<uint8_t> &dst,
+                 uint32_t &channels) {
+  auto const width = (uint32_t)frame->width;
+  auto const height = (uint32_t)frame->height;
+  auto const fmt = frame->format;
+
+  ChromaShift shift;
+  auto const is_yuv = GetChromaShift(fmt, shift);
+
+  channels = gray_out ? 1U : 3U;
+  dst.resize((size_t)width * height * channels);
+
+  for (auto y = 0U; y < height; y++) {
+    auto const *row = frame->data[0] + (size_t)y * frame->linesize[0];
+    auto *out = dst.data() + (size_t)y * width * channels;
+
+    if (is_yuv) {
+      auto const full_range = IsFullRange(frame);
+      auto const *row_u =
+          frame->data[1] + (size_t)(y >> shift.y) * frame->linesize[1];
+      auto const *row_v =
+          frame->data[2] + (size_t)(y >> shift.y) * frame->linesize[2];
+      for (auto x = 0U; x < width; x++) {
+        if (1U == channels) {
+          out[x] = full_range ? row[x]
+                              : Clamp(((row[x] - 16) * 255 + 109) / 219);
+        } else {
+          YuvToRgb(row[x], row_u[x >> shift.x], row_v[x >> shift.x],
+                   full_range, out + 3U * x);
+        }
+      }
+      continue;
+    }
+
+    for (auto x = 0U; x < width; x++) {
+      uint8_t rgb[3];
+      switch (fmt) {
+      case AV_PIX_FMT_GRAY8:
+        rgb[0] = rgb[1] = rgb[2] = row[x];
+        break;
+      case AV_PIX_FMT_GRAY16BE:
+      case AV_PIX_FMT_YA8:
+        // High byte of big endian gray, or gray of gray + alpha;
+        rgb[0] = rgb[1] = rgb[2] = row[2U * x];
+        break;
+      case AV_PIX_FMT_YA16BE:
+        rgb[0] = rgb[1] = rgb[2] = row[4U * x];
+        break;
+      case AV_PIX_FMT_MONOBLACK:
+      case AV_PIX_FMT_MONOWHITE: {
+        // 8 pixels per byte, most significant bit first;
+        auto const bit = (row[x >> 3U] >> (7U - (x & 7U))) & 1U;
+        auto const white = (AV_PIX_FMT_MONOBLACK == fmt) ? bit : 1U - bit;
+        rgb[0] = rgb[1] = rgb[2] = white ? 255U : 0U;
+        break;
+      }
+      case AV_PIX_FMT_RGB24:
+        memcpy(rgb, row + 3U * x, 3U);
+        break;
+      case AV_PIX_FMT_RGBA:
+        memcpy(rgb, row + 4U * x, 3U);
+        break;
+      case AV_PIX_FMT_ARGB:
+        memcpy(rgb, row + 4U * x + 1U, 3U);
+        break;
+      case AV_PIX_FMT_RGB48BE:
+        rgb[0] = row[6U * x];
+        rgb[1] = row[6U * x + 2U];
+        rgb[2] = row[6U * x + 4U];
+        break;
+      case AV_PIX_FMT_RGBA64BE:
+        rgb[0] = row[8U * x];
+        rgb[1] = row[8U * x + 2U];
+        rgb[2] = row[8U * x + 4U];
+        break;
+      case AV_PIX_FMT_PAL8: {
+        // Palette entries are native endian 0xAARRGGBB;
+        uint32_t entry;
+        memcpy(&entry, frame->data[1] + 4U * row[x], sizeof(entry));
+        rgb[0] = (uint8_t)(entry >> 16U);
+        rgb[1] = (uint8_t)(entry >> 8U);
+        rgb[2] = (uint8_t)entry;
+        break;
+      }
+      default:
+        throw runtime_error("Unsupported pixel format of decoded image");
+      }
+
+      if (1U == channels) {
+        out[x] = RgbToLuma(rgb);
+      } else {
+        memcpy(out + 3U * x, rgb, 3U);
+      }
+    }
+  }
+}
+
+/* Resamples packed gray or RGB into output layout; Gray source is
+ * replicated into all channels of RGB output;
+ */
+void Resample(const uint8_t *src, uint32_t src_width, uint32_t src_height,
+              uint32_t src_channels, const OutputLayout &dst,
+              uint32_t dst_width, uint32_t dst_height) {
+  auto const src_pitch = (size_t)src_width * src_channels;
+  auto Put = [&](uint32_t x, uint32_t y, uint32_t c, uint8_t value) {
+    dst.data[c][(size_t)y * dst.pitch + x * dst.step] = value;
+  };
+
+  if (dst_width <= src_width && dst_height <= src_height) {
+    // Area average, every output pixel covers whole source pixels;
+    vector<uint32_t> x_begin(dst_width), x_end(dst_width);
+    for (auto x = 0U; x < dst_width; x++) {
+      x_begin[x] = (uint32_t)((uint64_t)x * src_width / dst_width);
+      x_end[x] = max(x_begin[x] + 1U,
+                     (uint32_t)((uint64_t)(x + 1U) * src_width / dst_width));
+    }
+
+    for (auto y = 0U; y < dst_height; y++) {
+      auto const y0 = (uint32_t)((uint64_t)y * src_height / dst_height);
+      auto const y1 =
+          max(y0 + 1U, (uint32_t)((uint64_t)(y + 1U) * src_height /
+                                  dst_height));
+      for (auto x = 0U; x < dst_width; x++) {
+        uint32_t sum[3] = {0U, 0U, 0U};
+        for (auto sy = y0; sy < y1; sy++) {
+          auto const *p = src + sy * src_pitch + x_begin[x] * src_channels;
+          for (auto sx = x_begin[x]; sx < x_end[x]; sx++) {
+            for (auto c = 0U; c < src_channels; c++) {
+              sum[c] += *p++;
+            }
+          }
+        }
+
+        auto const area = (y1 - y0) * (x_end[x] - x_begin[x]);
+        for (auto c = 0U; c < dst.channels; c++) {
+          auto const sc = min(c, src_channels - 1U);
+          Put(x, y, c, (uint8_t)((sum[sc] + area / 2U) / area));
+        }
+      }
+    }
+    return;
+  }
+
+  // Bilinear with pixel centers aligned, weights are scaled by 2^8;
+  auto Map = [](uint32_t dst_pos, uint32_t src_size, uint32_t dst_size,
+                uint32_t &pos0, uint32_t &pos1, uint32_t &weight) {
+    auto const pos =
+        max(((double)dst_pos + 0.5) * src_size / dst_size - 0.5, 0.0);
+    pos0 = min((uint32_t)pos, src_size - 1U);
+    pos1 = min(pos0 + 1U, src_size - 1U);
+    weight = (uint32_t)((pos - pos0) * 256.0 + 0.5);
+  };
+
+  vector<uint32_t> x0(dst_width), x1(dst_width), wx(dst_width);
+  for (auto x = 0U; x < dst_width; x++) {
+    Map(x, src_width, dst_width, x0[x], x1[x], wx[x]);
+  }
+
+  for (auto y = 0U; y < dst_height; y++) {
+    uint32_t y0, y1, wy;
+    Map(y, src_height, dst_height, y0, y1, wy);
+    auto const *r0 = src + y0 * src_pitch;
+    auto const *r1 = src + y1 * src_pitch;
+
+    for (auto x = 0U; x < dst_width; x++) {
+      for (auto c = 0U; c < dst.channels; c++) {
+        auto const sc = min(c, src_channels - 1U);
+        auto const a = r0[x0[x] * src_channels + sc];
+        auto const b = r0[x1[x] * src_channels + sc];
+        auto const d = r1[x0[x] * src_channels + sc];
+        auto const e = r1[x1[x] * src_channels + sc];
+        auto const top = a * (256U - wx[x]) + b * wx[x];
+        auto const bottom = d * (256U - wx[x]) + e * wx[x];
+        auto const value = (top * (256U - wy) + bottom * wy + 32768U) >> 16U;
+        Put(x, y, c, (uint8_t)value);
+      }
+    }
+  }
+}
+
+/* Decoder contexts and scratch memory of single thread;
+ */
+class DecoderSet {
+public:
+  DecoderSet() {
+    frame = av_frame_alloc();
+    if (!frame) {
+      throw runtime_error("Can't allocate frame");
+    }
+  }
+
+  ~DecoderSet() {
+    for (auto &it : contexts) {
+      avcodec_free_context(&it.second);
+    }
+    av_frame_free(&frame);
+  }
+
+  // Frame is valid until the next call;
+  const AVFrame *Decode(const uint8_t *data, size_t size) {
+    auto const codec_id = DetectCodec(data, size);
+    if (AV_CODEC_ID_NONE == codec_id) {
+      throw runtime_error("Not a JPEG, PNG or WebP image");
+    }
+    auto avctx = GetContext(codec_id);
+
+    AVPacket pkt;
+    av_init_packet(&pkt);
+    pkt.data = (uint8_t *)data;
+    pkt.size = (int)size;
+
+    av_frame_unref(frame);
+    auto res = avcodec_send_packet(avctx, &pkt);
+    if (res >= 0) {
+      res = avcodec_receive_frame(avctx, frame);
+      if (AVERROR(EAGAIN) == res) {
+        // Decoder holds frame back, drain it;
+        avcodec_send_packet(avctx, nullptr);
+        res = avcodec_receive_frame(avctx, frame);
+        avcodec_flush_buffers(avctx);
+      }
+    }
+
+    if (res < 0) {
+      avcodec_flush_buffers(avctx);
+      throw runtime_error("Can't decode image: " + AvErrorToString(res));
+    }
+    return frame;
+  }
+
+  // Padded copy of blob and unpacked frame;
+  vector<uint8_t> input;
+  vector<uint8_t> unpacked;
+
+private:
+  AVCodecContext *GetContext(AVCodecID codec_id) {
+    auto it = contexts.find(codec_id);
+    if (contexts.end() != it) {
+      return it->second;
+    }
+
+    auto p_codec = avcodec_find_decoder(codec_id);
+    if (!p_codec) {
+      throw runtime_error("FFmpeg is built without decoder for this image "
+                          "format");
+    }
+
+    auto avctx = avcodec_alloc_context3(p_codec);
+    if (!avctx) {
+      throw runtime_error("Can't allocate decoder context");
+    }
+    // Images are decoded in parallel already;
+    avctx->thread_count = 1;
+
+    auto res = avcodec_open2(avctx, p_codec, nullptr);
+    if (res < 0) {
+      avcodec_free_context(&avctx);
+      throw runtime_error("Can't open image decoder: " +
+                          AvErrorToString(res));
+    }
+
+    contexts[codec_id] = avctx;
+    return avctx;
+  }
+
+  map<AVCodecID, AVCodecContext *> contexts;
+  AVFrame *frame = nullptr;
+};
+
+} // namespace
+
+namespace VPF {
+struct ImageDecoder_Impl {
+  ImageDecoderParams params;
+  size_t frame_size = 0U;
+
+  mutex mtx;
+  vector<unique_ptr<DecoderSet>> decoders;
+  vector<DecoderSet *> free_decoders;
+
+  // Shared with released batches, which may outlive decoder;
+  shared_ptr<BatchPool> batches;
+  unique_ptr<ThreadPool> pool;
+
+  explicit ImageDecoder_Impl(const ImageDecoderParams &new_params)
+      : params(new_params) {
+    if (Y != params.format && RGB != params.format && BGR != params.format &&
+        RGB_PLANAR != params.format) {
+      throw invalid_argument("Image decoder outputs RGB, BGR, RGB_PLANAR "
+                             "or Y");
+    }
+    if (!params.width || !params.height) {
+      throw invalid_argument("Output image size must be given");
+    }
+    frame_size = GetHostFrameSize(params.format, params.width, params.height);
+
+    params.num_threads = max(params.num_threads, 1U);
+    for (auto i = 0U; i < params.num_threads; i++) {
+      decoders.emplace_back(new DecoderSet());
+      free_decoders.push_back(decoders.back().get());
+    }
+    // Compact node is resolved once, so batches and workers share it;
+    params.placement.node = params.placement.GetNode();
+    batches = make_shared<BatchPool>(params.pipeline, params.placement.node);
+    pool.reset(new ThreadPool(params.num_threads, params.placement));
+  }
+
+  ~ImageDecoder_Impl() { pool.reset(); }
+
+  void Decode(const ImageSource &source, uint8_t *dst, ImageInfo &info) {
+    DecoderSet *decoder = nullptr;
+    {
+      // There are as many decoder sets as threads, so one is always free;
+      lock_guard<mutex> lock(mtx);
+      decoder = free_decoders.back();
+      free_decoders.pop_back();
+    }
+
+    try {
+      const uint8_t *data = source.data;
+      auto size = source.size;
+      if (!data) {
+        ReadFile(source.path, decoder->input);
+        data = decoder->input.data();
+        size = decoder->input.size();
+      } else {
+        decoder->input.resize(size + AV_INPUT_BUFFER_PADDING_SIZE);
+        memcpy(decoder->input.data(), data, size);
+        memset(decoder->input.data() + size, 0, AV_INPUT_BUFFER_PADDING_SIZE);
+        data = decoder->input.data();
+      }
+
+      auto frame = decoder->Decode(data, size);
+      info.width = frame->width;
+      info.height = frame->height;
+
+      uint32_t channels = 0U;
+      UnpackFrame(frame, Y == params.format, decoder->unpacked, channels);
+      Resample(decoder->unpacked.data(), frame->width, frame->height,
+               channels,
+               OutputLayout(dst, params.format, params.width, params.height),
+               params.width, params.height);
+      info.decoded = true;
+    } catch (exception &e) {
+      info.error = e.what();
+      memset(dst, 0, frame_size);
+      VPF_LOG(LOG_LEVEL_DEBUG, "ImageDecoder")
+          << (source.data ? string("blob") : source.path) << ": " << e.what();
+    }
+
+    lock_guard<mutex> lock(mtx);
+    free_decoders.push_back(decoder);
+  }
+};
+} // namespace VPF
+
+ImageDecoder *ImageDecoder::Make(const ImageDecoderParams &params) {
+  return new ImageDecoder(params);
+}
+
+ImageDecoder::ImageDecoder(const ImageDecoderParams &params) {
+  pImpl = new ImageDecoder_Impl(params);
+}
+
+ImageDecoder::~ImageDecoder() { delete pImpl; }
+
+shared_ptr<Buffer>
+ImageDecoder::DecodeBatch(const vector<ImageSource> &sources,
+                          vector<ImageInfo> &info) {
+  info.assign(sources.size(), ImageInfo());
+
+  auto batches = pImpl->batches;
+  shared_ptr<Buffer> batch(
+      batches->Acquire(max(sources.size(), (size_t)1U) * pImpl->frame_size,
+                       BudgetPolicy::BUDGET_BLOCK),
+      [batches](Buffer *buffer) { batches->Release(buffer); });
+
+  auto dst = batch->GetDataAs<uint8_t>();
+  vector<future<void>> results;
+  for (size_t i = 0U; i < sources.size(); i++) {
+    auto frame = dst + i * pImpl->frame_size;
+    auto impl = pImpl;
+    auto const &source = sources[i];
+    auto &image_info = info[i];
+    results.push_back(pImpl->pool->Submit(
+        [impl, &source, frame, &image_info]() {
+          impl->Decode(source, frame, image_info);
+        }));
+  }
+
+  for (auto &result : results) {
+    result.get();
+  }
+  return batch;
+}
+
+size_t ImageDecoder::GetFrameSize() const { return pImpl->frame_size; }
+
+void ImageDecoder::GetParams(ImageDecoderParams &params) const {
+  params = pImpl->params;
+}
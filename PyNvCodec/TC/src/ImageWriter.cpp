@@ -0,0 +1,731 @@
+/*
+ * Copyright 2020 NVIDIA Corporation
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ImageWriter.hpp"
+#include "EncodedOutput.hpp"
+#include "HostTransform.hpp"
+#include "Logger.hpp"
+#include "MemoryBudget.hpp"
+#include "Numa.hpp"
+#include "ThreadPool.hpp"
+#include <algorithm>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavutil/error.h>
+#include <libavutil/frame.h>
+}
+
+using namespace VPF;
+using namespace std;
+
+namespace {
+string AvErrorToString(int av_error_code) {
+  char err_string[AV_ERROR_MAX_STRING_SIZE] = {0};
+  if (0 != av_strerror(av_error_code, err_string, sizeof(err_string))) {
+    stringstream ss;
+    ss << "Unknown error with code " << av_error_code;
+    return ss.str();
+  }
+  return string(err_string);
+}
+
+/* Expands limited range samples to full range; Identity if full_range is
+ * set, so copy code is the same either way;
+ */
+struct RangeLut {
+  uint8_t luma[256];
+  uint8_t chroma[256];
+
+  explicit RangeLut(bool full_range) {
+    for (int i = 0; i < 256; i++) {
+      if (full_range) {
+        luma[i] = chroma[i] = (uint8_t)i;
+        continue;
+      }
+      auto const y = ((i - 16) * 255 + 109) / 219;
+      auto const c = ((i - 128) * 255 + (i < 128 ? -112 : 112)) / 224 + 128;
+      luma[i] = (uint8_t)min(max(y, 0), 255);
+      chroma[i] = (uint8_t)min(max(c, 0), 255);
+    }
+  }
+};
+
+/* Host frame planes, packed one after another the way GetHostFrameSize
+ * counts them;
+ */
+struct SrcPlanes {
+  const uint8_t *data[3];
+  int pitch[3];
+};
+
+SrcPlanes GetSrcPlanes(const uint8_t *src, Pixel_Format format,
+                       uint32_t width, uint32_t height) {
+  SrcPlanes planes = {{src, nullptr, nullptr}, {(int)width, 0, 0}};
+  auto const luma_size = (size_t)width * height;
+  auto const chroma_size = (size_t)(width / 2U) * (height / 2U);
+
+  switch (format) {
+  case NV12:
+    planes.data[1] = src + luma_size;
+    planes.pitch[1] = (width / 2U) * 2U;
+    break;
+  case YUV420:
+  case YCBCR:
+    planes.data[1] = src + luma_size;
+    planes.data[2] = src + luma_size + chroma_size;
+    planes.pitch[1] = planes.pitch[2] = width / 2U;
+    break;
+  case YUV444:
+  case RGB_PLANAR:
+    planes.data[1] = src + luma_size;
+    planes.data[2] = src + luma_size * 2U;
+    planes.pitch[1] = planes.pitch[2] = width;
+    break;
+  case RGB:
+  case BGR:
+    planes.pitch[0] = width * 3U;
+    break;
+  default:
+    break;
+  }
+  return planes;
+}
+
+void CopyPlane(const uint8_t *src, int src_pitch, uint8_t *dst, int dst_pitch,
+               uint32_t width, uint32_t height, const uint8_t *lut) {
+  for (auto y = 0U; y < height; y++) {
+    auto const *s = src + (size_t)y * src_pitch;
+    auto *d = dst + (size_t)y * dst_pitch;
+    for (auto x = 0U; x < width; x++) {
+      d[x] = lut[s[x]];
+    }
+  }
+}
+
+void FillPlane(uint8_t *dst, int dst_pitch, uint32_t width, uint32_t height,
+               uint8_t value) {
+  for (auto y = 0U; y < height; y++) {
+    memset(dst + (size_t)y * dst_pitch, value, width);
+  }
+}
+
+void SplitUV(const uint8_t *src, int src_pitch, uint8_t *dst_u,
+             int pitch_u, uint8_t *dst_v, int pitch_v, uint32_t width,
+             uint32_t height, const uint8_t *lut) {
+  for (auto y = 0U; y < height; y++) {
+    auto const *s = src + (size_t)y * src_pitch;
+    auto *u = dst_u + (size_t)y * pitch_u;
+    auto *v = dst_v + (size_t)y * pitch_v;
+    for (auto x = 0U; x < width; x++) {
+      u[x] = lut[s[2U * x]];
+      v[x] = lut[s[2U * x + 1U]];
+    }
+  }
+}
+
+// 2x2 box, last column and row are repeated for odd sizes;
+void HalvePlane(const uint8_t *src, int src_pitch, uint32_t src_width,
+                uint32_t src_height, uint8_t *dst, int dst_pitch) {
+  for (auto y = 0U; y < (src_height + 1U) / 2U; y++) {
+    auto const *r0 = src + (size_t)(2U * y) * src_pitch;
+    auto const *r1 = src + (size_t)min(2U * y + 1U, src_height - 1U) *
+                               src_pitch;
+    auto *d = dst + (size_t)y * dst_pitch;
+    for (auto x = 0U; x < (src_width + 1U) / 2U; x++) {
+      auto const x0 = 2U * x;
+      auto const x1 = min(x0 + 1U, src_width - 1U);
+      d[x] = (uint8_t)((r0[x0] + r0[x1] + r1[x0] + r1[x1] + 2U) >> 2U);
+    }
+  }
+}
+
+/* Gives R, G and B of pixel for any of RGB layouts;
+ */
+struct RgbReader {
+  const uint8_t *data[3];
+  int pitch;
+  uint32_t step;
+
+  RgbReader(const SrcPlanes &planes, Pixel_Format format) {
+    pitch = planes.pitch[0];
+    if (RGB_PLANAR == format) {
+      data[0] = planes.data[0];
+      data[1] = planes.data[1];
+      data[2] = planes.data[2];
+      step = 1U;
+    } else {
+      auto const bgr = (BGR == format);
+      data[0] = planes.data[0] + (bgr ? 2U : 0U);
+      data[1] = planes.data[0] + 1U;
+      data[2] = planes.data[0] + (bgr ? 0U : 2U);
+      step = 3U;
+    }
+  }
+
+  void Get(uint32_t x, uint32_t y, int &r, int &g, int &b) const {
+    auto const offset = (size_t)y * pitch + x * step;
+    r = data[0][offset];
+    g = data[1][offset];
+    b = data[2][offset];
+  }
+};
+
+// JFIF uses full range BT.601, coefficients are scaled by 2^16;
+void RgbToYuv444(const RgbReader &src, uint32_t width, uint32_t height,
+                 AVFrame *dst) {
+  for (auto y = 0U; y < height; y++) {
+    auto *dy = dst->data[0] + (size_t)y * dst->linesize[0];
+    auto *du = dst->data[1] + (size_t)y * dst->linesize[1];
+    auto *dv = dst->data[2] + (size_t)y * dst->linesize[2];
+    for (auto x = 0U; x < width; x++) {
+      int r, g, b;
+      src.Get(x, y, r, g, b);
+      dy[x] = (uint8_t)((19595 * r + 38470 * g + 7471 * b + 32768) >> 16);
+      du[x] = (uint8_t)((-11059 * r - 21709 * g + 32768 * b + 8421376) >> 16);
+      dv[x] = (uint8_t)((32768 * r - 27439 * g - 5329 * b + 8421376) >> 16);
+    }
+  }
+}
+
+void RgbToRgb24(const RgbReader &src, uint32_t width, uint32_t height,
+                AVFrame *dst) {
+  for (auto y = 0U; y < height; y++) {
+    auto *d = dst->data[0] + (size_t)y * dst->linesize[0];
+    for (auto x = 0U; x < width; x++) {
+      int r, g, b;
+      src.Get(x, y, r, g, b);
+      d[3U * x] = (uint8_t)r;
+      d[3U * x + 1U] = (uint8_t)g;
+      d[3U * x + 2U] = (uint8_t)b;
+    }
+  }
+}
+
+// RGB32 is native endian 0xAARRGGBB;
+void RgbToRgb32(const RgbReader &src, uint32_t width, uint32_t height,
+                AVFrame *dst) {
+  for (auto y = 0U; y < height; y++) {
+    auto *d = dst->data[0] + (size_t)y * dst->linesize[0];
+    for (auto x = 0U; x < width; x++) {
+      int r, g, b;
+      src.Get(x, y, r, g, b);
+      uint32_t const pixel = 0xFF000000U | ((uint32_t)r << 16U) |
+                             ((uint32_t)g << 8U) | (uint32_t)b;
+      memcpy(d + 4U * x, &pixel, sizeof(pixel));
+    }
+  }
+}
+
+bool IsYuv420(Pixel_Format format) {
+  return YUV420 == format || YCBCR == format || NV12 == format;
+}
+
+bool IsRgb(Pixel_Format format) {
+  return RGB == format || BGR == format || RGB_PLANAR == format;
+}
+
+AVPixelFormat GetEncoderFormat(ImageCodec codec, Pixel_Format format) {
+  switch (codec) {
+  case IMAGE_JPEG:
+    if (Y == format || IsYuv420(format)) {
+      return AV_PIX_FMT_YUVJ420P;
+    }
+    if (YUV444 == format || IsRgb(format)) {
+      return AV_PIX_FMT_YUVJ444P;
+    }
+    break;
+  case IMAGE_PNG:
+    if (Y == format) {
+      return AV_PIX_FMT_GRAY8;
+    }
+    if (IsYuv420(format) || IsRgb(format)) {
+      return AV_PIX_FMT_RGB24;
+    }
+    break;
+  case IMAGE_WEBP:
+    if (Y == format || IsYuv420(format) || YUV444 == format) {
+      return AV_PIX_FMT_YUV420P;
+    }
+    if (IsRgb(format)) {
+      return AV_PIX_FMT_RGB32;
+    }
+    break;
+  }
+  return AV_PIX_FMT_NONE;
+}
+
+AVCodecID GetCodecId(ImageCodec codec) {
+  switch (codec) {
+  case IMAGE_PNG:
+    return AV_CODEC_ID_PNG;
+  case IMAGE_WEBP:
+    return AV_CODEC_ID_WEBP;
+  default:
+    return AV_CODEC_ID_MJPEG;
+  }
+}
+
+/* Encoder context with its frame and scratch memory; There's one per
+ * thread, so nothing here is shared;
+ */
+class ImageEncoder {
+public:
+  ImageEncoder(const ImageWriterParams &params, uint32_t new_width,
+               uint32_t new_height, Pixel_Format new_format)
+      : width(new_width), height(new_height), format(new_format),
+        codec(params.codec), lut(params.full_range || IMAGE_WEBP == codec) {
+    auto const pix_fmt = GetEncoderFormat(codec, format);
+    auto const p_codec = avcodec_find_encoder(GetCodecId(codec));
+    if (!p_codec) {
+      throw runtime_error("FFmpeg is built without encoder for this image "
+                          "format");
+    }
+
+    avctx = avcodec_alloc_context3(p_codec);
+    frame = av_frame_alloc();
+    if (!avctx || !frame) {
+      Free();
+      throw runtime_error("Can't allocate image encoder");
+    }
+
+    avctx->width = width;
+    avctx->height = height;
+    avctx->pix_fmt = pix_fmt;
+    avctx->time_base = {1, 25};
+    // Images are encoded in parallel already;
+    avctx->thread_count = 1;
+
+    auto const quality = min(max(params.quality, 1U), 100U);
+    if (IMAGE_JPEG == codec) {
+      // Quality 100 gives qscale 2, quality 1 gives 31;
+      auto const qscale = 2 + ((100 - (int)quality) * 29 + 49) / 99;
+      avctx->flags |= AV_CODEC_FLAG_QSCALE;
+      avctx->global_quality = FF_QP2LAMBDA * qscale;
+    } else if (IMAGE_WEBP == codec) {
+      avctx->global_quality = FF_QP2LAMBDA * quality;
+    } else {
+      avctx->compression_level = min(params.compression_level, 9U);
+    }
+
+    auto res = avcodec_open2(avctx, p_codec, nullptr);
+    if (res < 0) {
+      Free();
+      throw runtime_error("Can't open image encoder: " +
+                          AvErrorToString(res));
+    }
+
+    frame->format = pix_fmt;
+    frame->width = width;
+    frame->height = height;
+    frame->quality = avctx->global_quality;
+    res = av_frame_get_buffer(frame, 32);
+    if (res < 0) {
+      Free();
+      throw runtime_error("Can't allocate image frame: " +
+                          AvErrorToString(res));
+    }
+
+    if (AV_PIX_FMT_RGB24 == pix_fmt && IsYuv420(format)) {
+      rgb_scratch.resize((size_t)width * height * 3U);
+      if (NV12 == format) {
+        uv_scratch.resize((size_t)(width / 2U) * (height / 2U) * 2U);
+      }
+    }
+  }
+
+  ~ImageEncoder() { Free(); }
+
+  // Returns packet which stays valid until the next call;
+  AVPacket *Encode(const uint8_t *src) {
+    auto res = av_frame_make_writable(frame);
+    if (res < 0) {
+      throw runtime_error("Can't write image frame: " + AvErrorToString(res));
+    }
+
+    Fill(src);
+
+    av_packet_unref(&pkt);
+    av_init_packet(&pkt);
+    res = avcodec_send_frame(avctx, frame);
+    if (res >= 0) {
+      res = avcodec_receive_packet(avctx, &pkt);
+    }
+    if (res < 0) {
+      throw runtime_error("Can't encode image: " + AvErrorToString(res));
+    }
+    return &pkt;
+  }
+
+private:
+  void Fill(const uint8_t *src) {
+    auto const planes = GetSrcPlanes(src, format, width, height);
+    auto const chroma_width = (width + 1U) / 2U;
+    auto const chroma_height = (height + 1U) / 2U;
+
+    switch (frame->format) {
+    case AV_PIX_FMT_GRAY8:
+      CopyPlane(planes.data[0], planes.pitch[0], frame->data[0],
+                frame->linesize[0], width, height, lut.luma);
+      break;
+
+    case AV_PIX_FMT_YUVJ420P:
+    case AV_PIX_FMT_YUV420P:
+      CopyPlane(planes.data[0], planes.pitch[0], frame->data[0],
+                frame->linesize[0], width, height, lut.luma);
+      if (Y == format) {
+        FillPlane(frame->data[1], frame->linesize[1], chroma_width,
+                  chroma_height, 128U);
+        FillPlane(frame->data[2], frame->linesize[2], chroma_width,
+                  chroma_height, 128U);
+      } else if (NV12 == format) {
+        SplitUV(planes.data[1], planes.pitch[1], frame->data[1],
+                frame->linesize[1], frame->data[2], frame->linesize[2],
+                width / 2U, height / 2U, lut.chroma);
+      } else if (YUV444 == format) {
+        HalvePlane(planes.data[1], planes.pitch[1], width, height,
+                   frame->data[1], frame->linesize[1]);
+        HalvePlane(planes.data[2], planes.pitch[2], width, height,
+                   frame->data[2], frame->linesize[2]);
+      } else {
+        CopyPlane(planes.data[1], planes.pitch[1], frame->data[1],
+                  frame->linesize[1], width / 2U, height / 2U, lut.chroma);
+        CopyPlane(planes.data[2], planes.pitch[2], frame->data[2],
+                  frame->linesize[2], width / 2U, height / 2U, lut.chroma);
+      }
+      break;
+
+    case AV_PIX_FMT_YUVJ444P:
+      if (YUV444 == format) {
+        for (int i = 0; i < 3; i++) {
+          CopyPlane(planes.data[i], planes.pitch[i], frame->data[i],
+                    frame->linesize[i], width, height,
+                    i ? lut.chroma : lut.luma);
+        }
+      } else {
+        RgbToYuv444(RgbReader(planes, format), width, height, frame);
+      }
+      break;
+
+    case AV_PIX_FMT_RGB24:
+      if (IsRgb(format)) {
+        RgbToRgb24(RgbReader(planes, format), width, height, frame);
+      } else {
+        YuvToRgb24(planes);
+      }
+      break;
+
+    default:
+      RgbToRgb32(RgbReader(planes, format), width, height, frame);
+      break;
+    }
+  }
+
+  void YuvToRgb24(const SrcPlanes &planes) {
+    HostPlanes yuv;
+    yuv.width = width;
+    yuv.height = height;
+    for (int i = 0; i < 3; i++) {
+      yuv.data[i] = planes.data[i];
+      yuv.pitch[i] = planes.pitch[i];
+    }
+
+    if (NV12 == format) {
+      auto const chroma_size = uv_scratch.size() / 2U;
+      auto *u = uv_scratch.data();
+      auto *v = u + chroma_size;
+      RangeLut identity(true);
+      SplitUV(planes.data[1], planes.pitch[1], u, width / 2U, v, width / 2U,
+              width / 2U, height / 2U, identity.chroma);
+      yuv.data[1] = u;
+      yuv.data[2] = v;
+      yuv.pitch[1] = yuv.pitch[2] = width / 2U;
+    }
+
+    FrameCopyParams params;
+    params.format = RGB;
+    CopyFrameYUV420(yuv, params, rgb_scratch.data());
+
+    for (auto y = 0U; y < height; y++) {
+      memcpy(frame->data[0] + (size_t)y * frame->linesize[0],
+             rgb_scratch.data() + (size_t)y * width * 3U, width * 3U);
+    }
+  }
+
+  void Free() {
+    av_packet_unref(&pkt);
+    av_frame_free(&frame);
+    avcodec_free_context(&avctx);
+  }
+
+  uint32_t width;
+  uint32_t height;
+  Pixel_Format format;
+  ImageCodec codec;
+  RangeLut lut;
+
+  AVCodecContext *avctx = nullptr;
+  AVFrame *frame = nullptr;
+  AVPacket pkt = {0};
+
+  vector<uint8_t> rgb_scratch;
+  vector<uint8_t> uv_scratch;
+};
+} // namespace
+
+namespace VPF {
+struct ImageWriter_Impl {
+  string path_template;
+  uint32_t width;
+  uint32_t height;
+  Pixel_Format format;
+  ImageWriterParams params;
+  shared_ptr<AsyncWriter> writer;
+  size_t frame_size = 0U;
+
+  /* Frames waiting for encoder or being encoded; Allocated on demand, up to
+   * twice as many as threads;
+   */
+  vector<vector<uint8_t>> frames;
+  vector<unique_ptr<ImageEncoder>> encoders;
+
+  mutex mtx;
+  condition_variable cv;
+  vector<uint32_t> free_frames;
+  vector<uint32_t> free_encoders;
+  uint32_t pending = 0U;
+
+  uint64_t next_number = 0U;
+  uint64_t num_images = 0U;
+  uint64_t num_failed = 0U;
+  uint64_t num_dropped = 0U;
+
+  MemoryBudget &budget;
+
+  // Destroyed first, so jobs don't outlive the rest;
+  unique_ptr<ThreadPool> pool;
+
+  ImageWriter_Impl(const char *new_path_template, uint32_t new_width,
+                   uint32_t new_height, Pixel_Format new_format,
+                   const ImageWriterParams &new_params,
+                   shared_ptr<AsyncWriter> new_writer)
+      : path_template(new_path_template), width(new_width),
+        height(new_height), format(new_format), params(new_params),
+        writer(new_writer), budget(MemoryBudget::Instance()) {
+    if (!IsNumberPattern(path_template)) {
+      throw invalid_argument("Image path " + path_template +
+                             " must have single integer format, e. g. %06d");
+    }
+
+    if (!width || !height) {
+      throw invalid_argument("Image size must be given");
+    }
+
+    if (AV_PIX_FMT_NONE == GetEncoderFormat(params.codec, format)) {
+      throw invalid_argument("Pixel format isn't supported by image codec");
+    }
+
+    auto const subsampled = (NV12 == format || YUV420 == format ||
+                             YCBCR == format);
+    if (subsampled && ((width | height) & 1U)) {
+      throw invalid_argument("Frame with subsampled chroma must have even "
+                             "width and height");
+    }
+
+    if (!writer) {
+      writer = AsyncWriter::GetDefault();
+    }
+
+    frame_size = GetHostFrameSize(format, width, height);
+    next_number = params.start_number;
+
+    auto const num_threads = max(params.num_threads, 1U);
+    for (auto i = 0U; i < num_threads; i++) {
+      encoders.emplace_back(new ImageEncoder(params, width, height, format));
+      free_encoders.push_back(i);
+    }
+
+    // Never reallocated, so frames may be added while others are encoded;
+    frames.reserve(num_threads * 2U);
+
+    // Compact node is resolved once, so frame copies and workers share it;
+    params.placement.node = params.placement.GetNode();
+    pool.reset(new ThreadPool(num_threads, params.placement));
+  }
+
+  ~ImageWriter_Impl() {
+    Flush();
+    pool.reset();
+    budget.Release(params.pipeline, frame_size * frames.size());
+  }
+
+  string MakePath(uint64_t number) const {
+    vector<char> path(path_template.size() + 32U);
+    snprintf(path.data(), path.size(), path_template.c_str(), (int)number);
+    return path.data();
+  }
+
+  // Returns false if frame is dropped by budget policy;
+  bool Submit(const uint8_t *src) {
+    auto const drop = BudgetPolicy::BUDGET_DROP == params.budget_policy;
+    uint32_t frame_idx = 0U;
+    {
+      unique_lock<mutex> lock(mtx);
+      while (free_frames.empty()) {
+        if (frames.size() < frames.capacity()) {
+          /* The first frame may wait for budget, further ones wait for
+           * frames being encoded unless policy is to drop;
+           */
+          auto const first = frames.empty();
+          lock.unlock();
+          auto const reserved =
+              (first || drop)
+                  ? budget.Reserve(params.pipeline, frame_size,
+                                   params.budget_policy)
+                  : budget.TryReserve(params.pipeline, frame_size);
+          lock.lock();
+
+          if (reserved) {
+            NumaNodeScope scope(params.placement.node);
+            frames.emplace_back(frame_size);
+            free_frames.push_back((uint32_t)frames.size() - 1U);
+            break;
+          }
+          if (drop) {
+            next_number++;
+            num_dropped++;
+            return false;
+          }
+        }
+        cv.wait(lock, [this]() { return !free_frames.empty(); });
+      }
+      frame_idx = free_frames.back();
+      free_frames.pop_back();
+      pending++;
+    }
+
+    memcpy(frames[frame_idx].data(), src, frame_size);
+    auto const path = MakePath(next_number++);
+    num_images++;
+
+    pool->Submit([this, frame_idx, path]() { Encode(frame_idx, path); });
+    return true;
+  }
+
+  void Encode(uint32_t frame_idx, const string &path) {
+    uint32_t encoder_idx = 0U;
+    {
+      // There are as many encoders as threads, so one is always free;
+      lock_guard<mutex> lock(mtx);
+      encoder_idx = free_encoders.back();
+      free_encoders.pop_back();
+    }
+
+    auto success = true;
+    try {
+      auto pkt = encoders[encoder_idx]->Encode(frames[frame_idx].data());
+
+      unique_ptr<AsyncFile> file(AsyncFile::Make(writer, path));
+      file->Write(pkt->data, pkt->size);
+      {
+        lock_guard<mutex> lock(mtx);
+        pending++;
+      }
+      file->CloseAsync([this](bool closed) { Done(closed); });
+    } catch (exception &e) {
+      VPF_LOG(LOG_LEVEL_ERROR, "ImageWriter") << path << ": " << e.what();
+      success = false;
+    }
+
+    lock_guard<mutex> lock(mtx);
+    free_encoders.push_back(encoder_idx);
+    free_frames.push_back(frame_idx);
+    pending--;
+    num_failed += success ? 0U : 1U;
+    cv.notify_all();
+  }
+
+  // Called when file is closed;
+  void Done(bool success) {
+    lock_guard<mutex> lock(mtx);
+    pending--;
+    num_failed += success ? 0U : 1U;
+    cv.notify_all();
+  }
+
+  bool Flush() {
+    unique_lock<mutex> lock(mtx);
+    cv.wait(lock, [this]() { return !pending; });
+    return !num_failed;
+  }
+};
+} // namespace VPF
+
+ImageWriter *ImageWriter::Make(const char *path_template, uint32_t width,
+                               uint32_t height, Pixel_Format format,
+                               const ImageWriterParams &params,
+                               shared_ptr<AsyncWriter> writer) {
+  return new ImageWriter(path_template, width, height, format, params, writer);
+}
+
+ImageWriter::ImageWriter(const char *path_template, uint32_t width,
+                         uint32_t height, Pixel_Format format,
+                         const ImageWriterParams &params,
+                         shared_ptr<AsyncWriter> writer)
+    : Task("ImageWriter", ImageWriter::numInputs, ImageWriter::numOutputs) {
+  pImpl = new ImageWriter_Impl(path_template, width, height, format, params,
+                               writer);
+}
+
+ImageWriter::~ImageWriter() { delete pImpl; }
+
+TaskExecStatus ImageWriter::Execute() {
+  auto pInput = (Buffer *)GetInput(0U);
+  if (!pInput) {
+    return TaskExecStatus::TASK_EXEC_FAIL;
+  }
+
+  if (pInput->GetRawMemSize() < pImpl->frame_size) {
+    VPF_LOG(LOG_LEVEL_ERROR, "ImageWriter")
+        << "Input frame is " << pInput->GetRawMemSize() << " bytes, "
+        << pImpl->frame_size << " expected";
+    return TaskExecStatus::TASK_EXEC_FAIL;
+  }
+
+  if (!pImpl->Submit(pInput->GetDataAs<uint8_t>())) {
+    VPF_LOG(LOG_LEVEL_DEBUG, "ImageWriter")
+        << "Frame is dropped, memory budget is exhausted";
+  }
+  return TaskExecStatus::TASK_EXEC_SUCCESS;
+}
+
+bool ImageWriter::Flush() { return pImpl->Flush(); }
+
+uint64_t ImageWriter::GetNumImages() const { return pImpl->num_images; }
+
+uint64_t ImageWriter::GetNumFailed() const {
+  lock_guard<mutex> lock(pImpl->mtx);
+  return pImpl->num_failed;
+}
+
+uint64_t ImageWriter::GetNumDropped() const {
+  lock_guard<mutex> lock(pImpl->mtx);
+  return pImpl->num_dropped;
+}
@@ -0,0 +1,138 @@
+/*
+ * Copyright 2020 NVIDIA Corporation
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "MappedFile.hpp"
+#include <sstream>
+#include <stdexcept>
+
+#if defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace VPF;
+using namespace std;
+
+namespace VPF {
+struct MappedFile_Impl {
+#if defined(_WIN32)
+  HANDLE file = INVALID_HANDLE_VALUE;
+  HANDLE mapping = nullptr;
+#else
+  int fd = -1;
+#endif
+  uint8_t *data = nullptr;
+  size_t size = 0U;
+
+  MappedFile_Impl(const char *path, bool sequential) {
+#if defined(_WIN32)
+    file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr,
+                       OPEN_EXISTING,
+                       sequential ? FILE_FLAG_SEQUENTIAL_SCAN
+                                  : FILE_FLAG_RANDOM_ACCESS,
+                       nullptr);
+    if (INVALID_HANDLE_VALUE == file) {
+      ThrowError(path);
+    }
+
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file, &file_size)) {
+      ThrowError(path);
+    }
+    size = (size_t)file_size.QuadPart;
+
+    if (size) {
+      mapping =
+          CreateFileMappingA(file, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+      if (!mapping) {
+        ThrowError(path);
+      }
+      data = (uint8_t *)MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+      if (!data) {
+        ThrowError(path);
+      }
+    }
+#else
+    fd = open(path, O_RDONLY);
+    if (fd < 0) {
+      ThrowError(path);
+    }
+
+    struct stat st;
+    if (0 != fstat(fd, &st)) {
+      ThrowError(path);
+    }
+    size = (size_t)st.st_size;
+
+    if (size) {
+      auto ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd,
+                      0);
+      if (MAP_FAILED == ptr) {
+        ThrowError(path);
+      }
+      data = (uint8_t *)ptr;
+      madvise(data, size, sequential ? MADV_SEQUENTIAL : MADV_RANDOM);
+    }
+#endif
+  }
+
+  ~MappedFile_Impl() { Close(); }
+
+  void Close() {
+#if defined(_WIN32)
+    if (data) {
+      UnmapViewOfFile(data);
+    }
+    if (mapping) {
+      CloseHandle(mapping);
+    }
+    if (INVALID_HANDLE_VALUE != file) {
+      CloseHandle(file);
+    }
+    mapping = nullptr;
+    file = INVALID_HANDLE_VALUE;
+#else
+    if (data) {
+      munmap(data, size);
+    }
+    if (fd >= 0) {
+      close(fd);
+    }
+    fd = -1;
+#endif
+    data = nullptr;
+  }
+
+  void ThrowError(const char *path) {
+    Close();
+    stringstream ss;
+    ss << "Can't map file " << path;
+    throw runtime_error(ss.str());
+  }
+};
+} // namespace VPF
+
+MappedFile::MappedFile(const char *path, bool sequential) {
+  pImpl = new MappedFile_Impl(path, sequential);
+}
+
+MappedFile::~MappedFile() { delete pImpl; }
+
+uint8_t *MappedFile::Data() const { return pImpl->data; }
+
+size_t MappedFile::Size() const { return pImpl->size; }
@@ -1,3 +1,4 @@
+#include "Logger.hpp"
 #include "NppCommon.hpp"
 #include <cstring>
 #include <iostream>
@@ -16,14 +17,16 @@ void SetupNppContext(CUcontext context, CUstream stream,
   CUdevice device;
   auto res = cuCtxGetDevice(&device);
   if (CUDA_SUCCESS != res) {
-    cerr << "Failed to get CUDA device. Error code: " << res << endl;
+    VPF_LOG(LOG_LEVEL_ERROR, "Npp")
+        << "Failed to get CUDA device. Error code: " << res;
   }
 
   cudaDeviceProp properties = {0};
   auto ret = cudaGetDeviceProperties(&properties, device);
   if (cudaSuccess != ret) {
-    cerr << "Failed to get CUDA device properties. Error code: " << ret << endl;
-    cerr << "Error description: " << cudaGetErrorString(ret) << endl;
+    VPF_LOG(LOG_LEVEL_ERROR, "Npp")
+        << "Failed to get CUDA device properties. Error code: " << ret
+        << ". Error description: " << cudaGetErrorString(ret);
   }
   cuCtxPopCurrent(nullptr);
 
@@ -20,6 +20,7 @@
 #include <sstream>
 #include <vector>
 
+#include "Logger.hpp"
 #include "NvCodecUtils.h"
 #include "NvDecoder.h"
 #include "nvcuvid.h"
@@ -142,6 +143,9 @@ struct Dim {
 struct NvDecoderImpl {
   bool m_bReconfigExternal = false, m_bReconfigExtPPChange = false;
 
+  // Set by Reset(), next sequence may have any resolution within max one;
+  bool m_bNewInput = false;
+
   unsigned int m_nWidth = 0U, m_nLumaHeight = 0U, m_nChromaHeight = 0U,
                m_nNumChromaPlanes = 0U, m_nMaxWidth = 0U, m_nMaxHeight = 0U;
 
@@ -149,6 +153,10 @@ struct NvDecoderImpl {
       m_nFrameAlloc = 0, m_nBPP = 1, m_nDecodedFrame = 0, m_nDecodePicCnt = 0,
       m_nPicNumInDecodeOrder[32] = {0};
 
+  // Parser DPB size, decoder surfaces count goes here once it's created;
+  int m_nNumDecodeSurfaces = 1;
+  bool m_bLowLatency = false;
+
   Rect m_displayRect = {}, m_cropRect = {};
 
   Dim m_resizeDim = {};
@@ -168,7 +176,8 @@ struct NvDecoderImpl {
   cudaVideoSurfaceFormat m_eOutputFormat = cudaVideoSurfaceFormat_NV12;
 
   vector<CUdeviceptr> m_vpFrame;
-  queue<CUdeviceptr> m_vpFrameRet;
+  // Surfaces ready for display along with their timestamps;
+  queue<pair<CUdeviceptr, int64_t>> m_vpFrameRet;
   vector<int64_t> m_vTimestamp;
 
   mutex m_mtxVPFrame;
@@ -328,10 +337,11 @@ int NvDecoder::HandleVideoSequence(CUVIDEOFORMAT *pVideoFormat) noexcept {
         cuvidCreateDecoder(&p_impl->m_hDecoder, &videoDecodeCreateInfo),
         __LINE__);
     ThrowOnCudaError(cuCtxPopCurrent(nullptr), __LINE__);
+    p_impl->m_nNumDecodeSurfaces = nDecodeSurface;
 
     return nDecodeSurface;
   } catch (exception &e) {
-    cerr << e.what() << endl;
+    VPF_LOG(LOG_LEVEL_ERROR, "NvDecoder") << e.what();
   }
 
   return 0;
@@ -377,6 +387,14 @@ int NvDecoder::ReconfigureDecoder(CUVIDEOFORMAT *pVideoFormat) {
     return 1;
   }
 
+  auto const isNewInput = p_impl->m_bNewInput;
+  p_impl->m_bNewInput = false;
+  bool const isCropOrResize = (p_impl->m_cropRect.r && p_impl->m_cropRect.b) ||
+                              (p_impl->m_resizeDim.w && p_impl->m_resizeDim.h);
+  if (bDecodeResChange && isNewInput && !isCropOrResize) {
+    return ReconfigureForNewInput(pVideoFormat, nDecodeSurface);
+  }
+
   if (!bDecodeResChange && !p_impl->m_bReconfigExtPPChange) {
     // if the coded_width/coded_height hasn't changed but display resolution has
     // changed, then need to update width/height for correct output without
@@ -431,6 +449,50 @@ int NvDecoder::ReconfigureDecoder(CUVIDEOFORMAT *pVideoFormat) {
   ThrowOnCudaError(cuvidReconfigureDecoder(p_impl->m_hDecoder, &reconfigParams),
                    __LINE__);
   ThrowOnCudaError(cuCtxPopCurrent(nullptr), __LINE__);
+  p_impl->m_nNumDecodeSurfaces = nDecodeSurface;
+
+  return nDecodeSurface;
+}
+
+/* Unlike resolution change within stream, frames of new input are output
+ * in their own resolution rather than scaled to the previous one;
+ */
+int NvDecoder::ReconfigureForNewInput(CUVIDEOFORMAT *pVideoFormat,
+                                      int nDecodeSurface) {
+  CUVIDRECONFIGUREDECODERINFO reconfigParams = {0};
+  reconfigParams.ulWidth = pVideoFormat->coded_width;
+  reconfigParams.ulHeight = pVideoFormat->coded_height;
+  reconfigParams.ulTargetWidth = pVideoFormat->coded_width;
+  reconfigParams.ulTargetHeight = pVideoFormat->coded_height;
+  reconfigParams.ulNumDecodeSurfaces = nDecodeSurface;
+
+  ThrowOnCudaError(cuCtxPushCurrent(p_impl->m_cuContext), __LINE__);
+  ThrowOnCudaError(cuvidReconfigureDecoder(p_impl->m_hDecoder, &reconfigParams),
+                   __LINE__);
+  {
+    // Frames of previous input size can't hold new ones;
+    lock_guard<mutex> lock(p_impl->m_mtxVPFrame);
+    for (auto pFrame : p_impl->m_vpFrame) {
+      cuMemFree(pFrame);
+    }
+    p_impl->m_vpFrame.clear();
+    p_impl->m_nDeviceFramePitch = 0;
+  }
+  ThrowOnCudaError(cuCtxPopCurrent(nullptr), __LINE__);
+
+  p_impl->m_videoFormat = *pVideoFormat;
+  p_impl->m_nWidth =
+      pVideoFormat->display_area.right - pVideoFormat->display_area.left;
+  p_impl->m_nLumaHeight =
+      pVideoFormat->display_area.bottom - pVideoFormat->display_area.top;
+  p_impl->m_nChromaHeight =
+      int(p_impl->m_nLumaHeight *
+          GetChromaHeightFactor(pVideoFormat->chroma_format));
+  p_impl->m_nNumChromaPlanes =
+      GetChromaPlaneCount(pVideoFormat->chroma_format);
+  p_impl->m_nSurfaceWidth = pVideoFormat->coded_width;
+  p_impl->m_nSurfaceHeight = pVideoFormat->coded_height;
+  p_impl->m_nNumDecodeSurfaces = nDecodeSurface;
 
   return nDecodeSurface;
 }
@@ -451,7 +513,7 @@ int NvDecoder::HandlePictureDecode(CUVIDPICPARAMS *pPicParams) noexcept {
 
     return 1;
   } catch (exception &e) {
-    cerr << e.what();
+    VPF_LOG(LOG_LEVEL_ERROR, "NvDecoder") << e.what();
     return 0;
   }
 }
@@ -561,7 +623,7 @@ int NvDecoder::HandlePictureDisplay(CUVIDPARSERDISPINFO *pDispInfo) noexcept {
                      __LINE__);
     return 1;
   } catch (exception &e) {
-    cerr << e.what();
+    VPF_LOG(LOG_LEVEL_ERROR, "NvDecoder") << e.what();
     return 0;
   }
 }
@@ -575,14 +637,18 @@ NvDecoder::NvDecoder(CUstream cuStream, CUcontext cuContext,
   p_impl->m_eCodec = eCodec;
   p_impl->m_nMaxWidth = maxWidth;
   p_impl->m_nMaxHeight = maxHeight;
+  p_impl->m_bLowLatency = bLowLatency;
   p_impl->decode_error.store(0);
 
   ThrowOnCudaError(cuvidCtxLockCreate(&p_impl->m_ctxLock, cuContext), __LINE__);
+  CreateParser();
+}
 
+void NvDecoder::CreateParser() {
   CUVIDPARSERPARAMS videoParserParameters = {};
-  videoParserParameters.CodecType = eCodec;
-  videoParserParameters.ulMaxNumDecodeSurfaces = 1;
-  videoParserParameters.ulMaxDisplayDelay = bLowLatency ? 0 : 1;
+  videoParserParameters.CodecType = p_impl->m_eCodec;
+  videoParserParameters.ulMaxNumDecodeSurfaces = p_impl->m_nNumDecodeSurfaces;
+  videoParserParameters.ulMaxDisplayDelay = p_impl->m_bLowLatency ? 0 : 1;
   videoParserParameters.pUserData = this;
   videoParserParameters.pfnSequenceCallback = HandleVideoSequenceProc;
   videoParserParameters.pfnDecodePicture = HandlePictureDecodeProc;
@@ -592,6 +658,35 @@ NvDecoder::NvDecoder(CUstream cuStream, CUcontext cuContext,
       __LINE__);
 }
 
+bool NvDecoder::Reset() {
+  if (1 == p_impl->decode_error.load()) {
+    return false;
+  }
+
+  if (p_impl->m_hParser) {
+    cuvidDestroyVideoParser(p_impl->m_hParser);
+    p_impl->m_hParser = nullptr;
+  }
+
+  {
+    lock_guard<mutex> lock(p_impl->m_mtxVPFrame);
+    // Frames decoded from previous input are never returned;
+    while (!p_impl->m_vpFrameRet.empty()) {
+      p_impl->m_vpFrame.push_back(p_impl->m_vpFrameRet.front().first);
+      p_impl->m_vpFrameRet.pop();
+    }
+    p_impl->m_nDecodedFrame = 0;
+  }
+  p_impl->m_nDecodePicCnt = 0;
+  p_impl->m_bNewInput = true;
+
+  /* New parser starts with DPB size of existing decoder, because sequence
+   * callback doesn't override it unless decoder is reconfigured;
+   */
+  CreateParser();
+  return true;
+}
+
 NvDecoder::~NvDecoder() {
 
   cuCtxPushCurrent(p_impl->m_cuContext);
@@ -609,7 +704,7 @@ NvDecoder::~NvDecoder() {
     lock_guard<mutex> lock(p_impl->m_mtxVPFrame);
     // Return all surfaces to m_vpFrame;
     while (!p_impl->m_vpFrameRet.empty()) {
-      auto &surface = p_impl->m_vpFrameRet.front();
+      auto surface = p_impl->m_vpFrameRet.front().first;
       p_impl->m_vpFrameRet.pop();
       p_impl->m_vpFrame.push_back(surface);
     }
@@ -650,7 +745,9 @@ int NvDecoder::GetBitDepth() { return p_impl->m_nBitDepthMinus8 + 8; }
 
 bool NvDecoder::DecodeLockSurface(const uint8_t *pData, size_t nSize,
                                   CUdeviceptr &decSurface,
-                                  bool &isFrameReturned, uint32_t flags) {
+                                  bool &isFrameReturned, uint32_t flags,
+                                  int64_t timestamp,
+                                  int64_t *pSurfaceTimestamp) {
   if (!p_impl->m_hParser) {
     throw runtime_error("Parser not initialized.");
   }
@@ -664,7 +761,7 @@ bool NvDecoder::DecodeLockSurface(const uint8_t *pData, size_t nSize,
   packet.payload = pData;
   packet.payload_size = nSize;
   packet.flags = flags | CUVID_PKT_TIMESTAMP;
-  packet.timestamp = 0;
+  packet.timestamp = timestamp;
   if (!pData || nSize == 0) {
     packet.flags |= CUVID_PKT_ENDOFSTREAM;
   }
@@ -677,17 +774,25 @@ bool NvDecoder::DecodeLockSurface(const uint8_t *pData, size_t nSize,
   /* Move all decoded surfaces from decoder-owned pool to queue of frames ready
    * for display;
    */
-  while (p_impl->m_nDecodedFrame > 0) {
-    p_impl->m_vpFrameRet.push(p_impl->m_vpFrame.front());
-    p_impl->m_vpFrame.erase(p_impl->m_vpFrame.begin());
-    p_impl->m_nDecodedFrame--;
+  auto const numDecoded = p_impl->m_nDecodedFrame;
+  for (int i = 0; i < numDecoded; i++) {
+    p_impl->m_vpFrameRet.push(
+        make_pair(p_impl->m_vpFrame[i], p_impl->m_vTimestamp[i]));
   }
+  p_impl->m_vpFrame.erase(p_impl->m_vpFrame.begin(),
+                          p_impl->m_vpFrame.begin() + numDecoded);
+  p_impl->m_vTimestamp.erase(p_impl->m_vTimestamp.begin(),
+                             p_impl->m_vTimestamp.begin() + numDecoded);
+  p_impl->m_nDecodedFrame = 0;
 
   /* Return only one decoded frame;
    */
   if (!p_impl->m_vpFrameRet.empty()) {
     isFrameReturned = true;
-    decSurface = p_impl->m_vpFrameRet.front();
+    decSurface = p_impl->m_vpFrameRet.front().first;
+    if (pSurfaceTimestamp) {
+      *pSurfaceTimestamp = p_impl->m_vpFrameRet.front().second;
+    }
     p_impl->m_vpFrameRet.pop();
   }
 
@@ -0,0 +1,822 @@
+/*
+ * Copyright 2020 NVIDIA Corporation
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ParameterSets.hpp"
+#include "Logger.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+using namespace VPF;
+using namespace std;
+
+namespace {
+
+enum H264NalType {
+  H264_NAL_SLICE = 1,
+  H264_NAL_IDR_SLICE = 5,
+  H264_NAL_SPS = 7,
+  H264_NAL_PPS = 8
+};
+
+enum HevcNalType {
+  HEVC_NAL_RSV_VCL_N14 = 14,
+  HEVC_NAL_BLA_W_LP = 16,
+  HEVC_NAL_IDR_W_RADL = 19,
+  HEVC_NAL_IDR_N_LP = 20,
+  HEVC_NAL_RSV_IRAP_23 = 23,
+  HEVC_NAL_VPS = 32,
+  HEVC_NAL_SPS = 33,
+  HEVC_NAL_PPS = 34
+};
+
+// Slice header fields needed are close to NAL unit start;
+const size_t maxSliceHeaderBytes = 64U;
+
+/* Reads RBSP, so emulation prevention bytes (00 00 03) are dropped upon
+ * construction; Throws std::out_of_range when data is over;
+ */
+class BitReader {
+public:
+  BitReader(const uint8_t *data, size_t size) {
+    rbsp.reserve(size);
+    auto zeros = 0U;
+    for (size_t i = 0U; i < size; i++) {
+      if (zeros >= 2U && 0x03 == data[i]) {
+        zeros = 0U;
+        continue;
+      }
+      zeros = data[i] ? 0U : zeros + 1U;
+      rbsp.push_back(data[i]);
+    }
+  }
+
+  uint32_t ReadBits(uint32_t num_bits) {
+    uint32_t value = 0U;
+    for (auto i = 0U; i < num_bits; i++) {
+      value = (value << 1) | ReadBit();
+    }
+    return value;
+  }
+
+  uint32_t ReadBit() {
+    if (pos >= rbsp.size() * 8U) {
+      throw out_of_range("Parameter set is truncated");
+    }
+    auto bit = (rbsp[pos / 8U] >> (7U - pos % 8U)) & 1U;
+    pos++;
+    return bit;
+  }
+
+  bool ReadFlag() { return 1U == ReadBit(); }
+
+  void SkipBits(size_t num_bits) {
+    pos += num_bits;
+    if (pos > rbsp.size() * 8U) {
+      throw out_of_range("Parameter set is truncated");
+    }
+  }
+
+  // Exp-Golomb unsigned;
+  uint32_t ReadUE() {
+    auto leading_zeros = 0U;
+    while (!ReadBit()) {
+      if (++leading_zeros > 31U) {
+        throw out_of_range("Invalid Exp-Golomb code");
+      }
+    }
+    return (uint32_t)((1ULL << leading_zeros) - 1ULL) +
+           ReadBits(leading_zeros);
+  }
+
+  // Exp-Golomb signed;
+  int32_t ReadSE() {
+    auto code = ReadUE();
+    return (code & 1U) ? (int32_t)((code + 1U) / 2U)
+                       : -(int32_t)(code / 2U);
+  }
+
+private:
+  vector<uint8_t> rbsp;
+  size_t pos = 0U;
+};
+
+void ReadH264ScalingList(BitReader &br, uint32_t size) {
+  int32_t last_scale = 8, next_scale = 8;
+  for (auto j = 0U; j < size; j++) {
+    if (next_scale) {
+      next_scale = (last_scale + br.ReadSE() + 256) % 256;
+    }
+    last_scale = next_scale ? next_scale : last_scale;
+  }
+}
+
+/* Aspect ratio, video signal type and chroma location are the same in
+ * H.264 and HEVC VUI;
+ */
+void ReadVuiColour(BitReader &br, VideoStreamInfo &info) {
+  if (br.ReadFlag()) {
+    static const uint32_t sar_table[][2] = {
+        {0, 0},   {1, 1},   {12, 11}, {10, 11}, {16, 11}, {40, 33},
+        {24, 11}, {20, 11}, {32, 11}, {80, 33}, {18, 11}, {15, 11},
+        {64, 33}, {160, 99}, {4, 3},  {3, 2},   {2, 1}};
+    auto const extended_sar = 255U;
+
+    auto aspect_ratio_idc = br.ReadBits(8);
+    if (extended_sar == aspect_ratio_idc) {
+      info.sar_width = br.ReadBits(16);
+      info.sar_height = br.ReadBits(16);
+    } else if (aspect_ratio_idc < sizeof(sar_table) / sizeof(sar_table[0])) {
+      info.sar_width = sar_table[aspect_ratio_idc][0];
+      info.sar_height = sar_table[aspect_ratio_idc][1];
+    }
+  }
+
+  // Overscan info;
+  if (br.ReadFlag()) {
+    br.SkipBits(1);
+  }
+
+  if (br.ReadFlag()) {
+    // Video format;
+    br.SkipBits(3);
+    info.video_full_range = br.ReadFlag();
+    if (br.ReadFlag()) {
+      info.colour_primaries = br.ReadBits(8);
+      info.transfer_characteristics = br.ReadBits(8);
+      info.matrix_coefficients = br.ReadBits(8);
+    }
+  }
+
+  // Chroma sample location;
+  if (br.ReadFlag()) {
+    br.ReadUE();
+    br.ReadUE();
+  }
+}
+
+void ParseH264Sps(BitReader &br, VideoStreamInfo &info) {
+  info.codec = cudaVideoCodec_H264;
+  info.profile = br.ReadBits(8);
+  // Constraint set flags;
+  br.SkipBits(8);
+  info.level = br.ReadBits(8);
+  // SPS id;
+  br.ReadUE();
+
+  info.chroma_format_idc = 1U;
+  info.bit_depth_luma = 8U;
+  info.bit_depth_chroma = 8U;
+  bool separate_colour_plane = false;
+
+  static const uint32_t high_profiles[] = {100, 110, 122, 244, 44, 83, 86,
+                                           118, 128, 138, 139, 134, 135};
+  if (end(high_profiles) !=
+      find(begin(high_profiles), end(high_profiles), info.profile)) {
+    info.chroma_format_idc = br.ReadUE();
+    if (3U == info.chroma_format_idc) {
+      separate_colour_plane = br.ReadFlag();
+    }
+    info.bit_depth_luma = br.ReadUE() + 8U;
+    info.bit_depth_chroma = br.ReadUE() + 8U;
+    // Transform bypass;
+    br.SkipBits(1);
+
+    if (br.ReadFlag()) {
+      auto const num_lists = (3U != info.chroma_format_idc) ? 8U : 12U;
+      for (auto i = 0U; i < num_lists; i++) {
+        if (br.ReadFlag()) {
+          ReadH264ScalingList(br, i < 6U ? 16U : 64U);
+        }
+      }
+    }
+  }
+
+  // Max frame num;
+  br.ReadUE();
+  auto const poc_type = br.ReadUE();
+  if (0U == poc_type) {
+    br.ReadUE();
+  } else if (1U == poc_type) {
+    br.SkipBits(1);
+    br.ReadSE();
+    br.ReadSE();
+    auto const num_ref_frames_in_poc_cycle = br.ReadUE();
+    for (auto i = 0U; i < num_ref_frames_in_poc_cycle; i++) {
+      br.ReadSE();
+    }
+  }
+
+  // Max ref frames and gaps in frame num;
+  br.ReadUE();
+  br.SkipBits(1);
+
+  auto const width_in_mbs = br.ReadUE() + 1U;
+  auto const height_in_map_units = br.ReadUE() + 1U;
+  auto const frame_mbs_only = br.ReadFlag();
+  info.progressive = frame_mbs_only;
+  if (!frame_mbs_only) {
+    // MB adaptive frame field;
+    br.SkipBits(1);
+  }
+  // Direct 8x8 inference;
+  br.SkipBits(1);
+
+  info.coded_width = width_in_mbs * 16U;
+  info.coded_height = (frame_mbs_only ? 1U : 2U) * height_in_map_units * 16U;
+
+  if (br.ReadFlag()) {
+    auto const chroma_array_type =
+        separate_colour_plane ? 0U : info.chroma_format_idc;
+    auto crop_unit_x = 1U, crop_unit_y = frame_mbs_only ? 1U : 2U;
+    if (chroma_array_type) {
+      crop_unit_x = (3U == chroma_array_type) ? 1U : 2U;
+      crop_unit_y *= (1U == chroma_array_type) ? 2U : 1U;
+    }
+
+    info.crop_left = br.ReadUE() * crop_unit_x;
+    info.crop_right = br.ReadUE() * crop_unit_x;
+    info.crop_top = br.ReadUE() * crop_unit_y;
+    info.crop_bottom = br.ReadUE() * crop_unit_y;
+  }
+
+  info.width = info.coded_width - info.crop_left - info.crop_right;
+  info.height = info.coded_height - info.crop_top - info.crop_bottom;
+
+  if (br.ReadFlag()) {
+    ReadVuiColour(br, info);
+    if (br.ReadFlag()) {
+      info.num_units_in_tick = br.ReadBits(32);
+      info.time_scale = br.ReadBits(32);
+      // Field rate is signalled, frame takes two ticks;
+      if (info.num_units_in_tick) {
+        info.frame_rate =
+            (double)info.time_scale / (2.0 * info.num_units_in_tick);
+      }
+    }
+  }
+}
+
+void ParseH264Pps(BitReader &br, VideoStreamInfo &info) {
+  // PPS and SPS id;
+  br.ReadUE();
+  br.ReadUE();
+  info.cabac = br.ReadFlag();
+  info.has_pps = true;
+}
+
+void ParseHevcProfileTierLevel(BitReader &br, uint32_t max_sub_layers_minus1,
+                               VideoStreamInfo &info) {
+  // Profile space;
+  br.SkipBits(2);
+  info.tier = br.ReadBits(1);
+  info.profile = br.ReadBits(5);
+  // Compatibility flags;
+  br.SkipBits(32);
+  info.progressive = br.ReadFlag();
+  // Interlaced, non-packed, frame only and 44 constraint bits;
+  br.SkipBits(3 + 44);
+  info.level = br.ReadBits(8);
+
+  vector<bool> profile_present(max_sub_layers_minus1);
+  vector<bool> level_present(max_sub_layers_minus1);
+  for (auto i = 0U; i < max_sub_layers_minus1; i++) {
+    profile_present[i] = br.ReadFlag();
+    level_present[i] = br.ReadFlag();
+  }
+
+  if (max_sub_layers_minus1) {
+    br.SkipBits(2 * (8 - max_sub_layers_minus1));
+  }
+
+  for (auto i = 0U; i < max_sub_layers_minus1; i++) {
+    if (profile_present[i]) {
+      br.SkipBits(88);
+    }
+    if (level_present[i]) {
+      br.SkipBits(8);
+    }
+  }
+}
+
+void SkipHevcScalingListData(BitReader &br) {
+  for (auto size_id = 0U; size_id < 4U; size_id++) {
+    for (auto matrix_id = 0U; matrix_id < 6U;
+         matrix_id += (3U == size_id) ? 3U : 1U) {
+      if (!br.ReadFlag()) {
+        // Delta of reference matrix id;
+        br.ReadUE();
+        continue;
+      }
+
+      auto const num_coefs = min(64U, 1U << (4U + (size_id << 1U)));
+      if (size_id > 1U) {
+        // DC coefficient;
+        br.ReadSE();
+      }
+      for (auto i = 0U; i < num_coefs; i++) {
+        br.ReadSE();
+      }
+    }
+  }
+}
+
+/* Returns number of delta POCs in the set, sets predicted from previous one
+ * depend on it;
+ */
+uint32_t SkipHevcShortTermRefPicSet(BitReader &br, uint32_t idx,
+                                    const vector<uint32_t> &num_delta_pocs) {
+  if (idx && br.ReadFlag()) {
+    // Delta RPS sign and abs;
+    br.SkipBits(1);
+    br.ReadUE();
+
+    auto num_pocs = 0U;
+    for (auto j = 0U; j <= num_delta_pocs[idx - 1]; j++) {
+      auto const used_by_curr_pic = br.ReadFlag();
+      auto const use_delta = used_by_curr_pic ? true : br.ReadFlag();
+      num_pocs += use_delta ? 1U : 0U;
+    }
+    return num_pocs;
+  }
+
+  auto const num_negative = br.ReadUE();
+  auto const num_positive = br.ReadUE();
+  for (auto i = 0U; i < num_negative + num_positive; i++) {
+    br.ReadUE();
+    br.SkipBits(1);
+  }
+  return num_negative + num_positive;
+}
+
+void ParseHevcSps(BitReader &br, VideoStreamInfo &info) {
+  info.codec = cudaVideoCodec_HEVC;
+  // VPS id;
+  br.SkipBits(4);
+  auto const max_sub_layers_minus1 = br.ReadBits(3);
+  // Temporal id nesting;
+  br.SkipBits(1);
+  ParseHevcProfileTierLevel(br, max_sub_layers_minus1, info);
+
+  // SPS id;
+  br.ReadUE();
+  info.chroma_format_idc = br.ReadUE();
+  if (3U == info.chroma_format_idc) {
+    // Separate colour plane;
+    br.SkipBits(1);
+  }
+
+  info.coded_width = br.ReadUE();
+  info.coded_height = br.ReadUE();
+
+  if (br.ReadFlag()) {
+    auto const sub_width = (1U == info.chroma_format_idc ||
+                            2U == info.chroma_format_idc)
+                               ? 2U
+                               : 1U;
+    auto const sub_height = (1U == info.chroma_format_idc) ? 2U : 1U;
+    info.crop_left = br.ReadUE() * sub_width;
+    info.crop_right = br.ReadUE() * sub_width;
+    info.crop_top = br.ReadUE() * sub_height;
+    info.crop_bottom = br.ReadUE() * sub_height;
+  }
+
+  info.width = info.coded_width - info.crop_left - info.crop_right;
+  info.height = info.coded_height - info.crop_top - info.crop_bottom;
+
+  info.bit_depth_luma = br.ReadUE() + 8U;
+  info.bit_depth_chroma = br.ReadUE() + 8U;
+  auto const log2_max_poc_lsb = br.ReadUE() + 4U;
+
+  auto const sub_layer_ordering_info = br.ReadFlag();
+  for (auto i = sub_layer_ordering_info ? 0U : max_sub_layers_minus1;
+       i <= max_sub_layers_minus1; i++) {
+    br.ReadUE();
+    br.ReadUE();
+    br.ReadUE();
+  }
+
+  // Coding block and transform block sizes, transform hierarchy depth;
+  for (auto i = 0U; i < 6U; i++) {
+    br.ReadUE();
+  }
+
+  if (br.ReadFlag() && br.ReadFlag()) {
+    SkipHevcScalingListData(br);
+  }
+
+  // AMP and SAO;
+  br.SkipBits(2);
+
+  if (br.ReadFlag()) {
+    // PCM bit depths, sizes and loop filter;
+    br.SkipBits(8);
+    br.ReadUE();
+    br.ReadUE();
+    br.SkipBits(1);
+  }
+
+  auto const num_short_term_ref_pic_sets = br.ReadUE();
+  if (num_short_term_ref_pic_sets > 64U) {
+    throw out_of_range("Invalid number of short term ref pic sets");
+  }
+  vector<uint32_t> num_delta_pocs(num_short_term_ref_pic_sets);
+  for (auto i = 0U; i < num_short_term_ref_pic_sets; i++) {
+    num_delta_pocs[i] = SkipHevcShortTermRefPicSet(br, i, num_delta_pocs);
+  }
+
+  if (br.ReadFlag()) {
+    auto const num_long_term_ref_pics = br.ReadUE();
+    for (auto i = 0U; i < num_long_term_ref_pics; i++) {
+      br.SkipBits(log2_max_poc_lsb + 1U);
+    }
+  }
+
+  // Temporal MVP and strong intra smoothing;
+  br.SkipBits(2);
+
+  if (br.ReadFlag()) {
+    ReadVuiColour(br, info);
+    // Neutral chroma, field sequence, frame field info;
+    br.SkipBits(3);
+
+    if (br.ReadFlag()) {
+      // Default display window;
+      for (auto i = 0U; i < 4U; i++) {
+        br.ReadUE();
+      }
+    }
+
+    if (br.ReadFlag()) {
+      info.num_units_in_tick = br.ReadBits(32);
+      info.time_scale = br.ReadBits(32);
+      if (info.num_units_in_tick) {
+        info.frame_rate = (double)info.time_scale / info.num_units_in_tick;
+      }
+    }
+  }
+}
+
+/* Only timing is taken from VPS, SPS is preferred source of the rest;
+ */
+void ParseHevcVps(BitReader &br, VideoStreamInfo &info) {
+  // VPS id, base layer flags, max layers;
+  br.SkipBits(4 + 2 + 6);
+  auto const max_sub_layers_minus1 = br.ReadBits(3);
+  // Temporal id nesting and reserved 16 bits;
+  br.SkipBits(1 + 16);
+
+  VideoStreamInfo ptl;
+  ParseHevcProfileTierLevel(br, max_sub_layers_minus1, ptl);
+
+  auto const sub_layer_ordering_info = br.ReadFlag();
+  for (auto i = sub_layer_ordering_info ? 0U : max_sub_layers_minus1;
+       i <= max_sub_layers_minus1; i++) {
+    br.ReadUE();
+    br.ReadUE();
+    br.ReadUE();
+  }
+
+  auto const max_layer_id = br.ReadBits(6);
+  auto const num_layer_sets = br.ReadUE() + 1U;
+  for (auto i = 1U; i < num_layer_sets; i++) {
+    br.SkipBits(max_layer_id + 1U);
+  }
+
+  if (br.ReadFlag()) {
+    info.num_units_in_tick = br.ReadBits(32);
+    info.time_scale = br.ReadBits(32);
+    if (info.num_units_in_tick) {
+      info.frame_rate = (double)info.time_scale / info.num_units_in_tick;
+    }
+  }
+}
+
+void ParseHevcPps(BitReader &br, VideoStreamInfo &info) {
+  // PPS and SPS id;
+  br.ReadUE();
+  br.ReadUE();
+  // Dependent slices, output flag, extra slice header bits, sign data
+  // hiding, CABAC init present;
+  br.SkipBits(1 + 1 + 3 + 1 + 1);
+  // Num ref idx defaults, init QP;
+  br.ReadUE();
+  br.ReadUE();
+  br.ReadSE();
+  // Constrained intra, transform skip;
+  br.SkipBits(2);
+  if (br.ReadFlag()) {
+    br.ReadUE();
+  }
+  // Cb and Cr QP offsets;
+  br.ReadSE();
+  br.ReadSE();
+  // Slice chroma QP offsets, weighted prediction, transquant bypass;
+  br.SkipBits(4);
+  info.tiles = br.ReadFlag();
+  info.wavefront = br.ReadFlag();
+  info.cabac = true;
+  info.has_pps = true;
+}
+
+/* Every parameter set is parsed into its own struct, so that broken one
+ * doesn't spoil the rest;
+ */
+struct ParseState {
+  cudaVideoCodec codec;
+  VideoStreamInfo sps;
+  VideoStreamInfo pps;
+  VideoStreamInfo vps;
+  bool has_sps = false;
+  bool has_vps = false;
+};
+
+/* First parameter set of each kind wins, streams with several of them are
+ * rare and the first ones describe the first picture anyway;
+ */
+void ParseNalUnit(const uint8_t *nal, size_t size, ParseState &state) {
+  auto const is_h264 = (cudaVideoCodec_H264 == state.codec);
+  auto const header_size = is_h264 ? 1U : 2U;
+  if (size <= header_size) {
+    return;
+  }
+
+  auto const type = is_h264 ? (nal[0] & 0x1F) : ((nal[0] >> 1) & 0x3F);
+  auto const is_sps = is_h264 ? (H264_NAL_SPS == type) : (HEVC_NAL_SPS == type);
+  auto const is_pps = is_h264 ? (H264_NAL_PPS == type) : (HEVC_NAL_PPS == type);
+  auto const is_vps = !is_h264 && (HEVC_NAL_VPS == type);
+
+  if ((is_sps && state.has_sps) || (is_pps && state.pps.has_pps) ||
+      (is_vps && state.has_vps) || !(is_sps || is_pps || is_vps)) {
+    return;
+  }
+
+  BitReader br(nal + header_size, size - header_size);
+  try {
+    if (is_sps) {
+      VideoStreamInfo sps;
+      is_h264 ? ParseH264Sps(br, sps) : ParseHevcSps(br, sps);
+      state.sps = sps;
+      state.has_sps = true;
+    } else if (is_pps) {
+      VideoStreamInfo pps;
+      is_h264 ? ParseH264Pps(br, pps) : ParseHevcPps(br, pps);
+      state.pps = pps;
+    } else {
+      VideoStreamInfo vps;
+      ParseHevcVps(br, vps);
+      state.vps = vps;
+      state.has_vps = true;
+    }
+  } catch (exception &e) {
+    VPF_LOG(LOG_LEVEL_DEBUG, "ParameterSets")
+        << "NAL unit type " << type << ": " << e.what();
+  }
+}
+
+uint32_t ReadU16(const uint8_t *data) { return (data[0] << 8) | data[1]; }
+
+/* avcC: 5 bytes of header, SPS count, SPS list, PPS count, PPS list;
+ * Every parameter set is prefixed with 16 bit size;
+ */
+bool ParseAvcC(const uint8_t *data, size_t size, ParseState &state) {
+  size_t pos = 5U;
+  for (auto list = 0U; list < 2U; list++) {
+    if (pos >= size) {
+      return false;
+    }
+    uint32_t const count = data[pos++] & (list ? 0xFFU : 0x1FU);
+
+    for (auto i = 0U; i < count; i++) {
+      if (pos + 2U > size || pos + 2U + ReadU16(data + pos) > size) {
+        return false;
+      }
+      auto const nal_size = ReadU16(data + pos);
+      ParseNalUnit(data + pos + 2U, nal_size, state);
+      pos += 2U + nal_size;
+    }
+  }
+  return true;
+}
+
+/* hvcC: 22 bytes of header, number of arrays, then arrays of NAL units;
+ */
+bool ParseHvcC(const uint8_t *data, size_t size, ParseState &state) {
+  size_t pos = 22U;
+  if (pos >= size) {
+    return false;
+  }
+
+  auto const num_arrays = data[pos++];
+  for (auto i = 0U; i < num_arrays; i++) {
+    if (pos + 3U > size) {
+      return false;
+    }
+    auto const num_nalus = ReadU16(data + pos + 1U);
+    pos += 3U;
+
+    for (auto j = 0U; j < num_nalus; j++) {
+      if (pos + 2U > size || pos + 2U + ReadU16(data + pos) > size) {
+        return false;
+      }
+      auto const nal_size = ReadU16(data + pos);
+      ParseNalUnit(data + pos + 2U, nal_size, state);
+      pos += 2U + nal_size;
+    }
+  }
+  return true;
+}
+
+/* Calls on_nal_unit for NAL units of Annex B byte stream until it returns
+ * false; Units longer than max_nal_size are given truncated to it, so that
+ * callers which only need headers don't wait for payload scan;
+ */
+template <typename F>
+void ForEachNalUnit(const uint8_t *data, size_t size, F on_nal_unit,
+                    size_t max_nal_size = SIZE_MAX) {
+  auto is_start_code = [&](size_t i) {
+    return i + 3U <= size && 0 == data[i] && 0 == data[i + 1] &&
+           1 == data[i + 2];
+  };
+
+  size_t i = 0U;
+  while (i < size && !is_start_code(i)) {
+    i++;
+  }
+
+  while (i < size) {
+    auto const nal_start = i + 3U;
+    auto const scan_end = nal_start + min(size - nal_start, max_nal_size);
+    auto nal_end = nal_start;
+    while (nal_end < scan_end && !is_start_code(nal_end)) {
+      nal_end++;
+    }
+
+    // Trailing zero belongs to the next 4 byte start code;
+    auto trimmed_end = nal_end;
+    if (nal_end < scan_end || size == scan_end) {
+      while (trimmed_end > nal_start && 0 == data[trimmed_end - 1]) {
+        trimmed_end--;
+      }
+    }
+
+    if (!on_nal_unit(data + nal_start, trimmed_end - nal_start)) {
+      return;
+    }
+
+    while (nal_end < size && !is_start_code(nal_end)) {
+      nal_end++;
+    }
+    i = nal_end;
+  }
+}
+} // namespace
+
+bool VPF::ParseParameterSets(cudaVideoCodec codec, const uint8_t *data,
+                             size_t size, VideoStreamInfo &info) {
+  if (!data || !size) {
+    return false;
+  }
+
+  if (cudaVideoCodec_H264 != codec && cudaVideoCodec_HEVC != codec) {
+    return false;
+  }
+
+  ParseState state;
+  state.codec = codec;
+
+  // Both avcC and hvcC start with configuration version 1;
+  if (1 == data[0]) {
+    auto ok = (cudaVideoCodec_H264 == codec) ? ParseAvcC(data, size, state)
+                                             : ParseHvcC(data, size, state);
+    if (!ok) {
+      return false;
+    }
+  } else {
+    ForEachNalUnit(data, size, [&state](const uint8_t *nal, size_t nal_size) {
+      ParseNalUnit(nal, nal_size, state);
+      return true;
+    });
+  }
+
+  auto &sps = state.sps;
+  if (!state.has_sps || !sps.width || !sps.height ||
+      sps.crop_left + sps.crop_right >= sps.coded_width ||
+      sps.crop_top + sps.crop_bottom >= sps.coded_height) {
+    return false;
+  }
+
+  info = sps;
+  info.has_pps = state.pps.has_pps;
+  info.cabac = state.pps.cabac;
+  info.tiles = state.pps.tiles;
+  info.wavefront = state.pps.wavefront;
+
+  if (!info.frame_rate && state.vps.frame_rate) {
+    info.num_units_in_tick = state.vps.num_units_in_tick;
+    info.time_scale = state.vps.time_scale;
+    info.frame_rate = state.vps.frame_rate;
+  }
+  return true;
+}
+
+SliceHeaderParser::SliceHeaderParser(cudaVideoCodec new_codec)
+    : codec(new_codec), extraSliceHeaderBits(64U, 0U) {}
+
+bool SliceHeaderParser::Parse(const uint8_t *data, size_t size,
+                              AccessUnitInfo &info) {
+  info = AccessUnitInfo();
+  if (!data || (cudaVideoCodec_H264 != codec && cudaVideoCodec_HEVC != codec)) {
+    return false;
+  }
+
+  auto const is_h264 = (cudaVideoCodec_H264 == codec);
+  auto const header_size = is_h264 ? 1U : 2U;
+  bool has_slices = false;
+
+  auto on_nal_unit = [&](const uint8_t *nal, size_t nal_size) {
+    if (nal_size <= header_size) {
+      return true;
+    }
+
+    auto const type = is_h264 ? (nal[0] & 0x1F) : ((nal[0] >> 1) & 0x3F);
+    auto const is_irap = !is_h264 && type >= HEVC_NAL_BLA_W_LP &&
+                         type <= HEVC_NAL_RSV_IRAP_23;
+    auto const is_slice =
+        is_h264 ? (H264_NAL_SLICE == type || H264_NAL_IDR_SLICE == type)
+                : (is_irap || type <= HEVC_NAL_RSV_VCL_N14);
+    if (!is_slice && (is_h264 || HEVC_NAL_PPS != type)) {
+      return true;
+    }
+
+    BitReader br(nal + header_size, nal_size - header_size);
+    try {
+      if (is_h264) {
+        // First MB in slice;
+        br.ReadUE();
+        static const FrameType slice_types[] = {FRAME_TYPE_P, FRAME_TYPE_B,
+                                                FRAME_TYPE_I, FRAME_TYPE_P,
+                                                FRAME_TYPE_I};
+        info.frame_type = slice_types[br.ReadUE() % 5U];
+        info.is_idr = (H264_NAL_IDR_SLICE == type);
+        info.is_reference = (0 != (nal[0] & 0x60));
+        has_slices = true;
+        return false;
+      }
+
+      if (HEVC_NAL_PPS == type) {
+        auto const pps_id = br.ReadUE();
+        // SPS id, dependent slices and output flag;
+        br.ReadUE();
+        br.SkipBits(2);
+        if (pps_id < extraSliceHeaderBits.size()) {
+          extraSliceHeaderBits[pps_id] = br.ReadBits(3);
+        }
+        return true;
+      }
+
+      // Address of further slice segments depends on SPS;
+      if (!br.ReadFlag()) {
+        return true;
+      }
+      if (is_irap) {
+        // No output of prior pics;
+        br.SkipBits(1);
+      }
+      auto const pps_id = br.ReadUE();
+      if (pps_id < extraSliceHeaderBits.size()) {
+        br.SkipBits(extraSliceHeaderBits[pps_id]);
+      }
+
+      static const FrameType slice_types[] = {FRAME_TYPE_B, FRAME_TYPE_P,
+                                              FRAME_TYPE_I};
+      auto const slice_type = br.ReadUE();
+      info.frame_type = (slice_type < 3U) ? slice_types[slice_type]
+                                          : FRAME_TYPE_UNKNOWN;
+      info.is_idr =
+          (HEVC_NAL_IDR_W_RADL == type || HEVC_NAL_IDR_N_LP == type);
+      // Even VCL types below IRAP ones are sub-layer non-reference;
+      info.is_reference = is_irap || (type & 1U);
+      has_slices = true;
+    } catch (exception &e) {
+      VPF_LOG(LOG_LEVEL_DEBUG, "ParameterSets")
+          << "Slice header of NAL unit type " << type << ": " << e.what();
+    }
+    return !is_slice;
+  };
+
+  // Only the first slice is parsed, its header is all that's read;
+  ForEachNalUnit(data, size, on_nal_unit, header_size + maxSliceHeaderBytes);
+  return has_slices;
+}
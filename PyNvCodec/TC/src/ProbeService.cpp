@@ -0,0 +1,430 @@
+/*
+ * Copyright 2020 NVIDIA Corporation
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ProbeService.hpp"
+#include "FFmpegDemuxer.h"
+#include "Logger.hpp"
+#include "ThreadPool.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <sys/stat.h>
+#include <thread>
+#include <unordered_map>
+
+using namespace VPF;
+using namespace std;
+using namespace std::chrono;
+
+namespace {
+const char dbMagic[] = "VPFPROBE";
+const uint32_t dbVersion = 1U;
+const size_t dbHeaderSize = sizeof(dbMagic) - 1U + sizeof(dbVersion);
+
+// Record can't be that big, size prefix is garbage then;
+const uint32_t maxRecordSize = 1U << 20;
+
+/* Records are stored in host byte order, database isn't meant to be moved
+ * between machines of different endianness;
+ */
+class RecordWriter {
+public:
+  template <typename T> void Put(const T &value) {
+    auto ptr = (const uint8_t *)&value;
+    bytes.insert(bytes.end(), ptr, ptr + sizeof(value));
+  }
+
+  void PutString(const string &str) {
+    Put((uint32_t)str.size());
+    bytes.insert(bytes.end(), str.begin(), str.end());
+  }
+
+  const vector<uint8_t> &Bytes() const { return bytes; }
+
+private:
+  vector<uint8_t> bytes;
+};
+
+class RecordReader {
+public:
+  RecordReader(const uint8_t *new_data, size_t new_size)
+      : data(new_data), size(new_size) {}
+
+  template <typename T> bool Get(T &value) {
+    if (pos + sizeof(value) > size) {
+      return false;
+    }
+    memcpy(&value, data + pos, sizeof(value));
+    pos += sizeof(value);
+    return true;
+  }
+
+  bool GetString(string &str) {
+    uint32_t length = 0U;
+    if (!Get(length) || pos + length > size) {
+      return false;
+    }
+    str.assign((const char *)data + pos, length);
+    pos += length;
+    return true;
+  }
+
+private:
+  const uint8_t *data;
+  size_t size;
+  size_t pos = 0U;
+};
+
+vector<uint8_t> Serialize(const MediaInfo &info) {
+  RecordWriter writer;
+  writer.PutString(info.path);
+  writer.Put(info.file_size);
+  writer.Put(info.mtime);
+  writer.PutString(info.error);
+  writer.Put((uint32_t)info.codec);
+  writer.Put(info.profile);
+  writer.Put(info.level);
+  writer.Put(info.width);
+  writer.Put(info.height);
+  writer.Put(info.chroma_format_idc);
+  writer.Put(info.bit_depth);
+  writer.Put(info.frame_rate);
+  writer.Put(info.duration);
+  writer.Put(info.bit_rate);
+  writer.Put(info.num_frames);
+  writer.Put(info.num_keyframes);
+  writer.Put(info.max_gop_size);
+  writer.Put(info.avg_gop_size);
+  return writer.Bytes();
+}
+
+bool Deserialize(const vector<uint8_t> &bytes, MediaInfo &info) {
+  RecordReader reader(bytes.data(), bytes.size());
+  uint32_t codec = 0U;
+  auto ok = reader.GetString(info.path) && reader.Get(info.file_size) &&
+            reader.Get(info.mtime) && reader.GetString(info.error) &&
+            reader.Get(codec) && reader.Get(info.profile) &&
+            reader.Get(info.level) && reader.Get(info.width) &&
+            reader.Get(info.height) && reader.Get(info.chroma_format_idc) &&
+            reader.Get(info.bit_depth) && reader.Get(info.frame_rate) &&
+            reader.Get(info.duration) && reader.Get(info.bit_rate) &&
+            reader.Get(info.num_frames) && reader.Get(info.num_keyframes) &&
+            reader.Get(info.max_gop_size) && reader.Get(info.avg_gop_size);
+  info.codec = (cudaVideoCodec)codec;
+  return ok;
+}
+
+bool WriteRecord(FILE *file, const MediaInfo &info) {
+  auto const bytes = Serialize(info);
+  auto const size = (uint32_t)bytes.size();
+  return 1U == fwrite(&size, sizeof(size), 1U, file) &&
+         bytes.size() == fwrite(bytes.data(), 1U, bytes.size(), file);
+}
+
+bool WriteHeader(FILE *file) {
+  return 1U == fwrite(dbMagic, sizeof(dbMagic) - 1U, 1U, file) &&
+         1U == fwrite(&dbVersion, sizeof(dbVersion), 1U, file);
+}
+
+void ProbeFile(MediaInfo &info, bool scan_gop) {
+  FFmpegDemuxer demuxer(info.path.c_str(), map<string, string>());
+
+  info.codec = FFmpeg2NvCodecId(demuxer.GetVideoCodec());
+  info.width = demuxer.GetWidth();
+  info.height = demuxer.GetHeight();
+  info.frame_rate = demuxer.GetFramerate();
+  info.duration = demuxer.GetDuration();
+  info.bit_rate = demuxer.GetBitrate();
+  info.num_frames = max<int64_t>(0, demuxer.GetNumFrames());
+
+  VideoStreamInfo stream_info;
+  if (demuxer.GetStreamInfo(stream_info)) {
+    info.profile = stream_info.profile;
+    info.level = stream_info.level;
+    info.chroma_format_idc = stream_info.chroma_format_idc;
+    info.bit_depth = stream_info.bit_depth_luma;
+  }
+
+  vector<KeyframeIndexEntry> index;
+  uint64_t num_packets = 0U;
+  if (demuxer.GetKeyframeIndex(index, num_packets, scan_gop)) {
+    info.num_keyframes = index.size();
+    for (size_t i = 0U; i < index.size(); i++) {
+      auto const next = (i + 1U < index.size()) ? index[i + 1U].packet_number
+                                                : num_packets;
+      auto const gop_size = (uint32_t)(next - index[i].packet_number);
+      info.max_gop_size = max(info.max_gop_size, gop_size);
+    }
+    info.avg_gop_size =
+        (double)(num_packets - index.front().packet_number) / index.size();
+
+    if (!info.num_frames) {
+      info.num_frames = num_packets;
+    }
+  }
+
+  if (0.0 == info.duration && info.num_frames && info.frame_rate > 0.0) {
+    info.duration = info.num_frames / info.frame_rate;
+  }
+  if (!info.bit_rate && info.duration > 0.0) {
+    info.bit_rate = (int64_t)(info.file_size * 8U / info.duration);
+  }
+}
+} // namespace
+
+namespace VPF {
+struct ProbeService_Impl {
+  string db_path;
+  uint32_t num_threads;
+  bool scan_gop;
+
+  mutable mutex lock;
+  unordered_map<string, MediaInfo> records;
+  unique_ptr<FILE, int (*)(FILE *)> db;
+  uint32_t num_unflushed = 0U;
+
+  static const uint32_t flushInterval = 256U;
+
+  ProbeService_Impl(const string &path, uint32_t threads, bool scan)
+      : db_path(path), num_threads(threads), scan_gop(scan),
+        db(nullptr, fclose) {
+    if (db_path.empty()) {
+      throw invalid_argument("Probe database path is empty");
+    }
+
+    if (!num_threads) {
+      num_threads = max(1U, thread::hardware_concurrency());
+    }
+
+    Load();
+  }
+
+  /* Reads all records, truncated last record is ignored; Database is
+   * rewritten if it has stale or broken records or stray bytes after the
+   * last good one, so that new records aren't appended after them;
+   */
+  void Load() {
+    uint64_t num_records = 0U;
+    bool is_broken = false;
+
+    unique_ptr<FILE, int (*)(FILE *)> input(fopen(db_path.c_str(), "rb"),
+                                            fclose);
+    if (input) {
+      char header[dbHeaderSize] = {};
+      uint32_t version = 0U;
+      if (1U != fread(header, dbHeaderSize, 1U, input.get()) ||
+          0 != memcmp(header, dbMagic, sizeof(dbMagic) - 1U)) {
+        throw runtime_error(db_path + " isn't probe database");
+      }
+      memcpy(&version, header + sizeof(dbMagic) - 1U, sizeof(version));
+      if (dbVersion != version) {
+        throw runtime_error(db_path + " has unsupported version");
+      }
+
+      uint32_t size = 0U;
+      uint64_t good_end = dbHeaderSize;
+      vector<uint8_t> bytes;
+      while (1U == fread(&size, sizeof(size), 1U, input.get())) {
+        MediaInfo info;
+        bytes.resize(min(size, maxRecordSize));
+        if (size > maxRecordSize ||
+            bytes.size() != fread(bytes.data(), 1U, size, input.get()) ||
+            !Deserialize(bytes, info)) {
+          is_broken = true;
+          break;
+        }
+        records[info.path] = info;
+        num_records++;
+        good_end += sizeof(size) + size;
+      }
+
+      // Crash may cut the file inside size prefix as well;
+      struct stat st;
+      if (!is_broken && (0 != stat(db_path.c_str(), &st) ||
+                         (uint64_t)st.st_size != good_end)) {
+        is_broken = true;
+      }
+    }
+
+    auto const is_new = !input;
+    input.reset();
+    if (is_new || is_broken || num_records > records.size()) {
+      Compact();
+    }
+
+    db.reset(fopen(db_path.c_str(), "ab"));
+    if (!db) {
+      throw runtime_error("Can't open " + db_path + " for writing");
+    }
+
+    VPF_LOG(LOG_LEVEL_INFO, "ProbeService")
+        << records.size() << " files in " << db_path;
+  }
+
+  void Compact() {
+    auto const tmp_path = db_path + ".tmp";
+    {
+      unique_ptr<FILE, int (*)(FILE *)> output(fopen(tmp_path.c_str(), "wb"),
+                                               fclose);
+      bool ok = output && WriteHeader(output.get());
+      for (auto it = records.begin(); ok && it != records.end(); it++) {
+        ok = WriteRecord(output.get(), it->second);
+      }
+      if (!ok || 0 != fflush(output.get())) {
+        throw runtime_error("Can't write " + tmp_path);
+      }
+    }
+
+    if (0 != rename(tmp_path.c_str(), db_path.c_str())) {
+      throw runtime_error("Can't replace " + db_path);
+    }
+  }
+
+  void ProbeOne(const string &path, ProbeStats &stats) {
+    MediaInfo info;
+    info.path = path;
+
+    struct stat st;
+    if (0 != stat(path.c_str(), &st)) {
+      VPF_LOG(LOG_LEVEL_ERROR, "ProbeService") << "Can't stat " << path;
+      lock_guard<mutex> guard(lock);
+      stats.num_failed++;
+      return;
+    }
+    info.file_size = st.st_size;
+    info.mtime = st.st_mtime;
+
+    {
+      lock_guard<mutex> guard(lock);
+      auto it = records.find(path);
+      if (records.end() != it && it->second.file_size == info.file_size &&
+          it->second.mtime == info.mtime) {
+        stats.num_cached++;
+        return;
+      }
+    }
+
+    try {
+      ProbeFile(info, scan_gop);
+    } catch (exception &e) {
+      info.error = e.what();
+      if (info.error.empty()) {
+        info.error = "unknown error";
+      }
+    }
+
+    lock_guard<mutex> guard(lock);
+    if (!WriteRecord(db.get(), info)) {
+      throw runtime_error("Can't write " + db_path);
+    }
+    stats.num_probed++;
+    stats.num_failed += info.error.empty() ? 0U : 1U;
+    records[path] = move(info);
+
+    if (++num_unflushed >= flushInterval) {
+      fflush(db.get());
+      num_unflushed = 0U;
+    }
+  }
+
+  ProbeStats Probe(const vector<string> &paths) {
+    ProbeStats stats;
+    auto const start = steady_clock::now();
+
+    // Workers take paths one by one, so slow files don't stall the rest;
+    atomic<size_t> next(0U);
+    auto const num_workers =
+        (uint32_t)min<size_t>(num_threads, max<size_t>(1U, paths.size()));
+    {
+      ThreadPool pool(num_workers);
+      vector<future<void>> results;
+      for (auto i = 0U; i < num_workers; i++) {
+        results.push_back(pool.Submit([this, &paths, &next, &stats]() {
+          for (auto idx = next++; idx < paths.size(); idx = next++) {
+            ProbeOne(paths[idx], stats);
+          }
+        }));
+      }
+
+      for (auto &result : results) {
+        result.get();
+      }
+    }
+
+    lock_guard<mutex> guard(lock);
+    fflush(db.get());
+    num_unflushed = 0U;
+    stats.probe_sec = duration<double>(steady_clock::now() - start).count();
+
+    VPF_LOG(LOG_LEVEL_INFO, "ProbeService")
+        << stats.num_probed << " files probed, " << stats.num_cached
+        << " up to date, " << stats.num_failed << " failed in "
+        << stats.probe_sec << " s";
+    return stats;
+  }
+};
+} // namespace VPF
+
+ProbeService *ProbeService::Make(const string &db_path, uint32_t num_threads,
+                                 bool scan_gop) {
+  return new ProbeService(db_path, num_threads, scan_gop);
+}
+
+ProbeService::ProbeService(const string &db_path, uint32_t num_threads,
+                           bool scan_gop)
+    : pImpl(new ProbeService_Impl(db_path, num_threads, scan_gop)) {}
+
+ProbeService::~ProbeService() { delete pImpl; }
+
+ProbeStats ProbeService::Probe(const vector<string> &paths) {
+  return pImpl->Probe(paths);
+}
+
+vector<MediaInfo> ProbeService::Query(const vector<string> &paths) const {
+  vector<MediaInfo> infos;
+  infos.reserve(paths.size());
+
+  lock_guard<mutex> guard(pImpl->lock);
+  for (auto &path : paths) {
+    auto it = pImpl->records.find(path);
+    if (pImpl->records.end() != it) {
+      infos.push_back(it->second);
+    } else {
+      infos.push_back(MediaInfo());
+      infos.back().path = path;
+      infos.back().error = "not probed";
+    }
+  }
+  return infos;
+}
+
+vector<MediaInfo> ProbeService::QueryAll() const {
+  vector<MediaInfo> infos;
+  lock_guard<mutex> guard(pImpl->lock);
+  infos.reserve(pImpl->records.size());
+  for (auto &record : pImpl->records) {
+    infos.push_back(record.second);
+  }
+  return infos;
+}
+
+size_t ProbeService::Size() const {
+  lock_guard<mutex> guard(pImpl->lock);
+  return pImpl->records.size();
+}
@@ -0,0 +1,391 @@
+/*
+ * Copyright 2020 NVIDIA Corporation
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "RawVideo.hpp"
+#include "AsyncWriter.hpp"
+#include "Logger.hpp"
+#include "MappedFile.hpp"
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+using namespace VPF;
+using namespace std;
+
+namespace {
+const char y4m_signature[] = "YUV4MPEG2";
+const char y4m_frame[] = "FRAME";
+const char vpf_format_tag[] = "XVPF_FORMAT=";
+
+// Y4M header lines are short, anything longer is a broken file;
+const size_t max_header_size = 64U * 1024U;
+
+struct FormatName {
+  Pixel_Format format;
+  const char *name;
+};
+
+const FormatName format_names[] = {
+    {Y, "y"},           {RGB, "rgb"},     {NV12, "nv12"},
+    {YUV420, "yuv420"}, {RGB_PLANAR, "rgb_planar"},
+    {BGR, "bgr"},       {YCBCR, "ycbcr"}, {YUV444, "yuv444"}};
+
+const char *FormatToName(Pixel_Format format) {
+  for (auto &entry : format_names) {
+    if (entry.format == format) {
+      return entry.name;
+    }
+  }
+  return "undefined";
+}
+
+Pixel_Format FormatFromName(const string &name) {
+  for (auto &entry : format_names) {
+    if (name == entry.name) {
+      return entry.format;
+    }
+  }
+  return UNDEFINED;
+}
+
+/* Y4M colorspace of the same frame size; Formats whose layout differs
+ * from it are tagged, so other readers still split file into frames;
+ */
+const char *FormatToColorspace(Pixel_Format format, bool &needs_tag) {
+  needs_tag = (Y != format && YUV420 != format && YUV444 != format);
+  switch (format) {
+  case Y:
+    return "mono";
+  case YUV420:
+  case YCBCR:
+  case NV12:
+    return "420jpeg";
+  default:
+    return "444";
+  }
+}
+
+Pixel_Format FormatFromColorspace(const string &colorspace) {
+  if ("420jpeg" == colorspace || "420paldv" == colorspace ||
+      "420mpeg2" == colorspace || "420" == colorspace) {
+    return YUV420;
+  } else if ("444" == colorspace) {
+    return YUV444;
+  } else if ("mono" == colorspace) {
+    return Y;
+  }
+
+  stringstream ss;
+  ss << "Y4M colorspace " << colorspace << " isn't supported";
+  throw invalid_argument(ss.str());
+}
+
+/* Parses Y4M stream header, returns its size including line feed;
+ */
+size_t ParseY4mHeader(const uint8_t *data, size_t size,
+                      RawVideoParams &params) {
+  auto const *end = (const uint8_t *)memchr(data, '\n',
+                                            min(size, max_header_size));
+  if (!end) {
+    throw invalid_argument("Y4M header isn't terminated");
+  }
+
+  // Default Y4M colorspace;
+  params.format = YUV420;
+  params.width = 0U;
+  params.height = 0U;
+  params.frame_rate = 0.0;
+
+  string header((const char *)data, end - data);
+  stringstream tokens(header.substr(sizeof(y4m_signature) - 1U));
+  string token;
+  while (tokens >> token) {
+    auto const value = token.substr(1U);
+    switch (token[0]) {
+    case 'W':
+      params.width = stoul(value);
+      break;
+    case 'H':
+      params.height = stoul(value);
+      break;
+    case 'F': {
+      auto const colon = value.find(':');
+      if (string::npos != colon) {
+        auto const num = stod(value.substr(0U, colon));
+        auto const den = stod(value.substr(colon + 1U));
+        params.frame_rate = (den > 0.0) ? num / den : 0.0;
+      }
+      break;
+    }
+    case 'C':
+      params.format = FormatFromColorspace(value);
+      break;
+    case 'X':
+      // Formats Y4M has no colorspace for;
+      if (0 == token.compare(0U, sizeof(vpf_format_tag) - 1U,
+                             vpf_format_tag)) {
+        auto const format =
+            FormatFromName(token.substr(sizeof(vpf_format_tag) - 1U));
+        if (UNDEFINED != format) {
+          params.format = format;
+        }
+      }
+      break;
+    default:
+      // Interlacing, aspect ratio and comments don't matter;
+      break;
+    }
+  }
+
+  if (!params.width || !params.height) {
+    throw invalid_argument("Y4M header has no frame size");
+  }
+
+  return end - data + 1U;
+}
+
+} // namespace
+
+namespace VPF {
+struct RawVideoReader_Impl {
+  MappedFile file;
+  RawVideoParams params;
+  size_t frame_size = 0U;
+  bool is_y4m = false;
+
+  // Frame offsets, Y4M frame headers may differ in size;
+  vector<size_t> offsets;
+  uint64_t next_frame = 0U;
+
+  Buffer *frame = nullptr;
+
+  RawVideoReader_Impl(const char *path, const RawVideoParams &new_params)
+      : file(path), params(new_params) {
+    auto const *data = file.Data();
+    auto const size = file.Size();
+
+    size_t pos = 0U;
+    is_y4m = size >= sizeof(y4m_signature) - 1U &&
+             0 == memcmp(data, y4m_signature, sizeof(y4m_signature) - 1U);
+    if (is_y4m) {
+      pos = ParseY4mHeader(data, size, params);
+      if (YUV420 == params.format && (params.width % 2U || params.height % 2U)) {
+        throw invalid_argument("Y4M 420 stream of odd size isn't supported");
+      }
+    }
+
+    if (UNDEFINED == params.format || !params.width || !params.height) {
+      throw invalid_argument("Raw video frame size and format must be given");
+    }
+    frame_size = GetHostFrameSize(params.format, params.width, params.height);
+
+    if (is_y4m) {
+      IndexY4mFrames(pos);
+    } else {
+      for (; pos + frame_size <= size; pos += frame_size) {
+        offsets.push_back(pos);
+      }
+      if (pos != size) {
+        VPF_LOG(LOG_LEVEL_WARNING, "RawVideoReader")
+            << path << " has " << size - pos << " bytes of incomplete frame";
+      }
+    }
+
+    frame = Buffer::Make(frame_size, nullptr);
+  }
+
+  ~RawVideoReader_Impl() { delete frame; }
+
+  // Only frame headers are touched, pixels aren't paged in;
+  void IndexY4mFrames(size_t pos) {
+    auto const *data = file.Data();
+    auto const size = file.Size();
+    auto const frame_tag_size = sizeof(y4m_frame) - 1U;
+
+    while (pos + frame_tag_size <= size) {
+      if (0 != memcmp(data + pos, y4m_frame, frame_tag_size)) {
+        VPF_LOG(LOG_LEVEL_WARNING, "RawVideoReader")
+            << "Y4M frame header is missing at offset " << pos;
+        break;
+      }
+
+      auto const *end = (const uint8_t *)memchr(
+          data + pos, '\n', min(size - pos, max_header_size));
+      if (!end) {
+        break;
+      }
+
+      pos = end - data + 1U;
+      if (pos + frame_size > size) {
+        VPF_LOG(LOG_LEVEL_WARNING, "RawVideoReader")
+            << "Last Y4M frame is incomplete";
+        break;
+      }
+
+      offsets.push_back(pos);
+      pos += frame_size;
+    }
+  }
+
+  const uint8_t *GetFrame(uint64_t frame_index) const {
+    return (frame_index < offsets.size())
+               ? file.Data() + offsets[frame_index]
+               : nullptr;
+  }
+};
+
+struct RawVideoWriter_Impl {
+  RawVideoParams params;
+  size_t frame_size = 0U;
+  bool y4m;
+  uint64_t num_frames = 0U;
+  unique_ptr<AsyncFile> writer;
+
+  RawVideoWriter_Impl(const char *path, const RawVideoParams &new_params,
+                      bool new_y4m)
+      : params(new_params), y4m(new_y4m) {
+    if (!params.width || !params.height) {
+      throw invalid_argument("Raw video frame size must be given");
+    }
+    frame_size = GetHostFrameSize(params.format, params.width, params.height);
+
+    writer.reset(AsyncFile::Make(AsyncWriter::GetDefault(), path));
+
+    if (y4m) {
+      auto const header = MakeY4mHeader();
+      writer->Write(header.data(), header.size());
+    }
+  }
+
+  string MakeY4mHeader() const {
+    stringstream ss;
+    ss << y4m_signature << " W" << params.width << " H" << params.height;
+
+    // Y4M wants rational frame rate, 1/1000 precision covers NTSC rates;
+    if (params.frame_rate > 0.0) {
+      ss << " F" << (uint64_t)(params.frame_rate * 1000.0 + 0.5) << ":1000";
+    }
+    ss << " Ip A1:1";
+
+    bool needs_tag = false;
+    ss << " C" << FormatToColorspace(params.format, needs_tag);
+    if (needs_tag) {
+      ss << " " << vpf_format_tag << FormatToName(params.format);
+    }
+    ss << "\n";
+    return ss.str();
+  }
+
+  bool Write(const uint8_t *data) {
+    if (y4m) {
+      static const char frame_header[] = "FRAME\n";
+      writer->Write(frame_header, sizeof(frame_header) - 1U);
+    }
+    num_frames++;
+    return writer->Write(data, frame_size);
+  }
+};
+} // namespace VPF
+
+RawVideoReader *RawVideoReader::Make(const char *path,
+                                     const RawVideoParams &params) {
+  return new RawVideoReader(path, params);
+}
+
+RawVideoReader::RawVideoReader(const char *path, const RawVideoParams &params)
+    : Task("RawVideoReader", RawVideoReader::numInputs,
+           RawVideoReader::numOutputs) {
+  pImpl = new RawVideoReader_Impl(path, params);
+}
+
+RawVideoReader::~RawVideoReader() { delete pImpl; }
+
+TaskExecStatus RawVideoReader::Execute() {
+  ClearOutputs();
+
+  auto const *data = pImpl->GetFrame(pImpl->next_frame);
+  if (!data) {
+    return TaskExecStatus::TASK_EXEC_FAIL;
+  }
+
+  pImpl->frame->Update(pImpl->frame_size, (void *)data);
+  pImpl->next_frame++;
+
+  SetOutput(pImpl->frame, 0U);
+  return TaskExecStatus::TASK_EXEC_SUCCESS;
+}
+
+void RawVideoReader::GetParams(RawVideoParams &params) const {
+  params = pImpl->params;
+}
+
+uint64_t RawVideoReader::GetNumFrames() const { return pImpl->offsets.size(); }
+
+uint64_t RawVideoReader::GetFrameIndex() const { return pImpl->next_frame; }
+
+bool RawVideoReader::Seek(uint64_t frame_index) {
+  if (frame_index >= pImpl->offsets.size()) {
+    return false;
+  }
+
+  pImpl->next_frame = frame_index;
+  return true;
+}
+
+const uint8_t *RawVideoReader::GetFrame(uint64_t frame_index) const {
+  return pImpl->GetFrame(frame_index);
+}
+
+size_t RawVideoReader::GetFrameSize() const { return pImpl->frame_size; }
+
+RawVideoWriter *RawVideoWriter::Make(const char *path,
+                                     const RawVideoParams &params, bool y4m) {
+  return new RawVideoWriter(path, params, y4m);
+}
+
+RawVideoWriter::RawVideoWriter(const char *path, const RawVideoParams &params,
+                               bool y4m)
+    : Task("RawVideoWriter", RawVideoWriter::numInputs,
+           RawVideoWriter::numOutputs) {
+  pImpl = new RawVideoWriter_Impl(path, params, y4m);
+}
+
+RawVideoWriter::~RawVideoWriter() { delete pImpl; }
+
+TaskExecStatus RawVideoWriter::Execute() {
+  auto pInput = (Buffer *)GetInput(0U);
+  if (!pInput) {
+    return TaskExecStatus::TASK_EXEC_FAIL;
+  }
+
+  if (pInput->GetRawMemSize() < pImpl->frame_size) {
+    VPF_LOG(LOG_LEVEL_ERROR, "RawVideoWriter")
+        << "Input frame is " << pInput->GetRawMemSize() << " bytes, "
+        << pImpl->frame_size << " expected";
+    return TaskExecStatus::TASK_EXEC_FAIL;
+  }
+
+  if (!pImpl->Write(pInput->GetDataAs<uint8_t>())) {
+    VPF_LOG(LOG_LEVEL_ERROR, "RawVideoWriter") << "Failed to write frame";
+    return TaskExecStatus::TASK_EXEC_FAIL;
+  }
+
+  return TaskExecStatus::TASK_EXEC_SUCCESS;
+}
+
+bool RawVideoWriter::Flush() { return pImpl->writer->Flush(); }
+
+uint64_t RawVideoWriter::GetNumFrames() const { return pImpl->num_frames; }
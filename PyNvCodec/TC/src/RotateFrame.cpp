@@ -0,0 +1,102 @@
+/*
+ * Copyright 2020 NVIDIA Corporation
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "HostTransform.hpp"
+#include "Logger.hpp"
+#include "MemoryInterfaces.hpp"
+#include "Tasks.hpp"
+#include "ThreadPool.hpp"
+#include <memory>
+#include <stdexcept>
+
+using namespace VPF;
+using namespace std;
+
+namespace VPF {
+struct RotateFrame_Impl {
+  uint32_t width;
+  uint32_t height;
+  Pixel_Format format;
+  RotateParams params;
+
+  size_t src_size = 0U;
+  uint32_t dst_width = 0U;
+  uint32_t dst_height = 0U;
+  size_t dst_size = 0U;
+
+  Buffer *dst_frame = nullptr;
+  unique_ptr<ThreadPool> pool;
+
+  RotateFrame_Impl(uint32_t new_width, uint32_t new_height,
+                   Pixel_Format new_format, const RotateParams &new_params,
+                   uint32_t num_threads)
+      : width(new_width), height(new_height), format(new_format),
+        params(new_params) {
+    // Input frame size is output size of the identity transform;
+    uint32_t src_width = 0U, src_height = 0U;
+    GetRotatedFrameSize(format, width, height, RotateParams(), src_width,
+                        src_height, src_size);
+    GetRotatedFrameSize(format, width, height, params, dst_width, dst_height,
+                        dst_size);
+
+    dst_frame = Buffer::MakeOwnMem(dst_size);
+    if (num_threads > 1U) {
+      pool.reset(new ThreadPool(num_threads));
+    }
+  }
+
+  ~RotateFrame_Impl() { delete dst_frame; }
+};
+} // namespace VPF
+
+RotateFrame *RotateFrame::Make(uint32_t width, uint32_t height,
+                               Pixel_Format format, const RotateParams &params,
+                               uint32_t num_threads) {
+  return new RotateFrame(width, height, format, params, num_threads);
+}
+
+RotateFrame::RotateFrame(uint32_t width, uint32_t height, Pixel_Format format,
+                         const RotateParams &params, uint32_t num_threads)
+    : Task("RotateFrame", RotateFrame::numInputs, RotateFrame::numOutputs) {
+  pImpl = new RotateFrame_Impl(width, height, format, params, num_threads);
+}
+
+RotateFrame::~RotateFrame() { delete pImpl; }
+
+TaskExecStatus RotateFrame::Execute() {
+  ClearOutputs();
+
+  auto pInput = (Buffer *)GetInput(0U);
+  if (!pInput) {
+    return TaskExecStatus::TASK_EXEC_FAIL;
+  }
+
+  if (pInput->GetRawMemSize() < pImpl->src_size) {
+    VPF_LOG(LOG_LEVEL_ERROR, "RotateFrame")
+        << "Input frame is " << pInput->GetRawMemSize() << " bytes, "
+        << pImpl->src_size << " expected";
+    return TaskExecStatus::TASK_EXEC_FAIL;
+  }
+
+  RotateHostFrame(pInput->GetDataAs<uint8_t>(), pImpl->width, pImpl->height,
+                  pImpl->format, pImpl->params,
+                  pImpl->dst_frame->GetDataAs<uint8_t>(), pImpl->pool.get());
+
+  SetOutput(pImpl->dst_frame, 0U);
+  return TaskExecStatus::TASK_EXEC_SUCCESS;
+}
+
+void RotateFrame::GetFrameParams(uint32_t &width, uint32_t &height) const {
+  width = pImpl->dst_width;
+  height = pImpl->dst_height;
+}
@@ -0,0 +1,206 @@
+/*
+ * Copyright 2020 NVIDIA Corporation
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "StreamAnalyzer.hpp"
+#include "FFmpegDemuxer.h"
+#include "Logger.hpp"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+using namespace VPF;
+using namespace std;
+
+namespace {
+struct PacketSample {
+  double time;
+  uint64_t num_bytes;
+};
+
+void CountFrame(FrameType frame_type, uint64_t &num_i, uint64_t &num_p,
+                uint64_t &num_b, uint64_t &num_unknown) {
+  switch (frame_type) {
+  case FRAME_TYPE_I:
+    num_i++;
+    break;
+  case FRAME_TYPE_P:
+    num_p++;
+    break;
+  case FRAME_TYPE_B:
+    num_b++;
+    break;
+  default:
+    num_unknown++;
+    break;
+  }
+}
+} // namespace
+
+namespace VPF {
+struct StreamAnalyzer_Impl {
+  StreamAnalyzerParams params;
+  StreamAnalysis analysis;
+
+  explicit StreamAnalyzer_Impl(const StreamAnalyzerParams &new_params)
+      : params(new_params) {
+    if (params.window_sec <= 0.0 || params.step_sec <= 0.0) {
+      throw invalid_argument("Bitrate window and step must be positive");
+    }
+  }
+
+  void MeasureBitrate(const vector<PacketSample> &samples) {
+    auto const duration = analysis.duration_sec;
+    if (duration <= 0.0) {
+      return;
+    }
+
+    // Tail windows shorter than window_sec are dropped, they're noisy;
+    auto const window = min(params.window_sec, duration);
+    auto const num_windows =
+        (size_t)floor((duration - window) / params.step_sec) + 1U;
+
+    size_t lo = 0U, hi = 0U;
+    uint64_t num_bytes = 0U;
+    for (size_t i = 0U; i < num_windows; i++) {
+      auto const start = i * params.step_sec;
+      while (hi < samples.size() && samples[hi].time < start + window) {
+        num_bytes += samples[hi++].num_bytes;
+      }
+      while (lo < hi && samples[lo].time < start) {
+        num_bytes -= samples[lo++].num_bytes;
+      }
+
+      auto const bitrate = num_bytes * 8.0 / window;
+      analysis.bitrate.push_back(bitrate);
+      analysis.max_bitrate = max(analysis.max_bitrate, bitrate);
+    }
+  }
+
+  uint64_t Run() {
+    analysis = StreamAnalysis();
+    FFmpegDemuxer demuxer(params.input.c_str(), params.demux_options);
+    demuxer.EnableSliceParsing(true);
+
+    auto const frame_rate = demuxer.GetFramerate();
+    auto const frame_sec = (frame_rate > 0.0) ? 1.0 / frame_rate : 0.0;
+    auto const time_base = demuxer.GetTimebase();
+
+    vector<PacketSample> samples;
+    uint8_t *data = nullptr;
+    size_t size = 0U;
+    PacketData pkt_data = {};
+
+    // Timestamps are used if the first packet has them;
+    bool use_timestamps = false;
+    bool has_key_flags = false;
+    double start_time = 0.0, last_time = 0.0, last_duration = frame_sec;
+    uint32_t num_consecutive_b = 0U;
+
+    while (demuxer.Demux(data, size)) {
+      if (!size) {
+        continue;
+      }
+      demuxer.GetLastPacketData(pkt_data);
+
+      auto const ts =
+          (AV_NOPTS_VALUE != pkt_data.dts) ? pkt_data.dts : pkt_data.pts;
+      if (!analysis.num_frames) {
+        use_timestamps = (AV_NOPTS_VALUE != ts);
+        start_time = use_timestamps ? ts * time_base : 0.0;
+      }
+
+      auto time = (use_timestamps && AV_NOPTS_VALUE != ts)
+                      ? ts * time_base - start_time
+                      : analysis.num_frames * frame_sec;
+      // Broken timestamps shouldn't make the curve go back;
+      time = max(time, last_time);
+      last_time = time;
+      last_duration =
+          pkt_data.duration ? pkt_data.duration * time_base : frame_sec;
+      samples.push_back({time, size});
+
+      has_key_flags = has_key_flags || pkt_data.is_keyframe;
+      auto const is_gop_start = analysis.gops.empty() ||
+                                pkt_data.is_keyframe ||
+                                (!has_key_flags && pkt_data.is_idr);
+      if (is_gop_start) {
+        if (!analysis.gops.empty()) {
+          auto &prev = analysis.gops.back();
+          prev.duration_sec = time - samples[prev.first_packet].time;
+        }
+        GopInfo gop;
+        gop.first_packet = analysis.num_frames;
+        gop.is_idr = pkt_data.is_idr;
+        analysis.gops.push_back(gop);
+      }
+
+      auto &gop = analysis.gops.back();
+      gop.num_frames++;
+      gop.num_bytes += size;
+      uint64_t num_i = 0U, num_p = 0U, num_b = 0U, num_unknown = 0U;
+      CountFrame(pkt_data.frame_type, num_i, num_p, num_b, num_unknown);
+      gop.num_i += num_i;
+      gop.num_p += num_p;
+      gop.num_b += num_b;
+
+      analysis.num_frames++;
+      analysis.num_i += num_i;
+      analysis.num_p += num_p;
+      analysis.num_b += num_b;
+      analysis.num_unknown += num_unknown;
+      analysis.num_idr += pkt_data.is_idr ? 1U : 0U;
+      analysis.num_reference += pkt_data.is_reference ? 1U : 0U;
+      analysis.num_bytes += size;
+
+      num_consecutive_b = num_b ? num_consecutive_b + 1U : 0U;
+      analysis.max_consecutive_b =
+          max(analysis.max_consecutive_b, num_consecutive_b);
+    }
+
+    if (!analysis.num_frames) {
+      return 0U;
+    }
+
+    analysis.duration_sec = last_time + last_duration;
+    auto &last_gop = analysis.gops.back();
+    last_gop.duration_sec =
+        analysis.duration_sec - samples[last_gop.first_packet].time;
+
+    if (analysis.duration_sec > 0.0) {
+      analysis.avg_bitrate = analysis.num_bytes * 8.0 / analysis.duration_sec;
+    }
+    MeasureBitrate(samples);
+
+    VPF_LOG(LOG_LEVEL_INFO, "StreamAnalyzer")
+        << params.input << ": " << analysis.num_frames << " frames in "
+        << analysis.gops.size() << " GOPs, " << analysis.num_i << " I, "
+        << analysis.num_p << " P, " << analysis.num_b << " B";
+    return analysis.num_frames;
+  }
+};
+} // namespace VPF
+
+StreamAnalyzer *StreamAnalyzer::Make(const StreamAnalyzerParams &params) {
+  return new StreamAnalyzer(params);
+}
+
+StreamAnalyzer::StreamAnalyzer(const StreamAnalyzerParams &params)
+    : pImpl(new StreamAnalyzer_Impl(params)) {}
+
+StreamAnalyzer::~StreamAnalyzer() { delete pImpl; }
+
+uint64_t StreamAnalyzer::Run() { return pImpl->Run(); }
+
+void StreamAnalyzer::GetAnalysis(StreamAnalysis &analysis) const {
+  analysis = pImpl->analysis;
+}
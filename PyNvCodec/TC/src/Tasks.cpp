@@ -21,6 +21,8 @@
 #include <vector>
 
 #include "CodecsSupport.hpp"
+#include "Logger.hpp"
+#include "MemoryBudget.hpp"
 #include "MemoryInterfaces.hpp"
 #include "NppCommon.hpp"
 #include "Tasks.hpp"
@@ -51,6 +53,14 @@ struct NvencEncodeFrame_Impl {
   NV_ENC_BUFFER_FORMAT enc_buffer_format;
   queue<packet> packetQueue;
   vector<uint8_t> lastPacket;
+
+  /* Queued packets are accounted in MemoryBudget; They are neither dropped,
+   * since that breaks the stream, nor waited for, since only this task
+   * drains the queue, so budget is overcommitted if need be;
+   */
+  MemoryBudget &budget;
+  uint64_t queuedBytes = 0U;
+  static const char *budgetName;
   Buffer *pElementaryVideo;
   NvEncoderCuda *pEncoderCuda = nullptr;
   CUcontext context = nullptr;
@@ -69,7 +79,8 @@ struct NvencEncodeFrame_Impl {
                         NvEncoderClInterface &cli_iface, CUcontext ctx,
                         CUstream str, int32_t width, int32_t height,
                         bool verbose)
-      : init_params(recfg_params.reInitEncodeParams) {
+      : init_params(recfg_params.reInitEncodeParams),
+        budget(MemoryBudget::Instance()) {
     pElementaryVideo = Buffer::Make(0U);
 
     context = ctx;
@@ -99,12 +110,27 @@ struct NvencEncodeFrame_Impl {
     return pEncoderCuda->Reconfigure(&recfg_params);
   }
 
+  void PushPacket(packet &pkt) {
+    budget.Overcommit(budgetName, pkt.size());
+    queuedBytes += pkt.size();
+    packetQueue.push(move(pkt));
+  }
+
+  void PopPacket() {
+    budget.Release(budgetName, packetQueue.front().size());
+    queuedBytes -= packetQueue.front().size();
+    packetQueue.pop();
+  }
+
   ~NvencEncodeFrame_Impl() {
+    budget.Release(budgetName, queuedBytes);
     pEncoderCuda->DestroyEncoder();
     delete pEncoderCuda;
     delete pElementaryVideo;
   }
 };
+
+const char *NvencEncodeFrame_Impl::budgetName = "NvencEncodeFrame";
 } // namespace VPF
 
 NvencEncodeFrame *NvencEncodeFrame::Make(CUstream cuStream, CUcontext cuContext,
@@ -200,7 +226,7 @@ TaskExecStatus NvencEncodeFrame::Execute() {
     /* Push encoded packets into queue;
      */
     for (auto &packet : encPackets) {
-      pImpl->packetQueue.push(packet);
+      pImpl->PushPacket(packet);
     }
 
     /* Then return least recent packet;
@@ -210,13 +236,13 @@ TaskExecStatus NvencEncodeFrame::Execute() {
       pImpl->lastPacket = pImpl->packetQueue.front();
       pImpl->pElementaryVideo->Update(pImpl->lastPacket.size(),
                                       (void *)pImpl->lastPacket.data());
-      pImpl->packetQueue.pop();
+      pImpl->PopPacket();
       SetOutput(pImpl->pElementaryVideo, 0U);
     }
 
     return TASK_EXEC_SUCCESS;
   } catch (exception &e) {
-    cerr << e.what() << endl;
+    VPF_LOG(LOG_LEVEL_ERROR, "NvencEncodeFrame") << e.what();
     return TASK_EXEC_FAIL;
   }
 }
@@ -225,22 +251,66 @@ namespace VPF {
 struct NvdecDecodeFrame_Impl {
   NvDecoder nvDecoder;
   Surface *pLastSurface = nullptr;
+  Pixel_Format format;
   CUstream stream = 0;
   CUcontext context = nullptr;
   bool didDecode = false;
 
+  /* Parser timestamp carries packet sequence number, so that packet data
+   * survives reordering and packets which hold several frames;
+   */
+  Buffer *pPacketData = nullptr;
+  map<int64_t, PacketData> inFlight;
+  int64_t numPackets = 0;
+  static const size_t maxInFlight = 64U;
+
   NvdecDecodeFrame_Impl() = delete;
   NvdecDecodeFrame_Impl(const NvdecDecodeFrame_Impl &other) = delete;
   NvdecDecodeFrame_Impl &operator=(const NvdecDecodeFrame_Impl &other) = delete;
 
   NvdecDecodeFrame_Impl(CUstream cuStream, CUcontext cuContext,
                         cudaVideoCodec videoCodec, Pixel_Format format)
-      : stream(cuStream), context(cuContext),
+      : format(format), stream(cuStream), context(cuContext),
         nvDecoder(cuStream, cuContext, videoCodec) {
     pLastSurface = Surface::Make(format);
+    pPacketData = Buffer::MakeOwnMem(sizeof(PacketData));
+  }
+
+  static PacketData NoPacketData() {
+    PacketData pkt_data = {};
+    pkt_data.pts = AV_NOPTS_VALUE;
+    pkt_data.dts = AV_NOPTS_VALUE;
+    return pkt_data;
   }
 
-  ~NvdecDecodeFrame_Impl() { delete pLastSurface; }
+  int64_t PushPacketData(Buffer *pInput) {
+    auto const seq = numPackets++;
+    if (pInput && pInput->GetRawMemSize() >= sizeof(PacketData)) {
+      inFlight[seq] = *pInput->GetDataAs<PacketData>();
+    } else {
+      inFlight[seq] = NoPacketData();
+    }
+
+    // Packets which produced no frame (e. g. dropped) are forgotten;
+    while (inFlight.size() > maxInFlight) {
+      inFlight.erase(inFlight.begin());
+    }
+    return seq;
+  }
+
+  /* Entry isn't erased on lookup because packet may hold several frames,
+   * e. g. two fields;
+   */
+  void PopPacketData(int64_t seq) {
+    auto *pOut = pPacketData->GetDataAs<PacketData>();
+    auto it = inFlight.find(seq);
+    *pOut = (it != inFlight.end()) ? it->second : NoPacketData();
+  }
+
+  ~NvdecDecodeFrame_Impl() {
+    delete pLastSurface;
+    delete pPacketData;
+  }
 };
 } // namespace VPF
 
@@ -277,7 +347,8 @@ TaskExecStatus NvdecDecodeFrame::Execute() {
   ClearOutputs();
 
   auto &decoder = pImpl->nvDecoder;
-  auto pElementaryVideoStream = (Buffer *)GetInput();
+  auto pElementaryVideoStream = (Buffer *)GetInput(0U);
+  auto pInPacketData = (Buffer *)GetInput(1U);
 
   uint8_t *pVideo = nullptr;
   size_t nVideoBytes = 0U;
@@ -294,8 +365,11 @@ TaskExecStatus NvdecDecodeFrame::Execute() {
 
   CUdeviceptr surface = 0U;
   bool isSurfaceReturned = false;
+  int64_t seq = pVideo ? pImpl->PushPacketData(pInPacketData) : 0;
+  int64_t surfaceSeq = 0;
   auto res = decoder.DecodeLockSurface(pVideo, nVideoBytes, surface,
-                                       isSurfaceReturned);
+                                       isSurfaceReturned, 0U, seq,
+                                       &surfaceSeq);
   pImpl->didDecode = true;
   if (!res) {
     return TASK_EXEC_FAIL;
@@ -312,12 +386,30 @@ TaskExecStatus NvdecDecodeFrame::Execute() {
     SurfacePlane tmpPlane(rawW, rawH, rawP, sizeof(uint8_t), surface);
     pImpl->pLastSurface->Update(&tmpPlane, 1);
     SetOutput(pImpl->pLastSurface, 0U);
+
+    pImpl->PopPacketData(surfaceSeq);
+    SetOutput(pImpl->pPacketData, 1U);
     return TASK_EXEC_SUCCESS;
   }
 
   return (nVideoBytes == 0) ? TASK_EXEC_FAIL : TASK_EXEC_SUCCESS;
 }
 
+bool NvdecDecodeFrame::Reset() {
+  ClearInputs();
+  ClearOutputs();
+
+  // Empty surface, so that stale pointer isn't unlocked twice;
+  auto lastSurface = pImpl->pLastSurface->PlanePtr();
+  pImpl->nvDecoder.UnlockSurface(lastSurface);
+  delete pImpl->pLastSurface;
+  pImpl->pLastSurface = Surface::Make(pImpl->format);
+
+  pImpl->didDecode = false;
+  pImpl->inFlight.clear();
+  return pImpl->nvDecoder.Reset();
+}
+
 void NvdecDecodeFrame::GetDecodedFrameParams(uint32_t &width, uint32_t &height,
                                              uint32_t &elem_size) {
   width = pImpl->nvDecoder.GetWidth();
@@ -557,14 +649,8 @@ struct DemuxFrame_Impl {
 };
 } // namespace VPF
 
-DemuxFrame *DemuxFrame::Make(const char *url, const char **ffmpeg_options,
-                             uint32_t opts_size) {
-  return new DemuxFrame(url, ffmpeg_options, opts_size);
-}
-
-DemuxFrame::DemuxFrame(const char *url, const char **ffmpeg_options,
-                       uint32_t opts_size)
-    : Task("DemuxFrame", DemuxFrame::numInputs, DemuxFrame::numOutputs) {
+static map<string, string> OptionsToMap(const char **ffmpeg_options,
+                                        uint32_t opts_size) {
   map<string, string> options;
   if (0 == opts_size % 2) {
     for (auto i = 0; i < opts_size;) {
@@ -576,7 +662,18 @@ DemuxFrame::DemuxFrame(const char *url, const char **ffmpeg_options,
       options.insert(pair<string, string>(key, value));
     }
   }
-  pImpl = new DemuxFrame_Impl(url, options);
+  return options;
+}
+
+DemuxFrame *DemuxFrame::Make(const char *url, const char **ffmpeg_options,
+                             uint32_t opts_size) {
+  return new DemuxFrame(url, ffmpeg_options, opts_size);
+}
+
+DemuxFrame::DemuxFrame(const char *url, const char **ffmpeg_options,
+                       uint32_t opts_size)
+    : Task("DemuxFrame", DemuxFrame::numInputs, DemuxFrame::numOutputs) {
+  pImpl = new DemuxFrame_Impl(url, OptionsToMap(ffmpeg_options, opts_size));
 }
 
 DemuxFrame::~DemuxFrame() { delete pImpl; }
@@ -616,6 +713,31 @@ TaskExecStatus DemuxFrame::Execute() {
   return TASK_EXEC_SUCCESS;
 }
 
+bool DemuxFrame::GetKeyframeIndex(vector<KeyframeIndexEntry> &index,
+                                  uint64_t &num_packets) {
+  return pImpl->demuxer.GetKeyframeIndex(index, num_packets);
+}
+
+bool DemuxFrame::Seek(const KeyframeIndexEntry &keyframe) {
+  return pImpl->demuxer.Seek(keyframe);
+}
+
+bool DemuxFrame::Reopen(const char *url, const char **ffmpeg_options,
+                        uint32_t opts_size) {
+  ClearInputs();
+  ClearOutputs();
+  pImpl->videoBytes = 0U;
+  return pImpl->demuxer.Reopen(url, OptionsToMap(ffmpeg_options, opts_size));
+}
+
+bool DemuxFrame::GetStreamInfo(VideoStreamInfo &info) const {
+  return pImpl->demuxer.GetStreamInfo(info);
+}
+
+void DemuxFrame::EnableSliceParsing(bool enable) {
+  pImpl->demuxer.EnableSliceParsing(enable);
+}
+
 void DemuxFrame::GetParams(MuxingParams &params) const {
   params.videoContext.width = pImpl->demuxer.GetWidth();
   params.videoContext.height = pImpl->demuxer.GetHeight();
@@ -623,6 +745,7 @@ void DemuxFrame::GetParams(MuxingParams &params) const {
   params.videoContext.timeBase = pImpl->demuxer.GetTimebase();
   params.videoContext.streamIndex = pImpl->demuxer.GetVideoStreamIndex();
   params.videoContext.codec = FFmpeg2NvCodecId(pImpl->demuxer.GetVideoCodec());
+  params.videoContext.rotation = pImpl->demuxer.GetRotation();
 
   switch (pImpl->demuxer.GetPixelFormat()) {
   case AV_PIX_FMT_YUVJ420P:
@@ -643,11 +766,39 @@ void DemuxFrame::GetParams(MuxingParams &params) const {
   }
 }
 
+static int WriteAsyncFile(void *opaque, uint8_t *buf, int buf_size) {
+  auto file = (AsyncFile *)opaque;
+  return file->Write(buf, buf_size) ? buf_size : AVERROR(EIO);
+}
+
+static int64_t SeekAsyncFile(void *opaque, int64_t offset, int whence) {
+  auto file = (AsyncFile *)opaque;
+  switch (whence & ~AVSEEK_FORCE) {
+  case AVSEEK_SIZE:
+    return file->GetSize();
+  case SEEK_SET:
+    break;
+  case SEEK_CUR:
+    offset += file->Tell();
+    break;
+  case SEEK_END:
+    offset += file->GetSize();
+    break;
+  default:
+    return AVERROR(EINVAL);
+  }
+  return file->Seek(offset) ? offset : AVERROR(EIO);
+}
+
 namespace VPF {
 struct MuxFrame_Impl {
   AVFormatContext *outFmtCtx = nullptr;
   AVStream *videoStream = nullptr;
+  // Set if output goes through AsyncWriter;
+  unique_ptr<AsyncFile> asyncFile;
   map<uint32_t, uint32_t> streamMapping;
+  // Time base of incoming packets timestamps, muxer may change stream one;
+  AVRational frameTimeBase;
 
   MuxFrame_Impl() = delete;
   MuxFrame_Impl(const MuxFrame_Impl &other) = delete;
@@ -668,7 +819,8 @@ private:
     }
 
     videoStream->index = videoCtx.streamIndex;
-    videoStream->time_base = av_make_q(1, videoCtx.frameRate);
+    frameTimeBase = av_inv_q(av_d2q(videoCtx.frameRate, 1 << 16));
+    videoStream->time_base = frameTimeBase;
 
     AVCodecParameters *videoCodecParams = videoStream->codecpar;
     videoCodecParams->codec_type = AVMEDIA_TYPE_VIDEO;
@@ -693,7 +845,8 @@ private:
   }
 
 public:
-  MuxFrame_Impl(MuxingParams &params, const char *url) {
+  MuxFrame_Impl(MuxingParams &params, const char *url,
+                shared_ptr<AsyncWriter> writer) {
     auto ret =
         avformat_alloc_output_context2(&outFmtCtx, nullptr, nullptr, url);
     if (ret < 0) {
@@ -705,10 +858,15 @@ public:
 
     SetupVideoStream(params);
     streamMapping[videoStream->index] = outFmtCtx->nb_streams - 1;
-    cout << "Video steam mapping: " << videoStream->index << "->"
-         << streamMapping[videoStream->index] << endl;
+    VPF_LOG(LOG_LEVEL_DEBUG, "MuxFrame")
+        << "Video steam mapping: " << videoStream->index << "->"
+        << streamMapping[videoStream->index];
 
-    ret = avio_open(&outFmtCtx->pb, url, AVIO_FLAG_WRITE);
+    if (writer) {
+      ret = OpenAsyncOutput(url, writer);
+    } else {
+      ret = avio_open(&outFmtCtx->pb, url, AVIO_FLAG_WRITE);
+    }
     if (ret < 0) {
       stringstream ss;
       ss << __FUNCTION__ << ": can't open output URL. Error code " << ret
@@ -727,17 +885,54 @@ public:
 
   ~MuxFrame_Impl() {
     av_write_trailer(outFmtCtx);
-    if (outFmtCtx && !(outFmtCtx->oformat->flags & AVFMT_NOFILE))
+    if (asyncFile) {
+      avio_flush(outFmtCtx->pb);
+      if (!asyncFile->Close()) {
+        VPF_LOG(LOG_LEVEL_ERROR, "MuxFrame") << "Failed to write output";
+      }
+      av_freep(&outFmtCtx->pb->buffer);
+      av_freep(&outFmtCtx->pb);
+    } else if (outFmtCtx && !(outFmtCtx->oformat->flags & AVFMT_NOFILE))
       avio_closep(&outFmtCtx->pb);
     avformat_free_context(outFmtCtx);
   }
+
+private:
+  int OpenAsyncOutput(const char *url, shared_ptr<AsyncWriter> writer) {
+    try {
+      asyncFile.reset(AsyncFile::Make(writer, url));
+    } catch (exception &e) {
+      VPF_LOG(LOG_LEVEL_ERROR, "MuxFrame") << e.what();
+      return AVERROR(EIO);
+    }
+
+    // Small one is enough, AsyncFile gathers data into big buffers anyway;
+    const int avioc_buffer_size = 64 * 1024;
+    auto avioc_buffer = (uint8_t *)av_malloc(avioc_buffer_size);
+    if (!avioc_buffer) {
+      return AVERROR(ENOMEM);
+    }
+
+    outFmtCtx->pb =
+        avio_alloc_context(avioc_buffer, avioc_buffer_size, 1, asyncFile.get(),
+                           nullptr, WriteAsyncFile, SeekAsyncFile);
+    if (!outFmtCtx->pb) {
+      av_freep(&avioc_buffer);
+      return AVERROR(ENOMEM);
+    }
+    outFmtCtx->flags |= AVFMT_FLAG_CUSTOM_IO;
+    return 0;
+  }
 };
 } // namespace VPF
 
-MuxFrame *MuxFrame::Make(const char *url) { return new MuxFrame(url); }
+MuxFrame *MuxFrame::Make(const char *url, shared_ptr<AsyncWriter> writer) {
+  return new MuxFrame(url, writer);
+}
 
-MuxFrame::MuxFrame(const char *url)
-    : Task("MuxFrame", MuxFrame::numInputs, MuxFrame::numOutputs) {
+MuxFrame::MuxFrame(const char *url, shared_ptr<AsyncWriter> new_writer)
+    : Task("MuxFrame", MuxFrame::numInputs, MuxFrame::numOutputs),
+      writer(new_writer) {
   output = (char *)calloc(strlen(url) + 1, sizeof(char));
   strcpy(output, url);
 }
@@ -762,7 +957,7 @@ TaskExecStatus MuxFrame::Execute() {
 
   auto muxingParams = muxingParamsBuffer->GetDataAs<MuxingParams>();
   if (!pImpl) {
-    pImpl = new MuxFrame_Impl(*muxingParams, output);
+    pImpl = new MuxFrame_Impl(*muxingParams, output, writer);
   }
 
   auto FindMappedStreamIndex = [&](map<uint32_t, uint32_t> &map,
@@ -791,8 +986,11 @@ TaskExecStatus MuxFrame::Execute() {
     pkt.data = (uint8_t *)elementaryData.GetRawMemPtr();
     pkt.stream_index = FindMappedStreamIndex(streamMapping, nativeStreamIndex);
 
-    auto timeBase = stream->time_base;
     auto &packetData = muxParams.videoContext.packetData;
+    pkt.pts = packetData.pts;
+    pkt.dts = packetData.dts;
+    pkt.duration = packetData.duration ? packetData.duration : 1;
+    av_packet_rescale_ts(&pkt, pImpl->frameTimeBase, stream->time_base);
     pkt.pos = -1;
 
     auto ret = av_interleaved_write_frame(outFmtCtx, &pkt);
@@ -813,7 +1011,7 @@ TaskExecStatus MuxFrame::Execute() {
       return TASK_EXEC_FAIL;
     }
   } catch (exception &e) {
-    cerr << e.what() << endl;
+    VPF_LOG(LOG_LEVEL_ERROR, "MuxFrame") << e.what();
     return TASK_EXEC_FAIL;
   }
 
@@ -881,8 +1079,8 @@ struct NppResizeSurfacePacked3C_Impl final : ResizeSurface_Impl {
                                      pDst, nDstStep, oDstSize, oDstRectROI,
                                      eInterpolation, nppCtx);
     if (NPP_NO_ERROR != ret) {
-      cerr << "Can't resize 3-channel packed image. Error code: " << ret
-           << endl;
+      VPF_LOG(LOG_LEVEL_ERROR, "ResizeSurface")
+          << "Can't resize 3-channel packed image. Error code: " << ret;
       return TASK_EXEC_FAIL;
     }
 
@@ -906,8 +1104,9 @@ struct NppResizeSurfacePlanar420_Impl final : ResizeSurface_Impl {
   TaskExecStatus Execute(Surface &source) {
 
     if (pSurface->PixelFormat() != source.PixelFormat()) {
-      cerr << "Actual pixel format is " << source.PixelFormat() << endl;
-      cerr << "Expected input format is " << pSurface->PixelFormat() << endl;
+      VPF_LOG(LOG_LEVEL_ERROR, "ResizeSurface")
+          << "Actual pixel format is " << source.PixelFormat()
+          << ", expected input format is " << pSurface->PixelFormat();
       return TaskExecStatus::TASK_EXEC_FAIL;
     }
 
@@ -940,7 +1139,8 @@ struct NppResizeSurfacePlanar420_Impl final : ResizeSurface_Impl {
                                        pDst, nDstStep, oDstSize, oDstRectROI,
                                        eInterpolation, nppCtx);
       if (NPP_NO_ERROR != ret) {
-        cerr << "NPP error with code " << ret << endl;
+        VPF_LOG(LOG_LEVEL_ERROR, "ResizeSurface")
+            << "NPP error with code " << ret;
         return TASK_EXEC_FAIL;
       }
     }
@@ -12,6 +12,7 @@
  */
 
 #include "CodecsSupport.hpp"
+#include "Logger.hpp"
 #include "MemoryInterfaces.hpp"
 #include "NppCommon.hpp"
 #include "Tasks.hpp"
@@ -66,7 +67,8 @@ struct nv12_bgr final : public NppConvertSurface_Impl {
     auto err = nppiNV12ToBGR_8u_P2C3R_Ctx(
         pSrc, pInput->Pitch(), pDst, pSurface->Pitch(), oSizeRoi, nppCtx);
     if (NPP_NO_ERROR != err) {
-      cerr << "Failed to convert surface. Error code: " << err << endl;
+      VPF_LOG(LOG_LEVEL_ERROR, "ConvertSurface")
+          << "Failed to convert surface. Error code: " << err;
       return nullptr;
     }
 
@@ -101,7 +103,8 @@ struct nv12_rgb final : public NppConvertSurface_Impl {
     auto err = nppiNV12ToRGB_709HDTV_8u_P2C3R_Ctx(
         pSrc, pInput->Pitch(), pDst, pSurface->Pitch(), oSizeRoi, nppCtx);
     if (NPP_NO_ERROR != err) {
-      cerr << "Failed to convert surface. Error code: " << err << endl;
+      VPF_LOG(LOG_LEVEL_ERROR, "ConvertSurface")
+          << "Failed to convert surface. Error code: " << err;
       return nullptr;
     }
 
@@ -143,7 +146,8 @@ struct nv12_yuv420 final : public NppConvertSurface_Impl {
                                          pSrc[1], pInput_NV12->Pitch(1U), pDst,
                                          dstStep, roi, nppCtx);
     if (NPP_NO_ERROR != err) {
-      cerr << "Failed to convert surface. Error code: " << err << endl;
+      VPF_LOG(LOG_LEVEL_ERROR, "ConvertSurface")
+          << "Failed to convert surface. Error code: " << err;
       return nullptr;
     }
 
@@ -182,7 +186,8 @@ struct yuv420_rgb final : public NppConvertSurface_Impl {
     auto err =
         nppiYUV420ToRGB_8u_P3C3R_Ctx(pSrc, srcStep, pDst, dstStep, roi, nppCtx);
     if (NPP_NO_ERROR != err) {
-      cerr << "Failed to convert surface. Error code: " << err << endl;
+      VPF_LOG(LOG_LEVEL_ERROR, "ConvertSurface")
+          << "Failed to convert surface. Error code: " << err;
       return nullptr;
     }
 
@@ -205,12 +210,12 @@ struct bgr_ycbcr final : public NppConvertSurface_Impl {
     auto pInputBGR = (SurfaceRGB *)pInput;
 
     if (BGR != pInputBGR->PixelFormat()) {
-      cerr << "Input surface isn't BGR" << endl;
+      VPF_LOG(LOG_LEVEL_ERROR, "ConvertSurface") << "Input surface isn't BGR";
       return nullptr;
     }
 
     if (YCBCR != pSurface->PixelFormat()) {
-      cerr << "Output surface isn't YCbCr" << endl;
+      VPF_LOG(LOG_LEVEL_ERROR, "ConvertSurface") << "Output surface isn't YCbCr";
       return nullptr;
     }
 
@@ -228,7 +233,8 @@ struct bgr_ycbcr final : public NppConvertSurface_Impl {
     auto err = nppiBGRToYCbCr420_8u_C3P3R_Ctx(pSrc, srcStep, pDst, dstStep, roi,
                                               nppCtx);
     if (NPP_NO_ERROR != err) {
-      cerr << "Failed to convert surface. Error code: " << err << endl;
+      VPF_LOG(LOG_LEVEL_ERROR, "ConvertSurface")
+          << "Failed to convert surface. Error code: " << err;
       return nullptr;
     }
 
@@ -268,7 +274,8 @@ struct rgb_yuv420 final : public NppConvertSurface_Impl {
     auto err =
         nppiRGBToYUV420_8u_C3P3R_Ctx(pSrc, srcStep, pDst, dstStep, roi, nppCtx);
     if (NPP_NO_ERROR != err) {
-      cerr << "Failed to convert surface. Error code: " << err << endl;
+      VPF_LOG(LOG_LEVEL_ERROR, "ConvertSurface")
+          << "Failed to convert surface. Error code: " << err;
       return nullptr;
     }
 
@@ -311,7 +318,8 @@ struct yuv420_nv12 final : public NppConvertSurface_Impl {
     auto err = nppiYCbCr420_8u_P3P2R_Ctx(pSrc, srcStep, pDst[0], dstStep[0],
                                          pDst[1], dstStep[1], roi, nppCtx);
     if (NPP_NO_ERROR != err) {
-      cerr << "Failed to convert surface. Error code: " << err << endl;
+      VPF_LOG(LOG_LEVEL_ERROR, "ConvertSurface")
+          << "Failed to convert surface. Error code: " << err;
       return nullptr;
     }
 
@@ -354,7 +362,8 @@ struct rgb8_deinterleave final : public NppConvertSurface_Impl {
     auto err =
         nppiCopy_8u_C3P3R_Ctx(pSrc, nSrcStep, aDst, nDstStep, oSizeRoi, nppCtx);
     if (NPP_NO_ERROR != err) {
-      cerr << "Failed to convert surface. Error code: " << err << endl;
+      VPF_LOG(LOG_LEVEL_ERROR, "ConvertSurface")
+          << "Failed to convert surface. Error code: " << err;
       return nullptr;
     }
 
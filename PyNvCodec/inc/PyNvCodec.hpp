@@ -13,8 +13,20 @@
 
 #pragma once
 
+#include "ActivitySampler.hpp"
+#include "ClipLoader.hpp"
+#include "DecoderPool.hpp"
+#include "FrameCache.hpp"
+#include "ImageDecoder.hpp"
+#include "ImageWriter.hpp"
+#include "MemoryBudget.hpp"
 #include "MemoryInterfaces.hpp"
+#include "Numa.hpp"
 #include "NvCodecCLIOptions.h"
+#include "Logger.hpp"
+#include "ProbeService.hpp"
+#include "RawVideo.hpp"
+#include "StreamAnalyzer.hpp"
 #include "TC_CORE.hpp"
 #include "Tasks.hpp"
 
@@ -123,6 +135,218 @@ public:
   Pixel_Format Format() const;
 
   cudaVideoCodec Codec() const;
+
+  // Clockwise rotation in degrees display matrix asks for;
+  int Rotation() const;
+
+  void LastPacketData(PacketData &packetData) const;
+
+  void EnableSliceParsing(bool enable);
+
+  // Returns None if stream has no H.264 / HEVC parameter sets;
+  py::object StreamInfo() const;
+};
+
+class PyProbeService {
+  std::unique_ptr<ProbeService> upService;
+
+public:
+  PyProbeService(const std::string &db_path, uint32_t num_threads,
+                 bool scan_gop);
+
+  ProbeStats Probe(const std::vector<std::string> &paths);
+
+  std::vector<MediaInfo> Query(const std::vector<std::string> &paths) const;
+
+  std::vector<MediaInfo> QueryAll() const;
+
+  size_t Size() const;
+};
+
+/* Tells how many times frame goes to output of given frame rate;
+ * Decision is made by packet data only, so it's cheap to call before
+ * conversion, resize or download;
+ */
+class PyFrameRateConverter {
+  std::unique_ptr<FrameRateConverter> upConverter;
+
+public:
+  PyFrameRateConverter(double target_fps, double time_base,
+                       FrameRateMode mode, bool packet_level, double src_fps);
+
+  uint32_t Select(const PacketData &pkt_data);
+
+  void Reset();
+};
+
+/* Rotates and downscales host frames given as numpy arrays; Writes
+ * straight to destination array, which is resized if needed;
+ */
+class PyFrameRotator {
+  uint32_t width;
+  uint32_t height;
+  Pixel_Format format;
+  RotateParams params;
+  std::unique_ptr<ThreadPool> upPool;
+
+public:
+  PyFrameRotator(uint32_t width, uint32_t height, Pixel_Format format,
+                 const RotateParams &params, uint32_t num_threads);
+
+  bool Execute(const py::array_t<uint8_t> &src, py::array_t<uint8_t> &dst);
+
+  uint32_t Width() const;
+  uint32_t Height() const;
+};
+
+class PyRawVideoReader {
+  std::unique_ptr<RawVideoReader> upReader;
+
+public:
+  PyRawVideoReader(const std::string &path, uint32_t width, uint32_t height,
+                   Pixel_Format format);
+
+  uint32_t Width() const;
+  uint32_t Height() const;
+  Pixel_Format Format() const;
+  double Framerate() const;
+  uint64_t NumFrames() const;
+  uint64_t FrameIndex() const;
+  bool Seek(uint64_t frame_index);
+
+  // Copies next frame to numpy array;
+  bool ReadSingleFrame(py::array_t<uint8_t> &frame);
+
+  /* View of mapped frame, no pixels are copied; It keeps reader alive;
+   */
+  static py::array_t<uint8_t> Frame(py::object self, uint64_t frame_index);
+};
+
+class PyRawVideoWriter {
+  std::unique_ptr<RawVideoWriter> upWriter;
+
+public:
+  PyRawVideoWriter(const std::string &path, uint32_t width, uint32_t height,
+                   Pixel_Format format, double frame_rate, bool y4m);
+
+  bool WriteSingleFrame(const py::array_t<uint8_t> &frame);
+  bool Flush();
+  uint64_t NumFrames() const;
+};
+
+class PyAsyncFileSink {
+  std::unique_ptr<AsyncFileSink> upSink;
+
+public:
+  PyAsyncFileSink(const std::string &path, bool direct);
+
+  bool Write(const py::array_t<uint8_t> &data);
+  bool Flush();
+  uint64_t NumBytes() const;
+};
+
+class PyImageWriter {
+  std::unique_ptr<ImageWriter> upWriter;
+
+public:
+  PyImageWriter(const std::string &path_template, uint32_t width,
+                uint32_t height, Pixel_Format format,
+                const ImageWriterParams &params);
+
+  bool WriteSingleFrame(const py::array_t<uint8_t> &frame);
+  bool Flush();
+  uint64_t NumImages() const;
+  uint64_t NumFailed() const;
+  uint64_t NumDropped() const;
+};
+
+class PyFrameCache {
+  std::unique_ptr<FrameCache> upCache;
+
+public:
+  PyFrameCache(const std::string &dir, uint64_t budget);
+
+  std::string EntryPath(const std::string &source, uint32_t width,
+                        uint32_t height, Pixel_Format format) const;
+  bool Lookup(const std::string &source, uint32_t width, uint32_t height,
+              Pixel_Format format);
+  uint64_t Evict(uint64_t reserve);
+  uint64_t Size() const;
+};
+
+class PyFrameCacheWriter {
+  std::unique_ptr<FrameCacheWriter> upWriter;
+
+public:
+  PyFrameCacheWriter(const std::string &path, uint32_t width,
+                     uint32_t height, Pixel_Format format, bool compress);
+
+  bool WriteSingleFrame(const py::array_t<uint8_t> &frame);
+  bool WriteSingleFrame(const py::array_t<uint8_t> &frame,
+                        const PacketData &pkt_data);
+  bool Close();
+  uint64_t NumFrames() const;
+  uint64_t NumCompressed() const;
+};
+
+/* Reads cache entry the same way decoders are used;
+ */
+class PyFrameCacheReader {
+  std::unique_ptr<FrameCacheReader> upReader;
+
+public:
+  PyFrameCacheReader(const std::string &path);
+
+  uint32_t Width() const;
+  uint32_t Height() const;
+  Pixel_Format Format() const;
+  uint64_t NumFrames() const;
+  uint64_t FrameIndex() const;
+  bool Seek(uint64_t frame_index);
+  bool SeekToPts(int64_t pts);
+
+  bool DecodeSingleFrame(py::array_t<uint8_t> &frame);
+  bool DecodeSingleFrame(py::array_t<uint8_t> &frame, PacketData &pkt_data);
+
+  /* View of mapped frame if it's stored raw, copy otherwise; View keeps
+   * reader alive;
+   */
+  static py::array_t<uint8_t> Frame(py::object self, uint64_t frame_index);
+};
+
+class PyClipLoader {
+  std::unique_ptr<ClipLoader> upLoader;
+
+public:
+  PyClipLoader(const std::vector<std::string> &files, const ClipSpec &spec,
+               const ClipLoaderParams &params);
+
+  void StartEpoch(uint32_t epoch);
+
+  /* Returns tuple of batch array and list of (file index, start time,
+   * decoded) tuples, or None at the end of epoch;
+   */
+  py::object Next();
+
+  uint32_t NumFiles() const;
+  uint64_t NumClips() const;
+  uint64_t NumBatches() const;
+};
+
+class PyImageDecoder {
+  std::unique_ptr<ImageDecoder> upDecoder;
+
+  py::tuple Decode(const std::vector<ImageSource> &sources, bool as_list);
+
+public:
+  PyImageDecoder(uint32_t width, uint32_t height, Pixel_Format format,
+                 uint32_t num_threads, const ThreadPlacement &placement);
+
+  /* Both return tuple of batch and list of flags which tell which images
+   * were decoded; Batch is single array or list of per-image views into it;
+   */
+  py::tuple DecodeFiles(const std::vector<std::string> &paths, bool as_list);
+  py::tuple DecodeBlobs(const py::list &blobs, bool as_list);
 };
 
 class PyFfmpegDecoder {
@@ -132,16 +356,34 @@ class PyFfmpegDecoder {
 
 public:
   PyFfmpegDecoder(const std::string &pathToFile,
-                  const std::map<std::string, std::string> &ffmpeg_options);
+                  const std::map<std::string, std::string> &ffmpeg_options,
+                  const FrameCopyParams &copy_params = FrameCopyParams());
+
+  uint32_t Width() const;
+  uint32_t Height() const;
 
   bool DecodeSingleFrame(py::array_t<uint8_t> &frame);
 
+  /* Also gives timestamps, duration and type of decoded frame;
+   */
+  bool DecodeSingleFrame(py::array_t<uint8_t> &frame, PacketData &pkt_data);
+
   py::array_t<MotionVector> GetMotionVectors();
+
+  void SetErrorResilience(bool enable, uint32_t max_errors);
+  DecodeErrorStats GetErrorStats() const;
 };
 
 class PyNvDecoder {
-  std::unique_ptr<DemuxFrame> upDemuxer;
+  /* Demuxer and decoder are taken from GPU decoder pool when decoding from
+   * file and given back on destruction, so decoder of next file doesn't
+   * have to be created from scratch; Decoder is owned by this class in
+   * packet mode;
+   */
+  DecodeSession *pSession = nullptr;
   std::unique_ptr<NvdecDecodeFrame> upDecoder;
+  DemuxFrame *pDemuxer = nullptr;
+  NvdecDecodeFrame *pDecoder = nullptr;
   std::unique_ptr<PySurfaceDownloader> upDownloader;
   uint32_t gpuID;
   static uint32_t const poolFrameSize = 4U;
@@ -156,6 +398,8 @@ public:
   PyNvDecoder(const std::string &pathToFile, int gpuOrdinal,
               const std::map<std::string, std::string> &ffmpeg_options);
 
+  ~PyNvDecoder();
+
   static Buffer *getElementaryVideo(DemuxFrame *demuxer, bool needSEI);
 
   static Surface *getDecodedSurface(NvdecDecodeFrame *decoder,
@@ -202,10 +446,33 @@ public:
 
   std::shared_ptr<Surface> FlushSingleSurface();
 
+  /* Overloads below give packet data of decoded surface, which is taken
+   * from packet it was decoded from, so timestamps are correct despite
+   * frames reordering; In packet mode, enc_pkt_data is packet data of
+   * given packet, e. g. obtained from PyFFmpegDemuxer;
+   */
+  std::shared_ptr<Surface> DecodeSingleSurface(PacketData &pkt_data);
+
+  std::shared_ptr<Surface>
+  DecodeSurfaceFromPacket(const PacketData &enc_pkt_data,
+                          py::array_t<uint8_t> &packet, PacketData &pkt_data);
+
+  std::shared_ptr<Surface> FlushSingleSurface(PacketData &pkt_data);
+
+  bool DecodeSingleFrame(py::array_t<uint8_t> &frame, PacketData &pkt_data);
+
+  bool DecodeFrameFromPacket(py::array_t<uint8_t> &frame,
+                             const PacketData &enc_pkt_data,
+                             py::array_t<uint8_t> &packet,
+                             PacketData &pkt_data);
+
+  bool FlushSingleFrame(py::array_t<uint8_t> &frame, PacketData &pkt_data);
+
 private:
   bool DecodeSurface(struct DecodeContext &ctx);
 
   Surface *getDecodedSurfaceFromPacket(py::array_t<uint8_t> *pPacket,
+                                       const PacketData *pPktData,
                                        bool &hw_decoder_failure);
 };
 
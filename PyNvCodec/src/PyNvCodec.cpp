@@ -67,6 +67,7 @@ class CudaResMgr {
 
       g_Contexts.push_back(cuContext);
       g_Streams.push_back(cuStream);
+      g_DecoderPools.emplace_back(nullptr);
     }
     return;
   }
@@ -107,12 +108,23 @@ public:
     return g_Streams[idx];
   }
 
+  DecoderPool &GetDecoderPool(size_t idx) {
+    auto &pool = g_DecoderPools.at(idx);
+    if (!pool) {
+      pool.reset(DecoderPool::Make(GetCtx(idx), GetStream(idx)));
+    }
+    return *pool;
+  }
+
   /* Also a static function as we want to keep all the
    * CUDA stuff within one Python module;
    */
   ~CudaResMgr() {
     stringstream ss;
     try {
+      // Idle decoders hold video memory of contexts below;
+      g_DecoderPools.clear();
+
       for (auto &cuStream : g_Streams) {
         if (cuStream) {
           ThrowOnCudaError(cuStreamDestroy(cuStream), __LINE__);
@@ -141,6 +153,7 @@ public:
 
   vector<CUcontext> g_Contexts;
   vector<CUstream> g_Streams;
+  vector<unique_ptr<DecoderPool>> g_DecoderPools;
 };
 
 PyFrameUploader::PyFrameUploader(uint32_t width, uint32_t height,
@@ -167,7 +180,7 @@ PyFrameUploader::UploadSingleFrame(py::array_t<uint8_t> &frame) {
    */
   auto pRawFrame = Buffer::Make(frame.size(), frame.mutable_data());
   uploader->SetInput(pRawFrame, 0U);
-  auto res = uploader->Execute();
+  auto res = uploader->Run();
   delete pRawFrame;
 
   if (TASK_EXEC_FAIL == res) {
@@ -202,7 +215,7 @@ Pixel_Format PySurfaceDownloader::GetFormat() { return surfaceFormat; }
 bool PySurfaceDownloader::DownloadSingleSurface(shared_ptr<Surface> surface,
                                                 py::array_t<uint8_t> &frame) {
   upDownloader->SetInput(surface.get(), 0U);
-  if (TASK_EXEC_FAIL == upDownloader->Execute()) {
+  if (TASK_EXEC_FAIL == upDownloader->Run()) {
     return false;
   }
 
@@ -235,7 +248,7 @@ shared_ptr<Surface> PySurfaceConverter::Execute(shared_ptr<Surface> surface) {
   }
 
   upConverter->SetInput(surface.get(), 0U);
-  if (TASK_EXEC_SUCCESS != upConverter->Execute()) {
+  if (TASK_EXEC_SUCCESS != upConverter->Run()) {
     return shared_ptr<Surface>(Surface::Make(outputFormat));
   }
 
@@ -263,7 +276,7 @@ shared_ptr<Surface> PySurfaceResizer::Execute(shared_ptr<Surface> surface) {
 
   upResizer->SetInput(surface.get(), 0U);
 
-  if (TASK_EXEC_SUCCESS != upResizer->Execute()) {
+  if (TASK_EXEC_SUCCESS != upResizer->Run()) {
     return shared_ptr<Surface>(Surface::Make(outputFormat));
   }
 
@@ -273,13 +286,49 @@ shared_ptr<Surface> PySurfaceResizer::Execute(shared_ptr<Surface> surface) {
 }
 
 PyFfmpegDecoder::PyFfmpegDecoder(const string &pathToFile,
-                                 const map<string, string> &ffmpeg_options) {
+                                 const map<string, string> &ffmpeg_options,
+                                 const FrameCopyParams &copy_params) {
   NvDecoderClInterface cli_iface(ffmpeg_options);
-  upDecoder.reset(FfmpegDecodeFrame::Make(pathToFile.c_str(), cli_iface));
+  upDecoder.reset(
+      FfmpegDecodeFrame::Make(pathToFile.c_str(), cli_iface, copy_params));
+}
+
+uint32_t PyFfmpegDecoder::Width() const {
+  uint32_t width = 0U, height = 0U;
+  upDecoder->GetFrameParams(width, height);
+  return width;
+}
+
+uint32_t PyFfmpegDecoder::Height() const {
+  uint32_t width = 0U, height = 0U;
+  upDecoder->GetFrameParams(width, height);
+  return height;
+}
+
+void PyFfmpegDecoder::SetErrorResilience(bool enable, uint32_t max_errors) {
+  upDecoder->SetErrorResilience(enable, max_errors);
+}
+
+DecodeErrorStats PyFfmpegDecoder::GetErrorStats() const {
+  DecodeErrorStats stats;
+  upDecoder->GetErrorStats(stats);
+  return stats;
+}
+
+bool PyFfmpegDecoder::DecodeSingleFrame(py::array_t<uint8_t> &frame,
+                                        PacketData &pkt_data) {
+  if (DecodeSingleFrame(frame)) {
+    auto pPktData = (Buffer *)upDecoder->GetOutput(2U);
+    if (pPktData) {
+      pkt_data = *pPktData->GetDataAs<PacketData>();
+    }
+    return true;
+  }
+  return false;
 }
 
 bool PyFfmpegDecoder::DecodeSingleFrame(py::array_t<uint8_t> &frame) {
-  if (TASK_EXEC_SUCCESS == upDecoder->Execute()) {
+  if (TASK_EXEC_SUCCESS == upDecoder->Run()) {
     auto pRawFrame = (Buffer *)upDecoder->GetOutput(0U);
     if (pRawFrame) {
       auto const frame_size = pRawFrame->GetRawMemSize();
@@ -353,7 +402,7 @@ bool PyFFmpegDemuxer::DemuxSinglePacket(py::array_t<uint8_t> &packet) {
 
   Buffer *elementaryVideo = nullptr;
   do {
-    if (TASK_EXEC_FAIL == upDemuxer->Execute()) {
+    if (TASK_EXEC_FAIL == upDemuxer->Run()) {
       return false;
     }
     elementaryVideo = (Buffer *)upDemuxer->GetOutput(0U);
@@ -390,6 +439,593 @@ cudaVideoCodec PyFFmpegDemuxer::Codec() const {
   return params.videoContext.codec;
 }
 
+int PyFFmpegDemuxer::Rotation() const {
+  MuxingParams params;
+  upDemuxer->GetParams(params);
+  return params.videoContext.rotation;
+}
+
+void PyFFmpegDemuxer::LastPacketData(PacketData &packetData) const {
+  auto mp_buffer = (Buffer *)upDemuxer->GetOutput(1U);
+  if (mp_buffer) {
+    auto mp = mp_buffer->GetDataAs<MuxingParams>();
+    packetData = mp->videoContext.packetData;
+  }
+}
+
+void PyFFmpegDemuxer::EnableSliceParsing(bool enable) {
+  upDemuxer->EnableSliceParsing(enable);
+}
+
+py::object PyFFmpegDemuxer::StreamInfo() const {
+  VideoStreamInfo info;
+  if (!upDemuxer->GetStreamInfo(info)) {
+    return py::none();
+  }
+  return py::cast(info);
+}
+
+PyProbeService::PyProbeService(const string &db_path, uint32_t num_threads,
+                               bool scan_gop) {
+  upService.reset(ProbeService::Make(db_path, num_threads, scan_gop));
+}
+
+ProbeStats PyProbeService::Probe(const vector<string> &paths) {
+  // Probing takes long, let other Python threads run;
+  py::gil_scoped_release release;
+  return upService->Probe(paths);
+}
+
+vector<MediaInfo> PyProbeService::Query(const vector<string> &paths) const {
+  return upService->Query(paths);
+}
+
+vector<MediaInfo> PyProbeService::QueryAll() const {
+  return upService->QueryAll();
+}
+
+size_t PyProbeService::Size() const { return upService->Size(); }
+
+PyFrameRateConverter::PyFrameRateConverter(double target_fps,
+                                           double time_base,
+                                           FrameRateMode mode,
+                                           bool packet_level, double src_fps) {
+  FrameRateParams params;
+  params.target_fps = target_fps;
+  params.time_base = time_base;
+  params.src_fps = src_fps;
+  params.mode = mode;
+  params.packet_level = packet_level;
+  upConverter.reset(FrameRateConverter::Make(params));
+}
+
+uint32_t PyFrameRateConverter::Select(const PacketData &pkt_data) {
+  return upConverter->Select(&pkt_data);
+}
+
+void PyFrameRateConverter::Reset() { upConverter->Reset(); }
+
+PyFrameRotator::PyFrameRotator(uint32_t new_width, uint32_t new_height,
+                               Pixel_Format new_format,
+                               const RotateParams &new_params,
+                               uint32_t num_threads)
+    : width(new_width), height(new_height), format(new_format),
+      params(new_params) {
+  // Check parameters before the first frame comes;
+  uint32_t dst_width = 0U, dst_height = 0U;
+  size_t dst_size = 0U;
+  GetRotatedFrameSize(format, width, height, params, dst_width, dst_height,
+                      dst_size);
+
+  if (num_threads > 1U) {
+    upPool.reset(new ThreadPool(num_threads));
+  }
+}
+
+bool PyFrameRotator::Execute(const py::array_t<uint8_t> &src,
+                             py::array_t<uint8_t> &dst) {
+  uint32_t dst_width = 0U, dst_height = 0U;
+  size_t src_size = 0U, dst_size = 0U;
+  GetRotatedFrameSize(format, width, height, RotateParams(), dst_width,
+                      dst_height, src_size);
+  GetRotatedFrameSize(format, width, height, params, dst_width, dst_height,
+                      dst_size);
+
+  if ((size_t)src.size() < src_size) {
+    return false;
+  }
+
+  if ((size_t)dst.size() != dst_size) {
+    dst.resize({dst_size}, false);
+  }
+
+  RotateHostFrame(src.data(), width, height, format, params,
+                  dst.mutable_data(), upPool.get());
+  return true;
+}
+
+uint32_t PyFrameRotator::Width() const {
+  uint32_t dst_width = 0U, dst_height = 0U;
+  size_t dst_size = 0U;
+  GetRotatedFrameSize(format, width, height, params, dst_width, dst_height,
+                      dst_size);
+  return dst_width;
+}
+
+uint32_t PyFrameRotator::Height() const {
+  uint32_t dst_width = 0U, dst_height = 0U;
+  size_t dst_size = 0U;
+  GetRotatedFrameSize(format, width, height, params, dst_width, dst_height,
+                      dst_size);
+  return dst_height;
+}
+
+PyRawVideoReader::PyRawVideoReader(const string &path, uint32_t width,
+                                   uint32_t height, Pixel_Format format) {
+  RawVideoParams params;
+  params.width = width;
+  params.height = height;
+  params.format = format;
+  upReader.reset(RawVideoReader::Make(path.c_str(), params));
+}
+
+uint32_t PyRawVideoReader::Width() const {
+  RawVideoParams params;
+  upReader->GetParams(params);
+  return params.width;
+}
+
+uint32_t PyRawVideoReader::Height() const {
+  RawVideoParams params;
+  upReader->GetParams(params);
+  return params.height;
+}
+
+Pixel_Format PyRawVideoReader::Format() const {
+  RawVideoParams params;
+  upReader->GetParams(params);
+  return params.format;
+}
+
+double PyRawVideoReader::Framerate() const {
+  RawVideoParams params;
+  upReader->GetParams(params);
+  return params.frame_rate;
+}
+
+uint64_t PyRawVideoReader::NumFrames() const {
+  return upReader->GetNumFrames();
+}
+
+uint64_t PyRawVideoReader::FrameIndex() const {
+  return upReader->GetFrameIndex();
+}
+
+bool PyRawVideoReader::Seek(uint64_t frame_index) {
+  return upReader->Seek(frame_index);
+}
+
+bool PyRawVideoReader::ReadSingleFrame(py::array_t<uint8_t> &frame) {
+  if (TASK_EXEC_SUCCESS != upReader->Run()) {
+    return false;
+  }
+
+  auto pRawFrame = (Buffer *)upReader->GetOutput(0U);
+  auto const frame_size = pRawFrame->GetRawMemSize();
+  if (frame_size != frame.size()) {
+    frame.resize({frame_size}, false);
+  }
+
+  memcpy(frame.mutable_data(), pRawFrame->GetRawMemPtr(), frame_size);
+  return true;
+}
+
+py::array_t<uint8_t> PyRawVideoReader::Frame(py::object self,
+                                             uint64_t frame_index) {
+  auto &reader = self.cast<PyRawVideoReader &>();
+  auto const *data = reader.upReader->GetFrame(frame_index);
+  if (!data) {
+    throw py::index_error("No such frame");
+  }
+
+  auto const frame_size = reader.upReader->GetFrameSize();
+  return py::array_t<uint8_t>({frame_size}, {sizeof(uint8_t)}, data, self);
+}
+
+PyRawVideoWriter::PyRawVideoWriter(const string &path, uint32_t width,
+                                   uint32_t height, Pixel_Format format,
+                                   double frame_rate, bool y4m) {
+  RawVideoParams params;
+  params.width = width;
+  params.height = height;
+  params.format = format;
+  params.frame_rate = frame_rate;
+  upWriter.reset(RawVideoWriter::Make(path.c_str(), params, y4m));
+}
+
+bool PyRawVideoWriter::WriteSingleFrame(const py::array_t<uint8_t> &frame) {
+  unique_ptr<Buffer> pRawFrame(
+      Buffer::Make(frame.size(), (void *)frame.data()));
+  upWriter->SetInput(pRawFrame.get(), 0U);
+  return TASK_EXEC_SUCCESS == upWriter->Run();
+}
+
+bool PyRawVideoWriter::Flush() { return upWriter->Flush(); }
+
+uint64_t PyRawVideoWriter::NumFrames() const {
+  return upWriter->GetNumFrames();
+}
+
+PyAsyncFileSink::PyAsyncFileSink(const string &path, bool direct) {
+  upSink.reset(AsyncFileSink::Make(path.c_str(), nullptr, direct));
+}
+
+bool PyAsyncFileSink::Write(const py::array_t<uint8_t> &data) {
+  unique_ptr<Buffer> pData(Buffer::Make(data.size(), (void *)data.data()));
+  upSink->SetInput(pData.get(), 0U);
+  return TASK_EXEC_SUCCESS == upSink->Run();
+}
+
+bool PyAsyncFileSink::Flush() { return upSink->Flush(); }
+
+uint64_t PyAsyncFileSink::NumBytes() const { return upSink->GetNumBytes(); }
+
+PyImageWriter::PyImageWriter(const string &path_template, uint32_t width,
+                             uint32_t height, Pixel_Format format,
+                             const ImageWriterParams &params) {
+  upWriter.reset(
+      ImageWriter::Make(path_template.c_str(), width, height, format, params));
+}
+
+bool PyImageWriter::WriteSingleFrame(const py::array_t<uint8_t> &frame) {
+  unique_ptr<Buffer> pRawFrame(
+      Buffer::Make(frame.size(), (void *)frame.data()));
+  upWriter->SetInput(pRawFrame.get(), 0U);
+
+  // Waits for free frame slot if all of them are being encoded;
+  py::gil_scoped_release release;
+  return TASK_EXEC_SUCCESS == upWriter->Run();
+}
+
+bool PyImageWriter::Flush() { return upWriter->Flush(); }
+
+uint64_t PyImageWriter::NumImages() const { return upWriter->GetNumImages(); }
+
+uint64_t PyImageWriter::NumFailed() const { return upWriter->GetNumFailed(); }
+
+uint64_t PyImageWriter::NumDropped() const {
+  return upWriter->GetNumDropped();
+}
+
+PyFrameCache::PyFrameCache(const string &dir, uint64_t budget) {
+  upCache.reset(FrameCache::Make(dir.c_str(), budget));
+}
+
+namespace {
+FrameCacheParams MakeCacheParams(uint32_t width, uint32_t height,
+                                 Pixel_Format format) {
+  FrameCacheParams params;
+  params.width = width;
+  params.height = height;
+  params.format = format;
+  return params;
+}
+} // namespace
+
+string PyFrameCache::EntryPath(const string &source, uint32_t width,
+                               uint32_t height, Pixel_Format format) const {
+  return upCache->GetEntryPath(source, MakeCacheParams(width, height, format));
+}
+
+bool PyFrameCache::Lookup(const string &source, uint32_t width,
+                          uint32_t height, Pixel_Format format) {
+  return upCache->Lookup(source, MakeCacheParams(width, height, format));
+}
+
+uint64_t PyFrameCache::Evict(uint64_t reserve) {
+  return upCache->Evict(reserve);
+}
+
+uint64_t PyFrameCache::Size() const { return upCache->GetSize(); }
+
+PyFrameCacheWriter::PyFrameCacheWriter(const string &path, uint32_t width,
+                                       uint32_t height, Pixel_Format format,
+                                       bool compress) {
+  auto params = MakeCacheParams(width, height, format);
+  params.compress = compress;
+  upWriter.reset(FrameCacheWriter::Make(path.c_str(), params));
+}
+
+bool PyFrameCacheWriter::WriteSingleFrame(const py::array_t<uint8_t> &frame) {
+  unique_ptr<Buffer> pRawFrame(
+      Buffer::Make(frame.size(), (void *)frame.data()));
+  upWriter->SetInput(pRawFrame.get(), 0U);
+  upWriter->SetInput(nullptr, 1U);
+  return TASK_EXEC_SUCCESS == upWriter->Run();
+}
+
+bool PyFrameCacheWriter::WriteSingleFrame(const py::array_t<uint8_t> &frame,
+                                          const PacketData &pkt_data) {
+  unique_ptr<Buffer> pRawFrame(
+      Buffer::Make(frame.size(), (void *)frame.data()));
+  unique_ptr<Buffer> pPktData(
+      Buffer::MakeOwnMem(sizeof(PacketData), &pkt_data));
+  upWriter->SetInput(pRawFrame.get(), 0U);
+  upWriter->SetInput(pPktData.get(), 1U);
+  return TASK_EXEC_SUCCESS == upWriter->Run();
+}
+
+bool PyFrameCacheWriter::Close() { return upWriter->Close(); }
+
+uint64_t PyFrameCacheWriter::NumFrames() const {
+  return upWriter->GetNumFrames();
+}
+
+uint64_t PyFrameCacheWriter::NumCompressed() const {
+  return upWriter->GetNumCompressed();
+}
+
+PyFrameCacheReader::PyFrameCacheReader(const string &path) {
+  upReader.reset(FrameCacheReader::Make(path.c_str()));
+}
+
+uint32_t PyFrameCacheReader::Width() const {
+  FrameCacheParams params;
+  upReader->GetParams(params);
+  return params.width;
+}
+
+uint32_t PyFrameCacheReader::Height() const {
+  FrameCacheParams params;
+  upReader->GetParams(params);
+  return params.height;
+}
+
+Pixel_Format PyFrameCacheReader::Format() const {
+  FrameCacheParams params;
+  upReader->GetParams(params);
+  return params.format;
+}
+
+uint64_t PyFrameCacheReader::NumFrames() const {
+  return upReader->GetNumFrames();
+}
+
+uint64_t PyFrameCacheReader::FrameIndex() const {
+  return upReader->GetFrameIndex();
+}
+
+bool PyFrameCacheReader::Seek(uint64_t frame_index) {
+  return upReader->Seek(frame_index);
+}
+
+bool PyFrameCacheReader::SeekToPts(int64_t pts) {
+  return upReader->SeekToPts(pts);
+}
+
+bool PyFrameCacheReader::DecodeSingleFrame(py::array_t<uint8_t> &frame,
+                                           PacketData &pkt_data) {
+  if (DecodeSingleFrame(frame)) {
+    auto pPktData = (Buffer *)upReader->GetOutput(1U);
+    if (pPktData) {
+      pkt_data = *pPktData->GetDataAs<PacketData>();
+    }
+    return true;
+  }
+  return false;
+}
+
+bool PyFrameCacheReader::DecodeSingleFrame(py::array_t<uint8_t> &frame) {
+  if (TASK_EXEC_SUCCESS != upReader->Run()) {
+    return false;
+  }
+
+  auto pRawFrame = (Buffer *)upReader->GetOutput(0U);
+  auto const frame_size = pRawFrame->GetRawMemSize();
+  if (frame_size != frame.size()) {
+    frame.resize({frame_size}, false);
+  }
+
+  memcpy(frame.mutable_data(), pRawFrame->GetRawMemPtr(), frame_size);
+  return true;
+}
+
+py::array_t<uint8_t> PyFrameCacheReader::Frame(py::object self,
+                                               uint64_t frame_index) {
+  auto &reader = self.cast<PyFrameCacheReader &>();
+  auto const frame_size = reader.upReader->GetFrameSize();
+  auto const *data = reader.upReader->GetRawFrame(frame_index);
+  if (data) {
+    return py::array_t<uint8_t>({frame_size}, {sizeof(uint8_t)}, data, self);
+  }
+
+  // Compressed frame is unpacked by reading it;
+  auto const next_frame = reader.upReader->GetFrameIndex();
+  if (!reader.upReader->Seek(frame_index)) {
+    throw py::index_error("No such frame");
+  }
+
+  py::array_t<uint8_t> frame(frame_size);
+  auto const res = reader.DecodeSingleFrame(frame);
+  reader.upReader->Seek(next_frame);
+  if (!res) {
+    throw runtime_error("Can't unpack cached frame");
+  }
+  return frame;
+}
+
+PyClipLoader::PyClipLoader(const vector<string> &files, const ClipSpec &spec,
+                           const ClipLoaderParams &params) {
+  py::gil_scoped_release release;
+  upLoader.reset(ClipLoader::Make(files, spec, params));
+}
+
+void PyClipLoader::StartEpoch(uint32_t epoch) {
+  py::gil_scoped_release release;
+  upLoader->StartEpoch(epoch);
+}
+
+py::object PyClipLoader::Next() {
+  shared_ptr<Buffer> batch;
+  vector<ClipInfo> clips;
+  {
+    py::gil_scoped_release release;
+    batch = upLoader->Next(clips);
+  }
+  if (!batch) {
+    return py::none();
+  }
+
+  ClipSpec spec;
+  upLoader->GetSpec(spec);
+  auto const frame_size = upLoader->GetFrameSize();
+  auto const width = (size_t)spec.width;
+  auto const height = (size_t)spec.height;
+
+  vector<size_t> shape, strides;
+  switch (spec.format) {
+  case RGB:
+  case BGR:
+    shape = {height, width, 3U};
+    strides = {width * 3U, 3U, 1U};
+    break;
+  case Y:
+    shape = {height, width};
+    strides = {width, 1U};
+    break;
+  default:
+    shape = {frame_size};
+    strides = {1U};
+    break;
+  }
+  shape.insert(shape.begin(), {clips.size(), (size_t)spec.length});
+  strides.insert(strides.begin(), {frame_size * spec.length, frame_size});
+
+  // Array is view of pooled buffer, capsule returns it to the pool;
+  auto owner = new shared_ptr<Buffer>(batch);
+  py::capsule base(owner, [](void *ptr) {
+    delete reinterpret_cast<shared_ptr<Buffer> *>(ptr);
+  });
+
+  py::list infos;
+  for (auto &clip : clips) {
+    infos.append(
+        py::make_tuple(clip.file_index, clip.start_time, clip.decoded));
+  }
+
+  return py::make_tuple(py::array_t<uint8_t>(shape, strides,
+                                             batch->GetDataAs<uint8_t>(),
+                                             base),
+                        infos);
+}
+
+uint32_t PyClipLoader::NumFiles() const { return upLoader->GetNumFiles(); }
+
+uint64_t PyClipLoader::NumClips() const { return upLoader->GetNumClips(); }
+
+uint64_t PyClipLoader::NumBatches() const { return upLoader->GetNumBatches(); }
+
+PyImageDecoder::PyImageDecoder(uint32_t width, uint32_t height,
+                               Pixel_Format format, uint32_t num_threads,
+                               const ThreadPlacement &placement) {
+  ImageDecoderParams params;
+  params.width = width;
+  params.height = height;
+  params.format = format;
+  params.num_threads = num_threads;
+  params.placement = placement;
+  upDecoder.reset(ImageDecoder::Make(params));
+}
+
+py::tuple PyImageDecoder::Decode(const vector<ImageSource> &sources,
+                                 bool as_list) {
+  shared_ptr<Buffer> batch;
+  vector<ImageInfo> info;
+  {
+    py::gil_scoped_release release;
+    batch = upDecoder->DecodeBatch(sources, info);
+  }
+
+  ImageDecoderParams params;
+  upDecoder->GetParams(params);
+  auto const num_images = sources.size();
+  auto const width = (size_t)params.width;
+  auto const height = (size_t)params.height;
+
+  vector<size_t> shape, strides;
+  switch (params.format) {
+  case Y:
+    shape = {height, width};
+    strides = {width, 1U};
+    break;
+  case RGB_PLANAR:
+    shape = {3U, height, width};
+    strides = {height * width, width, 1U};
+    break;
+  default:
+    shape = {height, width, 3U};
+    strides = {width * 3U, 3U, 1U};
+    break;
+  }
+
+  // Arrays are views of pooled buffer, capsule returns it to the pool;
+  auto owner = new shared_ptr<Buffer>(batch);
+  py::capsule base(owner, [](void *ptr) {
+    delete reinterpret_cast<shared_ptr<Buffer> *>(ptr);
+  });
+
+  auto data = batch->GetDataAs<uint8_t>();
+  auto const frame_size = upDecoder->GetFrameSize();
+  py::object images;
+  if (as_list) {
+    py::list views;
+    for (size_t i = 0U; i < num_images; i++) {
+      views.append(py::array_t<uint8_t>(shape, strides, data + i * frame_size,
+                                        base));
+    }
+    images = views;
+  } else {
+    shape.insert(shape.begin(), num_images);
+    strides.insert(strides.begin(), frame_size);
+    images = py::array_t<uint8_t>(shape, strides, data, base);
+  }
+
+  py::list decoded;
+  for (auto &image_info : info) {
+    decoded.append(py::bool_(image_info.decoded));
+  }
+  return py::make_tuple(images, decoded);
+}
+
+py::tuple PyImageDecoder::DecodeFiles(const vector<string> &paths,
+                                      bool as_list) {
+  vector<ImageSource> sources(paths.size());
+  for (size_t i = 0U; i < paths.size(); i++) {
+    sources[i].path = paths[i];
+  }
+  return Decode(sources, as_list);
+}
+
+py::tuple PyImageDecoder::DecodeBlobs(const py::list &blobs, bool as_list) {
+  // Blobs are kept referenced until batch is decoded;
+  vector<py::array_t<uint8_t>> arrays;
+  vector<ImageSource> sources(blobs.size());
+  for (size_t i = 0U; i < blobs.size(); i++) {
+    py::object blob = blobs[i];
+    if (PyBytes_Check(blob.ptr())) {
+      sources[i].data = (const uint8_t *)PyBytes_AsString(blob.ptr());
+      sources[i].size = PyBytes_Size(blob.ptr());
+    } else {
+      arrays.push_back(
+          py::array_t<uint8_t, py::array::c_style | py::array::forcecast>(
+              blob));
+      sources[i].data = arrays.back().data();
+      sources[i].size = arrays.back().size();
+    }
+  }
+  return Decode(sources, as_list);
+}
+
 PyNvDecoder::PyNvDecoder(const string &pathToFile, int gpuOrdinal)
     : PyNvDecoder(pathToFile, gpuOrdinal, map<string, string>()) {}
 
@@ -399,25 +1035,16 @@ PyNvDecoder::PyNvDecoder(const string &pathToFile, int gpuOrdinal,
     gpuOrdinal = 0U;
   }
   gpuID = gpuOrdinal;
-  cout << "Decoding on GPU " << gpuID << endl;
+  VPF_LOG(LOG_LEVEL_INFO, "PyNvDecoder") << "Decoding on GPU " << gpuID;
 
-  vector<const char *> options;
-  for (auto &pair : ffmpeg_options) {
-    options.push_back(pair.first.c_str());
-    options.push_back(pair.second.c_str());
-  }
-  upDemuxer.reset(
-      DemuxFrame::Make(pathToFile.c_str(), options.data(), options.size()));
+  pSession = CudaResMgr::Instance().GetDecoderPool(gpuID).Acquire(
+      pathToFile, ffmpeg_options);
+  pDemuxer = pSession->GetDemuxer();
+  pDecoder = pSession->GetDecoder();
 
   MuxingParams params;
-  upDemuxer->GetParams(params);
+  pDemuxer->GetParams(params);
   format = params.videoContext.format;
-
-  upDecoder.reset(NvdecDecodeFrame::Make(
-      CudaResMgr::Instance().GetStream(gpuID),
-      CudaResMgr::Instance().GetCtx(gpuID), params.videoContext.codec,
-      poolFrameSize, params.videoContext.width, params.videoContext.height,
-      format));
 }
 
 PyNvDecoder::PyNvDecoder(uint32_t width, uint32_t height,
@@ -428,12 +1055,19 @@ PyNvDecoder::PyNvDecoder(uint32_t width, uint32_t height,
     gpuOrdinal = 0U;
   }
   gpuID = gpuOrdinal;
-  cout << "Decoding on GPU " << gpuID << endl;
+  VPF_LOG(LOG_LEVEL_INFO, "PyNvDecoder") << "Decoding on GPU " << gpuID;
 
   upDecoder.reset(
       NvdecDecodeFrame::Make(CudaResMgr::Instance().GetStream(gpuID),
                              CudaResMgr::Instance().GetCtx(gpuID), codec,
                              poolFrameSize, width, height, format));
+  pDecoder = upDecoder.get();
+}
+
+PyNvDecoder::~PyNvDecoder() {
+  if (pSession) {
+    CudaResMgr::Instance().GetDecoderPool(gpuID).Release(pSession);
+  }
 }
 
 Buffer *PyNvDecoder::getElementaryVideo(DemuxFrame *demuxer, bool needSEI) {
@@ -442,7 +1076,7 @@ Buffer *PyNvDecoder::getElementaryVideo(DemuxFrame *demuxer, bool needSEI) {
     if (needSEI) {
       demuxer->SetInput((Token*)0xdeadbeef, 0U);
     }
-    if (TASK_EXEC_FAIL == demuxer->Execute()) {
+    if (TASK_EXEC_FAIL == demuxer->Run()) {
       return nullptr;
     }
     elementaryVideo = (Buffer *)demuxer->GetOutput(0U);
@@ -457,17 +1091,30 @@ Surface *PyNvDecoder::getDecodedSurface(NvdecDecodeFrame *decoder,
                                         bool needSEI) {
   hw_decoder_failure = false;
   Surface *surface = nullptr;
+  unique_ptr<Buffer> packetData = nullptr;
   do {
     auto elementaryVideo = getElementaryVideo(demuxer, needSEI);
 
+    // Demuxed packet data goes through decoder along with packet;
+    auto muxParams = (Buffer *)demuxer->GetOutput(1U);
+    if (elementaryVideo && muxParams) {
+      auto &pkt_data =
+          muxParams->GetDataAs<MuxingParams>()->videoContext.packetData;
+      packetData.reset(Buffer::MakeOwnMem(sizeof(pkt_data), &pkt_data));
+    } else {
+      packetData.reset();
+    }
+
     decoder->SetInput(elementaryVideo, 0U);
+    decoder->SetInput(packetData.get(), 1U);
     try {
-      if (TASK_EXEC_FAIL == decoder->Execute()) {
+      if (TASK_EXEC_FAIL == decoder->Run()) {
         break;
       }
     } catch (exception &e) {
-      cerr << "Exception thrown during decoding process: " << e.what() << endl;
-      cerr << "HW decoder will be reset." << endl;
+      VPF_LOG(LOG_LEVEL_ERROR, "PyNvDecoder")
+          << "Exception thrown during decoding process: " << e.what()
+          << ". HW decoder will be reset.";
       hw_decoder_failure = true;
       break;
     }
@@ -479,35 +1126,44 @@ Surface *PyNvDecoder::getDecodedSurface(NvdecDecodeFrame *decoder,
 };
 
 Surface *PyNvDecoder::getDecodedSurfaceFromPacket(py::array_t<uint8_t> *pPacket,
+                                                  const PacketData *pPktData,
                                                   bool &hw_decoder_failure) {
   hw_decoder_failure = false;
   Surface *surface = nullptr;
   unique_ptr<Buffer> elementaryVideo = nullptr;
+  unique_ptr<Buffer> packetData = nullptr;
 
   if (pPacket && pPacket->size()) {
     elementaryVideo = unique_ptr<Buffer>(
         Buffer::MakeOwnMem(pPacket->size(), pPacket->data()));
+
+    if (pPktData) {
+      packetData = unique_ptr<Buffer>(
+          Buffer::MakeOwnMem(sizeof(*pPktData), pPktData));
+    }
   }
 
-  upDecoder->SetInput(elementaryVideo ? elementaryVideo.get() : nullptr, 0U);
+  pDecoder->SetInput(elementaryVideo ? elementaryVideo.get() : nullptr, 0U);
+  pDecoder->SetInput(packetData ? packetData.get() : nullptr, 1U);
   try {
-    if (TASK_EXEC_FAIL == upDecoder->Execute()) {
+    if (TASK_EXEC_FAIL == pDecoder->Run()) {
       return nullptr;
     }
   } catch (exception &e) {
-    cerr << "Exception thrown during decoding process: " << e.what() << endl;
-    cerr << "HW decoder will be reset." << endl;
+    VPF_LOG(LOG_LEVEL_ERROR, "PyNvDecoder")
+        << "Exception thrown during decoding process: " << e.what()
+        << ". HW decoder will be reset.";
     hw_decoder_failure = true;
     return nullptr;
   }
 
-  return (Surface *)upDecoder->GetOutput(0U);
+  return (Surface *)pDecoder->GetOutput(0U);
 };
 
 uint32_t PyNvDecoder::Width() const {
-  if (upDemuxer) {
+  if (pDemuxer) {
     MuxingParams params;
-    upDemuxer->GetParams(params);
+    pDemuxer->GetParams(params);
     return params.videoContext.width;
   } else {
     throw runtime_error("Decoder was created without built-in demuxer support. "
@@ -516,7 +1172,7 @@ uint32_t PyNvDecoder::Width() const {
 }
 
 void PyNvDecoder::LastPacketData(PacketData &packetData) const {
-  auto mp_buffer = (Buffer *)upDemuxer->GetOutput(1U);
+  auto mp_buffer = (Buffer *)pDemuxer->GetOutput(1U);
   if (mp_buffer) {
     auto mp = mp_buffer->GetDataAs<MuxingParams>();
     packetData = mp->videoContext.packetData;
@@ -524,10 +1180,10 @@ void PyNvDecoder::LastPacketData(PacketData &packetData) const {
 }
 
 uint32_t PyNvDecoder::Height() const {
-  if (upDemuxer) {
+  if (pDemuxer) {
 
     MuxingParams params;
-    upDemuxer->GetParams(params);
+    pDemuxer->GetParams(params);
     return params.videoContext.height;
   } else {
     throw runtime_error("Decoder was created without built-in demuxer support. "
@@ -536,10 +1192,10 @@ uint32_t PyNvDecoder::Height() const {
 }
 
 double PyNvDecoder::Framerate() const {
-  if (upDemuxer) {
+  if (pDemuxer) {
 
     MuxingParams params;
-    upDemuxer->GetParams(params);
+    pDemuxer->GetParams(params);
     return params.videoContext.frameRate;
   } else {
     throw runtime_error("Decoder was created without built-in demuxer support. "
@@ -548,9 +1204,9 @@ double PyNvDecoder::Framerate() const {
 }
 
 double PyNvDecoder::Timebase() const {
-  if (upDemuxer) {
+  if (pDemuxer) {
     MuxingParams params;
-    upDemuxer->GetParams(params);
+    pDemuxer->GetParams(params);
     return params.videoContext.timeBase;
   } else {
     throw runtime_error("Decoder was created without built-in demuxer support. "
@@ -559,7 +1215,7 @@ double PyNvDecoder::Timebase() const {
 }
 
 uint32_t PyNvDecoder::Framesize() const {
-  if (upDemuxer) {
+  if (pDemuxer) {
     auto pSurface = Surface::Make(GetPixelFormat(), Width(), Height(),
                                   CudaResMgr::Instance().GetCtx(gpuID));
     if (!pSurface) {
@@ -582,6 +1238,10 @@ struct DecodeContext {
   py::array_t<uint8_t> *pPacket;
   bool usePacket;
 
+  // Packet data given along with packet and packet data of decoded surface;
+  const PacketData *pInPktData = nullptr;
+  PacketData *pOutPktData = nullptr;
+
   DecodeContext(py::array_t<uint8_t> *sei, py::array_t<uint8_t> *packet)
       : pSurface(nullptr), pSei(sei), pPacket(packet), usePacket(true) {}
 
@@ -597,34 +1257,30 @@ bool PyNvDecoder::DecodeSurface(struct DecodeContext &ctx) {
 
   auto pRawSurf =
       ctx.usePacket
-          ? getDecodedSurfaceFromPacket(ctx.pPacket, hw_decoder_failure)
-          : getDecodedSurface(upDecoder.get(), upDemuxer.get(),
+          ? getDecodedSurfaceFromPacket(ctx.pPacket, ctx.pInPktData,
+                                        hw_decoder_failure)
+          : getDecodedSurface(pDecoder, pDemuxer,
                               hw_decoder_failure, ctx.pSei != nullptr);
 
-  if (hw_decoder_failure && upDemuxer) {
+  if (hw_decoder_failure && pDemuxer) {
     time_point<system_clock> then = system_clock::now();
 
-    MuxingParams params;
-    upDemuxer->GetParams(params);
-
-    upDecoder.reset(NvdecDecodeFrame::Make(
-        CudaResMgr::Instance().GetStream(gpuID),
-        CudaResMgr::Instance().GetCtx(gpuID), params.videoContext.codec,
-        poolFrameSize, params.videoContext.width, params.videoContext.height,
-        format));
+    pDecoder = pSession->RecreateDecoder();
 
     time_point<system_clock> now = system_clock::now();
     auto duration = duration_cast<milliseconds>(now - then).count();
-    cerr << "HW decoder reset time: " << duration << " milliseconds" << endl;
+    VPF_LOG(LOG_LEVEL_WARNING, "PyNvDecoder")
+        << "HW decoder reset time: " << duration << " milliseconds";
 
     throw HwResetException();
   } else if (hw_decoder_failure) {
-    cerr << "HW exception happened. Please reset class instance" << endl;
+    VPF_LOG(LOG_LEVEL_ERROR, "PyNvDecoder")
+        << "HW exception happened. Please reset class instance";
     throw HwResetException();
   }
 
   if (ctx.pSei) {
-    auto seiBuffer = (Buffer *)upDemuxer->GetOutput(2U);
+    auto seiBuffer = (Buffer *)pDemuxer->GetOutput(2U);
     if (seiBuffer) {
       ctx.pSei->resize({seiBuffer->GetRawMemSize()}, false);
       memcpy(ctx.pSei->mutable_data(), seiBuffer->GetRawMemPtr(),
@@ -635,7 +1291,15 @@ bool PyNvDecoder::DecodeSurface(struct DecodeContext &ctx) {
   }
 
   if (pRawSurf) {
+    if (pSession) {
+      pSession->OnSurfaceDecoded();
+    }
     ctx.pSurface = shared_ptr<Surface>(pRawSurf->Clone());
+
+    auto pPktData = (Buffer *)pDecoder->GetOutput(1U);
+    if (ctx.pOutPktData && pPktData) {
+      *ctx.pOutPktData = *pPktData->GetDataAs<PacketData>();
+    }
     return true;
   } else {
     return false;
@@ -701,6 +1365,46 @@ shared_ptr<Surface> PyNvDecoder::FlushSingleSurface() {
   }
 }
 
+shared_ptr<Surface> PyNvDecoder::DecodeSingleSurface(PacketData &pkt_data) {
+  DecodeContext ctx;
+  ctx.pOutPktData = &pkt_data;
+  if (DecodeSurface(ctx)) {
+    return ctx.pSurface;
+  } else {
+    auto pixFmt = GetPixelFormat();
+    auto pSurface = shared_ptr<Surface>(Surface::Make(pixFmt));
+    return shared_ptr<Surface>(pSurface->Clone());
+  }
+}
+
+shared_ptr<Surface>
+PyNvDecoder::DecodeSurfaceFromPacket(const PacketData &enc_pkt_data,
+                                     py::array_t<uint8_t> &packet,
+                                     PacketData &pkt_data) {
+  DecodeContext ctx(nullptr, &packet);
+  ctx.pInPktData = &enc_pkt_data;
+  ctx.pOutPktData = &pkt_data;
+  if (DecodeSurface(ctx)) {
+    return ctx.pSurface;
+  } else {
+    auto pixFmt = GetPixelFormat();
+    auto pSurface = shared_ptr<Surface>(Surface::Make(pixFmt));
+    return shared_ptr<Surface>(pSurface->Clone());
+  }
+}
+
+shared_ptr<Surface> PyNvDecoder::FlushSingleSurface(PacketData &pkt_data) {
+  DecodeContext ctx(nullptr, nullptr);
+  ctx.pOutPktData = &pkt_data;
+  if (DecodeSurface(ctx)) {
+    return ctx.pSurface;
+  } else {
+    auto pixFmt = GetPixelFormat();
+    auto pSurface = shared_ptr<Surface>(Surface::Make(pixFmt));
+    return shared_ptr<Surface>(pSurface->Clone());
+  }
+}
+
 bool PyNvDecoder::DecodeSingleFrame(py::array_t<uint8_t> &frame,
                                     py::array_t<uint8_t> &sei) {
   auto spRawSufrace = DecodeSingleSurface(sei);
@@ -710,7 +1414,7 @@ bool PyNvDecoder::DecodeSingleFrame(py::array_t<uint8_t> &frame,
 
   if (!upDownloader) {
     uint32_t width, height, elem_size;
-    upDecoder->GetDecodedFrameParams(width, height, elem_size);
+    pDecoder->GetDecodedFrameParams(width, height, elem_size);
     upDownloader.reset(new PySurfaceDownloader(width, height, format, gpuID));
   }
 
@@ -725,7 +1429,7 @@ bool PyNvDecoder::FlushSingleFrame(py::array_t<uint8_t> &frame) {
 
   if (!upDownloader) {
     uint32_t width, height, elem_size;
-    upDecoder->GetDecodedFrameParams(width, height, elem_size);
+    pDecoder->GetDecodedFrameParams(width, height, elem_size);
     upDownloader.reset(new PySurfaceDownloader(width, height, format, gpuID));
   }
 
@@ -740,7 +1444,7 @@ bool PyNvDecoder::DecodeSingleFrame(py::array_t<uint8_t> &frame) {
 
   if (!upDownloader) {
     uint32_t width, height, elem_size;
-    upDecoder->GetDecodedFrameParams(width, height, elem_size);
+    pDecoder->GetDecodedFrameParams(width, height, elem_size);
     upDownloader.reset(new PySurfaceDownloader(width, height, format, gpuID));
   }
 
@@ -757,7 +1461,7 @@ bool PyNvDecoder::DecodeFrameFromPacket(py::array_t<uint8_t> &frame,
 
   if (!upDownloader) {
     uint32_t width, height, elem_size;
-    upDecoder->GetDecodedFrameParams(width, height, elem_size);
+    pDecoder->GetDecodedFrameParams(width, height, elem_size);
     upDownloader.reset(new PySurfaceDownloader(width, height, format, gpuID));
   }
 
@@ -773,7 +1477,57 @@ bool PyNvDecoder::DecodeFrameFromPacket(py::array_t<uint8_t> &frame,
 
   if (!upDownloader) {
     uint32_t width, height, elem_size;
-    upDecoder->GetDecodedFrameParams(width, height, elem_size);
+    pDecoder->GetDecodedFrameParams(width, height, elem_size);
+    upDownloader.reset(new PySurfaceDownloader(width, height, format, gpuID));
+  }
+
+  return upDownloader->DownloadSingleSurface(spRawSufrace, frame);
+}
+
+bool PyNvDecoder::DecodeSingleFrame(py::array_t<uint8_t> &frame,
+                                    PacketData &pkt_data) {
+  auto spRawSufrace = DecodeSingleSurface(pkt_data);
+  if (spRawSufrace->Empty()) {
+    return false;
+  }
+
+  if (!upDownloader) {
+    uint32_t width, height, elem_size;
+    pDecoder->GetDecodedFrameParams(width, height, elem_size);
+    upDownloader.reset(new PySurfaceDownloader(width, height, format, gpuID));
+  }
+
+  return upDownloader->DownloadSingleSurface(spRawSufrace, frame);
+}
+
+bool PyNvDecoder::DecodeFrameFromPacket(py::array_t<uint8_t> &frame,
+                                        const PacketData &enc_pkt_data,
+                                        py::array_t<uint8_t> &packet,
+                                        PacketData &pkt_data) {
+  auto spRawSufrace = DecodeSurfaceFromPacket(enc_pkt_data, packet, pkt_data);
+  if (spRawSufrace->Empty()) {
+    return false;
+  }
+
+  if (!upDownloader) {
+    uint32_t width, height, elem_size;
+    pDecoder->GetDecodedFrameParams(width, height, elem_size);
+    upDownloader.reset(new PySurfaceDownloader(width, height, format, gpuID));
+  }
+
+  return upDownloader->DownloadSingleSurface(spRawSufrace, frame);
+}
+
+bool PyNvDecoder::FlushSingleFrame(py::array_t<uint8_t> &frame,
+                                   PacketData &pkt_data) {
+  auto spRawSufrace = FlushSingleSurface(pkt_data);
+  if (spRawSufrace->Empty()) {
+    return false;
+  }
+
+  if (!upDownloader) {
+    uint32_t width, height, elem_size;
+    pDecoder->GetDecodedFrameParams(width, height, elem_size);
     upDownloader.reset(new PySurfaceDownloader(width, height, format, gpuID));
   }
 
@@ -854,7 +1608,7 @@ PyNvEncoder::PyNvEncoder(const map<string, string> &encodeOptions,
     gpuOrdinal = 0U;
   }
   gpuID = gpuOrdinal;
-  cout << "Encoding on GPU " << gpuID << endl;
+  VPF_LOG(LOG_LEVEL_INFO, "PyNvEncoder") << "Encoding on GPU " << gpuID;
 
   /* Don't initialize uploader & encoder here, just prepare config params;
    */
@@ -938,7 +1692,7 @@ bool PyNvEncoder::EncodeSingleSurface(EncodeContext &ctx) {
     upEncoder->SetInput(spSEI.get(), 2U);
   }
 
-  if (TASK_EXEC_FAIL == upEncoder->Execute()) {
+  if (TASK_EXEC_FAIL == upEncoder->Run()) {
     throw runtime_error("Error while encoding frame");
   }
 
@@ -1060,6 +1814,54 @@ auto CopySurface = [](shared_ptr<Surface> self, shared_ptr<Surface> other,
   ThrowOnCudaError(cuStreamSynchronize(cudaStream), __LINE__);
 };
 
+/* Python objects captured by log sink must be released with GIL held,
+ * while logger thread calls sink without it;
+ */
+static Logger::LogSink MakePythonLogSink(py::object callback) {
+  auto pCallback = shared_ptr<py::object>(
+      new py::object(move(callback)), [](py::object *pObject) {
+        py::gil_scoped_acquire gil;
+        delete pObject;
+      });
+
+  return [pCallback](LogLevel level, const string &component,
+                     const string &message) {
+    py::gil_scoped_acquire gil;
+    try {
+      (*pCallback)(level, component, message);
+    } catch (py::error_already_set &) {
+      // Exceptions can't be propagated from logger thread;
+    }
+  };
+}
+
+static void SwapLogSink(Logger::LogSink sink) {
+  Logger::LogSink prev_sink;
+  {
+    /* Logger thread may be waiting for GIL inside the sink;
+     */
+    py::gil_scoped_release nogil;
+    prev_sink = Logger::Instance().SetSink(move(sink));
+  }
+}
+
+static void SetLogCallback(py::object callback) {
+  SwapLogSink(callback.is_none() ? Logger::LogSink()
+                                 : MakePythonLogSink(move(callback)));
+}
+
+static void RouteLogsToPython() {
+  auto logging = py::module::import("logging");
+  auto callback = py::cpp_function(
+      [logging](LogLevel level, const string &component,
+                const string &message) {
+        static const int py_levels[] = {5, 10, 20, 30, 40, 50};
+        auto logger = logging.attr("getLogger")("PyNvCodec." + component);
+        logger.attr("log")(py_levels[(int)level], message);
+      });
+  SwapLogSink(MakePythonLogSink(callback));
+}
+
 PYBIND11_MODULE(PyNvCodec, m) {
   m.doc() = "Python bindings for Nvidia-accelerated video processing";
 
@@ -1084,11 +1886,101 @@ PYBIND11_MODULE(PyNvCodec, m) {
       .value("UNDEFINED", Pixel_Format::UNDEFINED)
       .export_values();
 
+  py::enum_<LogLevel>(m, "LogLevel")
+      .value("TRACE", LogLevel::LOG_LEVEL_TRACE)
+      .value("DEBUG", LogLevel::LOG_LEVEL_DEBUG)
+      .value("INFO", LogLevel::LOG_LEVEL_INFO)
+      .value("WARNING", LogLevel::LOG_LEVEL_WARNING)
+      .value("ERROR", LogLevel::LOG_LEVEL_ERROR)
+      .value("NONE", LogLevel::LOG_LEVEL_NONE);
+
   py::enum_<cudaVideoCodec>(m, "CudaVideoCodec")
       .value("H264", cudaVideoCodec::cudaVideoCodec_H264)
       .value("HEVC", cudaVideoCodec::cudaVideoCodec_HEVC)
       .export_values();
 
+  py::enum_<FrameType>(m, "FrameType")
+      .value("UNKNOWN", FrameType::FRAME_TYPE_UNKNOWN)
+      .value("I", FrameType::FRAME_TYPE_I)
+      .value("P", FrameType::FRAME_TYPE_P)
+      .value("B", FrameType::FRAME_TYPE_B);
+
+  py::enum_<FrameRateMode>(m, "FrameRateMode")
+      .value("DROP", FrameRateMode::FRC_DROP)
+      .value("NEAREST", FrameRateMode::FRC_NEAREST)
+      .value("DUPLICATE", FrameRateMode::FRC_DUPLICATE);
+
+  py::enum_<DownscaleFilter>(m, "DownscaleFilter")
+      .value("BOX", DownscaleFilter::DOWNSCALE_BOX)
+      .value("BILINEAR", DownscaleFilter::DOWNSCALE_BILINEAR);
+
+  py::enum_<FrameRotation>(m, "FrameRotation")
+      .value("ROTATE_0", FrameRotation::ROTATE_0)
+      .value("ROTATE_90", FrameRotation::ROTATE_90)
+      .value("ROTATE_180", FrameRotation::ROTATE_180)
+      .value("ROTATE_270", FrameRotation::ROTATE_270);
+
+  py::class_<FrameCopyParams>(m, "FrameCopyParams")
+      .def(py::init<>())
+      .def_readwrite("format", &FrameCopyParams::format)
+      .def_readwrite("crop_x", &FrameCopyParams::crop_x)
+      .def_readwrite("crop_y", &FrameCopyParams::crop_y)
+      .def_readwrite("crop_width", &FrameCopyParams::crop_width)
+      .def_readwrite("crop_height", &FrameCopyParams::crop_height)
+      .def_readwrite("downscale", &FrameCopyParams::downscale)
+      .def_readwrite("filter", &FrameCopyParams::filter)
+      .def_readwrite("rotation", &FrameCopyParams::rotation)
+      .def_readwrite("hflip", &FrameCopyParams::hflip)
+      .def_readwrite("auto_rotate", &FrameCopyParams::auto_rotate);
+
+  py::class_<RotateParams>(m, "RotateParams")
+      .def(py::init<>())
+      .def_readwrite("rotation", &RotateParams::rotation)
+      .def_readwrite("hflip", &RotateParams::hflip)
+      .def_readwrite("downscale", &RotateParams::downscale)
+      .def_readwrite("filter", &RotateParams::filter);
+
+  m.def("RotationFromDegrees", &RotationFromDegrees, py::arg("degrees"));
+
+  py::enum_<PinPolicy>(m, "PinPolicy")
+      .value("NONE", PinPolicy::PIN_NONE)
+      .value("COMPACT", PinPolicy::PIN_COMPACT)
+      .value("SPREAD", PinPolicy::PIN_SPREAD)
+      .value("EXPLICIT", PinPolicy::PIN_EXPLICIT);
+
+  py::class_<NumaNode>(m, "NumaNode")
+      .def_readonly("id", &NumaNode::id)
+      .def_readonly("cpus", &NumaNode::cpus)
+      .def_readonly("memory_bytes", &NumaNode::memory_bytes);
+
+  py::class_<ThreadPlacement>(m, "ThreadPlacement")
+      .def(py::init<>())
+      .def_readwrite("policy", &ThreadPlacement::policy)
+      .def_readwrite("node", &ThreadPlacement::node)
+      .def_readwrite("cpus", &ThreadPlacement::cpus);
+
+  py::enum_<BudgetPolicy>(m, "BudgetPolicy")
+      .value("BLOCK", BudgetPolicy::BUDGET_BLOCK)
+      .value("DROP", BudgetPolicy::BUDGET_DROP);
+
+  py::enum_<ImageCodec>(m, "ImageCodec")
+      .value("JPEG", ImageCodec::IMAGE_JPEG)
+      .value("PNG", ImageCodec::IMAGE_PNG)
+      .value("WEBP", ImageCodec::IMAGE_WEBP);
+
+  py::class_<ImageWriterParams>(m, "ImageWriterParams")
+      .def(py::init<>())
+      .def_readwrite("codec", &ImageWriterParams::codec)
+      .def_readwrite("quality", &ImageWriterParams::quality)
+      .def_readwrite("compression_level",
+                     &ImageWriterParams::compression_level)
+      .def_readwrite("start_number", &ImageWriterParams::start_number)
+      .def_readwrite("num_threads", &ImageWriterParams::num_threads)
+      .def_readwrite("full_range", &ImageWriterParams::full_range)
+      .def_readwrite("pipeline", &ImageWriterParams::pipeline)
+      .def_readwrite("budget_policy", &ImageWriterParams::budget_policy)
+      .def_readwrite("placement", &ImageWriterParams::placement);
+
   py::class_<SurfacePlane, shared_ptr<SurfacePlane>>(m, "SurfacePlane")
       .def("Width", &SurfacePlane::Width)
       .def("Height", &SurfacePlane::Height)
@@ -1210,10 +2102,200 @@ PYBIND11_MODULE(PyNvCodec, m) {
       .def("Flush", &PyNvEncoder::Flush, py::arg("packets"));
 
   py::class_<PyFfmpegDecoder>(m, "PyFfmpegDecoder")
-      .def(py::init<const string &, const map<string, string> &>())
-      .def("DecodeSingleFrame", &PyFfmpegDecoder::DecodeSingleFrame)
+      .def(py::init<const string &, const map<string, string> &,
+                    const FrameCopyParams &>(),
+           py::arg("input"), py::arg("opts"),
+           py::arg("copy_params") = FrameCopyParams())
+      .def("Width", &PyFfmpegDecoder::Width,
+           "Width of the last decoded frame after crop and downscale")
+      .def("Height", &PyFfmpegDecoder::Height,
+           "Height of the last decoded frame after crop and downscale")
+      .def("DecodeSingleFrame",
+           py::overload_cast<py::array_t<uint8_t> &, PacketData &>(
+               &PyFfmpegDecoder::DecodeSingleFrame),
+           py::arg("frame"), py::arg("pkt_data"))
+      .def("DecodeSingleFrame",
+           py::overload_cast<py::array_t<uint8_t> &>(
+               &PyFfmpegDecoder::DecodeSingleFrame),
+           py::arg("frame"))
       .def("GetMotionVectors", &PyFfmpegDecoder::GetMotionVectors,
-           py::return_value_policy::move);
+           py::return_value_policy::move)
+      .def("SetErrorResilience", &PyFfmpegDecoder::SetErrorResilience,
+           py::arg("enable"), py::arg("max_errors") = 16U,
+           "Upon corrupt data or read error skip to the next keyframe "
+           "instead of failing")
+      .def("GetErrorStats", &PyFfmpegDecoder::GetErrorStats);
+
+  py::class_<PyFrameRotator>(m, "PyFrameRotator")
+      .def(py::init<uint32_t, uint32_t, Pixel_Format, const RotateParams &,
+                    uint32_t>(),
+           py::arg("width"), py::arg("height"), py::arg("format"),
+           py::arg("params"), py::arg("num_threads") = 1U)
+      .def("Execute", &PyFrameRotator::Execute, py::arg("src"),
+           py::arg("dst"),
+           "Rotates src frame into dst, returns False if src is too small")
+      .def("Width", &PyFrameRotator::Width)
+      .def("Height", &PyFrameRotator::Height);
+
+  py::class_<PyRawVideoReader>(m, "PyRawVideoReader")
+      .def(py::init<const string &, uint32_t, uint32_t, Pixel_Format>(),
+           py::arg("path"), py::arg("width") = 0U, py::arg("height") = 0U,
+           py::arg("format") = Pixel_Format::UNDEFINED,
+           "Frame size and format are taken from Y4M header if there's one")
+      .def("Width", &PyRawVideoReader::Width)
+      .def("Height", &PyRawVideoReader::Height)
+      .def("Format", &PyRawVideoReader::Format)
+      .def("Framerate", &PyRawVideoReader::Framerate)
+      .def("NumFrames", &PyRawVideoReader::NumFrames)
+      .def("FrameIndex", &PyRawVideoReader::FrameIndex)
+      .def("Seek", &PyRawVideoReader::Seek, py::arg("frame_index"))
+      .def("ReadSingleFrame", &PyRawVideoReader::ReadSingleFrame,
+           py::arg("frame"))
+      .def("Frame", &PyRawVideoReader::Frame, py::arg("frame_index"),
+           "View of memory-mapped frame, nothing is copied; Mapping is "
+           "private, so writes to it don't reach the file");
+
+  py::class_<PyRawVideoWriter>(m, "PyRawVideoWriter")
+      .def(py::init<const string &, uint32_t, uint32_t, Pixel_Format, double,
+                    bool>(),
+           py::arg("path"), py::arg("width"), py::arg("height"),
+           py::arg("format"), py::arg("frame_rate") = 0.0,
+           py::arg("y4m") = false)
+      .def("WriteSingleFrame", &PyRawVideoWriter::WriteSingleFrame,
+           py::arg("frame"))
+      .def("Flush", &PyRawVideoWriter::Flush)
+      .def("NumFrames", &PyRawVideoWriter::NumFrames);
+
+  py::class_<PyImageWriter>(m, "PyImageWriter")
+      .def(py::init<const string &, uint32_t, uint32_t, Pixel_Format,
+                    const ImageWriterParams &>(),
+           py::arg("path_template"), py::arg("width"), py::arg("height"),
+           py::arg("format"), py::arg("params") = ImageWriterParams(),
+           "Path template has single integer format, e. g. frame_%06d.jpg")
+      .def("WriteSingleFrame", &PyImageWriter::WriteSingleFrame,
+           py::arg("frame"),
+           "Copies frame and returns, it's encoded and written in background")
+      .def("Flush", &PyImageWriter::Flush,
+           py::call_guard<py::gil_scoped_release>(),
+           "Waits for all images, returns False if any of them has failed")
+      .def("NumImages", &PyImageWriter::NumImages)
+      .def("NumFailed", &PyImageWriter::NumFailed)
+      .def("NumDropped", &PyImageWriter::NumDropped);
+
+  py::class_<PyFrameCache>(m, "PyFrameCache")
+      .def(py::init<const string &, uint64_t>(), py::arg("dir"),
+           py::arg("budget") = 0U,
+           "Directory of decoded frame cache entries; Budget is in bytes, "
+           "zero means unlimited")
+      .def("EntryPath", &PyFrameCache::EntryPath, py::arg("source"),
+           py::arg("width"), py::arg("height"), py::arg("format"))
+      .def("Lookup", &PyFrameCache::Lookup, py::arg("source"),
+           py::arg("width"), py::arg("height"), py::arg("format"),
+           "True if complete entry exists, marks it as recently used")
+      .def("Evict", &PyFrameCache::Evict, py::arg("reserve") = 0U,
+           "Removes least recently used entries until cache and reserve fit "
+           "the budget; Returns number of bytes removed")
+      .def("Size", &PyFrameCache::Size);
+
+  py::class_<PyFrameCacheWriter>(m, "PyFrameCacheWriter")
+      .def(py::init<const string &, uint32_t, uint32_t, Pixel_Format, bool>(),
+           py::arg("path"), py::arg("width"), py::arg("height"),
+           py::arg("format"), py::arg("compress") = false)
+      .def("WriteSingleFrame",
+           py::overload_cast<const py::array_t<uint8_t> &,
+                             const PacketData &>(
+               &PyFrameCacheWriter::WriteSingleFrame),
+           py::arg("frame"), py::arg("pkt_data"))
+      .def("WriteSingleFrame",
+           py::overload_cast<const py::array_t<uint8_t> &>(
+               &PyFrameCacheWriter::WriteSingleFrame),
+           py::arg("frame"), "Frame index is used as pts")
+      .def("Close", &PyFrameCacheWriter::Close,
+           "Publishes entry, returns False if any write has failed")
+      .def("NumFrames", &PyFrameCacheWriter::NumFrames)
+      .def("NumCompressed", &PyFrameCacheWriter::NumCompressed);
+
+  py::class_<PyFrameCacheReader>(m, "PyFrameCacheReader")
+      .def(py::init<const string &>(), py::arg("path"))
+      .def("Width", &PyFrameCacheReader::Width)
+      .def("Height", &PyFrameCacheReader::Height)
+      .def("Format", &PyFrameCacheReader::Format)
+      .def("NumFrames", &PyFrameCacheReader::NumFrames)
+      .def("FrameIndex", &PyFrameCacheReader::FrameIndex)
+      .def("Seek", &PyFrameCacheReader::Seek, py::arg("frame_index"))
+      .def("SeekToPts", &PyFrameCacheReader::SeekToPts, py::arg("pts"),
+           "Seeks to frame with given pts or the first one after it")
+      .def("DecodeSingleFrame",
+           py::overload_cast<py::array_t<uint8_t> &, PacketData &>(
+               &PyFrameCacheReader::DecodeSingleFrame),
+           py::arg("frame"), py::arg("pkt_data"))
+      .def("DecodeSingleFrame",
+           py::overload_cast<py::array_t<uint8_t> &>(
+               &PyFrameCacheReader::DecodeSingleFrame),
+           py::arg("frame"))
+      .def("Frame", &PyFrameCacheReader::Frame, py::arg("frame_index"),
+           "View of memory-mapped frame if it's stored raw, copy otherwise");
+
+  py::class_<ClipSpec>(m, "ClipSpec")
+      .def(py::init<>())
+      .def_readwrite("length", &ClipSpec::length)
+      .def_readwrite("stride", &ClipSpec::stride)
+      .def_readwrite("fps", &ClipSpec::fps)
+      .def_readwrite("clip_step_sec", &ClipSpec::clip_step_sec)
+      .def_readwrite("width", &ClipSpec::width)
+      .def_readwrite("height", &ClipSpec::height)
+      .def_readwrite("format", &ClipSpec::format);
+
+  py::class_<ClipLoaderParams>(m, "ClipLoaderParams")
+      .def(py::init<>())
+      .def_readwrite("batch_size", &ClipLoaderParams::batch_size)
+      .def_readwrite("num_threads", &ClipLoaderParams::num_threads)
+      .def_readwrite("prefetch", &ClipLoaderParams::prefetch)
+      .def_readwrite("seed", &ClipLoaderParams::seed)
+      .def_readwrite("shuffle", &ClipLoaderParams::shuffle)
+      .def_readwrite("drop_last", &ClipLoaderParams::drop_last)
+      .def_readwrite("pipeline", &ClipLoaderParams::pipeline)
+      .def_readwrite("placement", &ClipLoaderParams::placement);
+
+  py::class_<PyClipLoader>(m, "PyClipLoader")
+      .def(py::init<const vector<string> &, const ClipSpec &,
+                    const ClipLoaderParams &>(),
+           py::arg("files"), py::arg("spec"),
+           py::arg("params") = ClipLoaderParams(),
+           "Probes files and starts epoch 0; Decoding runs on native threads")
+      .def("StartEpoch", &PyClipLoader::StartEpoch, py::arg("epoch"))
+      .def("Next", &PyClipLoader::Next,
+           "Returns (batch, clips) or None at the end of epoch; Batch is "
+           "(clips, length, height, width, channels) view of pooled memory")
+      .def("NumFiles", &PyClipLoader::NumFiles)
+      .def("NumClips", &PyClipLoader::NumClips)
+      .def("NumBatches", &PyClipLoader::NumBatches);
+
+  py::class_<PyImageDecoder>(m, "PyImageDecoder")
+      .def(py::init<uint32_t, uint32_t, Pixel_Format, uint32_t,
+                    const ThreadPlacement &>(),
+           py::arg("width"), py::arg("height"),
+           py::arg("format") = Pixel_Format::RGB, py::arg("num_threads") = 4U,
+           py::arg("placement") = ThreadPlacement(),
+           "Decodes JPEG, PNG and WebP images, every one is resized to given "
+           "size; Format is RGB, BGR, RGB_PLANAR or Y")
+      .def("DecodeFiles", &PyImageDecoder::DecodeFiles, py::arg("paths"),
+           py::arg("as_list") = false,
+           "Returns tuple of batch array and list of flags; Images which "
+           "failed to decode are filled with zeros")
+      .def("DecodeBlobs", &PyImageDecoder::DecodeBlobs, py::arg("blobs"),
+           py::arg("as_list") = false,
+           "Same as DecodeFiles, takes list of bytes or uint8 arrays");
+
+  py::class_<PyAsyncFileSink>(m, "PyAsyncFileSink")
+      .def(py::init<const string &, bool>(), py::arg("path"),
+           py::arg("direct") = false,
+           "Appends data to file through process-wide async writer")
+      .def("Write", &PyAsyncFileSink::Write, py::arg("data"),
+           "Copies data to writer buffer, returns False if write has failed")
+      .def("Flush", &PyAsyncFileSink::Flush,
+           "Waits until everything written so far is on disk")
+      .def("NumBytes", &PyAsyncFileSink::NumBytes);
 
   py::class_<PyFFmpegDemuxer>(m, "PyFFmpegDemuxer")
       .def(py::init<const string &>())
@@ -1222,14 +2304,225 @@ PYBIND11_MODULE(PyNvCodec, m) {
       .def("Width", &PyFFmpegDemuxer::Width)
       .def("Height", &PyFFmpegDemuxer::Height)
       .def("Format", &PyFFmpegDemuxer::Format)
-      .def("Codec", &PyFFmpegDemuxer::Codec);
+      .def("Codec", &PyFFmpegDemuxer::Codec)
+      .def("Rotation", &PyFFmpegDemuxer::Rotation,
+           "Clockwise rotation in degrees stream display matrix asks for")
+      .def("LastPacketData", &PyFFmpegDemuxer::LastPacketData)
+      .def("EnableSliceParsing", &PyFFmpegDemuxer::EnableSliceParsing,
+           py::arg("enable"),
+           "Fill frame type, IDR and reference flags of packet data from "
+           "slice headers")
+      .def("StreamInfo", &PyFFmpegDemuxer::StreamInfo);
+
+  py::class_<MediaInfo>(m, "MediaInfo")
+      .def(py::init<>())
+      .def_readonly("path", &MediaInfo::path)
+      .def_readonly("file_size", &MediaInfo::file_size)
+      .def_readonly("mtime", &MediaInfo::mtime)
+      .def_readonly("error", &MediaInfo::error)
+      .def_readonly("codec", &MediaInfo::codec)
+      .def_readonly("profile", &MediaInfo::profile)
+      .def_readonly("level", &MediaInfo::level)
+      .def_readonly("width", &MediaInfo::width)
+      .def_readonly("height", &MediaInfo::height)
+      .def_readonly("chroma_format_idc", &MediaInfo::chroma_format_idc)
+      .def_readonly("bit_depth", &MediaInfo::bit_depth)
+      .def_readonly("frame_rate", &MediaInfo::frame_rate)
+      .def_readonly("duration", &MediaInfo::duration)
+      .def_readonly("bit_rate", &MediaInfo::bit_rate)
+      .def_readonly("num_frames", &MediaInfo::num_frames)
+      .def_readonly("num_keyframes", &MediaInfo::num_keyframes)
+      .def_readonly("max_gop_size", &MediaInfo::max_gop_size)
+      .def_readonly("avg_gop_size", &MediaInfo::avg_gop_size);
+
+  py::class_<ProbeStats>(m, "ProbeStats")
+      .def(py::init<>())
+      .def_readonly("num_probed", &ProbeStats::num_probed)
+      .def_readonly("num_cached", &ProbeStats::num_cached)
+      .def_readonly("num_failed", &ProbeStats::num_failed)
+      .def_readonly("probe_sec", &ProbeStats::probe_sec);
+
+  py::class_<PyProbeService>(m, "PyProbeService")
+      .def(py::init<const string &, uint32_t, bool>(), py::arg("db_path"),
+           py::arg("num_threads") = 0U, py::arg("scan_gop") = false)
+      .def("Probe", &PyProbeService::Probe, py::arg("paths"))
+      .def("Query", &PyProbeService::Query, py::arg("paths"))
+      .def("QueryAll", &PyProbeService::QueryAll)
+      .def("Size", &PyProbeService::Size);
+
+  py::class_<PyFrameRateConverter>(m, "PyFrameRateConverter")
+      .def(py::init<double, double, FrameRateMode, bool, double>(),
+           py::arg("target_fps"), py::arg("time_base"),
+           py::arg("mode") = FrameRateMode::FRC_NEAREST,
+           py::arg("packet_level") = false, py::arg("src_fps") = 0.0)
+      .def("Select", &PyFrameRateConverter::Select, py::arg("pkt_data"))
+      .def("Reset", &PyFrameRateConverter::Reset);
+
+  py::class_<ActivityParams>(m, "ActivityParams")
+      .def(py::init<>())
+      .def_readwrite("threshold", &ActivityParams::threshold)
+      .def_readwrite("warmup_frames", &ActivityParams::warmup_frames)
+      .def_readwrite("window_frames", &ActivityParams::window_frames)
+      .def_readwrite("merge_gap_sec", &ActivityParams::merge_gap_sec)
+      .def_readwrite("pre_roll_sec", &ActivityParams::pre_roll_sec)
+      .def_readwrite("post_roll_sec", &ActivityParams::post_roll_sec);
+
+  py::class_<ActivityEstimator>(m, "ActivityEstimator")
+      .def(py::init<const ActivityParams &>(),
+           py::arg("params") = ActivityParams())
+      .def("Update", &ActivityEstimator::Update, py::arg("frame_type"),
+           py::arg("num_bytes"), py::arg("mv_energy") = -1.0,
+           "Returns activity score of frame, negative mv_energy means it's "
+           "unknown")
+      .def("IsActive", &ActivityEstimator::IsActive, py::arg("score"))
+      .def("Reset", &ActivityEstimator::Reset);
+
+  py::class_<FrameActivity>(m, "FrameActivity")
+      .def(py::init<>())
+      .def_readonly("time", &FrameActivity::time)
+      .def_readonly("num_bytes", &FrameActivity::num_bytes)
+      .def_readonly("frame_type", &FrameActivity::frame_type)
+      .def_readonly("is_keyframe", &FrameActivity::is_keyframe)
+      .def_readonly("score", &FrameActivity::score)
+      .def_readonly("is_active", &FrameActivity::is_active);
+
+  py::class_<ActivitySegment>(m, "ActivitySegment")
+      .def(py::init<>())
+      .def_readonly("start_time", &ActivitySegment::start_time)
+      .def_readonly("end_time", &ActivitySegment::end_time)
+      .def_readonly("keyframe_packet", &ActivitySegment::keyframe_packet)
+      .def_readonly("keyframe_pts", &ActivitySegment::keyframe_pts)
+      .def_readonly("num_active", &ActivitySegment::num_active)
+      .def_readonly("max_score", &ActivitySegment::max_score);
+
+  py::class_<ActivityReport>(m, "ActivityReport")
+      .def(py::init<>())
+      .def_readonly("frames", &ActivityReport::frames)
+      .def_readonly("segments", &ActivityReport::segments)
+      .def_readonly("num_active", &ActivityReport::num_active)
+      .def_readonly("duration_sec", &ActivityReport::duration_sec)
+      .def_readonly("active_share", &ActivityReport::active_share);
+
+  py::class_<VideoStreamInfo>(m, "StreamInfo")
+      .def(py::init<>())
+      .def_readonly("codec", &VideoStreamInfo::codec)
+      .def_readonly("profile", &VideoStreamInfo::profile)
+      .def_readonly("level", &VideoStreamInfo::level)
+      .def_readonly("tier", &VideoStreamInfo::tier)
+      .def_readonly("coded_width", &VideoStreamInfo::coded_width)
+      .def_readonly("coded_height", &VideoStreamInfo::coded_height)
+      .def_readonly("width", &VideoStreamInfo::width)
+      .def_readonly("height", &VideoStreamInfo::height)
+      .def_readonly("crop_left", &VideoStreamInfo::crop_left)
+      .def_readonly("crop_right", &VideoStreamInfo::crop_right)
+      .def_readonly("crop_top", &VideoStreamInfo::crop_top)
+      .def_readonly("crop_bottom", &VideoStreamInfo::crop_bottom)
+      .def_readonly("chroma_format_idc", &VideoStreamInfo::chroma_format_idc)
+      .def_readonly("bit_depth_luma", &VideoStreamInfo::bit_depth_luma)
+      .def_readonly("bit_depth_chroma", &VideoStreamInfo::bit_depth_chroma)
+      .def_readonly("progressive", &VideoStreamInfo::progressive)
+      .def_readonly("sar_width", &VideoStreamInfo::sar_width)
+      .def_readonly("sar_height", &VideoStreamInfo::sar_height)
+      .def_readonly("video_full_range", &VideoStreamInfo::video_full_range)
+      .def_readonly("colour_primaries", &VideoStreamInfo::colour_primaries)
+      .def_readonly("transfer_characteristics",
+                    &VideoStreamInfo::transfer_characteristics)
+      .def_readonly("matrix_coefficients",
+                    &VideoStreamInfo::matrix_coefficients)
+      .def_readonly("num_units_in_tick", &VideoStreamInfo::num_units_in_tick)
+      .def_readonly("time_scale", &VideoStreamInfo::time_scale)
+      .def_readonly("frame_rate", &VideoStreamInfo::frame_rate)
+      .def_readonly("has_pps", &VideoStreamInfo::has_pps)
+      .def_readonly("cabac", &VideoStreamInfo::cabac)
+      .def_readonly("tiles", &VideoStreamInfo::tiles)
+      .def_readonly("wavefront", &VideoStreamInfo::wavefront);
+
+  py::class_<TaskPerfStats>(m, "TaskPerfStats")
+      .def(py::init<>())
+      .def_readonly("num_calls", &TaskPerfStats::num_calls)
+      .def_readonly("wall_time_ns", &TaskPerfStats::wall_time_ns)
+      .def_readonly("cycles", &TaskPerfStats::cycles)
+      .def_readonly("instructions", &TaskPerfStats::instructions)
+      .def_readonly("llc_misses", &TaskPerfStats::llc_misses)
+      .def_readonly("branch_misses", &TaskPerfStats::branch_misses)
+      .def_readonly("hw_counters", &TaskPerfStats::hw_counters)
+      .def("IPC", &TaskPerfStats::IPC)
+      .def("WallTimePerFrame", &TaskPerfStats::WallTimePerCall)
+      .def("LlcMissesPerFrame", &TaskPerfStats::LlcMissesPerCall)
+      .def("BranchMissesPerFrame", &TaskPerfStats::BranchMissesPerCall);
+
+  py::class_<MemoryUsage>(m, "MemoryUsage")
+      .def(py::init<>())
+      .def_readonly("current", &MemoryUsage::current)
+      .def_readonly("peak", &MemoryUsage::peak)
+      .def_readonly("num_waits", &MemoryUsage::num_waits)
+      .def_readonly("num_drops", &MemoryUsage::num_drops);
+
+  py::class_<DecodeErrorStats>(m, "DecodeErrorStats")
+      .def(py::init<>())
+      .def_readonly("num_decode_errors", &DecodeErrorStats::num_decode_errors)
+      .def_readonly("num_demux_errors", &DecodeErrorStats::num_demux_errors)
+      .def_readonly("num_skipped_frames",
+                    &DecodeErrorStats::num_skipped_frames)
+      .def_readonly("num_corrupt_frames",
+                    &DecodeErrorStats::num_corrupt_frames)
+      .def_readonly("num_recoveries", &DecodeErrorStats::num_recoveries);
 
   py::class_<PacketData>(m, "PacketData")
       .def(py::init<>())
-      .def_readonly("pts", &PacketData::pts)
-      .def_readonly("dts", &PacketData::dts)
-      .def_readonly("pos", &PacketData::pos)
-      .def_readonly("duration", &PacketData::duration);
+      .def_readwrite("pts", &PacketData::pts)
+      .def_readwrite("dts", &PacketData::dts)
+      .def_readwrite("pos", &PacketData::pos)
+      .def_readwrite("duration", &PacketData::duration)
+      .def_readwrite("frame_type", &PacketData::frame_type)
+      .def_readwrite("is_keyframe", &PacketData::is_keyframe)
+      .def_readwrite("is_idr", &PacketData::is_idr)
+      .def_readwrite("is_reference", &PacketData::is_reference);
+
+  py::class_<GopInfo>(m, "GopInfo")
+      .def(py::init<>())
+      .def_readonly("first_packet", &GopInfo::first_packet)
+      .def_readonly("num_frames", &GopInfo::num_frames)
+      .def_readonly("num_i", &GopInfo::num_i)
+      .def_readonly("num_p", &GopInfo::num_p)
+      .def_readonly("num_b", &GopInfo::num_b)
+      .def_readonly("num_bytes", &GopInfo::num_bytes)
+      .def_readonly("duration_sec", &GopInfo::duration_sec)
+      .def_readonly("is_idr", &GopInfo::is_idr);
+
+  py::class_<StreamAnalysis>(m, "StreamAnalysis")
+      .def(py::init<>())
+      .def_readonly("num_frames", &StreamAnalysis::num_frames)
+      .def_readonly("num_i", &StreamAnalysis::num_i)
+      .def_readonly("num_p", &StreamAnalysis::num_p)
+      .def_readonly("num_b", &StreamAnalysis::num_b)
+      .def_readonly("num_unknown", &StreamAnalysis::num_unknown)
+      .def_readonly("num_idr", &StreamAnalysis::num_idr)
+      .def_readonly("num_reference", &StreamAnalysis::num_reference)
+      .def_readonly("max_consecutive_b", &StreamAnalysis::max_consecutive_b)
+      .def_readonly("num_bytes", &StreamAnalysis::num_bytes)
+      .def_readonly("duration_sec", &StreamAnalysis::duration_sec)
+      .def_readonly("avg_bitrate", &StreamAnalysis::avg_bitrate)
+      .def_readonly("max_bitrate", &StreamAnalysis::max_bitrate)
+      .def_readonly("gops", &StreamAnalysis::gops)
+      .def_readonly("bitrate", &StreamAnalysis::bitrate);
+
+  py::class_<DecoderPoolStats>(m, "DecoderPoolStats")
+      .def(py::init<>())
+      .def_readonly("num_demuxers_created",
+                    &DecoderPoolStats::num_demuxers_created)
+      .def_readonly("num_demuxers_reused",
+                    &DecoderPoolStats::num_demuxers_reused)
+      .def_readonly("num_decoders_created",
+                    &DecoderPoolStats::num_decoders_created)
+      .def_readonly("num_decoders_reused",
+                    &DecoderPoolStats::num_decoders_reused)
+      .def_readonly("num_decoders_reconfigured",
+                    &DecoderPoolStats::num_decoders_reconfigured)
+      .def_readonly("num_cold_sessions", &DecoderPoolStats::num_cold_sessions)
+      .def_readonly("num_warm_sessions", &DecoderPoolStats::num_warm_sessions)
+      .def_readonly("cold_setup_sec", &DecoderPoolStats::cold_setup_sec)
+      .def_readonly("warm_setup_sec", &DecoderPoolStats::warm_setup_sec);
 
   py::class_<PyNvDecoder>(m, "PyNvDecoder")
       .def(py::init<uint32_t, uint32_t, Pixel_Format, cudaVideoCodec,
@@ -1243,6 +2536,9 @@ PYBIND11_MODULE(PyNvCodec, m) {
       .def("Timebase", &PyNvDecoder::Timebase)
       .def("Framesize", &PyNvDecoder::Framesize)
       .def("Format", &PyNvDecoder::GetPixelFormat)
+      .def("DecodeSingleSurface",
+           py::overload_cast<PacketData &>(&PyNvDecoder::DecodeSingleSurface),
+           py::arg("pkt_data"), py::return_value_policy::take_ownership)
       .def("DecodeSingleSurface",
            py::overload_cast<py::array_t<uint8_t> &>(
                &PyNvDecoder::DecodeSingleSurface),
@@ -1250,6 +2546,11 @@ PYBIND11_MODULE(PyNvCodec, m) {
       .def("DecodeSingleSurface",
            py::overload_cast<>(&PyNvDecoder::DecodeSingleSurface),
            py::return_value_policy::take_ownership)
+      .def("DecodeSurfaceFromPacket",
+           py::overload_cast<const PacketData &, py::array_t<uint8_t> &,
+                             PacketData &>(
+               &PyNvDecoder::DecodeSurfaceFromPacket),
+           py::arg("enc_pkt_data"), py::arg("packet"), py::arg("pkt_data"))
       .def("DecodeSurfaceFromPacket",
            py::overload_cast<py::array_t<uint8_t> &, py::array_t<uint8_t> &>(
                &PyNvDecoder::DecodeSurfaceFromPacket),
@@ -1258,6 +2559,10 @@ PYBIND11_MODULE(PyNvCodec, m) {
            py::overload_cast<py::array_t<uint8_t> &>(
                &PyNvDecoder::DecodeSurfaceFromPacket),
            py::arg("packet"))
+      .def("DecodeSingleFrame",
+           py::overload_cast<py::array_t<uint8_t> &, PacketData &>(
+               &PyNvDecoder::DecodeSingleFrame),
+           py::arg("frame"), py::arg("pkt_data"))
       .def("DecodeSingleFrame",
            py::overload_cast<py::array_t<uint8_t> &, py::array_t<uint8_t> &>(
                &PyNvDecoder::DecodeSingleFrame),
@@ -1266,6 +2571,12 @@ PYBIND11_MODULE(PyNvCodec, m) {
            py::overload_cast<py::array_t<uint8_t> &>(
                &PyNvDecoder::DecodeSingleFrame),
            py::arg("frame"))
+      .def("DecodeFrameFromPacket",
+           py::overload_cast<py::array_t<uint8_t> &, const PacketData &,
+                             py::array_t<uint8_t> &, PacketData &>(
+               &PyNvDecoder::DecodeFrameFromPacket),
+           py::arg("frame"), py::arg("enc_pkt_data"), py::arg("packet"),
+           py::arg("pkt_data"))
       .def("DecodeFrameFromPacket",
            py::overload_cast<py::array_t<uint8_t> &, py::array_t<uint8_t> &,
                              py::array_t<uint8_t> &>(
@@ -1275,9 +2586,19 @@ PYBIND11_MODULE(PyNvCodec, m) {
            py::overload_cast<py::array_t<uint8_t> &, py::array_t<uint8_t> &>(
                &PyNvDecoder::DecodeFrameFromPacket),
            py::arg("frame"), py::arg("packet"))
-      .def("FlushSingleSurface", &PyNvDecoder::FlushSingleSurface,
+      .def("FlushSingleSurface",
+           py::overload_cast<PacketData &>(&PyNvDecoder::FlushSingleSurface),
+           py::arg("pkt_data"), py::return_value_policy::take_ownership)
+      .def("FlushSingleSurface",
+           py::overload_cast<>(&PyNvDecoder::FlushSingleSurface),
            py::return_value_policy::take_ownership)
-      .def("FlushSingleFrame", &PyNvDecoder::FlushSingleFrame,
+      .def("FlushSingleFrame",
+           py::overload_cast<py::array_t<uint8_t> &, PacketData &>(
+               &PyNvDecoder::FlushSingleFrame),
+           py::arg("frame"), py::arg("pkt_data"))
+      .def("FlushSingleFrame",
+           py::overload_cast<py::array_t<uint8_t> &>(
+               &PyNvDecoder::FlushSingleFrame),
            py::arg("frame"));
 
   py::class_<PyFrameUploader>(m, "PyFrameUploader")
@@ -1305,4 +2626,138 @@ PYBIND11_MODULE(PyNvCodec, m) {
            py::return_value_policy::take_ownership);
 
   m.def("GetNumGpus", &CudaResMgr::GetNumGpus);
+
+  m.def(
+      "GetDecoderPoolStats",
+      [](uint32_t gpu_id) {
+        DecoderPoolStats stats;
+        if (gpu_id < CudaResMgr::GetNumGpus()) {
+          CudaResMgr::Instance().GetDecoderPool(gpu_id).GetStats(stats);
+        }
+        return stats;
+      },
+      py::arg("gpu_id") = 0U,
+      "Returns stats of pool PyNvDecoder takes decoders from");
+
+  m.def(
+      "AnalyzeStream",
+      [](const string &input, const map<string, string> &demux_options,
+         double window_sec, double step_sec) {
+        StreamAnalyzerParams params;
+        params.input = input;
+        params.demux_options = demux_options;
+        params.window_sec = window_sec;
+        params.step_sec = step_sec;
+
+        StreamAnalysis analysis;
+        {
+          py::gil_scoped_release release;
+          unique_ptr<StreamAnalyzer> analyzer(StreamAnalyzer::Make(params));
+          analyzer->Run();
+          analyzer->GetAnalysis(analysis);
+        }
+        return analysis;
+      },
+      py::arg("input"), py::arg("demux_options") = map<string, string>(),
+      py::arg("window_sec") = 1.0, py::arg("step_sec") = 1.0,
+      "Reads input without decoding, returns GOP structure, frame types and "
+      "bitrate curve");
+
+  m.def(
+      "SampleActivity",
+      [](const string &input, const ActivityParams &params,
+         const map<string, string> &demux_options) {
+        ActivityReport report;
+        {
+          py::gil_scoped_release release;
+          unique_ptr<ActivitySampler> sampler(
+              ActivitySampler::Make(input, demux_options, params));
+          sampler->Run();
+          sampler->GetReport(report);
+        }
+        return report;
+      },
+      py::arg("input"), py::arg("params") = ActivityParams(),
+      py::arg("demux_options") = map<string, string>(),
+      "Scores frames by packet sizes without decoding, returns segments "
+      "which are worth full decoding");
+
+  m.def(
+      "MotionVectorEnergy",
+      [](py::array_t<MotionVector> &mvs, uint32_t width, uint32_t height) {
+        auto req = mvs.request();
+        return MotionVectorEnergy(static_cast<MotionVector *>(req.ptr),
+                                  (size_t)mvs.size(), width, height);
+      },
+      py::arg("mvs"), py::arg("width"), py::arg("height"),
+      "Mean motion vector length weighted by block area, to be given to "
+      "ActivityEstimator.Update");
+
+  m.def(
+      "ParseParameterSets",
+      [](cudaVideoCodec codec, py::array_t<uint8_t> &data) -> py::object {
+        VideoStreamInfo info;
+        if (!ParseParameterSets(codec, data.data(), data.size(), info)) {
+          return py::none();
+        }
+        return py::cast(info);
+      },
+      py::arg("codec"), py::arg("data"),
+      "Parses H.264 / HEVC extradata or Annex B packet, returns StreamInfo "
+      "or None");
+
+  m.def("EnableTaskTiming", &EnableTaskTiming, py::arg("enable"));
+  m.def("EnablePerfCounters", &EnablePerfCounters, py::arg("enable"));
+  m.def("PerfCountersAvailable", &PerfCountersAvailable);
+  m.def("GetTaskPerfStats", &GetPerfStatsByTaskName);
+  m.def("ResetTaskPerfStats", &ResetPerfStatsByTaskName);
+
+  m.def("GetNumaNodes", &GetNumaNodes,
+        "Returns NUMA nodes with CPUs process may run on");
+  m.def("GetCurrentNumaNode", &GetCurrentNumaNode);
+
+  m.def("SetMemoryBudget",
+        [](uint64_t bytes) { MemoryBudget::Instance().SetLimit(bytes); },
+        py::arg("bytes"),
+        "Limits memory held by pools and queues of all pipelines, 0 means "
+        "no limit");
+  m.def("GetMemoryBudget",
+        []() { return MemoryBudget::Instance().GetLimit(); });
+  m.def("GetMemoryUsage", []() { return MemoryBudget::Instance().GetUsage(); },
+        "Returns dictionary of MemoryUsage by pipeline name");
+  m.def("GetTotalMemoryUsage",
+        []() { return MemoryBudget::Instance().GetTotalUsage(); });
+  m.def("ResetMemoryStats", []() { MemoryBudget::Instance().ResetStats(); });
+
+  m.def("SetLogLevel",
+        [](LogLevel level) { Logger::Instance().SetLevel(level); },
+        py::arg("level"));
+  m.def("SetComponentLogLevel",
+        [](const string &component, LogLevel level) {
+          Logger::Instance().SetComponentLevel(component, level);
+        },
+        py::arg("component"), py::arg("level"));
+  m.def("ResetComponentLogLevels",
+        []() { Logger::Instance().ResetComponentLevels(); });
+  m.def("SetLogRateLimit",
+        [](uint32_t msgs_per_second) {
+          Logger::Instance().SetRateLimit(msgs_per_second);
+        },
+        py::arg("msgs_per_second"));
+  m.def("SetLogCallback", &SetLogCallback, py::arg("callback"));
+  m.def("RouteLogsToPython", &RouteLogsToPython);
+  m.def("FlushLogs", []() { Logger::Instance().Flush(); },
+        py::call_guard<py::gil_scoped_release>());
+  m.def("GetNumDroppedLogs",
+        []() { return Logger::Instance().GetNumDropped(); });
+
+  /* Python sink must not outlive interpreter;
+   */
+  py::module::import("atexit").attr("register")(py::cpp_function([]() {
+    {
+      py::gil_scoped_release nogil;
+      Logger::Instance().Flush();
+    }
+    SwapLogSink(Logger::LogSink());
+  }));
 }
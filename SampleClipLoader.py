@@ -0,0 +1,69 @@
+#
+# Copyright 2020 NVIDIA Corporation
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#    http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+
+import PyNvCodec as nvc
+import numpy as np
+import sys
+import time
+
+num_epochs = 2
+
+def load(files):
+    spec = nvc.ClipSpec()
+    spec.length = 16
+    spec.fps = 15.0
+    spec.width = 224
+    spec.height = 224
+    spec.format = nvc.PixelFormat.RGB
+
+    params = nvc.ClipLoaderParams()
+    params.batch_size = 8
+    params.num_threads = 8
+    params.seed = 42
+
+    loader = nvc.PyClipLoader(files, spec, params)
+    print(loader.NumFiles(), "files,", loader.NumClips(), "clips")
+
+    for epoch in range(0, num_epochs):
+        loader.StartEpoch(epoch)
+        start = time.time()
+        num_clips = 0
+
+        while True:
+            result = loader.Next()
+            if result is None:
+                break
+
+            # Batch is numpy view of loader memory, no copy is made;
+            batch, clips = result
+            num_clips += batch.shape[0]
+            failed = [clip for clip in clips if not clip[2]]
+            if len(failed):
+                print("Failed clips:", failed)
+
+        elapsed = time.time() - start
+        print("Epoch", epoch, ":", num_clips, "clips in", round(elapsed, 2), "s")
+
+if __name__ == "__main__":
+
+    print("This sample loads shuffled 16 frames clips of 224x224 RGB from input videos using FFmpeg CPU-based decoder.")
+    print("Usage: SampleClipLoader.py $input_file ...")
+
+    if(len(sys.argv) < 2):
+        print("Provide path to input files")
+        exit(1)
+
+    load(sys.argv[1:])
@@ -0,0 +1,63 @@
+/*
+ * Copyright 2020 NVIDIA Corporation
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "PipelineSpec.hpp"
+#include <ostream>
+
+namespace VPF {
+
+/* Native pipeline built from spec;
+ * Every stage is VPF Task, so per-stage stats come from Task::GetPerfStats;
+ */
+class Pipeline {
+public:
+  Pipeline() = delete;
+  Pipeline(const Pipeline &other) = delete;
+  Pipeline &operator=(const Pipeline &other) = delete;
+
+  /* Builds all the stages; Throws if spec can't be fulfilled
+   * (e. g. unsupported color conversion);
+   */
+  explicit Pipeline(const PipelineSpec &spec);
+  ~Pipeline();
+
+  /* Runs until input is over or frames limit is reached, flushes encoder;
+   * Returns number of processed frames;
+   */
+  uint64_t Run();
+
+  /* Prints per-stage statistics table;
+   */
+  void PrintStats(std::ostream &os) const;
+
+private:
+  struct Pipeline_Impl *pImpl = nullptr;
+};
+
+/* Transcodes input with ChunkedTranscoder when spec has several workers;
+ * Prints summary and returns number of encoded frames;
+ */
+uint64_t RunChunkedTranscode(const PipelineSpec &spec, std::ostream &os);
+
+/* Runs AbrLadder when spec has renditions;
+ * Prints summary and returns number of decoded frames;
+ */
+uint64_t RunAbrLadder(const PipelineSpec &spec, std::ostream &os);
+
+/* Runs jobs from spec batch list with JobScheduler;
+ * Prints state of every job and returns number of failed jobs;
+ */
+uint64_t RunBatch(const PipelineSpec &spec, std::ostream &os);
+} // namespace VPF
@@ -0,0 +1,151 @@
+/*
+ * Copyright 2020 NVIDIA Corporation
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "AbrLadder.hpp"
+#include "JobScheduler.hpp"
+#include "MemoryInterfaces.hpp"
+#include <map>
+#include <string>
+#include <vector>
+
+namespace VPF {
+
+enum class DecoderType { DECODER_HW, DECODER_SW };
+
+struct ThumbnailSpec {
+  // Output directory, empty means thumbnails are disabled;
+  std::string dir;
+  // Save every N-th frame;
+  uint32_t every = 1U;
+  // Thumbnail size, zero means processed frame size;
+  uint32_t width = 0U;
+  uint32_t height = 0U;
+};
+
+/* Batch mode settings; Capacity defaults are conservative for single GPU
+ * node, Nvenc sessions count is limited on consumer GPUs;
+ */
+struct BatchSpec {
+  // JSON array of job specs, empty means batch mode is off;
+  std::string jobs;
+  std::string journal;
+  // Zero means number of CPU threads;
+  uint32_t workers = 0U;
+  JobResources capacity;
+
+  BatchSpec();
+};
+
+/* Declarative description of single pipeline;
+ * Stages are always executed in following order:
+ * demux -> fps -> decode -> fps -> convert -> resize -> sinks (raw, hash,
+ *                                                       thumbnail)
+ *                                                    -> encode -> mux
+ */
+struct PipelineSpec {
+  std::string input;
+  std::map<std::string, std::string> demux_options;
+
+  DecoderType decoder = DecoderType::DECODER_HW;
+  int gpu_id = 0;
+
+  /* Output frame rate, zero means input rate is kept; Frames are chosen by
+   * timestamps, non-reference frames which would be dropped aren't decoded;
+   */
+  double fps = 0.0;
+  FrameRateMode fps_mode = FRC_NEAREST;
+
+  // Chain of color conversions applied to decoded frame;
+  std::vector<Pixel_Format> convert;
+
+  // Zero means no resize;
+  uint32_t resize_width = 0U;
+  uint32_t resize_height = 0U;
+
+  // Nvenc options in PyNvEncoder format (codec, preset, bitrate, etc.);
+  bool encode = false;
+  std::map<std::string, std::string> encoder_options;
+  // Elementary stream or any container supported by FFmpeg;
+  std::string output;
+
+  // Sinks, empty string means sink is disabled;
+  std::string raw_output;
+  std::string hash_output;
+  bool hash = false;
+  ThumbnailSpec thumbnail;
+
+  // Zero means whole input;
+  uint64_t max_frames = 0U;
+
+  /* More than one worker switches to chunked transcoding: input is split at
+   * keyframes and chunks are transcoded concurrently;
+   */
+  uint32_t workers = 1U;
+  uint32_t chunk_frames = 250U;
+
+  /* Non-empty checkpoint file switches to chunked transcoding as well, so
+   * that interrupted transcode is resumed from the last finished chunk;
+   */
+  std::string checkpoint;
+
+  /* Non-empty list switches to ABR ladder mode: input is decoded once and
+   * encoded into every rendition, encoder options are shared by renditions;
+   */
+  std::vector<AbrRendition> renditions;
+  uint32_t ladder_gop = 60U;
+  uint32_t segment_frames = 0U;
+  bool ladder_cascade = true;
+
+  BatchSpec batch;
+
+  bool perf_counters = false;
+  bool verbose = false;
+};
+
+struct JobSpec {
+  std::string id;
+  int priority = 0;
+  JobResources cost;
+  PipelineSpec pipeline;
+};
+
+/* Parses JSON array of pipeline specs; Every spec may also have "id"
+ * (input is used by default), "priority" and "cost" keys;
+ * Cost is estimated from spec unless given;
+ */
+void ParseJobList(const std::string &path, std::vector<JobSpec> &jobs);
+
+JobResources EstimateJobCost(const PipelineSpec &spec);
+
+/* Parses command line into spec; If --spec is given, JSON file is parsed
+ * first and the rest of command line options override it;
+ * Throws std::invalid_argument on malformed input;
+ */
+void ParseCommandLine(int argc, char **argv, PipelineSpec &spec);
+
+/* Parses JSON spec file; Throws std::invalid_argument on malformed input;
+ */
+void ParseJsonSpec(const std::string &path, PipelineSpec &spec);
+
+/* Checks spec consistency; Throws std::invalid_argument if spec is invalid;
+ */
+void ValidateSpec(const PipelineSpec &spec);
+
+Pixel_Format PixelFormatFromString(const std::string &name);
+
+const char *PixelFormatToString(Pixel_Format format);
+
+const char *Usage();
+} // namespace VPF
@@ -0,0 +1,870 @@
+/*
+ * Copyright 2020 NVIDIA Corporation
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Pipeline.hpp"
+#include "AbrLadder.hpp"
+#include "ChunkedTranscoder.hpp"
+#include "EncodedOutput.hpp"
+#include "Logger.hpp"
+#include "Tasks.hpp"
+#include <chrono>
+#include <cstdio>
+#include <iomanip>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+using namespace std;
+using namespace std::chrono;
+using namespace VPF;
+
+constexpr auto TASK_EXEC_SUCCESS = TaskExecStatus::TASK_EXEC_SUCCESS;
+constexpr auto TASK_EXEC_FAIL = TaskExecStatus::TASK_EXEC_FAIL;
+
+namespace {
+
+void ThrowOnCudaError(CUresult res, int lineNum) {
+  if (CUDA_SUCCESS != res) {
+    stringstream ss;
+    ss << __FILE__ << ":" << lineNum << ": CUDA error with code " << res;
+
+    const char *errDesc = nullptr;
+    if (CUDA_SUCCESS == cuGetErrorString(res, &errDesc) && errDesc) {
+      ss << ": " << errDesc;
+    }
+
+    throw runtime_error(ss.str());
+  }
+}
+
+struct CudaResources {
+  CUcontext ctx = nullptr;
+  CUstream str = nullptr;
+
+  explicit CudaResources(int gpu_id) {
+    ThrowOnCudaError(cuInit(0), __LINE__);
+
+    int num_gpus = 0;
+    ThrowOnCudaError(cuDeviceGetCount(&num_gpus), __LINE__);
+    if (gpu_id >= num_gpus) {
+      stringstream ss;
+      ss << "GPU " << gpu_id << " not found, " << num_gpus << " available";
+      throw invalid_argument(ss.str());
+    }
+
+    CUdevice device = 0;
+    ThrowOnCudaError(cuDeviceGet(&device, gpu_id), __LINE__);
+    ThrowOnCudaError(cuCtxCreate(&ctx, 0, device), __LINE__);
+    ThrowOnCudaError(cuStreamCreate(&str, 0), __LINE__);
+    cuCtxPopCurrent(nullptr);
+  }
+
+  ~CudaResources() {
+    if (str) {
+      CudaCtxPush push(ctx);
+      cuStreamDestroy(str);
+    }
+
+    if (ctx) {
+      cuCtxDestroy(ctx);
+    }
+  }
+};
+
+/* Sinks are Tasks as well, so they get same instrumentation as the rest
+ * of the pipeline;
+ */
+
+/* FNV-1a over every frame; Overall digest is calculated over per-frame
+ * digests, so it doesn't depend on how frames are split into buffers;
+ */
+class HashSink final : public Task {
+public:
+  explicit HashSink(const string &path) : Task("HashSink", 1U, 0U) {
+    if (!path.empty()) {
+      file = fopen(path.c_str(), "w");
+      if (!file) {
+        throw invalid_argument("Can't open " + path + " for writing");
+      }
+    }
+  }
+
+  ~HashSink() final {
+    if (file) {
+      fclose(file);
+    }
+  }
+
+  TaskExecStatus Execute() final {
+    auto pBuffer = (Buffer *)GetInput(0U);
+    if (!pBuffer) {
+      return TASK_EXEC_FAIL;
+    }
+
+    auto frame_hash = Fnv1a(fnv_offset, pBuffer->GetDataAs<uint8_t>(),
+                            pBuffer->GetRawMemSize());
+    digest = Fnv1a(digest, (const uint8_t *)&frame_hash, sizeof(frame_hash));
+
+    if (file) {
+      fprintf(file, "%llu %016llx\n", (unsigned long long)num_frames,
+              (unsigned long long)frame_hash);
+    }
+    num_frames++;
+
+    return TASK_EXEC_SUCCESS;
+  }
+
+  uint64_t Digest() const { return digest; }
+
+private:
+  static const uint64_t fnv_offset = 14695981039346656037ULL;
+  static const uint64_t fnv_prime = 1099511628211ULL;
+
+  static uint64_t Fnv1a(uint64_t hash, const uint8_t *data, size_t size) {
+    for (size_t i = 0U; i < size; i++) {
+      hash ^= data[i];
+      hash *= fnv_prime;
+    }
+    return hash;
+  }
+
+  FILE *file = nullptr;
+  uint64_t digest = fnv_offset;
+  uint64_t num_frames = 0U;
+};
+
+/* Saves packed RGB frames as binary PPM images;
+ */
+class PpmSink final : public Task {
+public:
+  PpmSink(const string &dir, uint32_t width, uint32_t height)
+      : Task("PpmSink", 1U, 0U), dir(dir), width(width), height(height) {}
+
+  void SetFrameNumber(uint64_t number) { frame_number = number; }
+
+  TaskExecStatus Execute() final {
+    auto pBuffer = (Buffer *)GetInput(0U);
+    if (!pBuffer || pBuffer->GetRawMemSize() != width * height * 3U) {
+      return TASK_EXEC_FAIL;
+    }
+
+    char name[32] = {0};
+    snprintf(name, sizeof(name), "/thumb_%06llu.ppm",
+             (unsigned long long)frame_number);
+
+    auto file = fopen((dir + name).c_str(), "wb");
+    if (!file) {
+      VPF_LOG(LOG_LEVEL_ERROR, "PpmSink") << "Can't open " << dir + name;
+      return TASK_EXEC_FAIL;
+    }
+
+    fprintf(file, "P6\n%u %u\n255\n", width, height);
+    auto const size = pBuffer->GetRawMemSize();
+    auto res = fwrite(pBuffer->GetRawMemPtr(), 1U, size, file);
+    fclose(file);
+
+    return (size == res) ? TASK_EXEC_SUCCESS : TASK_EXEC_FAIL;
+  }
+
+private:
+  string dir;
+  uint32_t width;
+  uint32_t height;
+  uint64_t frame_number = 0U;
+};
+
+struct Stage {
+  string label;
+  unique_ptr<Task> task;
+};
+
+void PrintStageTable(ostream &os, const vector<pair<string, Task *>> &stages,
+                     double elapsed) {
+  bool hw_counters = false;
+  for (auto &stage : stages) {
+    hw_counters = hw_counters || stage.second->GetPerfStats().hw_counters;
+  }
+
+  os << left << setw(32) << "Stage" << right << setw(10) << "Calls"
+     << setw(12) << "Total, ms" << setw(14) << "Per call, us" << setw(8)
+     << "Share";
+  if (hw_counters) {
+    os << setw(8) << "IPC" << setw(16) << "LLC miss/call";
+  }
+  os << "\n";
+
+  for (auto &stage : stages) {
+    auto stats = stage.second->GetPerfStats();
+    auto const total_ms = stats.wall_time_ns / 1e6;
+    auto const share = elapsed > 0.0 ? total_ms / (elapsed * 10.0) : 0.0;
+
+    os << left << setw(32) << stage.first << right << setw(10)
+       << stats.num_calls << setw(12) << setprecision(1) << total_ms
+       << setw(14) << stats.WallTimePerCall() / 1e3 << setw(7) << share
+       << "%";
+    if (hw_counters && stats.hw_counters) {
+      os << setw(8) << setprecision(2) << stats.IPC() << setw(16)
+         << setprecision(0) << stats.LlcMissesPerCall();
+    }
+    os << "\n";
+  }
+}
+} // namespace
+
+namespace VPF {
+struct Pipeline_Impl {
+  PipelineSpec spec;
+  CudaResources cuda;
+
+  // All the stages in order of creation, owns tasks;
+  vector<Stage> stages;
+
+  // Source;
+  MuxingParams in_params;
+  DemuxFrame *demuxer = nullptr;
+  NvdecDecodeFrame *nvdec = nullptr;
+  FfmpegDecodeFrame *ffdec = nullptr;
+  CudaUploadFrame *uploader = nullptr;
+  bool demuxer_eof = false;
+
+  // Frame rate conversion before and after decoder;
+  FrameRateConverter *packet_frc = nullptr;
+  FrameRateConverter *frame_frc = nullptr;
+  unique_ptr<Buffer> packet_data;
+  Buffer *frame_data = nullptr;
+
+  // Processing;
+  vector<Task *> processing;
+
+  // Sinks;
+  Task *downloader = nullptr;
+  AsyncFileSink *raw_sink = nullptr;
+  HashSink *hash_sink = nullptr;
+  vector<Task *> thumbnail_chain;
+  PpmSink *thumbnail_sink = nullptr;
+
+  // Encode & output;
+  Task *enc_converter = nullptr;
+  NvencEncodeFrame *encoder = nullptr;
+  MuxFrame *muxer = nullptr;
+  AsyncFileSink *es_sink = nullptr;
+  unique_ptr<Buffer> mux_params;
+
+  uint64_t num_frames = 0U;
+  uint64_t num_packets = 0U;
+  double elapsed_sec = 0.0;
+
+  template <typename T> T *AddStage(const string &label, T *task) {
+    Stage stage;
+    stage.label = label;
+    stage.task.reset(task);
+    stages.push_back(move(stage));
+    return task;
+  }
+
+  Task *AddConverter(uint32_t width, uint32_t height, Pixel_Format from,
+                     Pixel_Format to) {
+    stringstream label;
+    label << "ConvertSurface " << PixelFormatToString(from) << "->"
+          << PixelFormatToString(to);
+    return AddStage(label.str(), ConvertSurface::Make(width, height, from, to,
+                                                      cuda.ctx, cuda.str));
+  }
+
+  Task *AddResizer(uint32_t width, uint32_t height, Pixel_Format format) {
+    stringstream label;
+    label << "ResizeSurface " << width << "x" << height;
+    return AddStage(label.str(), ResizeSurface::Make(width, height, format,
+                                                     cuda.ctx, cuda.str));
+  }
+
+  explicit Pipeline_Impl(const PipelineSpec &new_spec)
+      : spec(new_spec), cuda(new_spec.gpu_id) {
+    Pixel_Format format = UNDEFINED;
+    uint32_t width = 0U, height = 0U;
+
+    SetupSource(format, width, height);
+    SetupProcessing(format, width, height);
+    SetupSinks(format, width, height);
+    SetupEncoder(format, width, height);
+  }
+
+  void SetupSource(Pixel_Format &format, uint32_t &width, uint32_t &height) {
+    vector<const char *> options;
+    for (auto &pair : spec.demux_options) {
+      options.push_back(pair.first.c_str());
+      options.push_back(pair.second.c_str());
+    }
+
+    if (DecoderType::DECODER_HW == spec.decoder) {
+      demuxer = AddStage("DemuxFrame",
+                         DemuxFrame::Make(spec.input.c_str(), options.data(),
+                                          options.size()));
+      demuxer->GetParams(in_params);
+      format = in_params.videoContext.format;
+
+      nvdec = AddStage("NvdecDecodeFrame",
+                       NvdecDecodeFrame::Make(
+                           cuda.str, cuda.ctx, in_params.videoContext.codec,
+                           poolFrameSize, in_params.videoContext.width,
+                           in_params.videoContext.height, format));
+    } else {
+      /* FFmpeg decoder doesn't report frame size, so take it from demuxer
+       * which is discarded afterwards;
+       */
+      unique_ptr<DemuxFrame> probe(DemuxFrame::Make(
+          spec.input.c_str(), options.data(), options.size()));
+      probe->GetParams(in_params);
+      probe.reset();
+
+      NvDecoderClInterface cli_iface(spec.demux_options);
+      ffdec = AddStage("FfmpegDecodeFrame",
+                       FfmpegDecodeFrame::Make(spec.input.c_str(), cli_iface));
+
+      // Only YUV420P is supported by FFmpeg decoder so far;
+      format = YUV420;
+      uploader = AddStage("CudaUploadFrame",
+                          CudaUploadFrame::Make(cuda.str, cuda.ctx,
+                                                in_params.videoContext.width,
+                                                in_params.videoContext.height,
+                                                format));
+    }
+
+    width = in_params.videoContext.width;
+    height = in_params.videoContext.height;
+
+    if (spec.fps > 0.0) {
+      FrameRateParams params;
+      params.target_fps = spec.fps;
+      params.time_base = in_params.videoContext.timeBase;
+      params.src_fps = in_params.videoContext.frameRate;
+      params.mode = spec.fps_mode;
+
+      if (nvdec) {
+        // Packet level converter skips packets by their frame type;
+        demuxer->EnableSliceParsing(true);
+        params.packet_level = true;
+        packet_frc = AddStage("FrameRateConverter packets",
+                              FrameRateConverter::Make(params));
+        params.packet_level = false;
+      }
+      frame_frc =
+          AddStage("FrameRateConverter", FrameRateConverter::Make(params));
+    }
+  }
+
+  double OutputFrameRate() const {
+    return (spec.fps > 0.0) ? spec.fps : in_params.videoContext.frameRate;
+  }
+
+  void SetupProcessing(Pixel_Format &format, uint32_t &width,
+                       uint32_t &height) {
+    for (auto to : spec.convert) {
+      if (to != format) {
+        processing.push_back(AddConverter(width, height, format, to));
+        format = to;
+      }
+    }
+
+    if (spec.resize_width && spec.resize_height) {
+      // There's no NV12 resizer, so go through YUV420;
+      if (NV12 == format) {
+        processing.push_back(AddConverter(width, height, NV12, YUV420));
+        format = YUV420;
+      }
+
+      width = spec.resize_width;
+      height = spec.resize_height;
+      processing.push_back(AddResizer(width, height, format));
+    }
+  }
+
+  void SetupSinks(Pixel_Format format, uint32_t width, uint32_t height) {
+    if (!spec.raw_output.empty() || spec.hash) {
+      downloader = AddStage("CudaDownloadSurface",
+                            CudaDownloadSurface::Make(cuda.str, cuda.ctx, width,
+                                                      height, format));
+    }
+
+    if (!spec.raw_output.empty()) {
+      raw_sink = AddStage("RawFileSink",
+                          AsyncFileSink::Make(spec.raw_output.c_str()));
+    }
+
+    if (spec.hash) {
+      hash_sink = AddStage("HashSink", new HashSink(spec.hash_output));
+    }
+
+    if (!spec.thumbnail.dir.empty()) {
+      if (NV12 == format || YUV420 == format) {
+        thumbnail_chain.push_back(AddConverter(width, height, format, RGB));
+      } else if (RGB != format) {
+        stringstream ss;
+        ss << "Thumbnails can't be made from "
+           << PixelFormatToString(format) << " frames";
+        throw invalid_argument(ss.str());
+      }
+
+      auto thumb_width = spec.thumbnail.width ? spec.thumbnail.width : width;
+      auto thumb_height =
+          spec.thumbnail.height ? spec.thumbnail.height : height;
+
+      if (thumb_width != width || thumb_height != height) {
+        thumbnail_chain.push_back(AddResizer(thumb_width, thumb_height, RGB));
+      }
+
+      thumbnail_chain.push_back(
+          AddStage("CudaDownloadSurface RGB",
+                   CudaDownloadSurface::Make(cuda.str, cuda.ctx, thumb_width,
+                                             thumb_height, RGB)));
+
+      thumbnail_sink =
+          AddStage("PpmSink", new PpmSink(spec.thumbnail.dir, thumb_width,
+                                          thumb_height));
+    }
+  }
+
+  void SetupEncoder(Pixel_Format format, uint32_t width, uint32_t height) {
+    if (!spec.encode) {
+      return;
+    }
+
+    auto options = spec.encoder_options;
+    if (options.end() == options.find("codec")) {
+      options["codec"] = "h264";
+    }
+
+    if (options.end() == options.find("s")) {
+      stringstream ss;
+      ss << width << "x" << height;
+      options["s"] = ss.str();
+    }
+
+    if (options.end() == options.find("fps")) {
+      stringstream ss;
+      ss << OutputFrameRate();
+      options["fps"] = ss.str();
+    }
+
+    NV_ENC_BUFFER_FORMAT enc_format = NV_ENC_BUFFER_FORMAT_UNDEFINED;
+    switch (format) {
+    case YUV420:
+      enc_converter = AddConverter(width, height, YUV420, NV12);
+      // Fall through;
+    case NV12:
+      enc_format = NV_ENC_BUFFER_FORMAT_NV12;
+      options["fmt"] = "NV12";
+      break;
+    case YUV444:
+      enc_format = NV_ENC_BUFFER_FORMAT_YUV444;
+      options["fmt"] = "YUV444";
+      break;
+    default:
+      stringstream ss;
+      ss << "Nvenc doesn't accept " << PixelFormatToString(format)
+         << " frames, convert them to nv12 or yuv420";
+      throw invalid_argument(ss.str());
+    }
+
+    NvEncoderClInterface cli_iface(options);
+    encoder = AddStage("NvencEncodeFrame",
+                       NvencEncodeFrame::Make(cuda.str, cuda.ctx, cli_iface,
+                                              enc_format, width, height,
+                                              spec.verbose));
+
+    if (IsElementaryStreamUrl(spec.output)) {
+      es_sink = AddStage("ElementaryStreamSink",
+                         AsyncFileSink::Make(spec.output.c_str()));
+      return;
+    }
+
+    MuxingParams params = {};
+    params.videoContext.width = width;
+    params.videoContext.height = height;
+    params.videoContext.frameRate = OutputFrameRate();
+    params.videoContext.timeBase = 1.0 / OutputFrameRate();
+    params.videoContext.streamIndex = 0U;
+    params.videoContext.codec = ("hevc" == options["codec"])
+                                    ? cudaVideoCodec_HEVC
+                                    : cudaVideoCodec_H264;
+    params.videoContext.format = NV12;
+    mux_params.reset(Buffer::MakeOwnMem(sizeof(params), &params));
+
+    // Network outputs are left to avio;
+    auto writer =
+        IsLocalPath(spec.output) ? AsyncWriter::GetDefault() : nullptr;
+    muxer = AddStage("MuxFrame", MuxFrame::Make(spec.output.c_str(), writer));
+  }
+
+  static Token *RunStage(Task *task, Token *input) {
+    task->SetInput(input, 0U);
+    if (TASK_EXEC_SUCCESS != task->Run()) {
+      stringstream ss;
+      ss << task->GetName() << " failed";
+      throw runtime_error(ss.str());
+    }
+    return task->GetOutput(0U);
+  }
+
+  // Returns packet data of demuxed packet or nullptr;
+  Buffer *DemuxedPacketData() {
+    auto mux_buffer = (Buffer *)demuxer->GetOutput(1U);
+    if (!mux_buffer) {
+      return nullptr;
+    }
+
+    if (!packet_data) {
+      packet_data.reset(Buffer::MakeOwnMem(sizeof(PacketData)));
+    }
+    *packet_data->GetDataAs<PacketData>() =
+        mux_buffer->GetDataAs<MuxingParams>()->videoContext.packetData;
+    return packet_data.get();
+  }
+
+  // Packet data of returned surface is saved to frame_data;
+  Surface *NextSurface() {
+    if (ffdec) {
+      if (TASK_EXEC_SUCCESS != ffdec->Run()) {
+        return nullptr;
+      }
+      frame_data = (Buffer *)ffdec->GetOutput(2U);
+      return (Surface *)RunStage(uploader, ffdec->GetOutput(0U));
+    }
+
+    while (true) {
+      Buffer *elementaryVideo = nullptr;
+      Buffer *pktData = nullptr;
+      if (!demuxer_eof) {
+        if (TASK_EXEC_SUCCESS != demuxer->Run()) {
+          demuxer_eof = true;
+        } else {
+          elementaryVideo = (Buffer *)demuxer->GetOutput(0U);
+          if (!elementaryVideo) {
+            continue;
+          }
+          pktData = DemuxedPacketData();
+
+          // Non-reference packets of frames to be dropped aren't decoded;
+          if (packet_frc) {
+            packet_frc->SetInput(pktData, 1U);
+            if (!RunStage(packet_frc, elementaryVideo)) {
+              continue;
+            }
+          }
+        }
+      }
+
+      // Empty input after end of stream flushes the decoder;
+      nvdec->SetInput(elementaryVideo, 0U);
+      nvdec->SetInput(pktData, 1U);
+      auto res = nvdec->Run();
+      auto surface = (Surface *)nvdec->GetOutput(0U);
+      if (surface) {
+        frame_data = (Buffer *)nvdec->GetOutput(1U);
+        return surface;
+      }
+
+      if (demuxer_eof) {
+        return nullptr;
+      }
+
+      if (TASK_EXEC_SUCCESS != res) {
+        throw runtime_error("NvdecDecodeFrame failed");
+      }
+    }
+  }
+
+  void WritePacket(Buffer *packet) {
+    if (!packet) {
+      return;
+    }
+
+    if (es_sink) {
+      RunStage(es_sink, packet);
+    } else {
+      // No B frames are produced by default, so pts equals dts;
+      auto params = mux_params->GetDataAs<MuxingParams>();
+      params->videoContext.packetData.pts = num_packets;
+      params->videoContext.packetData.dts = num_packets;
+      params->videoContext.packetData.duration = 1U;
+      muxer->SetInput(mux_params.get(), 1U);
+      RunStage(muxer, packet);
+    }
+    num_packets++;
+  }
+
+  void Encode(Surface *surface) {
+    if (enc_converter) {
+      surface = (Surface *)RunStage(enc_converter, surface);
+    }
+
+    encoder->ClearInputs();
+    WritePacket((Buffer *)RunStage(encoder, surface));
+  }
+
+  void FlushEncoder() {
+    while (true) {
+      /* Keep feeding encoder with null input until it returns nothing;
+       * Non-zero 2nd input signals sync encode;
+       */
+      encoder->ClearInputs();
+      encoder->SetInput((Token *)0xdeadbeef, 1U);
+      auto packet = (Buffer *)RunStage(encoder, nullptr);
+      if (!packet) {
+        break;
+      }
+      WritePacket(packet);
+    }
+  }
+
+  void ProcessFrame(Surface *surface) {
+    for (auto task : processing) {
+      surface = (Surface *)RunStage(task, surface);
+    }
+
+    if (downloader) {
+      auto frame = RunStage(downloader, surface);
+      if (raw_sink) {
+        RunStage(raw_sink, frame);
+      }
+      if (hash_sink) {
+        RunStage(hash_sink, frame);
+      }
+    }
+
+    if (thumbnail_sink && 0U == num_frames % spec.thumbnail.every) {
+      Token *thumbnail = surface;
+      for (auto task : thumbnail_chain) {
+        thumbnail = RunStage(task, thumbnail);
+      }
+      thumbnail_sink->SetFrameNumber(num_frames);
+      RunStage(thumbnail_sink, thumbnail);
+    }
+
+    if (encoder) {
+      Encode(surface);
+    }
+  }
+
+  uint64_t Run() {
+    auto then = steady_clock::now();
+
+    auto const FramesLeft = [this]() {
+      return !spec.max_frames || num_frames < spec.max_frames;
+    };
+
+    while (FramesLeft()) {
+      auto surface = NextSurface();
+      if (!surface) {
+        break;
+      }
+
+      uint32_t num_repeats = 1U;
+      if (frame_frc) {
+        frame_frc->SetInput(frame_data, 1U);
+        if (!RunStage(frame_frc, surface)) {
+          continue;
+        }
+        num_repeats = frame_frc->GetNumRepeats();
+      }
+
+      for (auto i = 0U; i < num_repeats && FramesLeft(); i++) {
+        ProcessFrame(surface);
+        num_frames++;
+      }
+    }
+
+    if (encoder) {
+      FlushEncoder();
+    }
+
+    elapsed_sec = duration<double>(steady_clock::now() - then).count();
+    return num_frames;
+  }
+
+  ~Pipeline_Impl() {
+    /* Tasks may hold CUDA memory, release them before context
+     * in reverse order of creation;
+     */
+    while (!stages.empty()) {
+      stages.pop_back();
+    }
+  }
+
+  static const uint32_t poolFrameSize = 4U;
+};
+} // namespace VPF
+
+Pipeline::Pipeline(const PipelineSpec &spec)
+    : pImpl(new Pipeline_Impl(spec)) {}
+
+Pipeline::~Pipeline() { delete pImpl; }
+
+uint64_t Pipeline::Run() { return pImpl->Run(); }
+
+void Pipeline::PrintStats(ostream &os) const {
+  auto const num_frames = pImpl->num_frames;
+  auto const elapsed = pImpl->elapsed_sec;
+
+  os << "Processed " << num_frames << " frames in " << fixed
+     << setprecision(3) << elapsed << " s";
+  if (elapsed > 0.0) {
+    os << ", " << setprecision(1) << num_frames / elapsed << " fps";
+  }
+  os << "\n";
+
+  vector<pair<string, Task *>> stages;
+  for (auto &stage : pImpl->stages) {
+    stages.emplace_back(stage.label, stage.task.get());
+  }
+  PrintStageTable(os, stages, elapsed);
+
+  if (pImpl->hash_sink) {
+    os << "Digest: " << hex << setw(16) << setfill('0')
+       << pImpl->hash_sink->Digest() << dec << setfill(' ') << "\n";
+  }
+}
+
+uint64_t VPF::RunChunkedTranscode(const PipelineSpec &spec, ostream &os) {
+  CudaResources cuda(spec.gpu_id);
+
+  ChunkedTranscodeParams params;
+  params.input = spec.input;
+  params.output = spec.output;
+  params.demux_options = spec.demux_options;
+  params.encoder_options = spec.encoder_options;
+  params.contexts.push_back(cuda.ctx);
+  params.num_workers = spec.workers;
+  params.min_chunk_frames = spec.chunk_frames;
+  params.checkpoint = spec.checkpoint;
+
+  if (spec.resize_width && spec.resize_height) {
+    stringstream ss;
+    ss << spec.resize_width << "x" << spec.resize_height;
+    params.encoder_options["s"] = ss.str();
+  }
+
+  unique_ptr<ChunkedTranscoder> transcoder(ChunkedTranscoder::Make(params));
+  auto const num_frames = transcoder->Run();
+
+  ChunkedTranscodeStats stats;
+  transcoder->GetStats(stats);
+  os << "Transcoded " << num_frames << " frames in " << stats.num_chunks
+     << " chunks with " << spec.workers << " workers, " << fixed
+     << setprecision(3) << stats.index_sec << " s indexing, "
+     << stats.transcode_sec << " s transcoding";
+  if (stats.num_resumed_chunks) {
+    os << ", " << stats.num_resumed_chunks << " chunks resumed";
+  }
+  if (stats.transcode_sec > 0.0) {
+    os << ", " << setprecision(1) << num_frames / stats.transcode_sec
+       << " fps";
+  }
+  os << "\n";
+
+  return num_frames;
+}
+
+uint64_t VPF::RunAbrLadder(const PipelineSpec &spec, ostream &os) {
+  CudaResources cuda(spec.gpu_id);
+
+  AbrLadderParams params;
+  params.input = spec.input;
+  params.demux_options = spec.demux_options;
+  params.encoder_options = spec.encoder_options;
+  params.renditions = spec.renditions;
+  params.ctx = cuda.ctx;
+  params.str = cuda.str;
+  params.gop = spec.ladder_gop;
+  params.segment_frames = spec.segment_frames;
+  params.cascade = spec.ladder_cascade;
+
+  unique_ptr<AbrLadder> ladder(AbrLadder::Make(params));
+  auto const num_frames = ladder->Run();
+
+  AbrLadderStats stats;
+  ladder->GetStats(stats);
+  os << "Decoded " << num_frames << " frames into " << spec.renditions.size()
+     << " renditions in " << fixed << setprecision(3) << stats.elapsed_sec
+     << " s";
+  if (stats.elapsed_sec > 0.0) {
+    os << ", " << setprecision(1) << num_frames / stats.elapsed_sec << " fps";
+  }
+  os << "\n";
+
+  for (size_t i = 0U; i < spec.renditions.size(); i++) {
+    auto &rendition = spec.renditions[i];
+    os << rendition.width << "x" << rendition.height << " -> "
+       << rendition.output << ": " << stats.num_packets[i] << " packets, "
+       << stats.num_segments[i] << " segments\n";
+  }
+
+  PrintStageTable(os, ladder->GetStages(), stats.elapsed_sec);
+  return num_frames;
+}
+
+uint64_t VPF::RunBatch(const PipelineSpec &spec, ostream &os) {
+  vector<JobSpec> jobs;
+  ParseJobList(spec.batch.jobs, jobs);
+  for (auto &job : jobs) {
+    try {
+      ValidateSpec(job.pipeline);
+    } catch (exception &e) {
+      throw invalid_argument("Job " + job.id + ": " + e.what());
+    }
+  }
+
+  auto const num_workers = spec.batch.workers ? spec.batch.workers
+                                              : spec.batch.capacity.cpu_threads;
+  JobScheduler scheduler(spec.batch.capacity, num_workers,
+                         spec.batch.journal);
+
+  for (auto &job : jobs) {
+    auto const *job_spec = &job;
+    auto job_func = [job_spec]() {
+      auto const &pipeline_spec = job_spec->pipeline;
+      stringstream summary;
+      if (!pipeline_spec.renditions.empty()) {
+        RunAbrLadder(pipeline_spec, summary);
+      } else if (pipeline_spec.workers > 1U ||
+                 !pipeline_spec.checkpoint.empty()) {
+        RunChunkedTranscode(pipeline_spec, summary);
+      } else {
+        Pipeline pipeline(pipeline_spec);
+        pipeline.Run();
+        pipeline.PrintStats(summary);
+      }
+      VPF_LOG(LOG_LEVEL_DEBUG, "vpf-cli")
+          << job_spec->id << "\n" << summary.str();
+    };
+
+    if (!scheduler.Submit(job.id, job.priority, job.cost, job_func)) {
+      VPF_LOG(LOG_LEVEL_INFO, "vpf-cli") << job.id << " is done already";
+    }
+  }
+  scheduler.WaitAll();
+
+  uint64_t num_failed = 0U;
+  for (auto &info : scheduler.GetJobs()) {
+    os << left << setw(8) << JobStateToString(info.state) << " " << info.id;
+    if (JobState::JOB_FAILED == info.state) {
+      os << ": " << info.error;
+      num_failed++;
+    }
+    os << "\n";
+  }
+  os << jobs.size() - num_failed << " of " << jobs.size() << " jobs done\n";
+
+  return num_failed;
+}
@@ -0,0 +1,847 @@
+/*
+ * Copyright 2020 NVIDIA Corporation
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "PipelineSpec.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+using namespace std;
+using namespace VPF;
+
+namespace {
+
+/* Minimal JSON DOM; Spec files are tiny so no attention is paid to
+ * performance here;
+ */
+struct JsonValue {
+  enum Type { JSON_NULL, JSON_BOOL, JSON_NUMBER, JSON_STRING, JSON_ARRAY,
+              JSON_OBJECT };
+
+  Type type = JSON_NULL;
+  bool boolean = false;
+  double number = 0.0;
+  string str;
+  vector<JsonValue> array;
+  vector<pair<string, JsonValue>> object;
+
+  string AsString(const string &key) const {
+    switch (type) {
+    case JSON_STRING:
+      return str;
+    case JSON_NUMBER: {
+      // Integers such as bitrate must not end up in exponential notation;
+      stringstream ss;
+      if (number == (double)(int64_t)number) {
+        ss << (int64_t)number;
+      } else {
+        ss << number;
+      }
+      return ss.str();
+    }
+    case JSON_BOOL:
+      return boolean ? "true" : "false";
+    default:
+      throw invalid_argument("JSON value of \"" + key + "\" must be scalar");
+    }
+  }
+
+  double AsDouble(const string &key) const {
+    if (JSON_NUMBER != type) {
+      throw invalid_argument("JSON value of \"" + key + "\" must be number");
+    }
+    return number;
+  }
+
+  uint64_t AsUnsigned(const string &key) const {
+    if (JSON_NUMBER != type || number < 0.0) {
+      throw invalid_argument("JSON value of \"" + key +
+                             "\" must be non-negative number");
+    }
+    return (uint64_t)number;
+  }
+
+  bool AsBool(const string &key) const {
+    if (JSON_BOOL != type) {
+      throw invalid_argument("JSON value of \"" + key + "\" must be boolean");
+    }
+    return boolean;
+  }
+};
+
+class JsonParser {
+public:
+  explicit JsonParser(const string &text) : text(text) {}
+
+  JsonValue Parse() {
+    auto value = ParseValue();
+    SkipSpaces();
+    if (pos != text.size()) {
+      Fail("trailing characters");
+    }
+    return value;
+  }
+
+private:
+  const string &text;
+  size_t pos = 0U;
+
+  void Fail(const string &what) const {
+    stringstream ss;
+    ss << "JSON parse error at offset " << pos << ": " << what;
+    throw invalid_argument(ss.str());
+  }
+
+  void SkipSpaces() {
+    while (pos < text.size() && isspace((unsigned char)text[pos])) {
+      pos++;
+    }
+  }
+
+  char Peek() {
+    SkipSpaces();
+    if (pos >= text.size()) {
+      Fail("unexpected end of input");
+    }
+    return text[pos];
+  }
+
+  void Expect(char c) {
+    if (Peek() != c) {
+      Fail(string("expected '") + c + "'");
+    }
+    pos++;
+  }
+
+  bool Consume(const char *literal) {
+    auto len = strlen(literal);
+    if (text.compare(pos, len, literal) == 0) {
+      pos += len;
+      return true;
+    }
+    return false;
+  }
+
+  JsonValue ParseValue() {
+    JsonValue value;
+    auto c = Peek();
+
+    if ('{' == c) {
+      value.type = JsonValue::JSON_OBJECT;
+      pos++;
+      if (Peek() == '}') {
+        pos++;
+        return value;
+      }
+      do {
+        auto key = ParseString();
+        Expect(':');
+        value.object.emplace_back(key, ParseValue());
+      } while (Peek() == ',' && ++pos);
+      Expect('}');
+    } else if ('[' == c) {
+      value.type = JsonValue::JSON_ARRAY;
+      pos++;
+      if (Peek() == ']') {
+        pos++;
+        return value;
+      }
+      do {
+        value.array.push_back(ParseValue());
+      } while (Peek() == ',' && ++pos);
+      Expect(']');
+    } else if ('"' == c) {
+      value.type = JsonValue::JSON_STRING;
+      value.str = ParseString();
+    } else if (Consume("true")) {
+      value.type = JsonValue::JSON_BOOL;
+      value.boolean = true;
+    } else if (Consume("false")) {
+      value.type = JsonValue::JSON_BOOL;
+      value.boolean = false;
+    } else if (Consume("null")) {
+      value.type = JsonValue::JSON_NULL;
+    } else {
+      const char *begin = text.c_str() + pos;
+      char *end = nullptr;
+      value.type = JsonValue::JSON_NUMBER;
+      value.number = strtod(begin, &end);
+      if (end == begin) {
+        Fail("unexpected character");
+      }
+      pos += end - begin;
+    }
+
+    return value;
+  }
+
+  string ParseString() {
+    Expect('"');
+    string result;
+    while (pos < text.size() && text[pos] != '"') {
+      auto c = text[pos++];
+      if ('\\' == c) {
+        if (pos >= text.size()) {
+          Fail("unterminated escape sequence");
+        }
+        c = text[pos++];
+        switch (c) {
+        case 'n':
+          c = '\n';
+          break;
+        case 't':
+          c = '\t';
+          break;
+        case 'r':
+          c = '\r';
+          break;
+        case 'b':
+          c = '\b';
+          break;
+        case 'f':
+          c = '\f';
+          break;
+        case 'u':
+          // Spec values are paths and codec options, ASCII is enough;
+          Fail("\\u escapes are not supported");
+          break;
+        default:
+          // '"', '\\' and '/' map to themselves;
+          break;
+        }
+      }
+      result.push_back(c);
+    }
+    Expect('"');
+    return result;
+  }
+};
+
+void ParseResolution(const string &res_string, uint32_t &width,
+                     uint32_t &height) {
+  auto x_pos = res_string.find('x');
+  if (string::npos == x_pos) {
+    throw invalid_argument("Invalid resolution: " + res_string);
+  }
+
+  width = strtoul(res_string.substr(0, x_pos).c_str(), nullptr, 10);
+  height = strtoul(res_string.substr(x_pos + 1).c_str(), nullptr, 10);
+  if (!width || !height) {
+    throw invalid_argument("Invalid resolution: " + res_string);
+  }
+}
+
+void ParseKeyValue(const string &pair_string,
+                   map<string, string> &key_values) {
+  auto eq_pos = pair_string.find('=');
+  if (string::npos == eq_pos || 0U == eq_pos) {
+    throw invalid_argument("Expected key=value, got " + pair_string);
+  }
+  key_values[pair_string.substr(0, eq_pos)] = pair_string.substr(eq_pos + 1);
+}
+
+void ParseFormatList(const string &list, vector<Pixel_Format> &formats) {
+  stringstream ss(list);
+  string name;
+  while (getline(ss, name, ',')) {
+    formats.push_back(PixelFormatFromString(name));
+  }
+}
+
+DecoderType DecoderTypeFromString(const string &name) {
+  if ("hw" == name || "nvdec" == name) {
+    return DecoderType::DECODER_HW;
+  } else if ("sw" == name || "ffmpeg" == name) {
+    return DecoderType::DECODER_SW;
+  }
+  throw invalid_argument("Unknown decoder type: " + name);
+}
+
+FrameRateMode FrameRateModeFromString(const string &name) {
+  if ("drop" == name) {
+    return FRC_DROP;
+  } else if ("nearest" == name) {
+    return FRC_NEAREST;
+  } else if ("duplicate" == name) {
+    return FRC_DUPLICATE;
+  }
+  throw invalid_argument("Unknown frame rate mode: " + name);
+}
+
+double ParseFrameRate(const string &fps_string) {
+  char *end = nullptr;
+  auto fps = strtod(fps_string.c_str(), &end);
+  // Fractions such as 30000/1001 are accepted as well;
+  if (end != fps_string.c_str() && '/' == *end) {
+    auto const *den_string = end + 1;
+    auto const den = strtod(den_string, &end);
+    fps = (end != den_string && den > 0.0) ? fps / den : -1.0;
+  }
+
+  if (end == fps_string.c_str() || *end || fps <= 0.0) {
+    throw invalid_argument("Invalid frame rate: " + fps_string);
+  }
+  return fps;
+}
+
+const JsonValue &ExpectObject(const JsonValue &value, const string &key) {
+  if (JsonValue::JSON_OBJECT != value.type) {
+    throw invalid_argument("JSON value of \"" + key + "\" must be object");
+  }
+  return value;
+}
+void ParseRendition(const string &rendition_string,
+                    vector<AbrRendition> &renditions) {
+  auto eq_pos = rendition_string.find('=');
+  if (string::npos == eq_pos) {
+    throw invalid_argument("Expected WxH=OUTPUT, got " + rendition_string);
+  }
+
+  AbrRendition rendition;
+  ParseResolution(rendition_string.substr(0, eq_pos), rendition.width,
+                  rendition.height);
+  rendition.output = rendition_string.substr(eq_pos + 1);
+  renditions.push_back(rendition);
+}
+
+void ParseLadder(const JsonValue &ladder, PipelineSpec &spec) {
+  for (auto &entry : ExpectObject(ladder, "ladder").object) {
+    auto &key = entry.first;
+    auto &value = entry.second;
+
+    if ("gop" == key) {
+      spec.ladder_gop = value.AsUnsigned(key);
+    } else if ("segment_frames" == key) {
+      spec.segment_frames = value.AsUnsigned(key);
+    } else if ("cascade" == key) {
+      spec.ladder_cascade = value.AsBool(key);
+    } else if ("renditions" == key) {
+      if (JsonValue::JSON_ARRAY != value.type) {
+        throw invalid_argument("JSON value of \"renditions\" must be array");
+      }
+
+      for (auto &item : value.array) {
+        AbrRendition rendition;
+        for (auto &option : ExpectObject(item, key).object) {
+          if ("size" == option.first) {
+            ParseResolution(option.second.AsString(option.first),
+                            rendition.width, rendition.height);
+          } else if ("output" == option.first) {
+            rendition.output = option.second.AsString(option.first);
+          } else if ("playlist" == option.first) {
+            rendition.playlist = option.second.AsString(option.first);
+          } else if ("encoder" == option.first) {
+            for (auto &enc_option :
+                 ExpectObject(option.second, option.first).object) {
+              rendition.encoder_options[enc_option.first] =
+                  enc_option.second.AsString(enc_option.first);
+            }
+          } else {
+            throw invalid_argument("Unknown rendition option " +
+                                   option.first);
+          }
+        }
+        spec.renditions.push_back(rendition);
+      }
+    } else {
+      throw invalid_argument("Unknown ladder option " + key);
+    }
+  }
+}
+} // namespace
+
+Pixel_Format VPF::PixelFormatFromString(const string &name) {
+  string lower(name);
+  transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+
+  static const map<string, Pixel_Format> formats = {
+      {"y", Y},           {"rgb", RGB},
+      {"nv12", NV12},     {"yuv420", YUV420},
+      {"rgb_planar", RGB_PLANAR},
+      {"bgr", BGR},       {"ycbcr", YCBCR},
+      {"yuv444", YUV444}};
+
+  auto it = formats.find(lower);
+  if (formats.end() == it) {
+    throw invalid_argument("Unknown pixel format: " + name);
+  }
+  return it->second;
+}
+
+const char *VPF::PixelFormatToString(Pixel_Format format) {
+  switch (format) {
+  case Y:
+    return "y";
+  case RGB:
+    return "rgb";
+  case NV12:
+    return "nv12";
+  case YUV420:
+    return "yuv420";
+  case RGB_PLANAR:
+    return "rgb_planar";
+  case BGR:
+    return "bgr";
+  case YCBCR:
+    return "ycbcr";
+  case YUV444:
+    return "yuv444";
+  default:
+    return "undefined";
+  }
+}
+
+namespace {
+JsonValue ReadJsonFile(const string &path) {
+  ifstream file(path);
+  if (!file) {
+    throw invalid_argument("Can't open spec file " + path);
+  }
+  string text((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+  return JsonParser(text).Parse();
+}
+
+void ParseSpecObject(const JsonValue &root, PipelineSpec &spec) {
+  for (auto &entry : ExpectObject(root, "root").object) {
+    auto &key = entry.first;
+    auto &value = entry.second;
+
+    if ("input" == key) {
+      spec.input = value.AsString(key);
+    } else if ("demux_options" == key) {
+      for (auto &option : ExpectObject(value, key).object) {
+        spec.demux_options[option.first] = option.second.AsString(key);
+      }
+    } else if ("decoder" == key) {
+      spec.decoder = DecoderTypeFromString(value.AsString(key));
+    } else if ("gpu" == key) {
+      spec.gpu_id = (int)value.AsUnsigned(key);
+    } else if ("fps" == key) {
+      spec.fps = (JsonValue::JSON_NUMBER == value.type)
+                     ? value.AsDouble(key)
+                     : ParseFrameRate(value.AsString(key));
+    } else if ("fps_mode" == key) {
+      spec.fps_mode = FrameRateModeFromString(value.AsString(key));
+    } else if ("convert" == key) {
+      if (JsonValue::JSON_ARRAY == value.type) {
+        for (auto &format : value.array) {
+          spec.convert.push_back(PixelFormatFromString(format.AsString(key)));
+        }
+      } else {
+        ParseFormatList(value.AsString(key), spec.convert);
+      }
+    } else if ("resize" == key) {
+      ParseResolution(value.AsString(key), spec.resize_width,
+                      spec.resize_height);
+    } else if ("encoder" == key) {
+      spec.encode = true;
+      for (auto &option : ExpectObject(value, key).object) {
+        spec.encoder_options[option.first] = option.second.AsString(key);
+      }
+    } else if ("output" == key) {
+      spec.output = value.AsString(key);
+    } else if ("raw" == key) {
+      spec.raw_output = value.AsString(key);
+    } else if ("hash" == key) {
+      if (JsonValue::JSON_BOOL == value.type) {
+        spec.hash = value.boolean;
+      } else {
+        spec.hash = true;
+        spec.hash_output = value.AsString(key);
+      }
+    } else if ("thumbnail" == key) {
+      for (auto &option : ExpectObject(value, key).object) {
+        if ("dir" == option.first) {
+          spec.thumbnail.dir = option.second.AsString(option.first);
+        } else if ("every" == option.first) {
+          spec.thumbnail.every = option.second.AsUnsigned(option.first);
+        } else if ("size" == option.first) {
+          ParseResolution(option.second.AsString(option.first),
+                          spec.thumbnail.width, spec.thumbnail.height);
+        } else {
+          throw invalid_argument("Unknown thumbnail option " + option.first);
+        }
+      }
+    } else if ("frames" == key) {
+      spec.max_frames = value.AsUnsigned(key);
+    } else if ("ladder" == key) {
+      ParseLadder(value, spec);
+    } else if ("workers" == key) {
+      spec.workers = value.AsUnsigned(key);
+    } else if ("chunk_frames" == key) {
+      spec.chunk_frames = value.AsUnsigned(key);
+    } else if ("checkpoint" == key) {
+      spec.checkpoint = value.AsString(key);
+    } else if ("perf_counters" == key) {
+      spec.perf_counters = value.AsBool(key);
+    } else if ("verbose" == key) {
+      spec.verbose = value.AsBool(key);
+    } else {
+      throw invalid_argument("Unknown spec key \"" + key + "\"");
+    }
+  }
+}
+
+/* Accepts plain number of bytes or number with K, M, G, T suffix;
+ */
+uint64_t ParseSize(const string &size_string) {
+  char *end = nullptr;
+  auto size = strtod(size_string.c_str(), &end);
+  if (end == size_string.c_str() || size < 0.0) {
+    throw invalid_argument("Invalid size: " + size_string);
+  }
+
+  switch (toupper(*end)) {
+  case 'T':
+    size *= 1024.0;
+    // Fall through;
+  case 'G':
+    size *= 1024.0;
+    // Fall through;
+  case 'M':
+    size *= 1024.0;
+    // Fall through;
+  case 'K':
+    size *= 1024.0;
+    end++;
+  default:
+    break;
+  }
+
+  if (*end) {
+    throw invalid_argument("Invalid size: " + size_string);
+  }
+  return (uint64_t)size;
+}
+
+void ParseJobCost(const JsonValue &value, JobResources &cost) {
+  for (auto &entry : ExpectObject(value, "cost").object) {
+    auto &key = entry.first;
+    if ("threads" == key) {
+      cost.cpu_threads = entry.second.AsUnsigned(key);
+    } else if ("memory" == key) {
+      cost.memory_bytes = ParseSize(entry.second.AsString(key));
+    } else if ("decoders" == key) {
+      cost.decoder_sessions = entry.second.AsUnsigned(key);
+    } else if ("encoders" == key) {
+      cost.encoder_sessions = entry.second.AsUnsigned(key);
+    } else {
+      throw invalid_argument("Unknown job cost " + key);
+    }
+  }
+}
+} // namespace
+
+BatchSpec::BatchSpec() {
+  capacity.cpu_threads = max(1U, thread::hardware_concurrency());
+  capacity.memory_bytes = numeric_limits<uint64_t>::max();
+  capacity.decoder_sessions = 32U;
+  capacity.encoder_sessions = 3U;
+}
+
+void VPF::ParseJsonSpec(const string &path, PipelineSpec &spec) {
+  ParseSpecObject(ReadJsonFile(path), spec);
+}
+
+JobResources VPF::EstimateJobCost(const PipelineSpec &spec) {
+  JobResources cost;
+  cost.cpu_threads = 1U;
+
+  auto const num_encoders =
+      spec.renditions.empty() ? (spec.encode ? spec.workers : 0U)
+                              : (uint32_t)spec.renditions.size();
+  cost.encoder_sessions = num_encoders;
+
+  if (DecoderType::DECODER_HW == spec.decoder) {
+    cost.decoder_sessions = spec.workers;
+  } else {
+    // FFmpeg decoder uses frame threads;
+    cost.cpu_threads = 2U;
+  }
+
+  // Chunked transcoding keeps every worker busy on CPU side as well;
+  cost.cpu_threads = max(cost.cpu_threads, spec.workers);
+  return cost;
+}
+
+void VPF::ParseJobList(const string &path, vector<JobSpec> &jobs) {
+  auto root = ReadJsonFile(path);
+  if (JsonValue::JSON_ARRAY != root.type) {
+    throw invalid_argument("Job list " + path + " must be JSON array");
+  }
+
+  for (auto &item : root.array) {
+    JobSpec job;
+    JsonValue pipeline;
+    pipeline.type = JsonValue::JSON_OBJECT;
+    bool has_cost = false;
+
+    for (auto &entry : ExpectObject(item, "job").object) {
+      if ("id" == entry.first) {
+        job.id = entry.second.AsString(entry.first);
+      } else if ("priority" == entry.first) {
+        job.priority = (int)entry.second.number;
+      } else if ("cost" == entry.first) {
+        ParseJobCost(entry.second, job.cost);
+        has_cost = true;
+      } else {
+        pipeline.object.push_back(entry);
+      }
+    }
+
+    ParseSpecObject(pipeline, job.pipeline);
+    if (job.id.empty()) {
+      job.id = job.pipeline.input;
+    }
+    if (!has_cost) {
+      job.cost = EstimateJobCost(job.pipeline);
+    }
+    jobs.push_back(job);
+  }
+}
+
+void VPF::ParseCommandLine(int argc, char **argv, PipelineSpec &spec) {
+  vector<string> args(argv + 1, argv + argc);
+
+  // JSON spec goes first so command line can override it;
+  for (size_t i = 0U; i + 1 < args.size(); i++) {
+    if ("--spec" == args[i]) {
+      ParseJsonSpec(args[i + 1], spec);
+    }
+  }
+
+  for (size_t i = 0U; i < args.size(); i++) {
+    auto &arg = args[i];
+
+    auto NextArg = [&]() -> const string & {
+      if (i + 1 >= args.size()) {
+        throw invalid_argument("Option " + arg + " requires an argument");
+      }
+      return args[++i];
+    };
+
+    if ("--spec" == arg) {
+      NextArg();
+    } else if ("-i" == arg || "--input" == arg) {
+      spec.input = NextArg();
+    } else if ("--demux-opt" == arg) {
+      ParseKeyValue(NextArg(), spec.demux_options);
+    } else if ("--decoder" == arg) {
+      spec.decoder = DecoderTypeFromString(NextArg());
+    } else if ("--gpu" == arg) {
+      spec.gpu_id = atoi(NextArg().c_str());
+    } else if ("--fps" == arg) {
+      spec.fps = ParseFrameRate(NextArg());
+    } else if ("--fps-mode" == arg) {
+      spec.fps_mode = FrameRateModeFromString(NextArg());
+    } else if ("--convert" == arg) {
+      ParseFormatList(NextArg(), spec.convert);
+    } else if ("--resize" == arg) {
+      ParseResolution(NextArg(), spec.resize_width, spec.resize_height);
+    } else if ("--encode" == arg) {
+      spec.encode = true;
+    } else if ("--enc-opt" == arg) {
+      spec.encode = true;
+      ParseKeyValue(NextArg(), spec.encoder_options);
+    } else if ("-o" == arg || "--output" == arg) {
+      spec.output = NextArg();
+    } else if ("--raw" == arg) {
+      spec.raw_output = NextArg();
+    } else if ("--hash" == arg) {
+      spec.hash = true;
+    } else if ("--hash-output" == arg) {
+      spec.hash = true;
+      spec.hash_output = NextArg();
+    } else if ("--thumbnail" == arg) {
+      spec.thumbnail.dir = NextArg();
+    } else if ("--thumbnail-every" == arg) {
+      spec.thumbnail.every = strtoul(NextArg().c_str(), nullptr, 10);
+    } else if ("--thumbnail-size" == arg) {
+      ParseResolution(NextArg(), spec.thumbnail.width, spec.thumbnail.height);
+    } else if ("--frames" == arg) {
+      spec.max_frames = strtoull(NextArg().c_str(), nullptr, 10);
+    } else if ("--rendition" == arg) {
+      ParseRendition(NextArg(), spec.renditions);
+    } else if ("--gop" == arg) {
+      spec.ladder_gop = strtoul(NextArg().c_str(), nullptr, 10);
+    } else if ("--segment-frames" == arg) {
+      spec.segment_frames = strtoul(NextArg().c_str(), nullptr, 10);
+    } else if ("--batch" == arg) {
+      spec.batch.jobs = NextArg();
+    } else if ("--journal" == arg) {
+      spec.batch.journal = NextArg();
+    } else if ("--batch-workers" == arg) {
+      spec.batch.workers = strtoul(NextArg().c_str(), nullptr, 10);
+    } else if ("--max-threads" == arg) {
+      spec.batch.capacity.cpu_threads = strtoul(NextArg().c_str(), nullptr, 10);
+    } else if ("--max-memory" == arg) {
+      spec.batch.capacity.memory_bytes = ParseSize(NextArg());
+    } else if ("--nvdec-sessions" == arg) {
+      spec.batch.capacity.decoder_sessions =
+          strtoul(NextArg().c_str(), nullptr, 10);
+    } else if ("--nvenc-sessions" == arg) {
+      spec.batch.capacity.encoder_sessions =
+          strtoul(NextArg().c_str(), nullptr, 10);
+    } else if ("--workers" == arg) {
+      spec.workers = strtoul(NextArg().c_str(), nullptr, 10);
+    } else if ("--chunk-frames" == arg) {
+      spec.chunk_frames = strtoul(NextArg().c_str(), nullptr, 10);
+    } else if ("--checkpoint" == arg) {
+      spec.checkpoint = NextArg();
+    } else if ("--perf-counters" == arg) {
+      spec.perf_counters = true;
+    } else if ("-v" == arg || "--verbose" == arg) {
+      spec.verbose = true;
+    } else {
+      throw invalid_argument("Unknown option " + arg);
+    }
+  }
+}
+
+void VPF::ValidateSpec(const PipelineSpec &spec) {
+  if (!spec.batch.jobs.empty()) {
+    if (!spec.input.empty()) {
+      throw invalid_argument("Batch mode takes inputs from job list only");
+    }
+
+    if (!spec.batch.capacity.cpu_threads) {
+      throw invalid_argument("Batch CPU threads limit must be positive");
+    }
+    return;
+  }
+
+  if (spec.input.empty()) {
+    throw invalid_argument("No input given");
+  }
+
+  if (!spec.renditions.empty()) {
+    if (DecoderType::DECODER_HW != spec.decoder || spec.workers > 1U) {
+      throw invalid_argument("ABR ladder needs hw decoder and single worker");
+    }
+
+    if (!spec.output.empty() || !spec.convert.empty() ||
+        spec.resize_width || !spec.raw_output.empty() || spec.hash ||
+        !spec.thumbnail.dir.empty() || spec.max_frames || spec.fps > 0.0) {
+      throw invalid_argument("ABR ladder has per-rendition outputs only, "
+                             "no conversions, resize, sinks, frame rate or "
+                             "frames limit");
+    }
+
+    for (auto &rendition : spec.renditions) {
+      if (rendition.output.empty()) {
+        throw invalid_argument("Rendition has no output");
+      }
+    }
+    return;
+  }
+
+  if (spec.encode && spec.output.empty()) {
+    throw invalid_argument("Encoding requested but no output given");
+  }
+
+  if (!spec.encode && !spec.output.empty()) {
+    throw invalid_argument("Output given but encoding isn't enabled, "
+                           "use --encode or --enc-opt");
+  }
+
+  if (!spec.thumbnail.dir.empty() && !spec.thumbnail.every) {
+    throw invalid_argument("Thumbnail interval must be positive");
+  }
+
+  if (spec.fps < 0.0) {
+    throw invalid_argument("Frame rate must be positive");
+  }
+
+  if (spec.gpu_id < 0) {
+    throw invalid_argument("GPU ordinal must be non-negative");
+  }
+
+  if (!spec.workers) {
+    throw invalid_argument("Number of workers must be positive");
+  }
+
+  if (spec.workers > 1U || !spec.checkpoint.empty()) {
+    if (!spec.encode || DecoderType::DECODER_HW != spec.decoder) {
+      throw invalid_argument("Multiple workers and checkpoint need --encode "
+                             "and hw decoder");
+    }
+
+    if (!spec.convert.empty() || !spec.raw_output.empty() || spec.hash ||
+        !spec.thumbnail.dir.empty() || spec.max_frames || spec.fps > 0.0) {
+      throw invalid_argument("Chunked transcoding supports resize only, "
+                             "no conversions, sinks, frame rate or frames "
+                             "limit");
+    }
+  }
+}
+
+const char *VPF::Usage() {
+  return "Usage: vpf-cli [options]\n"
+         "  --spec FILE              read pipeline spec from JSON file,\n"
+         "                           other options override it\n"
+         "  -i, --input URL          input file or stream\n"
+         "  --demux-opt KEY=VALUE    FFmpeg demuxer option, repeatable\n"
+         "  --decoder hw|sw          Nvdec or FFmpeg decoder, hw by default\n"
+         "  --gpu N                  GPU ordinal, 0 by default\n"
+         "  --fps N[/D]              output frame rate, frames are chosen\n"
+         "                           by timestamps\n"
+         "  --fps-mode MODE          drop, nearest (default) or duplicate\n"
+         "  --convert FMT[,FMT...]   chain of color conversions\n"
+         "  --resize WxH             resize processed frames\n"
+         "  --encode                 encode processed frames with Nvenc\n"
+         "  --enc-opt KEY=VALUE      Nvenc option (codec, preset, bitrate,\n"
+         "                           etc.), repeatable, implies --encode\n"
+         "  -o, --output URL         encoded output; .h264 / .hevc files\n"
+         "                           are written as elementary stream,\n"
+         "                           other names are muxed by FFmpeg\n"
+         "  --raw FILE               dump processed frames to raw file\n"
+         "  --hash                   print digest of processed frames\n"
+         "  --hash-output FILE       also save per-frame digests to file\n"
+         "  --thumbnail DIR          save RGB thumbnails as PPM images\n"
+         "  --thumbnail-every N      thumbnail interval in frames\n"
+         "  --thumbnail-size WxH     thumbnail size\n"
+         "  --frames N               stop after N frames\n"
+         "  --rendition WxH=OUTPUT   ABR ladder rendition, repeatable;\n"
+         "                           input is decoded once and encoded\n"
+         "                           into every rendition\n"
+         "  --gop N                  ABR ladder keyframe interval\n"
+         "  --segment-frames N       split renditions into segments,\n"
+         "                           OUTPUT must have %05d-like format\n"
+         "  --batch FILE             run jobs from JSON array of specs,\n"
+         "                           each may have id, priority and cost\n"
+         "                           {threads, memory, decoders, encoders}\n"
+         "  --journal FILE           batch state file, done jobs are\n"
+         "                           skipped upon restart\n"
+         "  --batch-workers N        concurrent jobs limit\n"
+         "  --max-threads N          batch CPU threads budget\n"
+         "  --max-memory SIZE        batch memory budget, e. g. 16G\n"
+         "  --nvdec-sessions N       batch Nvdec sessions budget\n"
+         "  --nvenc-sessions N       batch Nvenc sessions budget\n"
+         "  --workers N              transcode N keyframe-aligned chunks\n"
+         "                           concurrently, 1 by default\n"
+         "  --chunk-frames N         minimal chunk length, 250 by default\n"
+         "  --checkpoint FILE        save progress at chunk boundaries,\n"
+         "                           resume from FILE if it exists\n"
+         "  --perf-counters          collect HW performance counters\n"
+         "  -v, --verbose            verbose output\n"
+         "Pixel formats: y, rgb, nv12, yuv420, rgb_planar, bgr, ycbcr, "
+         "yuv444\n";
+}
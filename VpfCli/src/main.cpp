@@ -0,0 +1,75 @@
+/*
+ * Copyright 2020 NVIDIA Corporation
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Logger.hpp"
+#include "Pipeline.hpp"
+#include "PipelineSpec.hpp"
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+using namespace std;
+using namespace VPF;
+
+int main(int argc, char **argv) {
+  for (int i = 1; i < argc; i++) {
+    if (0 == strcmp(argv[i], "-h") || 0 == strcmp(argv[i], "--help")) {
+      cout << Usage();
+      return 0;
+    }
+  }
+
+  PipelineSpec spec;
+  try {
+    ParseCommandLine(argc, argv, spec);
+    ValidateSpec(spec);
+  } catch (exception &e) {
+    cerr << e.what() << "\n\n" << Usage();
+    return 1;
+  }
+
+  if (spec.verbose) {
+    Logger::Instance().SetLevel(LogLevel::LOG_LEVEL_DEBUG);
+  }
+
+  // Stage table is printed for every run;
+  EnableTaskTiming(true);
+  if (spec.perf_counters) {
+    EnablePerfCounters(true);
+    if (!PerfCountersAvailable()) {
+      cerr << "HW performance counters aren't available, "
+           << "only wall time will be collected" << endl;
+    }
+  }
+
+  int ret = 0;
+  try {
+    if (!spec.batch.jobs.empty()) {
+      ret = RunBatch(spec, cout) ? 1 : 0;
+    } else if (!spec.renditions.empty()) {
+      RunAbrLadder(spec, cout);
+    } else if (spec.workers > 1U || !spec.checkpoint.empty()) {
+      RunChunkedTranscode(spec, cout);
+    } else {
+      Pipeline pipeline(spec);
+      pipeline.Run();
+      pipeline.PrintStats(cout);
+    }
+  } catch (exception &e) {
+    cerr << "Pipeline failed: " << e.what() << endl;
+    ret = 1;
+  }
+
+  Logger::Instance().Flush();
+  return ret;
+}